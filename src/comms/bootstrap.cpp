@@ -0,0 +1,306 @@
+#include "bootstrap.h"
+#include <asio/buffers_iterator.hpp>
+#include <asio/read_until.hpp>
+#include <fstream>
+using asio::ip::tcp;
+
+namespace {
+// Unmeasured endpoints sort after every measured one.
+auto rtt_rank(const ServerEndpoint &server) -> std::chrono::microseconds {
+    return server.rtt.count() == 0 ? std::chrono::microseconds::max()
+                                   : server.rtt;
+}
+
+void sort_by_rtt(std::vector<ServerEndpoint> &endpoints) {
+    std::ranges::stable_sort(endpoints, {}, rtt_rank);
+}
+} // namespace
+
+auto load_server_cache(const std::filesystem::path &path)
+    -> std::vector<ServerEndpoint> {
+    std::vector<ServerEndpoint> endpoints;
+    std::ifstream input(path);
+    std::string host;
+    std::string address;
+    uint16_t port = 0;
+    int64_t rtt_us = 0;
+    while (input >> host >> address >> port >> rtt_us) {
+        asio::error_code ecode;
+        auto ip_addr = asio::ip::make_address(address, ecode);
+        if (ecode || rtt_us < 0) {
+            continue;
+        }
+        endpoints.push_back({.host = host,
+                             .endpoint = tcp::endpoint(ip_addr, port),
+                             .rtt = std::chrono::microseconds(rtt_us)});
+    }
+    sort_by_rtt(endpoints);
+    return endpoints;
+}
+
+void save_server_cache(const std::filesystem::path &path,
+                       std::vector<ServerEndpoint> endpoints) {
+    sort_by_rtt(endpoints);
+
+    std::filesystem::path temp_path = path;
+    temp_path += ".tmp";
+    {
+        std::ofstream output(temp_path, std::ios::trunc);
+        for (const auto &server : endpoints) {
+            output << server.host << ' '
+                   << server.endpoint.address().to_string() << ' '
+                   << server.endpoint.port() << ' ' << server.rtt.count()
+                   << '\n';
+        }
+        if (!output) {
+            spdlog::warn("Failed to write server cache: {}",
+                         temp_path.string());
+            return;
+        }
+    }
+
+    std::error_code ecode;
+    std::filesystem::rename(temp_path, path, ecode);
+    if (ecode) {
+        spdlog::warn("Failed to replace server cache: {}", ecode.message());
+    }
+}
+
+ServerBootstrap::Attempt::Attempt(const IoStrand &strand,
+                                  ServerEndpoint server)
+    : server(std::move(server)), socket(strand), deadline(strand),
+      started(std::chrono::steady_clock::now()) {}
+
+auto ServerBootstrap::create(asio::io_context &io_context,
+                             BootstrapOptions options)
+    -> std::shared_ptr<ServerBootstrap> {
+    return create(asio::make_strand(io_context), std::move(options));
+}
+
+auto ServerBootstrap::create(IoStrand strand, BootstrapOptions options)
+    -> std::shared_ptr<ServerBootstrap> {
+    return std::shared_ptr<ServerBootstrap>(
+        new ServerBootstrap(std::move(strand), std::move(options)));
+}
+
+ServerBootstrap::ServerBootstrap(IoStrand strand, BootstrapOptions options)
+    : strand_(std::move(strand)), options_(std::move(options)),
+      stagger_(strand_),
+      bootstrap_logger_(
+          spdlog::default_logger()->clone("\033[34mbootstrap\033[0m")) {}
+
+void ServerBootstrap::start(Handler on_done) {
+    on_done_ = std::move(on_done);
+
+    if (!options_.cache_path.empty()) {
+        for (auto &server : load_server_cache(options_.cache_path)) {
+            bool configured = std::ranges::any_of(
+                options_.servers,
+                [&server](const ServerAddress &address) -> bool {
+                    return address.host == server.host;
+                });
+            if (configured) {
+                known_.push_back(std::move(server));
+            }
+        }
+    }
+    candidates_.assign(known_.begin(), known_.end());
+
+    std::vector<ServerAddress> uncached;
+    for (const auto &address : options_.servers) {
+        bool cached = std::ranges::any_of(
+            known_, [&address](const ServerEndpoint &server) -> bool {
+                return server.host == address.host;
+            });
+        if (!cached) {
+            uncached.push_back(address);
+        }
+    }
+    resolved_all_ = uncached.size() == options_.servers.size();
+
+    resolve(uncached);
+    launch_next();
+    check_exhausted();
+}
+
+void ServerBootstrap::resolve(const std::vector<ServerAddress> &servers) {
+    auto self(shared_from_this());
+    for (const auto &address : servers) {
+        resolving_++;
+        auto resolver = std::make_shared<tcp::resolver>(strand_);
+        resolver->async_resolve(
+            address.host, address.service,
+            [self, resolver, host = address.host](
+                asio::error_code ecode,
+                const tcp::resolver::results_type &results) -> void {
+                self->resolving_--;
+                if (self->finished_) {
+                    return;
+                }
+                if (ecode) {
+                    self->bootstrap_logger_->warn("Resolve error: {}, for: {}",
+                                                  ecode.message(), host);
+                }
+                for (const auto &entry : results) {
+                    bool seen = std::ranges::any_of(
+                        self->known_,
+                        [&entry](const ServerEndpoint &server) -> bool {
+                            return server.endpoint == entry.endpoint();
+                        });
+                    if (seen) {
+                        continue;
+                    }
+                    ServerEndpoint server{.host = host,
+                                          .endpoint = entry.endpoint()};
+                    self->known_.push_back(server);
+                    self->candidates_.push_back(std::move(server));
+                }
+                // A stagger that fired while nothing was left to launch is
+                // not re-armed; start the new candidates now.
+                if (!self->stagger_pending_) {
+                    self->launch_next();
+                }
+                self->check_exhausted();
+            });
+    }
+}
+
+void ServerBootstrap::launch_next() {
+    if (finished_ || candidates_.empty()) {
+        return;
+    }
+
+    auto attempt =
+        std::make_shared<Attempt>(strand_, std::move(candidates_.front()));
+    candidates_.pop_front();
+    attempts_.push_back(attempt);
+
+    auto self(shared_from_this());
+    attempt->deadline.expires_after(options_.attempt_timeout);
+    attempt->deadline.async_wait([attempt](asio::error_code ecode) -> void {
+        if (!ecode) {
+            asio::error_code ignored;
+            attempt->socket.close(ignored);
+        }
+    });
+
+    attempt->socket.async_connect(
+        attempt->server.endpoint,
+        [self, attempt](asio::error_code ecode) -> void {
+            if (ecode) {
+                self->attempt_failed(attempt, ecode);
+                return;
+            }
+            asio::async_read_until(
+                attempt->socket, attempt->buffer, '\n',
+                [self, attempt](asio::error_code ecode, std::size_t) -> void {
+                    if (ecode) {
+                        self->attempt_failed(attempt, ecode);
+                        return;
+                    }
+                    auto data = attempt->buffer.data();
+                    std::string_view first(
+                        static_cast<const char *>(data.data()), data.size());
+                    if (!first.starts_with("211")) {
+                        self->attempt_failed(attempt,
+                                             asio::error::invalid_argument);
+                        return;
+                    }
+                    self->attempt_won(attempt);
+                });
+        });
+
+    arm_stagger();
+}
+
+void ServerBootstrap::arm_stagger() {
+    auto self(shared_from_this());
+    stagger_pending_ = true;
+    stagger_.expires_after(options_.stagger);
+    stagger_.async_wait([self](asio::error_code ecode) -> void {
+        // A cancelled wait was either superseded by a newer one, which is
+        // still pending, or the race is over.
+        if (!ecode) {
+            self->stagger_pending_ = false;
+            self->launch_next();
+        }
+    });
+}
+
+void ServerBootstrap::attempt_failed(const std::shared_ptr<Attempt> &attempt,
+                                     const asio::error_code &ecode) {
+    if (finished_) {
+        return;
+    }
+    bootstrap_logger_->warn("Connect error: {}, to: {} ({})", ecode.message(),
+                            attempt->server.host,
+                            attempt->server.endpoint.address().to_string());
+    attempt->deadline.cancel();
+    std::erase(attempts_, attempt);
+
+    launch_next();
+    check_exhausted();
+}
+
+void ServerBootstrap::attempt_won(const std::shared_ptr<Attempt> &attempt) {
+    finished_ = true;
+    stagger_.cancel();
+    attempt->deadline.cancel();
+    for (auto &other : attempts_) {
+        if (other != attempt) {
+            asio::error_code ignored;
+            other->deadline.cancel();
+            other->socket.close(ignored);
+        }
+    }
+    attempts_.clear();
+
+    auto rtt = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - attempt->started);
+    attempt->server.rtt = std::max(rtt, std::chrono::microseconds(1));
+    bootstrap_logger_->info("Using {} ({}), 211 after {} ms",
+                            attempt->server.host,
+                            attempt->server.endpoint.address().to_string(),
+                            rtt.count() / 1000);
+
+    auto known = std::ranges::find_if(
+        known_, [&attempt](const ServerEndpoint &server) -> bool {
+            return server.endpoint == attempt->server.endpoint;
+        });
+    if (known != known_.end()) {
+        known->rtt = attempt->server.rtt;
+    } else {
+        known_.push_back(attempt->server);
+    }
+    if (!options_.cache_path.empty()) {
+        save_server_cache(options_.cache_path, known_);
+    }
+
+    auto data = attempt->buffer.data();
+    BootstrapResult result{
+        .server = attempt->server,
+        .received = std::string(asio::buffers_begin(data),
+                                asio::buffers_end(data))};
+    on_done_(std::move(result), std::move(attempt->socket));
+}
+
+void ServerBootstrap::check_exhausted() {
+    if (finished_ || !attempts_.empty() || !candidates_.empty() ||
+        resolving_ > 0) {
+        return;
+    }
+    if (!resolved_all_) {
+        // Every cached endpoint failed; fall back to fresh DNS.
+        resolved_all_ = true;
+        resolve(options_.servers);
+        return;
+    }
+    fail(asio::error::host_unreachable);
+}
+
+void ServerBootstrap::fail(const asio::error_code &ecode) {
+    finished_ = true;
+    stagger_.cancel();
+    bootstrap_logger_->error("No EPSP server reachable: {}", ecode.message());
+    on_done_(BootstrapResult{.error = ecode}, tcp::socket(strand_));
+}
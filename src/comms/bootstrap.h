@@ -0,0 +1,93 @@
+#pragma once
+#include "io_pool.h"
+#include <asio/io_context.hpp>
+#include <asio/ip/tcp.hpp>
+#include <asio/steady_timer.hpp>
+#include <asio/streambuf.hpp>
+#include <deque>
+#include <filesystem>
+
+struct ServerAddress {
+    std::string host;
+    std::string service;
+};
+
+struct ServerEndpoint {
+    std::string host;
+    asio::ip::tcp::endpoint endpoint;
+    std::chrono::microseconds rtt{0}; // 0 = never measured
+};
+
+// Resolved addresses and measured 211 round trips from earlier runs, one
+// "<host> <address> <port> <rtt_us>" line per endpoint, fastest first.
+auto load_server_cache(const std::filesystem::path &path)
+    -> std::vector<ServerEndpoint>;
+void save_server_cache(const std::filesystem::path &path,
+                       std::vector<ServerEndpoint> endpoints);
+
+struct BootstrapOptions {
+    std::vector<ServerAddress> servers;
+    std::filesystem::path cache_path{}; // empty disables the cache
+    std::chrono::milliseconds stagger{250};
+    std::chrono::milliseconds attempt_timeout{5000};
+};
+
+struct BootstrapResult {
+    asio::error_code error{};
+    ServerEndpoint server{};
+    std::string received{}; // bytes read so far, starting with the 211 line
+};
+
+// Happy-Eyeballs style race for the first server to send 211. Cached
+// endpoints are tried fastest first without DNS; every server without a
+// cache entry is resolved in parallel. A new attempt starts every `stagger`
+// or as soon as one fails, and the first 211 wins.
+class ServerBootstrap : public std::enable_shared_from_this<ServerBootstrap> {
+public:
+    using Handler =
+        std::function<void(BootstrapResult result, asio::ip::tcp::socket)>;
+
+    static auto create(asio::io_context &io_context, BootstrapOptions options)
+        -> std::shared_ptr<ServerBootstrap>;
+    // Runs every handler, and hands over the socket, on `strand`.
+    static auto create(IoStrand strand, BootstrapOptions options)
+        -> std::shared_ptr<ServerBootstrap>;
+
+    void start(Handler on_done);
+
+private:
+    struct Attempt {
+        ServerEndpoint server;
+        asio::ip::tcp::socket socket;
+        asio::steady_timer deadline;
+        asio::streambuf buffer;
+        std::chrono::steady_clock::time_point started;
+
+        Attempt(const IoStrand &strand, ServerEndpoint server);
+    };
+
+    explicit ServerBootstrap(IoStrand strand, BootstrapOptions options);
+
+    IoStrand strand_;
+    BootstrapOptions options_;
+    asio::steady_timer stagger_;
+    std::shared_ptr<spdlog::logger> bootstrap_logger_;
+    Handler on_done_;
+
+    std::vector<ServerEndpoint> known_;
+    std::deque<ServerEndpoint> candidates_;
+    std::vector<std::shared_ptr<Attempt>> attempts_;
+    std::size_t resolving_ = 0;
+    bool stagger_pending_ = false;
+    bool resolved_all_ = false;
+    bool finished_ = false;
+
+    void resolve(const std::vector<ServerAddress> &servers);
+    void launch_next();
+    void arm_stagger();
+    void attempt_failed(const std::shared_ptr<Attempt> &attempt,
+                        const asio::error_code &ecode);
+    void attempt_won(const std::shared_ptr<Attempt> &attempt);
+    void check_exhausted();
+    void fail(const asio::error_code &ecode);
+};
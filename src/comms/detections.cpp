@@ -0,0 +1,166 @@
+#include "detections.h"
+#include <charconv>
+
+namespace {
+auto to_second(std::chrono::steady_clock::time_point now) -> int64_t {
+    return std::chrono::duration_cast<std::chrono::seconds>(
+               now.time_since_epoch())
+        .count();
+}
+
+// Ring slot of a second. Seconds before the epoch are negative while the
+// windows reach back past it (steady_clock's epoch is often boot), so
+// this is a floored modulo, not a cast.
+auto slot_of(int64_t second) -> std::size_t {
+    constexpr auto horizon =
+        static_cast<int64_t>(DETECTION_WINDOWS.back().count());
+    return static_cast<std::size_t>(((second % horizon) + horizon) % horizon);
+}
+
+auto position(const Region &region) -> std::size_t {
+    return static_cast<std::size_t>(&region - regions.data());
+}
+} // namespace
+
+auto detection_area(std::string_view payload) -> const Region * {
+    auto field = payload.find_last_of(":,");
+    if (field != std::string_view::npos) {
+        payload.remove_prefix(field + 1);
+    }
+    return find_region(payload);
+}
+
+auto parse_region_peers(std::string_view payload, std::vector<RegionPeers> &out)
+    -> bool {
+    out.clear();
+    while (!payload.empty()) {
+        auto end = payload.find(';');
+        auto entry = payload.substr(0, end);
+        payload.remove_prefix(end == std::string_view::npos ? payload.size()
+                                                            : end + 1);
+        auto comma = entry.find(',');
+        if (comma == std::string_view::npos) {
+            return false;
+        }
+        auto count = entry.substr(comma + 1);
+        uint32_t peers = 0;
+        auto [ptr, ecode] =
+            std::from_chars(count.data(), count.data() + count.size(), peers);
+        if (ecode != std::errc{} || ptr != count.data() + count.size()) {
+            return false;
+        }
+        if (const auto *region = find_region(entry.substr(0, comma))) {
+            out.push_back({.region = region, .peers = peers});
+        }
+    }
+    return true;
+}
+
+DetectionAggregator::DetectionAggregator()
+    : windows_(regions.size()), peers_(regions.size(), 0) {}
+
+void DetectionAggregator::set_wake(std::function<void()> wake) {
+    wake_ = std::move(wake);
+}
+
+void DetectionAggregator::advance(Window &window, int64_t second) {
+    if (second <= window.head) {
+        return;
+    }
+    if (second - window.head >= static_cast<int64_t>(HORIZON)) {
+        window.buckets.fill(0);
+        window.sums.fill(0);
+        window.head = second;
+        return;
+    }
+    // Each step drops the bucket that just left every window; the oldest
+    // one lives in the slot about to be reused.
+    for (auto step = window.head + 1; step <= second; step++) {
+        for (std::size_t w = 0; w < DETECTION_WINDOWS.size(); w++) {
+            auto leaving = step - DETECTION_WINDOWS[w].count();
+            window.sums[w] -= window.buckets[slot_of(leaving)];
+        }
+        window.buckets[slot_of(step)] = 0;
+    }
+    window.head = second;
+}
+
+void DetectionAggregator::record(const Region &region, clock::time_point now) {
+    auto second = to_second(now);
+    auto slot = position(region);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto &window = windows_[slot];
+    if (!window) {
+        window = std::make_unique<Window>();
+        window->head = second;
+    }
+    // A report stamped before the head counts in the current second.
+    advance(*window, second);
+    window->buckets[slot_of(window->head)]++;
+    for (auto &sum : window->sums) {
+        sum++;
+    }
+    if (!window->listed) {
+        window->listed = true;
+        active_.push_back(static_cast<uint16_t>(slot));
+    }
+    total_++;
+}
+
+void DetectionAggregator::set_active_peers(
+    std::span<const RegionPeers> peers) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::ranges::fill(peers_, 0);
+    for (const auto &entry : peers) {
+        peers_[position(*entry.region)] = entry.peers;
+    }
+}
+
+void DetectionAggregator::publish(clock::time_point now) {
+    auto second = to_second(now);
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    auto &snapshot = buffers_[back_];
+    snapshot.taken = now;
+    snapshot.total = total_;
+    snapshot.regions.clear();
+    for (std::size_t i = 0; i < active_.size();) {
+        auto slot = active_[i];
+        auto &window = *windows_[slot];
+        advance(window, second);
+        if (window.sums.back() == 0) {
+            // Quiet for a whole horizon: stop visiting it.
+            window.listed = false;
+            active_[i] = active_.back();
+            active_.pop_back();
+            continue;
+        }
+        snapshot.regions.push_back({.region = &regions[slot],
+                                    .counts = window.sums,
+                                    .peers = peers_[slot]});
+        i++;
+    }
+    bool changed = snapshot.regions != published_;
+    if (changed) {
+        published_ = snapshot.regions;
+    }
+    back_ = middle_.exchange(back_ | DIRTY, std::memory_order_acq_rel) & INDEX;
+    lock.unlock();
+
+    if (changed && wake_) {
+        wake_();
+    }
+}
+
+auto DetectionAggregator::latest() -> const DetectionSnapshot & {
+    if ((middle_.load(std::memory_order_relaxed) & DIRTY) != 0) {
+        front_ = middle_.exchange(front_, std::memory_order_acq_rel) & INDEX;
+    }
+    return buffers_[front_];
+}
+
+auto detections() -> DetectionAggregator & {
+    static DetectionAggregator aggregator;
+    return aggregator;
+}
@@ -0,0 +1,109 @@
+#pragma once
+#include "../utils/region.h"
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string_view>
+#include <vector>
+
+// Sliding windows the 555 counts are kept over.
+inline constexpr std::array<std::chrono::seconds, 3> DETECTION_WINDOWS = {
+    std::chrono::seconds(10), std::chrono::seconds(60),
+    std::chrono::seconds(300)};
+
+struct RegionDetections {
+    const Region *region;
+    // Reports per window, same order as DETECTION_WINDOWS.
+    std::array<uint32_t, DETECTION_WINDOWS.size()> counts;
+    uint32_t peers; // active peers in the region, from the server's 247
+
+    auto operator==(const RegionDetections &) const -> bool = default;
+};
+
+struct DetectionSnapshot {
+    std::chrono::steady_clock::time_point taken{};
+    uint64_t total = 0; // reports since start
+    // Regions with a report inside the longest window.
+    std::vector<RegionDetections> regions;
+};
+
+// The region a 555 report came from: its data ends with the area code.
+auto detection_area(std::string_view payload) -> const Region *;
+
+struct RegionPeers {
+    const Region *region;
+    uint32_t peers;
+};
+
+// A 247 payload, "<area>,<peers>;<area>,<peers>;...". Unknown areas are
+// skipped; false if an entry is malformed.
+auto parse_region_peers(std::string_view payload, std::vector<RegionPeers> &out)
+    -> bool;
+
+// Per-region 555 counts over DETECTION_WINDOWS, kept in one-second buckets.
+// record() is O(1): it bumps the current bucket and each window's running
+// sum. Buckets leave the sums as time advances, once per region-second, not
+// once per report. publish() writes an immutable snapshot into a triple
+// buffer, so the render thread reads the latest one without locking.
+// A snapshot whose counts differ from the previous one runs the wake
+// callback, so a reader can sleep while nothing visible changes.
+class DetectionAggregator {
+public:
+    using clock = std::chrono::steady_clock;
+
+    DetectionAggregator();
+
+    // Runs on the publishing thread (e.g. glfwPostEmptyEvent). Set before
+    // the first publish().
+    void set_wake(std::function<void()> wake);
+
+    // Any thread.
+    void record(const Region &region, clock::time_point now = clock::now());
+    // Replaces every region's active peer count; unlisted regions have none.
+    void set_active_peers(std::span<const RegionPeers> peers);
+    // Any thread, but serialised with record(): one writer at a time.
+    void publish(clock::time_point now = clock::now());
+
+    // Render thread (one reader). The reference stays valid until the next
+    // call.
+    auto latest() -> const DetectionSnapshot &;
+
+private:
+    static constexpr auto HORIZON = static_cast<std::size_t>(
+        DETECTION_WINDOWS.back().count());
+    static constexpr uint8_t DIRTY = 0x4;
+    static constexpr uint8_t INDEX = 0x3;
+
+    // Allocated on a region's first report.
+    struct Window {
+        std::array<uint32_t, HORIZON> buckets{};
+        std::array<uint32_t, DETECTION_WINDOWS.size()> sums{};
+        int64_t head = 0; // last second accounted for
+        bool listed = false;
+    };
+
+    std::mutex mutex_;
+    std::vector<std::unique_ptr<Window>> windows_; // by table position
+    std::vector<uint32_t> peers_;                   // by table position
+    std::vector<uint16_t> active_; // positions with a non-empty window
+    uint64_t total_ = 0;
+    std::function<void()> wake_;
+    std::vector<RegionDetections> published_; // regions of the last snapshot
+
+    // Triple buffer: publish() fills back_, then swaps it with middle_; the
+    // reader swaps front_ with middle_ when it is marked DIRTY.
+    std::array<DetectionSnapshot, 3> buffers_;
+    uint8_t back_ = 0;
+    std::atomic<uint8_t> middle_{1};
+    uint8_t front_ = 2;
+
+    static void advance(Window &window, int64_t second);
+};
+
+// Fed by the peer relay; read by the GUI.
+auto detections() -> DetectionAggregator &;
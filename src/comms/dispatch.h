@@ -0,0 +1,92 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+
+// True for a null handler. This matches template arguments instead of
+// comparing values: with -fsanitize=null, GCC does not treat a member
+// pointer compared with nullptr as a constant expression.
+template <auto Handler>
+inline constexpr bool is_null_handler = std::is_same_v<
+    std::integral_constant<decltype(Handler), Handler>,
+    std::integral_constant<decltype(Handler), decltype(Handler){}>>;
+
+template <typename State, typename Code, typename Handler> struct Transition;
+
+// The only way to build a row, so every handler is checked at compile time.
+template <auto Handler, typename State, typename Code>
+consteval auto transition(State state, Code code, State next)
+    -> Transition<State, Code, decltype(Handler)> {
+    static_assert(!is_null_handler<Handler>, "transition without handler");
+    return {state, code, next, Handler};
+}
+
+// One row of a protocol state machine: receiving `code` while in `state`
+// moves to `next` and runs `handler`.
+template <typename State, typename Code, typename Handler> struct Transition {
+    State state;
+    Code code;
+    State next;
+    Handler handler;
+
+private:
+    constexpr Transition(State state, Code code, State next, Handler handler)
+        : state(state), code(code), next(next), handler(handler) {}
+
+    template <auto H, typename S, typename C>
+    friend consteval auto transition(S state, C code, S next)
+        -> Transition<S, C, decltype(H)>;
+};
+
+inline constexpr uint8_t DISPATCH_NONE = 0xFF;
+
+// Dense [state][code - CodeBase] -> transition index table, so dispatch is a
+// single lookup regardless of how many codes are handled. Bad rows are
+// rejected while the table is being built, which fails the build.
+template <std::size_t StateCount, uint16_t CodeBase, std::size_t CodeSpan,
+          typename Table>
+consteval auto make_dispatch_table(const Table &transitions)
+    -> std::array<std::array<uint8_t, CodeSpan>, StateCount> {
+    static_assert(std::tuple_size_v<Table> < DISPATCH_NONE,
+                  "too many transitions for uint8_t index");
+
+    std::array<std::array<uint8_t, CodeSpan>, StateCount> index{};
+    for (auto &row : index) {
+        row.fill(DISPATCH_NONE);
+    }
+
+    for (std::size_t i = 0; i < transitions.size(); i++) {
+        auto state = static_cast<std::size_t>(
+            std::to_underlying(transitions[i].state));
+        auto next = static_cast<std::size_t>(
+            std::to_underlying(transitions[i].next));
+        auto code = static_cast<std::size_t>(
+            std::to_underlying(transitions[i].code));
+
+        if (state >= StateCount || next >= StateCount) {
+            throw "transition state out of range";
+        }
+        if (code < CodeBase || code >= CodeBase + CodeSpan) {
+            throw "transition code out of range";
+        }
+        if (index[state][code - CodeBase] != DISPATCH_NONE) {
+            throw "duplicate transition";
+        }
+        index[state][code - CodeBase] = static_cast<uint8_t>(i);
+    }
+    return index;
+}
+
+template <uint16_t CodeBase, std::size_t CodeSpan, typename Index,
+          typename State>
+constexpr auto find_transition(const Index &index, State state, uint16_t code)
+    -> uint8_t {
+    auto state_idx = static_cast<std::size_t>(std::to_underlying(state));
+    if (code < CodeBase || code >= CodeBase + CodeSpan ||
+        state_idx >= index.size()) {
+        return DISPATCH_NONE;
+    }
+    return index[state_idx][code - CodeBase];
+}
@@ -0,0 +1,87 @@
+#include "event_channel.h"
+#include "message.h"
+
+auto relay_event_kind(uint16_t code) -> std::optional<epsp_event_kind_t> {
+    switch (static_cast<epsp_peer_code_t>(code)) {
+    case epsp_peer_code_t::EPSP_PEER_EQK_INFO:
+        return epsp_event_kind_t::EVENT_EQK_INFO;
+    case epsp_peer_code_t::EPSP_PEER_TSU_INFO:
+        return epsp_event_kind_t::EVENT_TSU_INFO;
+    case epsp_peer_code_t::EPSP_PEER_EQK_DTCT:
+        return epsp_event_kind_t::EVENT_EQK_DTCT;
+    case epsp_peer_code_t::EPSP_PEER_PEER_CPR:
+        return epsp_event_kind_t::EVENT_PEER_CPR;
+    default:
+        return std::nullopt;
+    }
+}
+
+EventChannel::EventChannel(std::size_t capacity) : ring_(capacity) {}
+
+void EventChannel::set_wake(std::function<void()> wake) {
+    wake_ = std::move(wake);
+}
+
+auto EventChannel::publish(NetEvent event) -> bool {
+    if (!consumer_) {
+        return false;
+    }
+    if (!ring_.try_push(std::move(event))) {
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    pushed();
+    return true;
+}
+
+auto EventChannel::publish(epsp_event_kind_t kind,
+                           std::chrono::system_clock::time_point received,
+                           std::string_view payload) -> bool {
+    if (!consumer_) {
+        return false;
+    }
+    if (!ring_.try_emplace([&](NetEvent &cell) -> void {
+            cell.kind = kind;
+            cell.received = received;
+            cell.payload.assign(payload);
+        })) {
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    pushed();
+    return true;
+}
+
+void EventChannel::pushed() {
+    published_.fetch_add(1, std::memory_order_relaxed);
+
+    if (!wake_pending_.exchange(true, std::memory_order_acq_rel) && wake_) {
+        wakes_.fetch_add(1, std::memory_order_relaxed);
+        wake_();
+    }
+}
+
+auto EventChannel::drain(std::vector<NetEvent> &batch) -> std::size_t {
+    // Re-arm before popping, so an event pushed after the last pop finds the
+    // flag clear and wakes the next frame. The exchange reads any producer's
+    // flag write, which makes that producer's push visible to the pops.
+    wake_pending_.exchange(false, std::memory_order_acq_rel);
+
+    std::size_t drained = 0;
+    while (auto event = ring_.try_copy()) {
+        batch.push_back(std::move(*event));
+        drained++;
+    }
+    return drained;
+}
+
+auto EventChannel::stats() const -> EventChannelStats {
+    return {.published = published_.load(std::memory_order_relaxed),
+            .dropped = dropped_.load(std::memory_order_relaxed),
+            .wakes = wakes_.load(std::memory_order_relaxed)};
+}
+
+auto net_events() -> EventChannel & {
+    static EventChannel channel;
+    return channel;
+}
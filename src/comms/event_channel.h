@@ -0,0 +1,85 @@
+#pragma once
+#include "mpsc_ring.h"
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+enum class epsp_event_kind_t : uint8_t {
+    EVENT_EQK_INFO,       // 551 earthquake report
+    EVENT_TSU_INFO,       // 552 tsunami forecast
+    EVENT_EQK_DTCT,       // 555 user detections
+    EVENT_PEER_CPR,       // 556
+    EVENT_SERVER_SESSION, // the server assigned a peer id (payload)
+    EVENT_SERVER_CLOSED,
+};
+
+// Relay code to event kind; nullopt for codes the GUI does not show.
+auto relay_event_kind(uint16_t code) -> std::optional<epsp_event_kind_t>;
+
+struct NetEvent {
+    epsp_event_kind_t kind = epsp_event_kind_t::EVENT_EQK_INFO;
+    std::chrono::system_clock::time_point received{};
+    std::string payload{};
+};
+
+struct EventChannelStats {
+    uint64_t published = 0;
+    uint64_t dropped = 0; // ring full
+    uint64_t wakes = 0;   // wake callbacks run
+};
+
+// Carries events from the io threads to the render thread without either
+// side taking a lock. Producers publish into a bounded MpscRing; the render
+// thread drains everything once per frame. Only the first event after a
+// drain runs the wake callback, so a burst costs one wake-up.
+class EventChannel {
+public:
+    static constexpr std::size_t CAPACITY = 1024;
+
+    explicit EventChannel(std::size_t capacity = CAPACITY);
+
+    // Runs on the publishing thread (e.g. glfwPostEmptyEvent). Set before
+    // any producer starts.
+    void set_wake(std::function<void()> wake);
+
+    // Whether a render thread drains the channel. Headless runs have none:
+    // publish() then discards events without counting them as dropped, so
+    // `dropped` only ever means overflow. Set before any producer starts.
+    void set_consumer(bool attached) { consumer_ = attached; }
+
+    // Any thread. Returns false and counts the drop when the ring is full;
+    // returns false without counting when there is no consumer.
+    auto publish(NetEvent event) -> bool;
+    // Same, but copies `payload` into the ring cell's own buffer, which
+    // outlives the event: once every cell has held a payload this size,
+    // publishing no longer allocates.
+    auto publish(epsp_event_kind_t kind,
+                 std::chrono::system_clock::time_point received,
+                 std::string_view payload) -> bool;
+    // Render thread. Appends a copy of every queued event to `batch`; the
+    // cells keep their buffers for the producers.
+    auto drain(std::vector<NetEvent> &batch) -> std::size_t;
+
+    [[nodiscard]] auto stats() const -> EventChannelStats;
+
+private:
+    // Counts a successful push and wakes the consumer if it is idle.
+    void pushed();
+
+    MpscRing<NetEvent> ring_;
+    std::function<void()> wake_;
+    bool consumer_ = true;
+    std::atomic<bool> wake_pending_{false};
+    std::atomic<uint64_t> published_{0};
+    std::atomic<uint64_t> dropped_{0};
+    std::atomic<uint64_t> wakes_{0};
+};
+
+// Shared by the comms layer and the GUI.
+auto net_events() -> EventChannel &;
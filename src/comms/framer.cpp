@@ -0,0 +1,58 @@
+#include "framer.h"
+#include <algorithm>
+#include <cstring>
+
+LineFramer::LineFramer(std::size_t capacity, std::size_t max_line)
+    : data_(std::make_unique<char[]>(capacity)), capacity_(capacity),
+      max_line_(std::min(max_line, capacity - 1)) {}
+
+auto LineFramer::write_area() -> std::span<char> {
+    if (begin_ > 0) {
+        std::memmove(data_.get(), data_.get() + begin_, end_ - begin_);
+        scanned_ -= begin_;
+        end_ -= begin_;
+        begin_ = 0;
+    }
+    return {data_.get() + end_, capacity_ - end_};
+}
+
+void LineFramer::commit(std::size_t bytes) {
+    end_ = std::min(end_ + bytes, capacity_);
+}
+
+auto LineFramer::take_lines(std::vector<std::string_view> &lines)
+    -> epsp_framer_t {
+    const char *base = data_.get();
+    while (scanned_ < end_) {
+        // memchr is vectorised by every libc we build against.
+        const auto *newline = static_cast<const char *>(
+            std::memchr(base + scanned_, '\n', end_ - scanned_));
+        if (newline == nullptr) {
+            scanned_ = end_;
+            break;
+        }
+
+        auto stop = static_cast<std::size_t>(newline - base);
+        std::string_view line(base + begin_, stop - begin_);
+        if (line.ends_with('\r')) {
+            line.remove_suffix(1);
+        }
+        if (line.size() > max_line_) {
+            return epsp_framer_t::FRAMER_LINE_TOO_LONG;
+        }
+        lines.push_back(line);
+        begin_ = stop + 1;
+        scanned_ = begin_;
+    }
+
+    if (end_ - begin_ > max_line_) {
+        return epsp_framer_t::FRAMER_LINE_TOO_LONG;
+    }
+    return epsp_framer_t::FRAMER_OK;
+}
+
+void LineFramer::reset() {
+    begin_ = 0;
+    scanned_ = 0;
+    end_ = 0;
+}
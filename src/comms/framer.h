@@ -0,0 +1,43 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string_view>
+#include <vector>
+
+constexpr std::size_t EPSP_RECV_CAPACITY = 16 * 1024;
+constexpr std::size_t EPSP_MAX_LINE_LEN = 8 * 1024;
+
+enum class epsp_framer_t : uint8_t {
+    FRAMER_OK,
+    FRAMER_LINE_TOO_LONG,
+};
+
+// Fixed-size receive buffer for one connection. The socket reads straight
+// into write_area(); take_lines() then splits out every complete line in a
+// single pass. Only the trailing partial line is kept between reads.
+class LineFramer {
+public:
+    explicit LineFramer(std::size_t capacity = EPSP_RECV_CAPACITY,
+                        std::size_t max_line = EPSP_MAX_LINE_LEN);
+
+    // Free space after the buffered bytes. Invalidates views returned by the
+    // previous take_lines().
+    auto write_area() -> std::span<char>;
+    void commit(std::size_t bytes);
+
+    // Appends views of all complete lines, without the CR/LF, to `lines`.
+    auto take_lines(std::vector<std::string_view> &lines) -> epsp_framer_t;
+
+    [[nodiscard]] auto buffered() const -> std::size_t { return end_ - begin_; }
+    void reset();
+
+private:
+    std::unique_ptr<char[]> data_;
+    std::size_t capacity_;
+    std::size_t max_line_;
+    std::size_t begin_ = 0;
+    std::size_t scanned_ = 0;
+    std::size_t end_ = 0;
+};
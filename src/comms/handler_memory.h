@@ -0,0 +1,154 @@
+#pragma once
+#include <array>
+#include <asio/async_result.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+// Fixed blocks reused by one chain of asio operations (e.g. the accept loop).
+// Asio frees an operation's memory before running its handler, so a loop
+// that re-arms itself from the handler keeps reusing the blocks and never
+// touches the heap. Anything that does not fit falls back to new.
+//
+// There are two blocks because a post to an idle strand allocates the
+// strand's invoker with the handler's allocator while the handler itself is
+// still queued. Give each chain its own HandlerMemory, with at most one
+// operation pending at a time; the blocks themselves take no lock.
+class HandlerMemory {
+public:
+    static constexpr std::size_t CAPACITY = 1024;
+
+    HandlerMemory() = default;
+    HandlerMemory(const HandlerMemory &) = delete;
+    auto operator=(const HandlerMemory &) -> HandlerMemory & = delete;
+
+    auto allocate(std::size_t size) -> void * {
+        if (size <= CAPACITY) {
+            for (auto &block : blocks_) {
+                if (!block.in_use) {
+                    block.in_use = true;
+                    reused_++;
+                    return block.storage.data();
+                }
+            }
+        }
+        fallbacks_++;
+        return ::operator new(size);
+    }
+
+    void deallocate(void *pointer) {
+        for (auto &block : blocks_) {
+            if (pointer == block.storage.data()) {
+                block.in_use = false;
+                return;
+            }
+        }
+        ::operator delete(pointer);
+    }
+
+    [[nodiscard]] auto reused() const -> uint64_t { return reused_; }
+    [[nodiscard]] auto fallbacks() const -> uint64_t { return fallbacks_; }
+
+private:
+    struct Block {
+        alignas(std::max_align_t) std::array<std::byte, CAPACITY> storage{};
+        bool in_use = false;
+    };
+
+    std::array<Block, 2> blocks_{};
+    uint64_t reused_ = 0;
+    uint64_t fallbacks_ = 0;
+};
+
+// Minimal allocator over a HandlerMemory, picked up by asio as the
+// handler's associated allocator.
+template <typename T> class HandlerAllocator {
+public:
+    using value_type = T;
+
+    explicit HandlerAllocator(HandlerMemory &memory) : memory_(&memory) {}
+    template <typename U>
+    HandlerAllocator(const HandlerAllocator<U> &other) noexcept // NOLINT
+        : memory_(other.memory_) {}
+
+    auto allocate(std::size_t count) -> T * {
+        return static_cast<T *>(memory_->allocate(sizeof(T) * count));
+    }
+    void deallocate(T *pointer, std::size_t /*count*/) {
+        memory_->deallocate(pointer);
+    }
+
+    auto operator==(const HandlerAllocator &other) const noexcept -> bool {
+        return memory_ == other.memory_;
+    }
+
+private:
+    template <typename> friend class HandlerAllocator;
+    HandlerMemory *memory_;
+};
+
+// Completion handler wrapper that exposes `allocator_type`, which asio's
+// associated_allocator looks for.
+template <typename Handler> class MemoryHandler {
+public:
+    using allocator_type = HandlerAllocator<Handler>;
+
+    MemoryHandler(HandlerMemory &memory, Handler handler)
+        : memory_(memory), handler_(std::move(handler)) {}
+
+    [[nodiscard]] auto get_allocator() const noexcept -> allocator_type {
+        return allocator_type(memory_);
+    }
+
+    template <typename... Args> void operator()(Args &&...args) {
+        std::move(handler_)(std::forward<Args>(args)...);
+    }
+
+private:
+    HandlerMemory &memory_;
+    Handler handler_;
+};
+
+template <typename Handler>
+auto bind_memory(HandlerMemory &memory, Handler handler)
+    -> MemoryHandler<Handler> {
+    return MemoryHandler<Handler>(memory, std::move(handler));
+}
+
+// Completion token adapter: the handler `token` produces (e.g. a coroutine's
+// use_awaitable handler) gets `memory` as its associated allocator, which
+// is what asio::bind_allocator does from asio 1.22 on. The operation still
+// runs on its io object's executor, so give coroutine ops a socket or timer
+// typed on the coroutine's strand.
+template <typename Token> struct MemoryToken {
+    HandlerMemory *memory;
+    Token token;
+};
+
+template <typename Token>
+auto with_memory(HandlerMemory &memory, Token token) -> MemoryToken<Token> {
+    return {.memory = &memory, .token = std::move(token)};
+}
+
+template <typename Token, typename Signature>
+struct asio::async_result<MemoryToken<Token>, Signature> {
+    using return_type =
+        typename asio::async_result<Token, Signature>::return_type;
+
+    template <typename Initiation, typename RawToken, typename... Args>
+    static auto initiate(Initiation &&initiation, RawToken &&token,
+                         Args &&...args) -> return_type {
+        return asio::async_initiate<Token, Signature>(
+            [memory = token.memory,
+             initiation = std::forward<Initiation>(initiation)]<
+                typename Handler, typename... CallArgs>(
+                Handler &&handler, CallArgs &&...call_args) mutable -> void {
+                std::move(initiation)(
+                    bind_memory(*memory, std::forward<Handler>(handler)),
+                    std::forward<CallArgs>(call_args)...);
+            },
+            token.token, std::forward<Args>(args)...);
+    }
+};
@@ -1,8 +1,12 @@
 #include "handshake.h"
+#include "comms.h"
+#include "event_channel.h"
 #include "message.h"
 #include "peer.h"
+#include "../utils/path.h"
+#include <asio/co_spawn.hpp>
 #include <asio/connect.hpp>
-#include <asio/read_until.hpp>
+#include <asio/detached.hpp>
 #include <asio/write.hpp>
 using asio::ip::tcp;
 
@@ -20,97 +24,256 @@ ConnectionServer::ConnectionServer(asio::io_context &io_context,
                                    std::shared_ptr<ConnectionPeer> peer_manager)
     : states_(epsp_state_server_t::EPSP_STATE_SERVER_DISCONNECTED,
               std::move(peer_manager)),
-      socket_(io_context),
+      strand_(asio::make_strand(io_context)), socket_(strand_),
+      write_signal_(strand_), deadline_(strand_),
       server_logger_(spdlog::default_logger()->clone("\033[34mserver\033[0m")) {
 }
 auto ConnectionServer::socket() -> asio::ip::tcp::socket & { return socket_; }
-void ConnectionServer::start() { do_read(); }
+void ConnectionServer::start(std::string_view received) {
+    auto area = framer_.write_area();
+    auto bytes = std::min(received.size(), area.size());
+    std::copy_n(received.data(), bytes, area.data());
+    framer_.commit(bytes);
+
+    deadline_.expires_after(handshake_timeout_);
+    auto self(shared_from_this());
+    asio::co_spawn(strand_, reader(self), asio::detached);
+    asio::co_spawn(strand_, writer(self), asio::detached);
+    asio::co_spawn(strand_, watchdog(std::move(self)), asio::detached);
+}
 
 void ConnectionServer::stop() {
     auto self(shared_from_this());
-    asio::post(socket_.get_executor(), [self] -> void {
+    asio::post(strand_, [self] -> void { self->close(); });
+}
+
+void ConnectionServer::close() {
+    if (write_signal_.closed()) {
+        return;
+    }
+    // Ends all three coroutines: the writer and watchdog are woken, the
+    // pending read fails with operation_aborted.
+    write_signal_.close();
+    deadline_.cancel();
+    net_events().publish({.kind = epsp_event_kind_t::EVENT_SERVER_CLOSED,
+                          .received = std::chrono::system_clock::now()});
+
+    asio::error_code ecode;
+    socket_.shutdown(asio::ip::tcp::socket::shutdown_both, ecode);
+    if (ecode) {
+        spdlog::warn("Shutdown error: {}", ecode.message());
+    }
+    socket_.close(ecode);
+    if (ecode) {
+        spdlog::error("Close error: {}", ecode.message());
+    }
+}
+
+void ConnectionServer::send_echo(std::size_t connected_peers) {
+    auto self(shared_from_this());
+    asio::post(strand_, [self, connected_peers] -> void {
+        if (!self->socket_.is_open() || !has_session_id()) {
+            return;
+        }
+        self->send(std::to_string(std::to_underlying(
+                       epsp_client_code_t::EPSP_CLIENT_ECHO_UPD)) +
+                   " 1 " +
+                   std::to_string(peer_id.load(std::memory_order_relaxed)) +
+                   ":" + std::to_string(connected_peers) + "\r\n");
+        self->request_region_peers();
+    });
+}
+
+void ConnectionServer::request_region_peers() {
+    send(std::to_string(std::to_underlying(
+             epsp_client_code_t::EPSP_CLIENT_PEER_RGN)) +
+         " 1\r\n");
+}
+
+void ConnectionServer::send(std::string_view line) {
+    if (line.empty()) {
+        return;
+    }
+    server_logger_->info("Sending: {}", line.substr(0, line.size() - 2));
+    pending_ += line;
+    write_signal_.notify();
+}
+
+auto ConnectionServer::reader(std::shared_ptr<ConnectionServer> /*self*/)
+    -> asio::awaitable<void> {
+    // Lines left over from the bootstrap read come first.
+    lines_.clear();
+    framer_.take_lines(lines_);
+
+    while (handle_lines()) {
+        if (!has_session_id()) {
+            deadline_.expires_after(handshake_timeout_);
+        } else if (deadline_.expiry() !=
+                   asio::steady_timer::time_point::max()) {
+            // Handshake done: no more deadline, and the GUI hears once.
+            deadline_.expires_at(asio::steady_timer::time_point::max());
+            net_events().publish(
+                {.kind = epsp_event_kind_t::EVENT_SERVER_SESSION,
+                 .received = std::chrono::system_clock::now(),
+                 .payload = std::to_string(
+                     peer_id.load(std::memory_order_relaxed))});
+            // The per-region peer counts the 555 reports are weighed
+            // against; refreshed with every echo.
+            request_region_peers();
+        }
+
+        auto area = framer_.write_area();
         asio::error_code ecode;
-        self->socket_.shutdown(asio::ip::tcp::socket::shutdown_both, ecode);
+        auto bytes = co_await socket_.async_read_some(
+            asio::buffer(area.data(), area.size()),
+            asio::redirect_error(asio::use_awaitable, ecode));
         if (ecode) {
-            spdlog::warn("Shutdown error: {}", ecode.message());
+            server_logger_->error("Read error: {}", ecode.message());
+            break;
         }
-        self->socket_.close(ecode);
-        if (ecode) {
-            spdlog::error("Close error: {}", ecode.message());
+
+        framer_.commit(bytes);
+        lines_.clear();
+        if (framer_.take_lines(lines_) ==
+            epsp_framer_t::FRAMER_LINE_TOO_LONG) {
+            server_logger_->error("Line exceeds {} bytes", EPSP_MAX_LINE_LEN);
+            break;
         }
-    });
+    }
+    close();
 }
 
-void ConnectionServer::do_read() {
-    auto self(shared_from_this());
-    asio::async_read_until(
-        socket_, buffer_, '\n',
-        [self](asio::error_code ecode, std::size_t) -> void {
-            if (ecode) {
-                self->server_logger_->error("Read error: {}", ecode.message());
-                return;
-            }
-
-            std::istream input(&self->buffer_);
-            std::string line;
-            std::getline(input, line);
-            self->server_logger_->info("Received: {}", line);
-
-            if (line.size() < 5) {
-                self->server_logger_->error("Invalid message: {}", line);
-                self->stop();
-                return;
-            }
-
-            self->handle_message(line);
+auto ConnectionServer::handle_lines() -> bool {
+    for (auto line : lines_) {
+        server_logger_->info("Received: {}", line);
+
+        if (line.size() < 5) {
+            server_logger_->error("Invalid message: {}", line);
+            return false;
         }
 
-    );
-}
+        states_.handle_message(line, response_);
+        if (response_ == "stop") {
+            return false;
+        }
+        send(response_);
 
-void ConnectionServer::handle_message(std::string &line) {
-    std::string response = states_.handle_message(line);
-    if (response == "stop") {
-        stop();
-        return;
+        // The 155 reply is queued once the peers connect; meanwhile the
+        // reader keeps going.
+        if (states_.has_pending_peers()) {
+            connect_peers();
+        }
     }
-    server_logger_->info("Sending: {}",
-                         response.substr(0, response.size() - 2));
-    do_write(response);
+    return true;
 }
 
-void ConnectionServer::do_write(std::string data) {
+void ConnectionServer::connect_peers() {
     auto self(shared_from_this());
-    asio::async_write(
-        socket_, asio::buffer(data),
-        [self, data](asio::error_code ecode, std::size_t) -> void {
-            if (ecode) {
-                self->server_logger_->error("Write error: {}", ecode.message());
-                self->stop();
-                return;
-            }
-            self->do_read();
-        });
+    states_.connect_pending_peers([self](std::string response) -> void {
+        asio::post(self->strand_,
+                   [self, response = std::move(response)] -> void {
+                       self->send(response);
+                   });
+    });
+}
+
+auto ConnectionServer::writer(std::shared_ptr<ConnectionServer> /*self*/)
+    -> asio::awaitable<void> {
+    // Replies queued while a write is in flight go out together next.
+    while (!write_signal_.closed()) {
+        if (pending_.empty()) {
+            co_await write_signal_.wait();
+            continue;
+        }
+
+        std::swap(pending_, in_flight_);
+        asio::error_code ecode;
+        co_await asio::async_write(
+            socket_, asio::buffer(in_flight_),
+            asio::redirect_error(asio::use_awaitable, ecode));
+        in_flight_.clear();
+        if (ecode) {
+            server_logger_->error("Write error: {}", ecode.message());
+            close();
+            break;
+        }
+    }
+}
+
+auto ConnectionServer::watchdog(std::shared_ptr<ConnectionServer> /*self*/)
+    -> asio::awaitable<void> {
+    while (!write_signal_.closed()) {
+        asio::error_code ignored;
+        co_await deadline_.async_wait(
+            asio::redirect_error(asio::use_awaitable, ignored));
+        // A re-armed deadline also wakes us; only a passed one counts.
+        if (!write_signal_.closed() &&
+            deadline_.expiry() <= std::chrono::steady_clock::now()) {
+            server_logger_->error("No reply from server in {} ms",
+                                  handshake_timeout_.count());
+            close();
+        }
+    }
 }
 
 auto init_server_connection(const std::string &ip_address,
                             const std::shared_ptr<ConnectionPeer> &peer_manager)
     -> std::shared_ptr<asio::io_context> {
-    auto server_io_context = std::make_shared<asio::io_context>();
-    auto server_resolver = std::make_shared<tcp::resolver>(*server_io_context);
-    auto server_endpoints = server_resolver->resolve(ip_address, "6910");
-    auto server = ConnectionServer::create(*server_io_context, peer_manager);
-
-    asio::async_connect(
-        server->socket(), server_endpoints,
-        [server_io_context, server, server_resolver](
-            asio::error_code ecode, const tcp::endpoint &) -> void {
-            if (ecode) {
-                std::cerr << "Connect error: " << ecode.message() << "\n";
-                return;
-            }
-            server->start();
-        });
+    BootstrapOptions options;
+    options.servers.push_back({.host = ip_address, .service = "6910"});
+    return init_server_connection(std::move(options), peer_manager);
+}
 
+auto init_server_connection(BootstrapOptions options,
+                            const std::shared_ptr<ConnectionPeer> &peer_manager)
+    -> std::shared_ptr<asio::io_context> {
+    auto server_io_context = std::make_shared<asio::io_context>();
+    init_server_connection(*server_io_context, std::move(options),
+                           peer_manager);
     return server_io_context;
 }
+
+auto init_server_connection(asio::io_context &io_context,
+                            BootstrapOptions options,
+                            const std::shared_ptr<ConnectionPeer> &peer_manager)
+    -> std::shared_ptr<ConnectionServer> {
+    auto server = ConnectionServer::create(io_context, peer_manager);
+    // The race hands its socket over on the server's strand.
+    auto bootstrap = ServerBootstrap::create(server->strand(),
+                                             std::move(options));
+
+    if (peer_manager) {
+        std::weak_ptr<ConnectionServer> weak_server = server;
+        peer_manager->set_server_echo(
+            [weak_server](std::size_t connected) -> void {
+                if (auto shared_server = weak_server.lock()) {
+                    shared_server->send_echo(connected);
+                }
+            });
+    }
+
+    bootstrap->start([server](BootstrapResult result,
+                              tcp::socket socket) -> void {
+        // ServerBootstrap has already logged why no server answered.
+        if (result.error) {
+            return;
+        }
+        server->socket() = std::move(socket);
+        server->start(result.received);
+    });
+
+    return server;
+}
+
+auto default_bootstrap_options() -> BootstrapOptions {
+    BootstrapOptions options;
+    for (auto host : EPSP_SERVERS) {
+        options.servers.push_back({.host = std::string(host),
+                                   .service = "6910"});
+    }
+    // The executable's directory is read-only once installed.
+    if (auto cache_dir = get_cache_dir(); !cache_dir.empty()) {
+        options.cache_path = cache_dir / "server_cache.txt";
+    }
+    return options;
+}
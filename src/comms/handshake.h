@@ -1,9 +1,12 @@
 #pragma once
+#include "bootstrap.h"
+#include "framer.h"
 #include "message.h"
 #include "peer.h"
+#include "write_signal.h"
 #include <asio/io_context.hpp>
 #include <asio/ip/tcp.hpp>
-#include <asio/streambuf.hpp>
+#include <asio/steady_timer.hpp>
 
 class ConnectionServer : public std::enable_shared_from_this<ConnectionServer> {
 public:
@@ -12,22 +15,65 @@ public:
         -> std::shared_ptr<ConnectionServer>;
 
     auto socket() -> asio::ip::tcp::socket &;
+    // Every handler of this connection runs here.
+    [[nodiscard]] auto strand() const -> const IoStrand & { return strand_; }
 
-    void start();
+    // `received` holds bytes already read from the socket (e.g. the 211
+    // line consumed by the bootstrap race). Call on the strand.
+    void start(std::string_view received = {});
     void stop();
+    // Sends the 123 echo, and a 127 for the region peer counts, once a
+    // session id has been assigned.
+    void send_echo(std::size_t connected_peers);
+    // The server must answer within `timeout` until a session id is
+    // assigned; after that the connection may idle between echoes. Call
+    // before start().
+    void set_handshake_timeout(std::chrono::milliseconds timeout) {
+        handshake_timeout_ = timeout;
+    }
 
 private:
     explicit ConnectionServer(asio::io_context &io_context,
                               std::shared_ptr<ConnectionPeer> peer_manager);
     ServerStates states_;
+    IoStrand strand_;
     asio::ip::tcp::socket socket_;
-    asio::streambuf buffer_;
+    LineFramer framer_;
+    std::vector<std::string_view> lines_;
+    std::string response_;
+    std::string pending_;   // queued replies, sent together
+    std::string in_flight_; // the write currently on the wire
+    WriteSignal write_signal_;
+    asio::steady_timer deadline_;
+    std::chrono::milliseconds handshake_timeout_{30'000};
     std::shared_ptr<spdlog::logger> server_logger_;
 
-    void do_read();
-    void handle_message(std::string &line);
-    void do_write(std::string data);
+    // Reader and writer run side by side, so the server may send several
+    // lines before we reply. `self` keeps the connection alive.
+    auto reader(std::shared_ptr<ConnectionServer> self)
+        -> asio::awaitable<void>;
+    auto writer(std::shared_ptr<ConnectionServer> self)
+        -> asio::awaitable<void>;
+    auto watchdog(std::shared_ptr<ConnectionServer> self)
+        -> asio::awaitable<void>;
+    // False once the session should end.
+    auto handle_lines() -> bool;
+    void connect_peers();
+    // 127: the server answers with 247, the active peers per region.
+    void request_region_peers();
+    void send(std::string_view line);
+    void close();
 };
 auto init_server_connection(const std::string &ip_address,
                             const std::shared_ptr<ConnectionPeer> &peer_manager)
     -> std::shared_ptr<asio::io_context>;
+auto init_server_connection(BootstrapOptions options,
+                            const std::shared_ptr<ConnectionPeer> &peer_manager)
+    -> std::shared_ptr<asio::io_context>;
+// Runs on a shared io_context (e.g. an IoPool's) instead of its own.
+auto init_server_connection(asio::io_context &io_context,
+                            BootstrapOptions options,
+                            const std::shared_ptr<ConnectionPeer> &peer_manager)
+    -> std::shared_ptr<ConnectionServer>;
+// Every server in EPSP_SERVERS, with the endpoint cache in get_cache_dir().
+auto default_bootstrap_options() -> BootstrapOptions;
@@ -0,0 +1,49 @@
+#include "io_pool.h"
+
+IoPool::IoPool(std::size_t threads)
+    : io_context_(std::make_shared<asio::io_context>(
+          static_cast<int>(std::max<std::size_t>(threads, 1)))),
+      work_(asio::make_work_guard(*io_context_)),
+      threads_(std::max<std::size_t>(threads, 1)) {}
+
+IoPool::~IoPool() { stop(); }
+
+void IoPool::start() {
+    if (!workers_.empty()) {
+        return;
+    }
+    running_ = threads_;
+    workers_.reserve(threads_);
+    for (std::size_t i = 0; i < threads_; i++) {
+        workers_.emplace_back([this] -> void {
+            io_context_->run();
+            std::lock_guard<std::mutex> lock(mutex_);
+            running_--;
+            drained_.notify_all();
+        });
+    }
+    spdlog::info("Started {} io threads", threads_);
+}
+
+void IoPool::stop(std::chrono::milliseconds drain) {
+    work_.reset();
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (!drained_.wait_for(lock, drain,
+                               [this] -> bool { return running_ == 0; })) {
+            spdlog::warn("Stopping io threads still busy after {} ms",
+                         drain.count());
+        }
+    }
+    io_context_->stop();
+    for (auto &worker : workers_) {
+        if (worker.joinable()) {
+            worker.join();
+        }
+    }
+    workers_.clear();
+}
+
+auto IoPool::default_threads() -> std::size_t {
+    return std::max<std::size_t>(std::thread::hardware_concurrency(), 2);
+}
@@ -0,0 +1,68 @@
+#pragma once
+#include <asio/awaitable.hpp>
+#include <asio/executor_work_guard.hpp>
+#include <asio/io_context.hpp>
+#include <asio/ip/tcp.hpp>
+#include <asio/steady_timer.hpp>
+#include <asio/strand.hpp>
+#include <asio/use_awaitable.hpp>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Serialises one connection's (or one shared table's) handlers while the
+// io_context runs them on any pool thread.
+using IoStrand = asio::strand<asio::io_context::executor_type>;
+
+// A socket, timer and coroutines typed on their strand. Through the type-erased
+// any_io_executor every operation copies the strand, and older asio
+// releases have no room for it in the small-object buffer, so each copy
+// goes to the heap.
+using StrandSocket = asio::basic_stream_socket<asio::ip::tcp, IoStrand>;
+using StrandTimer = asio::basic_waitable_timer<
+    std::chrono::steady_clock, asio::wait_traits<std::chrono::steady_clock>,
+    IoStrand>;
+template <typename T> using StrandAwaitable = asio::awaitable<T, IoStrand>;
+inline constexpr asio::use_awaitable_t<IoStrand> use_strand_awaitable;
+
+// One io_context shared by the server connection and every peer, run by a
+// fixed set of threads. Per-connection ordering comes from strands.
+class IoPool {
+public:
+    explicit IoPool(std::size_t threads = default_threads());
+    ~IoPool();
+    IoPool(const IoPool &) = delete;
+    auto operator=(const IoPool &) -> IoPool & = delete;
+
+    [[nodiscard]] auto context() const
+        -> const std::shared_ptr<asio::io_context> & {
+        return io_context_;
+    }
+    [[nodiscard]] auto threads() const -> std::size_t { return threads_; }
+
+    // Longest stop() waits for queued handlers to run out.
+    static constexpr std::chrono::seconds DRAIN_TIMEOUT{2};
+
+    void start();
+    // Releases the work guard so the threads finish what is queued (e.g.
+    // the closes stop_all() posts) and return on their own; the io_context
+    // is stopped only if that takes longer than `drain`. Joins every
+    // thread.
+    void stop(std::chrono::milliseconds drain = DRAIN_TIMEOUT);
+
+    // Hardware concurrency, at least 2 so a slow handler never stalls all
+    // connections.
+    static auto default_threads() -> std::size_t;
+
+private:
+    std::shared_ptr<asio::io_context> io_context_;
+    asio::executor_work_guard<asio::io_context::executor_type> work_;
+    std::size_t threads_;
+    std::vector<std::thread> workers_;
+
+    std::mutex mutex_;
+    std::condition_variable drained_;
+    std::size_t running_ = 0; // workers still inside run()
+};
@@ -1,109 +1,178 @@
 #include "message.h"
 #include "comms.h"
+#include "dispatch.h"
 #include "peer.h"
+#include "wire.h"
 #include <charconv> // for Mac clang
 
+namespace {
+constexpr uint16_t SERVER_CODE_BASE = 200;
+constexpr size_t SERVER_CODE_SPAN = 100;
+constexpr size_t SERVER_STATE_COUNT =
+    std::to_underlying(epsp_state_server_t::EPSP_STATE_SERVER_ACTIVE) + 1;
+
+constexpr uint16_t PEER_CODE_BASE = 500;
+constexpr size_t PEER_CODE_SPAN = 200;
+constexpr size_t PEER_STATE_COUNT =
+    std::to_underlying(epsp_state_peer_t::EPSP_STATE_PEER_ACTIVE) + 1;
+
+constexpr auto is_relay_code(uint16_t code) -> bool {
+    using code_t = epsp_peer_code_t;
+    return code == std::to_underlying(code_t::EPSP_PEER_EQK_INFO) ||
+           code == std::to_underlying(code_t::EPSP_PEER_TSU_INFO) ||
+           code == std::to_underlying(code_t::EPSP_PEER_EQK_DTCT) ||
+           code == std::to_underlying(code_t::EPSP_PEER_PEER_CPR);
+}
+
+void append_code(std::string &response, epsp_client_code_t code) {
+    response += std::to_string(std::to_underlying(code));
+}
+} // namespace
+
+struct ServerStates::Dispatch {
+    using state = epsp_state_server_t;
+    using code = epsp_server_code_t;
+
+    static constexpr std::array transitions = {
+        transition<&ServerStates::return_epsp_server_prtl_qry>(
+            state::EPSP_STATE_SERVER_DISCONNECTED, code::EPSP_SERVER_PRTL_QRY,
+            state::EPSP_STATE_SERVER_WAIT_PRTL_RET),
+        transition<&ServerStates::return_epsp_server_prtl_ret>(
+            state::EPSP_STATE_SERVER_WAIT_PRTL_RET, code::EPSP_SERVER_PRTL_RET,
+            state::EPSP_STATE_SERVER_WAIT_PID_TEMP),
+        transition<&ServerStates::return_epsp_server_pid_temp>(
+            state::EPSP_STATE_SERVER_WAIT_PID_TEMP, code::EPSP_SERVER_PID_TEMP,
+            state::EPSP_STATE_SERVER_WAIT_PORT_RET),
+        transition<&ServerStates::return_epsp_server_port_ret>(
+            state::EPSP_STATE_SERVER_WAIT_PORT_RET, code::EPSP_SERVER_PORT_RET,
+            state::EPSP_STATE_SERVER_WAIT_PEER_DAT),
+        transition<&ServerStates::return_epsp_server_peer_dat>(
+            state::EPSP_STATE_SERVER_WAIT_PEER_DAT, code::EPSP_SERVER_PEER_DAT,
+            state::EPSP_STATE_SERVER_WAIT_KEY_ASGN),
+        transition<&ServerStates::return_epsp_server_end_sess>(
+            state::EPSP_STATE_SERVER_DISCONNECTED, code::EPSP_SERVER_END_SESS,
+            state::EPSP_STATE_SERVER_DISCONNECTED),
+
+        // 247 answers the 127 sent once a session id is assigned and on
+        // every echo, so it arrives in any state from there on.
+        transition<&ServerStates::return_epsp_server_peer_rgn>(
+            state::EPSP_STATE_SERVER_WAIT_PORT_RET, code::EPSP_SERVER_PEER_RGN,
+            state::EPSP_STATE_SERVER_WAIT_PORT_RET),
+        transition<&ServerStates::return_epsp_server_peer_rgn>(
+            state::EPSP_STATE_SERVER_WAIT_PEER_DAT, code::EPSP_SERVER_PEER_RGN,
+            state::EPSP_STATE_SERVER_WAIT_PEER_DAT),
+        transition<&ServerStates::return_epsp_server_peer_rgn>(
+            state::EPSP_STATE_SERVER_WAIT_PID_FINL, code::EPSP_SERVER_PEER_RGN,
+            state::EPSP_STATE_SERVER_WAIT_PID_FINL),
+        transition<&ServerStates::return_epsp_server_peer_rgn>(
+            state::EPSP_STATE_SERVER_WAIT_KEY_ASGN, code::EPSP_SERVER_PEER_RGN,
+            state::EPSP_STATE_SERVER_WAIT_KEY_ASGN),
+        transition<&ServerStates::return_epsp_server_peer_rgn>(
+            state::EPSP_STATE_SERVER_WAIT_TIME_REF, code::EPSP_SERVER_PEER_RGN,
+            state::EPSP_STATE_SERVER_WAIT_TIME_REF),
+        transition<&ServerStates::return_epsp_server_peer_rgn>(
+            state::EPSP_STATE_SERVER_ACTIVE, code::EPSP_SERVER_PEER_RGN,
+            state::EPSP_STATE_SERVER_ACTIVE),
+    };
+
+    static constexpr auto index =
+        make_dispatch_table<SERVER_STATE_COUNT, SERVER_CODE_BASE,
+                            SERVER_CODE_SPAN>(transitions);
+};
+
 ServerStates::ServerStates(epsp_state_server_t server_state,
                            std::shared_ptr<ConnectionPeer> peer)
     : server_state_(server_state), peer_(std::move(peer)) {}
 
-auto ServerStates::handle_message(std::string &line) -> std::string {
-    if (line.back() == '\r') {
-        line.pop_back();
-    }
-
-    uint16_t code = std::stoul(line.substr(0, 3));
-    std::string data;
-    if (line.size() > 6) {
-        data = line.substr(6);
-    }
-
+auto ServerStates::handle_message(std::string_view line) -> std::string {
     std::string response;
-
-    if (200 <= code && code < 300) {
-        response = return_server_codes(code, data);
-    }
-
+    handle_message(line, response);
     return response;
 }
 
-auto ServerStates::return_server_codes(uint16_t code, std::string_view data)
-    -> std::string {
-    if (code == std::to_underlying(epsp_server_code_t::EPSP_SERVER_PRTL_QRY) &&
-        server_state_ == epsp_state_server_t::EPSP_STATE_SERVER_DISCONNECTED) {
-        server_state_ = epsp_state_server_t::EPSP_STATE_SERVER_WAIT_PRTL_RET;
-        return return_epsp_server_prtl_qry();
-    }
-    if (code == std::to_underlying(epsp_server_code_t::EPSP_SERVER_PRTL_RET) &&
-        server_state_ == epsp_state_server_t::EPSP_STATE_SERVER_WAIT_PRTL_RET) {
-        server_state_ = epsp_state_server_t::EPSP_STATE_SERVER_WAIT_PID_TEMP;
-        return return_epsp_server_prtl_ret();
-    }
-    if (code == std::to_underlying(epsp_server_code_t::EPSP_SERVER_PID_TEMP) &&
-        server_state_ == epsp_state_server_t::EPSP_STATE_SERVER_WAIT_PID_TEMP) {
-        server_state_ = epsp_state_server_t::EPSP_STATE_SERVER_WAIT_PORT_RET;
-        uint32_t temp_id = 0;
-        auto [ptr, errc] =
-            std::from_chars(data.data(), data.data() + data.size(), temp_id);
-        if (errc == std::errc() && !has_session_id()) {
-            peer_id.store(temp_id, std::memory_order_relaxed);
-            return return_epsp_server_pid_temp(EPSP_PORT);
-        }
-        std::error_code ecode = std::make_error_code(errc);
-        spdlog::error("Error parsing server temp id: {}", ecode.message());
-        return request_epsp_client_end_sess();
-    }
-    if (code == std::to_underlying(epsp_server_code_t::EPSP_SERVER_PORT_RET) &&
-        server_state_ == epsp_state_server_t::EPSP_STATE_SERVER_WAIT_PORT_RET) {
-        server_state_ = epsp_state_server_t::EPSP_STATE_SERVER_WAIT_PEER_DAT;
-        return return_epsp_server_port_ret();
+void ServerStates::handle_message(std::string_view line,
+                                  std::string &response) {
+    response.clear();
+
+    auto record = parse_wire_line(line);
+    if (!record) {
+        spdlog::error("Invalid server message ({}): {}",
+                      wire_error_string(record.error()), line);
+        request_epsp_client_end_sess(response);
+        return;
     }
-    if (code == std::to_underlying(epsp_server_code_t::EPSP_SERVER_PEER_DAT) &&
-        server_state_ == epsp_state_server_t::EPSP_STATE_SERVER_WAIT_PEER_DAT) {
-        server_state_ = epsp_state_server_t::EPSP_STATE_SERVER_WAIT_KEY_ASGN;
-        return return_epsp_server_peer_dat(data);
+
+    if (200 <= record->code && record->code < 300) {
+        return_server_codes(record->code, record->payload, response);
     }
-    if (code == std::to_underlying(epsp_server_code_t::EPSP_SERVER_END_SESS) &&
-        server_state_ == epsp_state_server_t::EPSP_STATE_SERVER_DISCONNECTED) {
+}
+
+void ServerStates::return_server_codes(uint16_t code, std::string_view data,
+                                       std::string &response) {
+    auto row = find_transition<SERVER_CODE_BASE, SERVER_CODE_SPAN>(
+        Dispatch::index, server_state_, code);
+    if (row == DISPATCH_NONE) {
         server_state_ = epsp_state_server_t::EPSP_STATE_SERVER_DISCONNECTED;
-        spdlog::info("Server end session");
-        return "stop";
+        request_epsp_client_end_sess(response);
+        return;
     }
-    server_state_ = epsp_state_server_t::EPSP_STATE_SERVER_DISCONNECTED;
-    return request_epsp_client_end_sess();
+
+    const auto &transition = Dispatch::transitions.at(row);
+    server_state_ = transition.next;
+    (this->*transition.handler)(data, response);
 }
 
-auto ServerStates::return_epsp_server_prtl_qry() -> std::string {
-    return std::to_string(
-               std::to_underlying(epsp_client_code_t::EPSP_CLIENT_PRTL_VER)) +
-           " 1 " + std::string(EPSP_PROTOCOL_VER) + ':' +
-           std::string(EPSP_CLIENT_NAME) + ':' + std::string(EPSP_CLIENT_VER) +
-           "\r\n";
+void ServerStates::return_epsp_server_prtl_qry(std::string_view /*data*/,
+                                               std::string &response) {
+    append_code(response, epsp_client_code_t::EPSP_CLIENT_PRTL_VER);
+    response += " 1 ";
+    response += EPSP_PROTOCOL_VER;
+    response += ':';
+    response += EPSP_CLIENT_NAME;
+    response += ':';
+    response += EPSP_CLIENT_VER;
+    response += "\r\n";
 }
 
-auto ServerStates::return_epsp_server_prtl_ret() -> std::string {
-    return std::to_string(
-               std::to_underlying(epsp_client_code_t::EPSP_CLIENT_PID_TEMP)) +
-           " 1\r\n";
+void ServerStates::return_epsp_server_prtl_ret(std::string_view /*data*/,
+                                               std::string &response) {
+    append_code(response, epsp_client_code_t::EPSP_CLIENT_PID_TEMP);
+    response += " 1\r\n";
 }
 
-auto ServerStates::return_epsp_server_pid_temp(uint16_t port) -> std::string {
-    return std::to_string(
-               std::to_underlying(epsp_client_code_t::EPSP_CLIENT_PORT_CHK)) +
-           " 1 " + std::to_string(peer_id) + ":" + std::to_string(port) +
-           "\r\n";
+void ServerStates::return_epsp_server_pid_temp(std::string_view data,
+                                               std::string &response) {
+    uint32_t temp_id = 0;
+    auto [ptr, errc] =
+        std::from_chars(data.data(), data.data() + data.size(), temp_id);
+    if (errc != std::errc() || has_session_id()) {
+        std::error_code ecode = std::make_error_code(errc);
+        spdlog::error("Error parsing server temp id: {}", ecode.message());
+        request_epsp_client_end_sess(response);
+        return;
+    }
+
+    peer_id.store(temp_id, std::memory_order_relaxed);
+    append_code(response, epsp_client_code_t::EPSP_CLIENT_PORT_CHK);
+    response += " 1 ";
+    response += std::to_string(temp_id);
+    response += ':';
+    response += std::to_string(EPSP_PORT);
+    response += "\r\n";
 }
 
-auto ServerStates::return_epsp_server_port_ret() -> std::string {
-    return std::to_string(
-               std::to_underlying(epsp_client_code_t::EPSP_CLIENT_PEER_QRY)) +
-           " 1 " + std::to_string(peer_id) + "\r\n";
+void ServerStates::return_epsp_server_port_ret(std::string_view /*data*/,
+                                               std::string &response) {
+    append_code(response, epsp_client_code_t::EPSP_CLIENT_PEER_QRY);
+    response += " 1 ";
+    response += std::to_string(peer_id);
+    response += "\r\n";
 }
 
-auto ServerStates::return_epsp_server_peer_dat(std::string_view data)
-    -> std::string {
+void ServerStates::return_epsp_server_peer_dat(std::string_view data,
+                                               std::string &response) {
     size_t index = 0;
-    std::vector<uint32_t> successful_conn;
+    pending_peers_.clear();
     while (index < data.size()) {
         size_t colon_pos = data.find(':', index);
         std::string_view peer;
@@ -120,7 +189,9 @@ auto ServerStates::return_epsp_server_peer_dat(std::string_view data)
 
         if (comma1 == std::string::npos || comma2 == std::string::npos) {
             spdlog::error("Invalid peer data: {}", data);
-            return request_epsp_client_end_sess();
+            pending_peers_.clear();
+            request_epsp_client_end_sess(response);
+            return;
         }
 
         std::string_view ip_str = peer.substr(0, comma1);
@@ -146,126 +217,213 @@ auto ServerStates::return_epsp_server_peer_dat(std::string_view data)
 
         uint32_t pid = 0;
         std::from_chars(pid_str.data(), pid_str.data() + pid_str.size(), pid);
-        asio::ip::tcp::endpoint endpoint(ip_addr, port);
-
-        if (peer_ && peer_->start(pid, endpoint)) {
-            successful_conn.push_back(pid);
-        }
+        pending_peers_.push_back(
+            {.peer_id = pid,
+             .endpoint = asio::ip::tcp::endpoint(ip_addr, port)});
     }
-    if (successful_conn.size() == 0) {
-        return request_epsp_client_end_sess();
+    if (pending_peers_.empty() || !peer_) {
+        pending_peers_.clear();
+        request_epsp_client_end_sess(response);
     }
+}
+
+void ServerStates::connect_pending_peers(
+    std::function<void(std::string)> on_reply) {
+    auto candidates = std::move(pending_peers_);
+    pending_peers_.clear();
+
+    peer_->connect_all(
+        std::move(candidates), PeerConnectOptions{},
+        [on_reply = std::move(on_reply)](
+            const std::vector<PeerConnectResult> &results) -> void {
+            std::string response;
+            return_epsp_client_peer_con(results, response);
+            on_reply(std::move(response));
+        });
+}
 
+void ServerStates::return_epsp_client_peer_con(
+    const std::vector<PeerConnectResult> &results, std::string &response) {
     std::string payload;
-    for (auto pid : successful_conn) {
-        payload += std::to_string(pid) + ":";
+    for (const auto &result : results) {
+        if (result.connected) {
+            payload += std::to_string(result.peer_id) + ":";
+        }
     }
+    if (payload.empty()) {
+        request_epsp_client_end_sess(response);
+        return;
+    }
+
     payload.pop_back();
-    return std::to_string(
-               std::to_underlying(epsp_client_code_t::EPSP_CLIENT_PEER_CON)) +
-           " 1 " + payload + "\r\n";
+    append_code(response, epsp_client_code_t::EPSP_CLIENT_PEER_CON);
+    response += " 1 ";
+    response += payload;
+    response += "\r\n";
+}
+
+void ServerStates::return_epsp_server_peer_rgn(std::string_view data,
+                                               std::string & /*response*/) {
+    if (!parse_region_peers(data, region_peers_)) {
+        spdlog::error("Invalid region peer counts: {}", data);
+        return;
+    }
+    detections().set_active_peers(region_peers_);
+}
+
+void ServerStates::return_epsp_server_end_sess(std::string_view /*data*/,
+                                               std::string &response) {
+    spdlog::info("Server end session");
+    response = "stop";
 }
 
-auto ServerStates::request_epsp_client_end_sess() -> std::string {
-    return std::to_string(
-               std::to_underlying(epsp_client_code_t::EPSP_CLIENT_END_SESS)) +
-           " 1\r\n";
+void ServerStates::request_epsp_client_end_sess(std::string &response) {
+    append_code(response, epsp_client_code_t::EPSP_CLIENT_END_SESS);
+    response += " 1\r\n";
 }
 
+struct PeerStates::Dispatch {
+    using state = epsp_state_peer_t;
+    using code = epsp_peer_code_t;
+
+    static constexpr std::array transitions = {
+        transition<&PeerStates::return_peer_prtl_req>(
+            state::EPSP_STATE_PEER_DISCONNECTED, code::EPSP_PEER_PRTL_REQ,
+            state::EPSP_STATE_PEER_WAIT_PID_RQST),
+        transition<&PeerStates::return_peer_prtl_rep>(
+            state::EPSP_STATE_PEER_WAIT_PRTL_REP, code::EPSP_PEER_PRTL_REP,
+            state::EPSP_STATE_PEER_WAIT_PID_REPL),
+        transition<&PeerStates::return_peer_pid_rqst>(
+            state::EPSP_STATE_PEER_WAIT_PID_RQST, code::EPSP_PEER_PID_RQST,
+            state::EPSP_STATE_PEER_CONNECTED),
+        transition<&PeerStates::return_peer_pid_repl>(
+            state::EPSP_STATE_PEER_WAIT_PID_REPL, code::EPSP_PEER_PID_REPL,
+            state::EPSP_STATE_PEER_CONNECTED),
+
+        transition<&PeerStates::return_peer_echo_req>(
+            state::EPSP_STATE_PEER_CONNECTED, code::EPSP_PEER_ECHO_REQ,
+            state::EPSP_STATE_PEER_CONNECTED),
+        transition<&PeerStates::return_peer_relay>(
+            state::EPSP_STATE_PEER_CONNECTED, code::EPSP_PEER_EQK_INFO,
+            state::EPSP_STATE_PEER_CONNECTED),
+        transition<&PeerStates::return_peer_relay>(
+            state::EPSP_STATE_PEER_CONNECTED, code::EPSP_PEER_TSU_INFO,
+            state::EPSP_STATE_PEER_CONNECTED),
+        transition<&PeerStates::return_peer_relay>(
+            state::EPSP_STATE_PEER_CONNECTED, code::EPSP_PEER_EQK_DTCT,
+            state::EPSP_STATE_PEER_CONNECTED),
+        transition<&PeerStates::return_peer_relay>(
+            state::EPSP_STATE_PEER_CONNECTED, code::EPSP_PEER_PEER_CPR,
+            state::EPSP_STATE_PEER_CONNECTED),
+    };
+
+    static constexpr auto index =
+        make_dispatch_table<PEER_STATE_COUNT, PEER_CODE_BASE, PEER_CODE_SPAN>(
+            transitions);
+};
+
 PeerStates::PeerStates() = default;
 
-auto PeerStates::handle_message(std::string &line,
+auto PeerStates::handle_message(std::string_view line,
                                 epsp_state_peer_t &peer_state)
     -> std::optional<PeerReply> {
-    if (line.back() == '\r') {
-        line.pop_back();
+    std::optional<PeerReply> message(PeerReply{});
+    if (!handle_message(line, peer_state, *message)) {
+        message = std::nullopt;
     }
+    return message;
+}
 
-    uint16_t code = std::stoul(line.substr(0, 3));
-
-    size_t pos = line.find(' ', 4);
-    if (pos == std::string::npos) {
-        spdlog::error("Invalid message: {}", line);
+auto PeerStates::handle_message(std::string_view line,
+                                epsp_state_peer_t &peer_state, PeerReply &reply)
+    -> bool {
+    auto record = parse_wire_line(line);
+    if (!record) {
+        spdlog::error("Invalid message ({}): {}",
+                      wire_error_string(record.error()), line);
+        return false;
     }
-    uint8_t hop = std::stoul(line.substr(4, pos - 4));
 
-    std::string data;
-    if (line.size() > 6) {
-        data = line.substr(6);
+    if (record->hop >= std::max(10, static_cast<int>(std::sqrt(total_peer)))) {
+        return false;
     }
 
-    if (hop >= std::max(10, static_cast<int>(std::sqrt(total_peer)))) {
-        return std::nullopt;
+    if (peer_state == epsp_state_peer_t::EPSP_STATE_PEER_CONNECTED &&
+        is_relay_code(record->code)) {
+        std::lock_guard<std::mutex> lock(relayed_mutex_);
+        if (!relayed_.insert(record->code, record->payload)) {
+            return false;
+        }
     }
 
-    std::optional<PeerReply> message(PeerReply{});
-    message->code = code;
-    message->hop = hop;
-    message->payload = data;
+    reply.target = epsp_peer_target_t::TARGET_NONE;
+    reply.code = record->code;
+    reply.hop = record->hop;
+    reply.payload.assign(record->payload);
 
-    if (500 <= code && code < 700) {
-        return_peer_codes(message, peer_state);
+    if (500 <= record->code && record->code < 700) {
+        return return_peer_codes(reply, peer_state);
     }
+    return true;
+}
 
-    return message;
+auto PeerStates::return_peer_codes(PeerReply &message,
+                                   epsp_state_peer_t &peer_state) -> bool {
+    auto row = find_transition<PEER_CODE_BASE, PEER_CODE_SPAN>(
+        Dispatch::index, peer_state, message.code);
+    if (row == DISPATCH_NONE) {
+        return false;
+    }
+
+    const auto &transition = Dispatch::transitions.at(row);
+    peer_state = transition.next;
+    return transition.handler(message);
 }
 
-void PeerStates::return_peer_codes(std::optional<PeerReply> &message,
-                                   epsp_state_peer_t &peer_state) {
+auto PeerStates::return_peer_prtl_req(PeerReply &message) -> bool {
+    message.target = epsp_peer_target_t::TARGET_UNICAST;
+    message.code = std::to_underlying(epsp_peer_code_t::EPSP_PEER_PRTL_REP);
+    message.hop = 1;
+    message.payload = std::string(EPSP_PROTOCOL_VER) + ":" +
+                      std::string(EPSP_CLIENT_NAME) + ":" +
+                      std::string(EPSP_CLIENT_VER);
+    return true;
+}
 
-    if (message->code ==
-            std::to_underlying(epsp_peer_code_t::EPSP_PEER_PRTL_REQ) &&
-        peer_state == epsp_state_peer_t::EPSP_STATE_PEER_DISCONNECTED) {
-        peer_state = epsp_state_peer_t::EPSP_STATE_PEER_WAIT_PID_RQST;
-        return_peer_prtl_req(message);
-        return;
-    }
-    if (message->code ==
-            std::to_underlying(epsp_peer_code_t::EPSP_PEER_PRTL_REP) &&
-        peer_state == epsp_state_peer_t::EPSP_STATE_PEER_WAIT_PRTL_REP) {
-        peer_state = epsp_state_peer_t::EPSP_STATE_PEER_WAIT_PID_REPL;
-        return_peer_prtl_rep(message);
-        return;
-    }
-    if (message->code ==
-            std::to_underlying(epsp_peer_code_t::EPSP_PEER_PID_RQST) &&
-        peer_state == epsp_state_peer_t::EPSP_STATE_PEER_WAIT_PID_RQST) {
-        peer_state = epsp_state_peer_t::EPSP_STATE_PEER_CONNECTED;
-        uint32_t temp_id = 0;
-        if (has_session_id()) {
-            temp_id = peer_id.load(std::memory_order_relaxed);
-        }
-        return_peer_pid_rqst(temp_id, message);
-        return;
-    }
-    if (message->code ==
-            std::to_underlying(epsp_peer_code_t::EPSP_PEER_PID_REPL) &&
-        peer_state == epsp_state_peer_t::EPSP_STATE_PEER_WAIT_PID_REPL) {
-        peer_state = epsp_state_peer_t::EPSP_STATE_PEER_CONNECTED;
-        message = std::nullopt;
-        return;
+auto PeerStates::return_peer_prtl_rep(PeerReply &message) -> bool {
+    message.target = epsp_peer_target_t::TARGET_UNICAST;
+    message.code = std::to_underlying(epsp_peer_code_t::EPSP_PEER_PID_RQST);
+    message.hop = 1;
+    message.payload.clear();
+    return true;
+}
+
+auto PeerStates::return_peer_pid_rqst(PeerReply &message) -> bool {
+    uint32_t temp_id = 0;
+    if (has_session_id()) {
+        temp_id = peer_id.load(std::memory_order_relaxed);
     }
-    message = std::nullopt;
+    message.target = epsp_peer_target_t::TARGET_UNICAST;
+    message.code = std::to_underlying(epsp_peer_code_t::EPSP_PEER_PID_REPL);
+    message.hop = 1;
+    message.payload = std::to_string(temp_id);
+    return true;
 }
 
-void PeerStates::return_peer_prtl_req(std::optional<PeerReply> &message) {
-    message->target = epsp_peer_target_t::TARGET_UNICAST;
-    message->code = std::to_underlying(epsp_peer_code_t::EPSP_PEER_PRTL_REP);
-    message->hop = 1;
-    message->payload = std::string(EPSP_PROTOCOL_VER) + ":" +
-                       std::string(EPSP_CLIENT_NAME) + ":" +
-                       std::string(EPSP_CLIENT_VER);
+auto PeerStates::return_peer_pid_repl(PeerReply & /*message*/) -> bool {
+    return false;
 }
-void PeerStates::return_peer_prtl_rep(std::optional<PeerReply> &message) {
-    message->target = epsp_peer_target_t::TARGET_UNICAST;
-    message->code = std::to_underlying(epsp_peer_code_t::EPSP_PEER_PID_RQST);
-    message->hop = 1;
-    message->payload = "";
+
+auto PeerStates::return_peer_echo_req(PeerReply &message) -> bool {
+    message.target = epsp_peer_target_t::TARGET_UNICAST;
+    message.code = std::to_underlying(epsp_peer_code_t::EPSP_PEER_ECHO_REP);
+    message.hop = 1;
+    message.payload.clear();
+    return true;
 }
-void PeerStates::return_peer_pid_rqst(uint32_t pid,
-                                      std::optional<PeerReply> &message) {
-    message->target = epsp_peer_target_t::TARGET_UNICAST;
-    message->code = std::to_underlying(epsp_peer_code_t::EPSP_PEER_PID_REPL);
-    message->hop = 1;
-    message->payload = std::to_string(pid);
+
+auto PeerStates::return_peer_relay(PeerReply &message) -> bool {
+    message.target = epsp_peer_target_t::TARGET_BROADCAST;
+    message.hop++;
+    return true;
 }
@@ -1,6 +1,9 @@
 #pragma once
+#include "detections.h"
+#include "seen_cache.h"
 #include <asio/io_context.hpp>
 #include <asio/ip/tcp.hpp>
+#include <mutex>
 
 // define codes
 enum class epsp_client_code_t : uint8_t {
@@ -93,28 +96,61 @@ enum class epsp_peer_target_t : uint8_t {
 };
 
 class ConnectionPeer;
+struct PeerConnectResult;
+
+// One entry of the 235 peer list.
+struct PeerCandidate {
+    uint32_t peer_id;
+    asio::ip::tcp::endpoint endpoint;
+};
 
 class ServerStates {
 public:
     explicit ServerStates(epsp_state_server_t server_state,
                           std::shared_ptr<ConnectionPeer> peer);
 
-    auto handle_message(std::string &line) -> std::string;
+    auto handle_message(std::string_view line) -> std::string;
+    // Same as above, but writes into a caller-owned buffer (cleared first).
+    void handle_message(std::string_view line, std::string &response);
+
+    // 235 leaves the 155 reply pending until the peer connections settle.
+    [[nodiscard]] auto has_pending_peers() const -> bool {
+        return !pending_peers_.empty();
+    }
+    // Connects to the pending 235 peers and calls `on_reply` with the 155
+    // (or 119) line. `on_reply` runs on the peer io_context.
+    void connect_pending_peers(std::function<void(std::string)> on_reply);
 
 private:
+    struct Dispatch;
+
     epsp_state_server_t server_state_ =
         epsp_state_server_t::EPSP_STATE_SERVER_DISCONNECTED;
     std::shared_ptr<ConnectionPeer> peer_;
-
-    auto return_server_codes(uint16_t code, std::string_view data)
-        -> std::string;
-
-    static auto return_epsp_server_prtl_qry() -> std::string;
-    static auto return_epsp_server_prtl_ret() -> std::string;
-    static auto return_epsp_server_pid_temp(uint16_t port) -> std::string;
-    static auto return_epsp_server_port_ret() -> std::string;
-    auto return_epsp_server_peer_dat(std::string_view data) -> std::string;
-    static auto request_epsp_client_end_sess() -> std::string;
+    std::vector<PeerCandidate> pending_peers_;
+    std::vector<RegionPeers> region_peers_; // reused by every 247
+
+    void return_server_codes(uint16_t code, std::string_view data,
+                             std::string &response);
+
+    void return_epsp_server_prtl_qry(std::string_view data,
+                                     std::string &response);
+    void return_epsp_server_prtl_ret(std::string_view data,
+                                     std::string &response);
+    void return_epsp_server_pid_temp(std::string_view data,
+                                     std::string &response);
+    void return_epsp_server_port_ret(std::string_view data,
+                                     std::string &response);
+    void return_epsp_server_peer_dat(std::string_view data,
+                                     std::string &response);
+    void return_epsp_server_peer_rgn(std::string_view data,
+                                     std::string &response);
+    void return_epsp_server_end_sess(std::string_view data,
+                                     std::string &response);
+    static void
+    return_epsp_client_peer_con(const std::vector<PeerConnectResult> &results,
+                                std::string &response);
+    static void request_epsp_client_end_sess(std::string &response);
 };
 
 class PeerStates {
@@ -128,14 +164,33 @@ public:
 
     explicit PeerStates();
 
-    auto handle_message(std::string &line, epsp_state_peer_t &peer_state)
+    auto handle_message(std::string_view line, epsp_state_peer_t &peer_state)
         -> std::optional<PeerReply>;
+    // Same as above, but fills a caller-owned reply whose payload keeps its
+    // capacity across calls. Returns false if there is nothing to send.
+    auto handle_message(std::string_view line, epsp_state_peer_t &peer_state,
+                        PeerReply &reply) -> bool;
+
+    [[nodiscard]] auto relay_stats() const -> SeenCacheStats {
+        std::lock_guard<std::mutex> lock(relayed_mutex_);
+        return relayed_.stats();
+    }
 
 private:
-    static void return_peer_codes(std::optional<PeerReply> &message,
-                                  epsp_state_peer_t &peer_state);
-    static void return_peer_prtl_req(std::optional<PeerReply> &message);
-    static void return_peer_prtl_rep(std::optional<PeerReply> &message);
-    static void return_peer_pid_rqst(uint32_t pid,
-                                     std::optional<PeerReply> &message);
+    struct Dispatch;
+
+    // The same report arrives from every neighbour; relay it only once.
+    // Peers parse on their own strands and share one cache.
+    mutable std::mutex relayed_mutex_;
+    SeenCache relayed_;
+
+    static auto return_peer_codes(PeerReply &message,
+                                  epsp_state_peer_t &peer_state) -> bool;
+    // Handlers fill the reply in place; returning false drops it.
+    static auto return_peer_prtl_req(PeerReply &message) -> bool;
+    static auto return_peer_prtl_rep(PeerReply &message) -> bool;
+    static auto return_peer_pid_rqst(PeerReply &message) -> bool;
+    static auto return_peer_pid_repl(PeerReply &message) -> bool;
+    static auto return_peer_echo_req(PeerReply &message) -> bool;
+    static auto return_peer_relay(PeerReply &message) -> bool;
 };
@@ -0,0 +1,63 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Recycles the buffers a connection encodes its messages into. The pool
+// keeps a reference to every buffer it hands out; once the last write
+// holding one has finished (use_count() is back to 1) the next acquire()
+// reuses it, capacity and control block included. Buffers come back in
+// roughly the order they were handed out, so acquire() only looks at the
+// few oldest entries after the cursor and grows the pool if those are all
+// busy. Past `limit` buffers it hands out one-off ones instead.
+//
+// Only the owning strand calls acquire(); writers on other strands just
+// drop their SharedMessage copies.
+class MessagePool {
+public:
+    static constexpr std::size_t LIMIT = 1024;
+
+    explicit MessagePool(std::size_t limit = LIMIT) : limit_(limit) {}
+    MessagePool(const MessagePool &) = delete;
+    auto operator=(const MessagePool &) -> MessagePool & = delete;
+
+    // An empty buffer to encode into; hand it on as a SharedMessage.
+    auto acquire() -> std::shared_ptr<std::string> {
+        auto window = std::min(entries_.size(), SCAN_LIMIT);
+        for (std::size_t scanned = 0; scanned < window; scanned++) {
+            auto &entry = entries_[cursor_];
+            cursor_ = cursor_ + 1 == entries_.size() ? 0 : cursor_ + 1;
+            if (entry.use_count() == 1) {
+                // The last holder released its copy with a release
+                // decrement; order its reads before our writes.
+                std::atomic_thread_fence(std::memory_order_acquire);
+                entry->clear();
+                reused_++;
+                return entry;
+            }
+        }
+        if (entries_.size() < limit_) {
+            entries_.push_back(std::make_shared<std::string>());
+            return entries_.back();
+        }
+        fallbacks_++;
+        return std::make_shared<std::string>();
+    }
+
+    [[nodiscard]] auto size() const -> std::size_t { return entries_.size(); }
+    [[nodiscard]] auto reused() const -> uint64_t { return reused_; }
+    [[nodiscard]] auto fallbacks() const -> uint64_t { return fallbacks_; }
+
+private:
+    static constexpr std::size_t SCAN_LIMIT = 4;
+
+    std::vector<std::shared_ptr<std::string>> entries_;
+    std::size_t limit_;
+    std::size_t cursor_ = 0;
+    uint64_t reused_ = 0;
+    uint64_t fallbacks_ = 0;
+};
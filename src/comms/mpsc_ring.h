@@ -0,0 +1,92 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <memory>
+#include <optional>
+#include <utility>
+
+// Bounded lock-free queue for many producers and one consumer. Every cell
+// carries a sequence number: producers claim a position with one CAS on
+// tail_ and publish by bumping the cell's sequence; the consumer only ever
+// reads its own head_. A full ring rejects the push instead of blocking.
+template <typename T> class MpscRing {
+public:
+    explicit MpscRing(std::size_t capacity)
+        : mask_(std::bit_ceil(std::max<std::size_t>(capacity, 2)) - 1),
+          cells_(std::make_unique<Cell[]>(mask_ + 1)) {
+        for (std::size_t i = 0; i <= mask_; i++) {
+            cells_[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+    MpscRing(const MpscRing &) = delete;
+    auto operator=(const MpscRing &) -> MpscRing & = delete;
+
+    // Any thread. False when the ring is full; `value` is left untouched.
+    auto try_push(T &&value) -> bool {
+        return try_emplace(
+            [&value](T &cell) -> void { cell = std::move(value); });
+    }
+
+    // Any thread. Like try_push, but `fill` writes the claimed cell in
+    // place, so buffers the cell already owns are reused.
+    template <typename Fill> auto try_emplace(Fill &&fill) -> bool {
+        auto position = tail_.load(std::memory_order_relaxed);
+        while (true) {
+            auto &cell = cells_[position & mask_];
+            auto sequence = cell.sequence.load(std::memory_order_acquire);
+            auto lag = static_cast<std::ptrdiff_t>(sequence) -
+                       static_cast<std::ptrdiff_t>(position);
+            if (lag == 0) {
+                if (tail_.compare_exchange_weak(position, position + 1,
+                                                std::memory_order_relaxed)) {
+                    fill(cell.value);
+                    cell.sequence.store(position + 1,
+                                        std::memory_order_release);
+                    return true;
+                }
+            } else if (lag < 0) {
+                return false;
+            } else {
+                position = tail_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // Consumer thread only.
+    auto try_pop() -> std::optional<T> {
+        return take([](T &cell) -> T { return std::move(cell); });
+    }
+
+    // Consumer thread only. Like try_pop, but copies the value out and
+    // leaves the cell's buffers to the next try_emplace.
+    auto try_copy() -> std::optional<T> {
+        return take([](const T &cell) -> T { return cell; });
+    }
+
+    [[nodiscard]] auto capacity() const -> std::size_t { return mask_ + 1; }
+
+private:
+    template <typename Take> auto take(Take &&from_cell) -> std::optional<T> {
+        auto &cell = cells_[head_ & mask_];
+        if (cell.sequence.load(std::memory_order_acquire) != head_ + 1) {
+            return std::nullopt;
+        }
+        std::optional<T> value(from_cell(cell.value));
+        cell.sequence.store(head_ + mask_ + 1, std::memory_order_release);
+        head_++;
+        return value;
+    }
+
+    struct Cell {
+        std::atomic<std::size_t> sequence;
+        T value;
+    };
+
+    std::size_t mask_;
+    std::unique_ptr<Cell[]> cells_;
+    // Producers hammer tail_; keep it off the consumer's cache line.
+    alignas(64) std::atomic<std::size_t> tail_{0};
+    alignas(64) std::size_t head_ = 0;
+};
@@ -0,0 +1,74 @@
+#include "outbound.h"
+#include <algorithm>
+
+OutboundQueue::OutboundQueue(OutboundPolicy policy) : policy_(policy) {}
+
+auto OutboundQueue::push(SharedMessage message) -> epsp_queue_push_t {
+    stats_.queued_bytes += message->size();
+    queue_.push_back(std::move(message));
+    stats_.queue_depth = queue_.size();
+    stats_.max_queue_depth =
+        std::max(stats_.max_queue_depth, stats_.queue_depth);
+
+    if (stats_.queued_bytes > policy_.high_watermark) {
+        congested_ = true;
+    }
+    if (!congested_) {
+        return epsp_queue_push_t::QUEUE_PUSH_OK;
+    }
+
+    if (policy_.slow_consumer ==
+        epsp_slow_consumer_t::SLOW_CONSUMER_DISCONNECT) {
+        return epsp_queue_push_t::QUEUE_PUSH_DISCONNECT;
+    }
+
+    // Keep the newest message even if it alone is above the low watermark.
+    std::size_t dropped = 0;
+    while (dropped + 1 < queue_.size() &&
+           stats_.queued_bytes > policy_.low_watermark) {
+        stats_.queued_bytes -= queue_[dropped]->size();
+        dropped++;
+    }
+    queue_.erase(queue_.begin(),
+                 queue_.begin() + static_cast<std::ptrdiff_t>(dropped));
+    stats_.dropped_messages += dropped;
+    stats_.queue_depth = queue_.size();
+    if (stats_.queued_bytes <= policy_.low_watermark) {
+        congested_ = false;
+    }
+    return dropped > 0 ? epsp_queue_push_t::QUEUE_PUSH_DROPPED
+                       : epsp_queue_push_t::QUEUE_PUSH_OK;
+}
+
+auto OutboundQueue::begin_flush(std::vector<SharedMessage> &batch) -> bool {
+    if (flushing_ || queue_.empty()) {
+        return false;
+    }
+
+    batch.clear();
+    batch.swap(queue_);
+    stats_.queued_bytes = 0;
+    stats_.queue_depth = 0;
+    flushing_ = true;
+    return true;
+}
+
+void OutboundQueue::end_flush(const std::vector<SharedMessage> &batch) {
+    flushing_ = false;
+    stats_.flushes++;
+    stats_.last_flush_messages = batch.size();
+    stats_.flushed_messages += batch.size();
+    for (const auto &message : batch) {
+        stats_.flushed_bytes += message->size();
+    }
+    if (stats_.queued_bytes <= policy_.low_watermark) {
+        congested_ = false;
+    }
+}
+
+void OutboundQueue::clear() {
+    queue_.clear();
+    stats_.queued_bytes = 0;
+    stats_.queue_depth = 0;
+    congested_ = false;
+}
@@ -0,0 +1,71 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Encoded once and shared by every outbound write that sends it; freed when
+// the last pending write completes.
+using SharedMessage = std::shared_ptr<const std::string>;
+
+enum class epsp_slow_consumer_t : uint8_t {
+    SLOW_CONSUMER_DROP_OLDEST,
+    SLOW_CONSUMER_DISCONNECT
+};
+
+enum class epsp_queue_push_t : uint8_t {
+    QUEUE_PUSH_OK,
+    QUEUE_PUSH_DROPPED,    // oldest queued messages were dropped to fit
+    QUEUE_PUSH_DISCONNECT, // policy says the peer must be disconnected
+};
+
+struct OutboundPolicy {
+    std::size_t high_watermark = 64 * 1024;
+    std::size_t low_watermark = 16 * 1024;
+    epsp_slow_consumer_t slow_consumer =
+        epsp_slow_consumer_t::SLOW_CONSUMER_DROP_OLDEST;
+};
+
+struct OutboundStats {
+    std::size_t queue_depth = 0;
+    std::size_t queued_bytes = 0;
+    std::size_t max_queue_depth = 0;
+    uint64_t flushes = 0;
+    uint64_t flushed_messages = 0;
+    uint64_t flushed_bytes = 0;
+    uint64_t last_flush_messages = 0;
+    uint64_t dropped_messages = 0;
+};
+
+// Bounded per-peer send queue. Everything queued while a write is in flight
+// goes out together in the next flush as one gather write. The queue and
+// the flushed batch trade vectors, so both keep their capacity.
+class OutboundQueue {
+public:
+    explicit OutboundQueue(OutboundPolicy policy = {});
+
+    auto push(SharedMessage message) -> epsp_queue_push_t;
+
+    // Hands all queued messages over in `batch` (its previous contents are
+    // discarded) and marks a flush in flight.
+    // Returns false if a flush is already in flight or nothing is queued.
+    auto begin_flush(std::vector<SharedMessage> &batch) -> bool;
+    void end_flush(const std::vector<SharedMessage> &batch);
+
+    [[nodiscard]] auto flushing() const -> bool { return flushing_; }
+    [[nodiscard]] auto congested() const -> bool { return congested_; }
+    [[nodiscard]] auto stats() const -> const OutboundStats & {
+        return stats_;
+    }
+
+    void set_policy(OutboundPolicy policy) { policy_ = policy; }
+    void clear();
+
+private:
+    OutboundPolicy policy_;
+    std::vector<SharedMessage> queue_;
+    OutboundStats stats_;
+    bool flushing_ = false;
+    bool congested_ = false;
+};
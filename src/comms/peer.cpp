@@ -1,21 +1,80 @@
 #include "peer.h"
 #include "comms.h"
+#include "detections.h"
+#include "event_channel.h"
 #include "message.h"
+#include <asio/bind_executor.hpp>
+#include <asio/co_spawn.hpp>
 #include <asio/connect.hpp>
+#include <asio/detached.hpp>
 #include <asio/error_code.hpp>
 #include <asio/ip/tcp.hpp>
-#include <asio/read_until.hpp>
+#include <asio/steady_timer.hpp>
 #include <asio/write.hpp>
+#include <span>
 using asio::ip::tcp;
 
+namespace {
+// Enough for a full 235 list without growing the pool.
+constexpr std::size_t PEER_POOL_SIZE = EPSP_MAX_PEERS * 4;
+
+constexpr std::array PEER_TIMERS = {epsp_timer_kind_t::TIMER_PEER_ECHO,
+                                    epsp_timer_kind_t::TIMER_PEER_IDLE,
+                                    epsp_timer_kind_t::TIMER_PEER_HANDSHAKE};
+
+auto protocol_request() -> const SharedMessage & {
+    static const SharedMessage message = std::make_shared<const std::string>(
+        std::to_string(
+            std::to_underlying(epsp_peer_code_t::EPSP_PEER_PRTL_REQ)) +
+        " 1 " + std::string(EPSP_PROTOCOL_VER) + ":" +
+        std::string(EPSP_CLIENT_NAME) + ":" + std::string(EPSP_CLIENT_VER) +
+        "\r\n");
+    return message;
+}
+
+auto echo_request() -> const SharedMessage & {
+    static const SharedMessage message = std::make_shared<const std::string>(
+        std::to_string(
+            std::to_underlying(epsp_peer_code_t::EPSP_PEER_ECHO_REQ)) +
+        " 1\r\n");
+    return message;
+}
+} // namespace
+
+// Acquired on the table strand, released from whichever strand drops the
+// last reference.
+struct ConnectionPeer::PeerPool {
+    asio::io_context &io_context;
+    std::mutex mutex;
+    std::vector<std::unique_ptr<Peer>> storage;
+    std::vector<Peer *> free;
+
+    PeerPool(asio::io_context &io_context, std::size_t capacity)
+        : io_context(io_context) {
+        storage.reserve(capacity);
+        free.reserve(capacity);
+        grow(capacity);
+    }
+
+    void grow(std::size_t count) {
+        for (std::size_t i = 0; i < count; i++) {
+            storage.push_back(std::make_unique<Peer>(io_context));
+            free.push_back(storage.back().get());
+        }
+    }
+};
+
 auto ConnectionPeer::create(asio::io_context &io_context)
     -> std::shared_ptr<ConnectionPeer> {
     return std::shared_ptr<ConnectionPeer>(new ConnectionPeer(io_context));
 }
 
 ConnectionPeer::ConnectionPeer(asio::io_context &io_context)
-    : peer_logger_(spdlog::default_logger()->clone("\033[35mpeer\033[0m")),
-      io_context_(io_context), acceptor_(io_context) {};
+    : peer_pool_(std::make_shared<PeerPool>(io_context, PEER_POOL_SIZE)),
+      peer_logger_(spdlog::default_logger()->clone("\033[35mpeer\033[0m")),
+      io_context_(io_context), strand_(asio::make_strand(io_context)),
+      acceptor_(strand_), liveness_(liveness_options_.tick),
+      liveness_timer_(strand_) {};
 
 void ConnectionPeer::start_acceptor() {
     tcp::endpoint endpoint(tcp::v4(), 6911);
@@ -31,197 +90,723 @@ void ConnectionPeer::stop_acceptor() { acceptor_.close(); }
 
 void ConnectionPeer::do_accept() {
     auto self(shared_from_this());
+    // Accept straight into a pooled peer, so the socket is already bound to
+    // the peer's strand.
+    auto peer = acquire_peer();
     acceptor_.async_accept(
-        [self](asio::error_code ecode, tcp::socket socket) -> void {
+        peer->socket,
+        bind_memory(accept_memory_, [self,
+                                     peer](asio::error_code ecode) -> void {
             if (ecode) {
                 self->peer_logger_->error("Accept error: {}", ecode.message());
             } else {
                 self->peer_logger_->info(
                     "New connection from {}:{}",
-                    socket.remote_endpoint().address().to_string(),
-                    socket.remote_endpoint().port());
-                self->handle_new_peer(std::move(socket));
+                    peer->socket.remote_endpoint().address().to_string(),
+                    peer->socket.remote_endpoint().port());
+                self->handle_new_peer(peer);
             }
 
             if (self->acceptor_.is_open()) {
                 self->do_accept();
             }
+        }));
+}
+
+auto ConnectionPeer::acquire_peer() -> std::shared_ptr<Peer> {
+    Peer *peer = nullptr;
+    {
+        auto &pool = *peer_pool_;
+        std::lock_guard<std::mutex> lock(pool.mutex);
+        if (pool.free.empty()) {
+            pool.grow(1);
+        }
+        peer = pool.free.back();
+        pool.free.pop_back();
+    }
+    peer->reset(shared_from_this());
+
+    // The deleter lives as long as the Peer's weak_this; drop the pool
+    // reference on release so the pool is not kept alive by its own peers.
+    return {peer, [pool = peer_pool_](Peer *released) mutable -> void {
+                asio::error_code ignored;
+                released->socket.close(ignored);
+                {
+                    std::lock_guard<std::mutex> lock(pool->mutex);
+                    pool->free.push_back(released);
+                }
+                pool.reset();
+            }};
+}
+
+auto ConnectionPeer::find_peer(uint32_t target_id) -> std::shared_ptr<Peer> {
+    auto found = std::ranges::find_if(
+        peers_, [target_id](const std::shared_ptr<Peer> &peer) -> bool {
+            return peer->peer_id == target_id;
         });
+    return found == peers_.end() ? nullptr : *found;
 }
 
-void ConnectionPeer::handle_new_peer(tcp::socket socket) {
-    auto peer = std::make_shared<Peer>(io_context_, shared_from_this());
+void ConnectionPeer::remove_peer(SlotHandle handle) {
+    if (!peers_.erase(handle)) {
+        return;
+    }
+    for (auto kind : PEER_TIMERS) {
+        liveness_.cancel({.owner = handle.index, .kind = kind});
+    }
+}
 
-    peer->endpoint = socket.remote_endpoint();
-    peer->socket = std::move(socket);
+void ConnectionPeer::handle_new_peer(const std::shared_ptr<Peer> &peer) {
+    peer->endpoint = peer->socket.remote_endpoint();
     peer->state = epsp_state_peer_t::EPSP_STATE_PEER_DISCONNECTED;
 
     // handle implementation still wip.
     // peer->read();
-    // peers_pending_.emplace(std::move(peer));
+    // peer->handle = peers_pending_.insert(std::move(peer));
 }
 
-auto ConnectionPeer::start(const uint32_t &target_id,
-                           const asio::ip::tcp::endpoint &endpoint) -> bool {
+namespace {
+// Shared by all attempts of one connect_all() call.
+struct ConnectRound {
+    std::vector<PeerConnectResult> results;
+    PeerConnectHandler on_done;
+    asio::steady_timer budget;
+    std::chrono::steady_clock::time_point started;
+    std::size_t pending = 0;
+    std::size_t connected = 0;
+    std::size_t enough = 0;
+    bool finished = false;
+
+    explicit ConnectRound(const IoStrand &strand)
+        : budget(strand), started(std::chrono::steady_clock::now()) {}
+
+    void finish() {
+        if (finished) {
+            return;
+        }
+        finished = true;
+        budget.cancel();
+        auto now = std::chrono::steady_clock::now();
+        for (auto &result : results) {
+            if (!result.completed) {
+                result.latency = now - started;
+            }
+        }
+        on_done(results);
+    }
+};
+} // namespace
+
+void ConnectionPeer::connect_all(std::vector<PeerCandidate> candidates,
+                                 PeerConnectOptions options,
+                                 PeerConnectHandler on_done) {
     auto self(shared_from_this());
-    auto peer = std::make_shared<Peer>(io_context_, shared_from_this());
+    asio::post(self->strand_, [self, candidates = std::move(candidates),
+                               options,
+                               on_done = std::move(on_done)] mutable -> void {
+        auto round = std::make_shared<ConnectRound>(self->strand_);
+        round->on_done = std::move(on_done);
+        round->pending = candidates.size();
+        round->enough = options.enough;
+        round->results.reserve(candidates.size());
 
-    peer->endpoint = endpoint;
-    peer->peer_id = target_id;
-    peer->state = epsp_state_peer_t::EPSP_STATE_PEER_WAIT_PID_RQST;
+        if (candidates.empty()) {
+            round->finish();
+            return;
+        }
 
-    asio::error_code ecode;
+        round->budget.expires_after(options.budget);
+        round->budget.async_wait([round](asio::error_code ecode) -> void {
+            if (!ecode) {
+                round->finish();
+            }
+        });
 
-    asio::connect(peer->socket, std::array<tcp::endpoint, 1>{endpoint}, ecode);
+        for (std::size_t i = 0; i < candidates.size(); i++) {
+            round->results.push_back({.peer_id = candidates[i].peer_id,
+                                      .endpoint = candidates[i].endpoint});
 
-    if (ecode) {
-        self->peer_logger_->error("Connect error: {}", ecode.message());
-        return false;
-    }
+            auto peer = self->acquire_peer();
+            peer->endpoint = candidates[i].endpoint;
+            peer->peer_id = candidates[i].peer_id;
+
+            // Until registered, the socket is only touched on strand_.
+            auto deadline = std::make_shared<asio::steady_timer>(
+                self->strand_, options.attempt_timeout);
+            deadline->async_wait([peer](asio::error_code ecode) -> void {
+                if (!ecode) {
+                    asio::error_code ignored;
+                    peer->socket.close(ignored);
+                }
+            });
+
+            peer->socket.async_connect(
+                peer->endpoint,
+                asio::bind_executor(self->strand_, [self, round, peer, deadline,
+                                                    i](asio::error_code ecode)
+                                                       -> void {
+                    deadline->cancel();
+                    auto &result = round->results[i];
+                    result.completed = !round->finished;
+                    result.latency =
+                        std::chrono::steady_clock::now() - round->started;
+                    round->pending--;
+
+                    if (ecode) {
+                        self->peer_logger_->error(
+                            "Connect error: {}, to: {}", ecode.message(),
+                            peer->endpoint.address().to_string() + ":" +
+                                std::to_string(peer->endpoint.port()));
+                    } else if (round->finished ||
+                               round->connected >= round->enough) {
+                        asio::error_code ignored;
+                        peer->socket.close(ignored);
+                    } else {
+                        result.connected = true;
+                        round->connected++;
+                        peer->connect_latency = result.latency;
+                        self->peer_logger_->info(
+                            "Connected to {} in {} ms",
+                            peer->endpoint.address().to_string() + ":" +
+                                std::to_string(peer->endpoint.port()),
+                            std::chrono::duration_cast<
+                                std::chrono::milliseconds>(result.latency)
+                                .count());
+                        self->register_peer(peer);
+                    }
+
+                    if (round->pending == 0 ||
+                        round->connected >= round->enough) {
+                        round->finish();
+                    }
+                }));
+        }
+    });
+}
 
-    peer->write_uni("614 1 " + std::string(EPSP_PROTOCOL_VER) + ":" +
-                    std::string(EPSP_CLIENT_NAME) + ":" +
-                    std::string(EPSP_CLIENT_VER) + "\r\n");
+void ConnectionPeer::register_peer(const std::shared_ptr<Peer> &peer) {
     peer->state = epsp_state_peer_t::EPSP_STATE_PEER_WAIT_PRTL_REP;
-    peer->read();
-    self->peers_.emplace(target_id, std::move(peer));
-    return true;
+    peer->last_seen = std::chrono::steady_clock::now();
+    peer->handle = peers_.insert(peer);
+    // The writer already coalesces everything queued into one gather write;
+    // Nagle would only hold the next one back for the peer's delayed ACK.
+    asio::error_code ignored;
+    peer->socket.set_option(tcp::no_delay(true), ignored);
+
+    // From here on the socket belongs to the peer's strand.
+    asio::post(peer->strand, [peer] -> void {
+        peer->write_uni(protocol_request());
+        peer->start();
+    });
+
+    auto slot = peer->handle.index;
+    start_liveness();
+    liveness_.schedule(
+        {.owner = slot, .kind = epsp_timer_kind_t::TIMER_PEER_HANDSHAKE},
+        liveness_options_.handshake_timeout);
+    liveness_.schedule(
+        {.owner = slot, .kind = epsp_timer_kind_t::TIMER_PEER_IDLE},
+        liveness_options_.idle_timeout);
+    liveness_.schedule(
+        {.owner = slot, .kind = epsp_timer_kind_t::TIMER_PEER_ECHO},
+        liveness_options_.echo_interval);
+    // Sized with the timers, so liveness ticks never grow it.
+    expired_.reserve(liveness_.size());
 }
 
-void ConnectionPeer::stop(uint32_t target_id) {
+void ConnectionPeer::evict_peer(const std::shared_ptr<Peer> &peer,
+                                std::string_view reason) {
+    peer_logger_->warn("Evicting peer {}: {}", peer->peer_id, reason);
     auto self(shared_from_this());
-    asio::post(io_context_, [self, target_id] -> void {
-        asio::error_code ecode;
-        self->peers_[target_id]->socket.shutdown(
-            asio::ip::tcp::socket::shutdown_both, ecode);
-        if (ecode) {
-            self->peer_logger_->warn("Shutdown error: {}", ecode.message());
+    asio::post(peer->strand,
+               [self, peer] -> void { self->close_peer(*peer); });
+    remove_peer(peer->handle);
+}
+
+void ConnectionPeer::set_liveness_options(LivenessOptions options) {
+    liveness_options_ = options;
+    liveness_ = TimerWheel(options.tick);
+}
+
+void ConnectionPeer::set_server_echo(
+    std::function<void(std::size_t connected)> on_echo) {
+    auto self(shared_from_this());
+    asio::post(strand_, [self, on_echo = std::move(on_echo)] mutable -> void {
+        self->server_echo_ = std::move(on_echo);
+        self->start_liveness();
+        self->liveness_.schedule(
+            {.owner = 0, .kind = epsp_timer_kind_t::TIMER_SERVER_ECHO},
+            self->liveness_options_.server_echo_interval);
+        self->expired_.reserve(self->liveness_.size());
+    });
+}
+
+void ConnectionPeer::liveness_stats(
+    std::function<void(std::vector<PeerLiveness>)> on_stats) {
+    auto self(shared_from_this());
+    asio::post(strand_, [self, on_stats = std::move(on_stats)] -> void {
+        auto now = std::chrono::steady_clock::now();
+        std::vector<PeerLiveness> stats;
+        stats.reserve(self->peers_.size());
+        for (const auto &peer : self->peers_) {
+            stats.push_back({.peer_id = peer->peer_id,
+                             .rtt = peer->rtt.load(),
+                             .idle = now - peer->last_seen.load()});
         }
-        self->peers_[target_id]->socket.close(ecode);
-        if (ecode) {
-            self->peer_logger_->error("Close error: {}", ecode.message());
+        on_stats(std::move(stats));
+    });
+}
+
+void ConnectionPeer::start_liveness() {
+    if (liveness_running_) {
+        return;
+    }
+    liveness_running_ = true;
+    on_liveness_tick();
+}
+
+void ConnectionPeer::on_liveness_tick() {
+    auto now = std::chrono::steady_clock::now();
+    expired_.clear();
+    liveness_.advance(now, expired_);
+    for (auto key : expired_) {
+        handle_timer(key);
+    }
+    // Slides the 555 windows even when no reports arrive.
+    detections().publish(now);
+
+    auto self(shared_from_this());
+    liveness_timer_.expires_after(liveness_.tick());
+    liveness_timer_.async_wait(
+        bind_memory(liveness_memory_, [self](asio::error_code ecode) -> void {
+            if (ecode) {
+                self->liveness_running_ = false;
+                return;
+            }
+            self->on_liveness_tick();
+        }));
+}
+
+void ConnectionPeer::handle_timer(TimerKey key) {
+    auto now = std::chrono::steady_clock::now();
+
+    if (key.kind == epsp_timer_kind_t::TIMER_SERVER_ECHO) {
+        if (server_echo_) {
+            std::size_t connected = std::ranges::count_if(
+                peers_, [](const std::shared_ptr<Peer> &peer) -> bool {
+                    return peer->state ==
+                           epsp_state_peer_t::EPSP_STATE_PEER_CONNECTED;
+                });
+            server_echo_(connected);
+        }
+        liveness_.schedule(key, liveness_options_.server_echo_interval);
+        return;
+    }
+
+    auto *found = peers_.get(peers_.handle_at(key.owner));
+    if (found == nullptr) {
+        return;
+    }
+    auto peer = *found;
+
+    switch (key.kind) {
+    case epsp_timer_kind_t::TIMER_PEER_ECHO: {
+        asio::post(peer->strand, [peer] -> void {
+            if (peer->state == epsp_state_peer_t::EPSP_STATE_PEER_CONNECTED) {
+                peer->echo_sent = std::chrono::steady_clock::now();
+                peer->write_uni(echo_request());
+            }
+        });
+        liveness_.schedule(key, liveness_options_.echo_interval);
+        break;
+    }
+    case epsp_timer_kind_t::TIMER_PEER_IDLE: {
+        auto idle = now - peer->last_seen.load();
+        if (idle >= liveness_options_.idle_timeout) {
+            evict_peer(peer, "idle timeout");
+            return;
+        }
+        liveness_.schedule(
+            key, std::chrono::duration_cast<std::chrono::milliseconds>(
+                     liveness_options_.idle_timeout - idle));
+        break;
+    }
+    case epsp_timer_kind_t::TIMER_PEER_HANDSHAKE:
+        if (peer->state != epsp_state_peer_t::EPSP_STATE_PEER_CONNECTED) {
+            evict_peer(peer, "handshake timeout");
+        }
+        break;
+    case epsp_timer_kind_t::TIMER_SERVER_ECHO:
+        break;
+    }
+}
+
+void ConnectionPeer::stop(uint32_t target_id) {
+    auto self(shared_from_this());
+    asio::post(strand_, [self, target_id] -> void {
+        if (auto peer = self->find_peer(target_id)) {
+            asio::post(peer->strand,
+                       [self, peer] -> void { self->close_peer(*peer); });
         }
     });
 }
 
+void ConnectionPeer::close_peer(Peer &peer) {
+    // Cancels the reader's pending read and wakes the writer to exit.
+    peer.write_signal.close();
+    asio::error_code ecode;
+    peer.socket.shutdown(asio::ip::tcp::socket::shutdown_both, ecode);
+    if (ecode) {
+        peer_logger_->warn("Shutdown error: {}", ecode.message());
+    }
+    peer.socket.close(ecode);
+    if (ecode) {
+        peer_logger_->error("Close error: {}", ecode.message());
+    }
+}
+
 void ConnectionPeer::stop_all() {
     auto self(shared_from_this());
-    asio::post(io_context_, [self] -> void {
+    asio::post(strand_, [self] -> void {
         self->stop_acceptor();
-        for (auto &[pid, _] : self->peers_) {
-            self->stop(pid);
+        for (auto &peer : self->peers_) {
+            asio::post(peer->strand,
+                       [self, peer] -> void { self->close_peer(*peer); });
+            for (auto kind : PEER_TIMERS) {
+                self->liveness_.cancel(
+                    {.owner = peer->handle.index, .kind = kind});
+            }
         }
 
         self->peers_.clear();
         self->peers_pending_.clear();
+        self->liveness_timer_.cancel();
     });
 }
 
-void ConnectionPeer::write_broad(const Peer &from_peer,
-                                 std::string_view message) {
+void ConnectionPeer::write_broad(SlotHandle from_peer, SharedMessage message) {
+    // Fan out from the table strand; each write then runs on its target's
+    // strand, so peers parse and send in parallel.
+    auto self(shared_from_this());
+    Broadcast broadcast{.from = from_peer, .message = std::move(message)};
+    if (!broadcasts_.try_push(std::move(broadcast))) {
+        // A full ring means fan-out is far behind; this one posts alone.
+        asio::post(strand_, [self, broadcast = std::move(broadcast)] -> void {
+            self->fan_out(broadcast);
+        });
+        return;
+    }
+    if (!fan_out_pending_.exchange(true, std::memory_order_acq_rel)) {
+        asio::post(strand_, bind_memory(fan_out_memory_, [self] -> void {
+                       self->fan_out();
+                   }));
+    }
+}
+
+void ConnectionPeer::fan_out() {
+    // Re-arm first, as EventChannel::drain does: a broadcast pushed after
+    // the last pop finds the flag clear and posts again.
+    fan_out_pending_.exchange(false, std::memory_order_acq_rel);
+    while (auto broadcast = broadcasts_.try_pop()) {
+        fan_out(*broadcast);
+    }
+}
+
+void ConnectionPeer::fan_out(const Broadcast &broadcast) {
     for (auto &peer : peers_) {
-        if (peer.second->state !=
-            epsp_state_peer_t::EPSP_STATE_PEER_CONNECTED) {
+        if (peer->state != epsp_state_peer_t::EPSP_STATE_PEER_CONNECTED ||
+            peer->handle == broadcast.from) {
             continue;
         }
-        if (peer.second->endpoint == from_peer.endpoint) {
-            continue;
-        }
-        peer.second->write_uni(message);
+        peer->deliver(broadcast.message);
     }
 }
-ConnectionPeer::Peer::Peer(asio::io_context &io_context,
-                           const std::shared_ptr<ConnectionPeer> &parent)
-    : parent(parent), peer_id(-1), socket(io_context) {}
 
-void ConnectionPeer::Peer::read() {
+void ConnectionPeer::set_outbound_policy(OutboundPolicy policy) {
+    outbound_policy_ = policy;
+}
+
+void ConnectionPeer::outbound_stats(
+    std::function<void(std::vector<std::pair<uint32_t, OutboundStats>>)>
+        on_stats) {
+    struct Collect {
+        std::mutex mutex;
+        std::vector<std::pair<uint32_t, OutboundStats>> stats;
+        std::size_t pending = 0;
+        decltype(on_stats) on_done;
+    };
+
     auto self(shared_from_this());
-    asio::async_read_until(
-        self->socket, self->buffer, '\n',
-        [self](asio::error_code ecode, std::size_t) -> void {
-            if (ecode) {
-                if (auto shared_parent = self->parent.lock()) {
-                    shared_parent->peer_logger_->error(
-                        "Read error: {}, from: {}", ecode.message(),
-                        self->endpoint.address().to_string() + ":" +
-                            std::to_string(self->endpoint.port()));
+    asio::post(strand_, [self, on_stats = std::move(on_stats)] mutable
+                            -> void {
+        auto collect = std::make_shared<Collect>();
+        collect->pending = self->peers_.size();
+        collect->on_done = std::move(on_stats);
+        if (collect->pending == 0) {
+            collect->on_done({});
+            return;
+        }
+        for (auto &peer : self->peers_) {
+            asio::post(peer->strand, [collect, peer] -> void {
+                std::unique_lock<std::mutex> lock(collect->mutex);
+                collect->stats.emplace_back(peer->peer_id,
+                                            peer->outbound.stats());
+                if (--collect->pending == 0) {
+                    lock.unlock();
+                    collect->on_done(std::move(collect->stats));
                 }
-                return;
-            }
+            });
+        }
+    });
+}
 
-            std::istream input(&self->buffer);
-            std::string line;
-            std::getline(input, line);
+ConnectionPeer::Peer::Peer(asio::io_context &io_context)
+    : peer_id(-1), strand(asio::make_strand(io_context)), socket(strand),
+      write_signal(strand) {}
 
-            if (auto shared_parent = self->parent.lock()) {
-                shared_parent->peer_logger_->info(
-                    "Received: {}, from: {}", line,
-                    self->endpoint.address().to_string() + ":" +
-                        std::to_string(self->endpoint.port()));
-            }
+void ConnectionPeer::Peer::reset(const std::shared_ptr<ConnectionPeer> &owner) {
+    asio::error_code ignored;
+    socket.close(ignored);
+
+    state = epsp_state_peer_t::EPSP_STATE_PEER_DISCONNECTED;
+    parent = owner;
+    last_seen = std::chrono::steady_clock::time_point{};
+    connect_latency = {};
+    echo_sent = {};
+    rtt = std::chrono::steady_clock::duration{};
+    peer_id = -1;
+    handle = {};
+    endpoint = {};
+
+    // Buffers keep their capacity across connections.
+    framer.reset();
+    lines.clear();
+    outbound = OutboundQueue(owner->outbound_policy_);
+    in_flight.clear();
+    gather.clear();
+    write_signal.reset();
+    while (inbox.try_pop()) {
+    }
+    inbox_pending = false;
+}
+
+void ConnectionPeer::Peer::start() {
+    auto self(shared_from_this());
+    asio::co_spawn(strand, reader(self), asio::detached);
+    asio::co_spawn(strand, writer(std::move(self)), asio::detached);
+}
+
+auto ConnectionPeer::Peer::reader(std::shared_ptr<Peer> /*self*/)
+    -> StrandAwaitable<void> {
+    auto from = endpoint.address().to_string() + ":" +
+                std::to_string(endpoint.port());
+    while (true) {
+        auto area = framer.write_area();
+        asio::error_code ecode;
+        auto bytes = co_await socket.async_read_some(
+            asio::buffer(area.data(), area.size()),
+            with_memory(read_memory,
+                        asio::redirect_error(use_strand_awaitable, ecode)));
+
+        auto shared_parent = parent.lock();
+        if (!shared_parent) {
+            break;
+        }
+        if (ecode) {
+            shared_parent->peer_logger_->error("Read error: {}, from: {}",
+                                               ecode.message(), from);
+            asio::post(shared_parent->strand_,
+                       [shared_parent, dropped = handle] -> void {
+                           shared_parent->remove_peer(dropped);
+                       });
+            break;
+        }
+
+        auto now = std::chrono::steady_clock::now();
+        last_seen = now;
 
+        framer.commit(bytes);
+        lines.clear();
+        auto framed = framer.take_lines(lines);
+
+        bool invalid = false;
+        for (auto line : lines) {
             if (line.size() < 5) {
-                if (auto shared_parent = self->parent.lock()) {
-                    shared_parent->peer_logger_->error(
-                        "Invalid message: {}, from: {}", line,
-                        self->endpoint.address().to_string() + ":" +
-                            std::to_string(self->endpoint.port()));
-                    shared_parent->stop(self->peer_id);
-                }
+                shared_parent->peer_logger_->error(
+                    "Invalid message: {}, from: {}", line, from);
+                invalid = true;
+                break;
+            }
 
-                return;
+            if (line.starts_with("631") &&
+                echo_sent.time_since_epoch().count() != 0) {
+                rtt = now - echo_sent;
             }
+            handle_message(*shared_parent, line, from);
+        }
+        if (invalid) {
+            drop("invalid message");
+            break;
+        }
 
-            self->handle_message(line);
-            self->read();
-        });
+        if (framed == epsp_framer_t::FRAMER_LINE_TOO_LONG) {
+            shared_parent->peer_logger_->error(
+                "Line exceeds {} bytes, from: {}", EPSP_MAX_LINE_LEN, from);
+            drop("line too long");
+            break;
+        }
+    }
+    write_signal.close();
 }
 
-void ConnectionPeer::Peer::handle_message(std::string &response) {
-    auto self(shared_from_this());
-    std::optional<PeerStates::PeerReply> message_struct;
-    if (auto shared_parent = parent.lock()) {
-        message_struct =
-            shared_parent->states_.handle_message(response, self->state);
-    }
+void ConnectionPeer::Peer::handle_message(ConnectionPeer &owner,
+                                          std::string_view response,
+                                          std::string_view from) {
+    auto peer_state = state.load();
+    bool replied = owner.states_.handle_message(response, peer_state, reply);
+    state = peer_state;
 
-    if (!message_struct.has_value()) {
+    // Duplicates were dropped above; a flood is counted in relay_stats(),
+    // not logged line by line. Codes outside 500-699 parse but answer
+    // nothing.
+    if (!replied || reply.target == epsp_peer_target_t::TARGET_NONE) {
         return;
     }
+    owner.peer_logger_->debug("Received: {}, from: {}", response, from);
+
+    auto buffer = messages.acquire();
+    encode_peer_reply(reply, *buffer);
+    SharedMessage message = std::move(buffer);
+    if (reply.target == epsp_peer_target_t::TARGET_UNICAST) {
+        write_uni(std::move(message));
+    } else if (reply.target == epsp_peer_target_t::TARGET_BROADCAST) {
+        owner.write_broad(handle, std::move(message));
+        if (reply.code ==
+            std::to_underlying(epsp_peer_code_t::EPSP_PEER_EQK_DTCT)) {
+            if (const auto *area = detection_area(reply.payload)) {
+                detections().record(*area);
+            }
+        }
+        // First sighting of a report: hand it to the GUI as well.
+        if (auto kind = relay_event_kind(reply.code)) {
+            net_events().publish(*kind, std::chrono::system_clock::now(),
+                                 reply.payload);
+        }
+    }
+}
 
-    std::string message = std::to_string(message_struct.value().code) + " " +
-                          std::to_string(message_struct.value().hop) + " " +
-                          message_struct.value().payload + "\r\n";
-    if (message_struct.value().target == epsp_peer_target_t::TARGET_UNICAST) {
-        write_uni(message);
-    } else if (message_struct.value().target ==
-               epsp_peer_target_t::TARGET_BROADCAST) {
+void ConnectionPeer::Peer::write_uni(SharedMessage response) {
+    auto result = outbound.push(std::move(response));
+    if (result == epsp_queue_push_t::QUEUE_PUSH_DISCONNECT) {
         if (auto shared_parent = parent.lock()) {
-            shared_parent->write_broad(*self, message);
+            shared_parent->peer_logger_->warn(
+                "Slow consumer, disconnecting: {}",
+                endpoint.address().to_string() + ":" +
+                    std::to_string(endpoint.port()));
         }
+        drop("slow consumer");
+        outbound.clear();
+        return;
     }
+    write_signal.notify();
 }
 
-void ConnectionPeer::Peer::write_uni(std::string_view response) {
-    auto self(shared_from_this());
-    asio::async_write(
-        socket, asio::buffer(response),
-        [self](asio::error_code ecode, std::size_t) -> void {
-            if (ecode) {
-                if (auto shared_parent = self->parent.lock()) {
-                    shared_parent->peer_logger_->error(
-                        "Write error: {}, to: {}", ecode.message(),
-                        self->endpoint.address().to_string() + ":" +
-                            std::to_string(self->endpoint.port()));
-                }
-            }
+void ConnectionPeer::Peer::deliver(SharedMessage message) {
+    if (!inbox.try_push(std::move(message))) {
+        // Inbox full: this message takes a post of its own.
+        asio::post(strand, [self = shared_from_this(), message] -> void {
+            self->write_uni(message);
         });
+        return;
+    }
+    if (!inbox_pending.exchange(true, std::memory_order_acq_rel)) {
+        asio::post(strand,
+                   bind_memory(inbox_memory, [self = shared_from_this()]
+                                   -> void { self->drain_inbox(); }));
+    }
+}
+
+void ConnectionPeer::Peer::drain_inbox() {
+    inbox_pending.exchange(false, std::memory_order_acq_rel);
+    while (auto message = inbox.try_pop()) {
+        write_uni(std::move(*message));
+    }
+}
+
+void ConnectionPeer::Peer::drop(std::string_view reason) {
+    auto shared_parent = parent.lock();
+    if (!shared_parent) {
+        return;
+    }
+    shared_parent->peer_logger_->warn("Dropping peer {}: {}", peer_id, reason);
+    shared_parent->close_peer(*this);
+    asio::post(shared_parent->strand_,
+               [shared_parent, dropped = handle] -> void {
+                   shared_parent->remove_peer(dropped);
+               });
+}
+
+auto ConnectionPeer::Peer::writer(std::shared_ptr<Peer> /*self*/)
+    -> StrandAwaitable<void> {
+    // Everything queued while a write is in flight goes out in the next
+    // gather write.
+    while (!write_signal.closed()) {
+        if (!outbound.begin_flush(in_flight)) {
+            co_await write_signal.wait();
+            continue;
+        }
+
+        gather.clear();
+        for (const auto &message : in_flight) {
+            gather.emplace_back(asio::buffer(*message));
+        }
+
+        asio::error_code ecode;
+        co_await asio::async_write(
+            socket, std::span<const asio::const_buffer>(gather),
+            with_memory(write_memory,
+                        asio::redirect_error(use_strand_awaitable, ecode)));
+        outbound.end_flush(in_flight);
+        in_flight.clear();
+        if (ecode) {
+            if (auto shared_parent = parent.lock()) {
+                shared_parent->peer_logger_->error(
+                    "Write error: {}, to: {}", ecode.message(),
+                    endpoint.address().to_string() + ":" +
+                        std::to_string(endpoint.port()));
+            }
+            outbound.clear();
+            break;
+        }
+    }
+}
+
+void encode_peer_reply(const PeerStates::PeerReply &reply,
+                       std::string &message) {
+    message.clear();
+    message.reserve(reply.payload.size() + 16);
+    message += std::to_string(reply.code);
+    message += ' ';
+    message += std::to_string(reply.hop);
+    message += ' ';
+    message += reply.payload;
+    message += "\r\n";
+}
+
+auto encode_peer_reply(const PeerStates::PeerReply &reply) -> SharedMessage {
+    auto message = std::make_shared<std::string>();
+    encode_peer_reply(reply, *message);
+    return message;
 }
 
 auto init_peer_connection() -> PeerInit {
-    auto peer_io_context = std::make_shared<asio::io_context>();
-    auto peer = ConnectionPeer::create(*peer_io_context);
-    PeerInit init_return = {.io_context = peer_io_context,
+    return init_peer_connection(std::make_shared<asio::io_context>());
+}
+
+auto init_peer_connection(std::shared_ptr<asio::io_context> io_context)
+    -> PeerInit {
+    auto peer = ConnectionPeer::create(*io_context);
+    PeerInit init_return = {.io_context = std::move(io_context),
                             .connection_peer = peer};
     return init_return;
 }
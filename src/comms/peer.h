@@ -1,19 +1,68 @@
 #pragma once
 
+#include "comms.h"
+#include "framer.h"
+#include "handler_memory.h"
+#include "io_pool.h"
 #include "message.h"
+#include "message_pool.h"
+#include "mpsc_ring.h"
+#include "outbound.h"
+#include "slot_map.h"
+#include "timer_wheel.h"
+#include "write_signal.h"
 #include <asio/io_context.hpp>
 #include <asio/ip/address.hpp>
 #include <asio/ip/tcp.hpp>
-#include <asio/streambuf.hpp>
+#include <asio/steady_timer.hpp>
 #include <cstdint>
 
+struct PeerConnectResult {
+    uint32_t peer_id;
+    asio::ip::tcp::endpoint endpoint;
+    bool connected = false;
+    bool completed = false; // false if the round ended first
+    std::chrono::steady_clock::duration latency{};
+};
+
+struct PeerConnectOptions {
+    std::chrono::milliseconds attempt_timeout{3000};
+    std::chrono::milliseconds budget{5000};
+    std::size_t enough = EPSP_MAX_PEERS;
+};
+
+struct LivenessOptions {
+    std::chrono::milliseconds tick{250};
+    std::chrono::milliseconds echo_interval{60'000};
+    std::chrono::milliseconds idle_timeout{180'000};
+    std::chrono::milliseconds handshake_timeout{15'000};
+    std::chrono::milliseconds server_echo_interval{600'000};
+};
+
+struct PeerLiveness {
+    uint32_t peer_id;
+    std::chrono::steady_clock::duration rtt; // last 611 -> 631 round trip
+    std::chrono::steady_clock::duration idle;
+};
+
+using PeerConnectHandler =
+    std::function<void(const std::vector<PeerConnectResult> &results)>;
+
+// Writes `reply` as one wire line into `message`, which is cleared first.
+void encode_peer_reply(const PeerStates::PeerReply &reply,
+                       std::string &message);
+auto encode_peer_reply(const PeerStates::PeerReply &reply) -> SharedMessage;
+
 class ConnectionPeer : public std::enable_shared_from_this<ConnectionPeer> {
 public:
     static auto create(asio::io_context &io_context)
         -> std::shared_ptr<ConnectionPeer>;
 
-    auto start(const uint32_t &target_id,
-               const asio::ip::tcp::endpoint &endpoint) -> bool;
+    // Connects to every candidate at once. `on_done` runs on the peer table
+    // strand once all attempts finish, `options.enough` succeed, or the
+    // budget runs out, whichever comes first.
+    void connect_all(std::vector<PeerCandidate> candidates,
+                     PeerConnectOptions options, PeerConnectHandler on_done);
     void stop(uint32_t target_id);
 
     void start_acceptor();
@@ -21,37 +70,138 @@ public:
 
     void stop_all();
 
+    // Applies to peers created afterwards.
+    void set_outbound_policy(OutboundPolicy policy);
+    // Per-peer send queue counters, gathered from each peer's strand.
+    void outbound_stats(
+        std::function<void(std::vector<std::pair<uint32_t, OutboundStats>>)>
+            on_stats);
+
+    // Must be set before the first peer connects.
+    void set_liveness_options(LivenessOptions options);
+    // Called on the peer table strand every server_echo_interval with the
+    // number of connected peers, to drive the 123 echo to the server.
+    void set_server_echo(std::function<void(std::size_t connected)> on_echo);
+    // Echo round trips and idle times, gathered on the peer table strand.
+    void liveness_stats(
+        std::function<void(std::vector<PeerLiveness>)> on_stats);
+    // Duplicate 551/552/555/556 suppression; safe from any thread.
+    [[nodiscard]] auto relay_stats() const -> SeenCacheStats {
+        return states_.relay_stats();
+    }
+
 private:
+    static constexpr std::size_t INBOX_CAPACITY = 1024;
+
+    // Socket, framing and send queue belong to the peer's own strand. The
+    // atomics are also read from the table strand (broadcast, liveness).
     struct Peer : public std::enable_shared_from_this<Peer> {
-        epsp_state_peer_t state{
+        std::atomic<epsp_state_peer_t> state{
             epsp_state_peer_t::EPSP_STATE_PEER_DISCONNECTED};
         std::weak_ptr<ConnectionPeer> parent;
-        std::chrono::steady_clock::time_point last_seen;
+        std::atomic<std::chrono::steady_clock::time_point> last_seen;
+        std::chrono::steady_clock::duration connect_latency{};
+        std::chrono::steady_clock::time_point echo_sent;
+        std::atomic<std::chrono::steady_clock::duration> rtt{};
         uint32_t peer_id;
+        SlotHandle handle; // in peers_, once registered
         asio::ip::tcp::endpoint endpoint;
 
-        asio::ip::tcp::socket socket;
-        asio::streambuf buffer;
+        IoStrand strand;
+        StrandSocket socket;
+        LineFramer framer;
+        std::vector<std::string_view> lines;
+        PeerStates::PeerReply reply; // reused for every line read
+        MessagePool messages;        // what this peer's lines encode into
+
+        OutboundQueue outbound;
+        std::vector<SharedMessage> in_flight;
+        std::vector<asio::const_buffer> gather;
+        BasicWriteSignal<IoStrand> write_signal;
+        HandlerMemory read_memory;  // the reader's socket reads
+        HandlerMemory write_memory; // the writer's async_write
 
-        explicit Peer(asio::io_context &io_context,
-                      const std::shared_ptr<ConnectionPeer> &parent);
+        // Broadcasts from other peers, pushed on the table strand. Only the
+        // first push after a drain posts to this peer's strand.
+        MpscRing<SharedMessage> inbox{INBOX_CAPACITY};
+        std::atomic<bool> inbox_pending{false};
+        HandlerMemory inbox_memory;
 
-        void read();
-        void handle_message(std::string &response);
-        void write_uni(std::string_view response);
+        explicit Peer(asio::io_context &io_context);
+        // Readies a pooled Peer for a new connection.
+        void reset(const std::shared_ptr<ConnectionPeer> &owner);
+
+        // Spawns the reader and writer coroutines on the peer's strand.
+        void start();
+        // `self` keeps the pooled Peer alive for the whole session.
+        auto reader(std::shared_ptr<Peer> self) -> StrandAwaitable<void>;
+        auto writer(std::shared_ptr<Peer> self) -> StrandAwaitable<void>;
+        void handle_message(ConnectionPeer &owner, std::string_view response,
+                            std::string_view from);
+        void write_uni(SharedMessage response);
+        // Table strand. Queues a broadcast for this peer's writer.
+        void deliver(SharedMessage message);
+        // Peer strand. Hands everything in the inbox to write_uni().
+        void drain_inbox();
+        // Closes the socket and drops the peer from the table.
+        void drop(std::string_view reason);
     };
     friend struct Peer;
-    std::unordered_map<uint32_t, std::shared_ptr<Peer>> peers_;
-    std::unordered_set<std::shared_ptr<Peer>> peers_pending_;
+    // Peers come from a pool that outlives every handler holding one, and
+    // return to it instead of being freed.
+    struct PeerPool;
+    std::shared_ptr<PeerPool> peer_pool_;
+    auto acquire_peer() -> std::shared_ptr<Peer>;
+
+    // The peer table, acceptor, connect rounds and liveness wheel are only
+    // touched on strand_.
+    SlotMap<std::shared_ptr<Peer>> peers_;
+    SlotMap<std::shared_ptr<Peer>> peers_pending_;
+    auto find_peer(uint32_t target_id) -> std::shared_ptr<Peer>;
+    void remove_peer(SlotHandle handle);
     std::shared_ptr<spdlog::logger> peer_logger_;
     explicit ConnectionPeer(asio::io_context &io_context);
 
     PeerStates states_;
+    OutboundPolicy outbound_policy_;
     asio::io_context &io_context_;
+    IoStrand strand_;
     asio::ip::tcp::acceptor acceptor_;
+    HandlerMemory accept_memory_;
     void do_accept();
-    void handle_new_peer(asio::ip::tcp::socket socket);
-    void write_broad(const Peer &from_peer, std::string_view message);
+    void handle_new_peer(const std::shared_ptr<Peer> &peer);
+    void register_peer(const std::shared_ptr<Peer> &peer);
+    // Runs on the peer's strand.
+    void close_peer(Peer &peer);
+    // Runs on strand_; the close is posted to the peer's strand.
+    void evict_peer(const std::shared_ptr<Peer> &peer, std::string_view reason);
+
+    // One wheel drives echo, idle and handshake timers for every peer,
+    // keyed by the peer's slot index.
+    LivenessOptions liveness_options_;
+    TimerWheel liveness_;
+    StrandTimer liveness_timer_;
+    HandlerMemory liveness_memory_;
+    bool liveness_running_ = false;
+    std::vector<TimerKey> expired_;
+    std::function<void(std::size_t connected)> server_echo_;
+    void start_liveness();
+    void on_liveness_tick();
+    void handle_timer(TimerKey key);
+    // Sends to every connected peer except the one at `from_peer`. Any
+    // strand: readers queue broadcasts without a lock, and only the first
+    // one after a fan-out posts the next fan-out to strand_.
+    void write_broad(SlotHandle from_peer, SharedMessage message);
+    struct Broadcast {
+        SlotHandle from;
+        SharedMessage message;
+    };
+    MpscRing<Broadcast> broadcasts_{INBOX_CAPACITY};
+    std::atomic<bool> fan_out_pending_{false};
+    HandlerMemory fan_out_memory_;
+    // Runs on strand_; delivers every queued broadcast.
+    void fan_out();
+    void fan_out(const Broadcast &broadcast);
 };
 
 struct PeerInit {
@@ -60,3 +210,6 @@ struct PeerInit {
 };
 
 auto init_peer_connection() -> PeerInit;
+// Shares an io_context (e.g. an IoPool's) with the rest of the client.
+auto init_peer_connection(std::shared_ptr<asio::io_context> io_context)
+    -> PeerInit;
@@ -0,0 +1,53 @@
+#include "seen_cache.h"
+#include <algorithm>
+#include <bit>
+#include <functional>
+
+SeenCache::SeenCache(std::size_t capacity, std::chrono::milliseconds ttl)
+    : slots_(std::bit_ceil(std::max(capacity, PROBE_LIMIT))),
+      mask_(slots_.size() - 1), ttl_(ttl) {}
+
+auto SeenCache::hash(uint16_t code, std::string_view payload) -> uint64_t {
+    uint64_t value = std::hash<std::string_view>{}(payload);
+    value ^= (static_cast<uint64_t>(code) + 0x9E3779B97F4A7C15ULL) *
+             0xBF58476D1CE4E5B9ULL;
+    value ^= value >> 31U;
+    return value == 0 ? 1 : value;
+}
+
+auto SeenCache::insert(uint16_t code, std::string_view payload,
+                       clock::time_point now) -> bool {
+    auto key = hash(code, payload);
+
+    Slot *free_slot = nullptr;
+    Slot *oldest = nullptr;
+    for (std::size_t i = 0; i < PROBE_LIMIT; i++) {
+        auto &slot = slots_[(key + i) & mask_];
+        bool live = slot.hash != 0 && slot.expires > now;
+        if (live && slot.hash == key) {
+            stats_.hits++;
+            return false;
+        }
+        if (!live) {
+            if (free_slot == nullptr) {
+                free_slot = &slot;
+            }
+        } else if (oldest == nullptr || slot.expires < oldest->expires) {
+            oldest = &slot;
+        }
+    }
+
+    if (free_slot == nullptr) {
+        free_slot = oldest;
+        stats_.evictions++;
+    }
+    free_slot->hash = key;
+    free_slot->expires = now + ttl_;
+    stats_.misses++;
+    return true;
+}
+
+void SeenCache::clear() {
+    std::ranges::fill(slots_, Slot{});
+    stats_ = {};
+}
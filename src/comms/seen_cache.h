@@ -0,0 +1,47 @@
+#pragma once
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+struct SeenCacheStats {
+    uint64_t hits = 0;      // duplicates dropped
+    uint64_t misses = 0;    // first sightings
+    uint64_t evictions = 0; // live entries overwritten to make room
+};
+
+// Bounded, time-expiring set of recently relayed (code, payload) pairs.
+// Open addressing over a fixed power-of-two table: only hashes are stored,
+// and a full probe window overwrites its oldest entry.
+class SeenCache {
+public:
+    using clock = std::chrono::steady_clock;
+
+    explicit SeenCache(std::size_t capacity = 4096,
+                       std::chrono::milliseconds ttl = std::chrono::minutes(1));
+
+    // Records the pair and returns true if it was not seen within the TTL.
+    auto insert(uint16_t code, std::string_view payload,
+                clock::time_point now = clock::now()) -> bool;
+
+    void clear();
+    [[nodiscard]] auto stats() const -> const SeenCacheStats & {
+        return stats_;
+    }
+
+private:
+    static constexpr std::size_t PROBE_LIMIT = 8;
+
+    struct Slot {
+        uint64_t hash = 0; // 0 = empty
+        clock::time_point expires{};
+    };
+
+    std::vector<Slot> slots_;
+    std::size_t mask_;
+    clock::duration ttl_;
+    SeenCacheStats stats_;
+
+    static auto hash(uint16_t code, std::string_view payload) -> uint64_t;
+};
@@ -0,0 +1,120 @@
+#pragma once
+#include <cstdint>
+#include <span>
+#include <utility>
+#include <vector>
+
+// Index into a SlotMap plus the generation it was issued for. A handle whose
+// slot has since been erased (and possibly reused) no longer resolves.
+struct SlotHandle {
+    uint32_t index = UINT32_MAX;
+    uint32_t generation = 0;
+
+    auto operator==(const SlotHandle &) const -> bool = default;
+};
+
+// Dense storage with stable generational handles. Values stay contiguous,
+// so iteration is a linear scan; erase swaps the last value into the hole.
+template <typename T> class SlotMap {
+public:
+    auto insert(T value) -> SlotHandle {
+        uint32_t index = 0;
+        if (free_head_ != NIL) {
+            index = free_head_;
+            free_head_ = slots_[index].dense;
+        } else {
+            index = static_cast<uint32_t>(slots_.size());
+            slots_.push_back({});
+        }
+
+        auto &slot = slots_[index];
+        slot.dense = static_cast<uint32_t>(values_.size());
+        values_.push_back(std::move(value));
+        owners_.push_back(index);
+        return {.index = index, .generation = slot.generation};
+    }
+
+    auto erase(SlotHandle handle) -> bool {
+        if (!contains(handle)) {
+            return false;
+        }
+        auto &slot = slots_[handle.index];
+        auto hole = slot.dense;
+        auto last = static_cast<uint32_t>(values_.size() - 1);
+        if (hole != last) {
+            values_[hole] = std::move(values_[last]);
+            owners_[hole] = owners_[last];
+            slots_[owners_[hole]].dense = hole;
+        }
+        values_.pop_back();
+        owners_.pop_back();
+
+        slot.generation++;
+        slot.dense = free_head_;
+        free_head_ = handle.index;
+        return true;
+    }
+
+    [[nodiscard]] auto contains(SlotHandle handle) const -> bool {
+        return handle.index < slots_.size() &&
+               slots_[handle.index].generation == handle.generation &&
+               slots_[handle.index].dense < values_.size() &&
+               owners_[slots_[handle.index].dense] == handle.index;
+    }
+
+    // nullptr for stale or foreign handles.
+    auto get(SlotHandle handle) -> T * {
+        return contains(handle) ? &values_[slots_[handle.index].dense]
+                                : nullptr;
+    }
+
+    // Current handle of the value at `index`, for keys that only carry the
+    // index (e.g. timers).
+    [[nodiscard]] auto handle_at(uint32_t index) const -> SlotHandle {
+        SlotHandle handle{.index = index,
+                          .generation = index < slots_.size()
+                                            ? slots_[index].generation
+                                            : 0};
+        return contains(handle) ? handle : SlotHandle{};
+    }
+
+    void clear() {
+        for (auto index : owners_) {
+            slots_[index].generation++;
+            slots_[index].dense = free_head_;
+            free_head_ = index;
+        }
+        values_.clear();
+        owners_.clear();
+    }
+
+    void reserve(std::size_t count) {
+        slots_.reserve(count);
+        values_.reserve(count);
+        owners_.reserve(count);
+    }
+
+    [[nodiscard]] auto size() const -> std::size_t { return values_.size(); }
+    [[nodiscard]] auto empty() const -> bool { return values_.empty(); }
+    auto values() -> std::span<T> { return values_; }
+    [[nodiscard]] auto values() const -> std::span<const T> {
+        return values_;
+    }
+    auto begin() { return values_.begin(); }
+    auto end() { return values_.end(); }
+    [[nodiscard]] auto begin() const { return values_.begin(); }
+    [[nodiscard]] auto end() const { return values_.end(); }
+
+private:
+    static constexpr uint32_t NIL = UINT32_MAX;
+
+    struct Slot {
+        uint32_t dense = NIL; // value index, or next free slot
+        uint32_t generation = 0;
+    };
+
+    std::vector<Slot> slots_;
+    std::vector<T> values_;
+    std::vector<uint32_t> owners_; // slot index of each value
+    uint32_t free_head_ = NIL;
+};
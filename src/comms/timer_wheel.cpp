@@ -0,0 +1,149 @@
+#include "timer_wheel.h"
+#include <algorithm>
+#include <utility>
+
+TimerWheel::TimerWheel(std::chrono::milliseconds tick, clock::time_point start)
+    : tick_(std::max(tick, std::chrono::milliseconds(1))), start_(start) {
+    heads_.fill(NIL);
+}
+
+auto TimerWheel::pack(TimerKey key) -> uint64_t {
+    return (static_cast<uint64_t>(key.owner) << 8U) |
+           std::to_underlying(key.kind);
+}
+
+void TimerWheel::schedule(TimerKey key, std::chrono::milliseconds delay) {
+    auto ticks = static_cast<uint64_t>(
+        (std::max(delay, std::chrono::milliseconds(0)) + tick_ -
+         std::chrono::milliseconds(1)) /
+        tick_);
+    uint64_t expires = now_tick_ + std::max<uint64_t>(ticks, 1);
+
+    auto [found, inserted] = index_.try_emplace(pack(key), NIL);
+    if (!inserted) {
+        unlink(found->second);
+        entries_[found->second].expires = expires;
+        link(found->second);
+        return;
+    }
+
+    uint32_t entry = 0;
+    if (!free_.empty()) {
+        entry = free_.back();
+        free_.pop_back();
+    } else {
+        entry = static_cast<uint32_t>(entries_.size());
+        entries_.emplace_back();
+        // Room to free every entry, so expiring timers never allocate.
+        free_.reserve(entries_.capacity());
+    }
+    entries_[entry] = Entry{.key = key,
+                            .expires = expires,
+                            .prev = NIL,
+                            .next = NIL,
+                            .slot = NO_SLOT};
+    found->second = entry;
+    link(entry);
+}
+
+void TimerWheel::cancel(TimerKey key) {
+    auto found = index_.find(pack(key));
+    if (found == index_.end()) {
+        return;
+    }
+    auto entry = found->second;
+    index_.erase(found);
+    unlink(entry);
+    release(entry);
+}
+
+void TimerWheel::cancel_owner(uint32_t owner) {
+    for (auto kind : {epsp_timer_kind_t::TIMER_PEER_ECHO,
+                      epsp_timer_kind_t::TIMER_PEER_IDLE,
+                      epsp_timer_kind_t::TIMER_PEER_HANDSHAKE,
+                      epsp_timer_kind_t::TIMER_SERVER_ECHO}) {
+        cancel({.owner = owner, .kind = kind});
+    }
+}
+
+void TimerWheel::advance(clock::time_point now,
+                         std::vector<TimerKey> &expired) {
+    if (now < start_) {
+        return;
+    }
+    auto target = static_cast<uint64_t>((now - start_) / tick_);
+
+    while (now_tick_ < target) {
+        now_tick_++;
+        if (now_tick_ % INNER_SLOTS == 0) {
+            cascade((now_tick_ / INNER_SLOTS) % OUTER_SLOTS);
+        }
+
+        auto entry = heads_.at(now_tick_ % INNER_SLOTS);
+        while (entry != NIL) {
+            auto next = entries_[entry].next;
+            if (entries_[entry].expires <= now_tick_) {
+                expired.push_back(entries_[entry].key);
+                index_.erase(pack(entries_[entry].key));
+                unlink(entry);
+                release(entry);
+            }
+            entry = next;
+        }
+    }
+}
+
+void TimerWheel::link(uint32_t entry) {
+    auto &item = entries_[entry];
+    uint64_t delta = item.expires > now_tick_ ? item.expires - now_tick_ : 1;
+
+    std::size_t slot = 0;
+    if (delta < INNER_SLOTS) {
+        slot = item.expires % INNER_SLOTS;
+    } else {
+        // Beyond the outer span: park in the furthest outer slot and let the
+        // cascade put it back until it is close enough.
+        uint64_t block = std::min(item.expires / INNER_SLOTS,
+                                  (now_tick_ / INNER_SLOTS) + OUTER_SLOTS - 1);
+        slot = INNER_SLOTS + (block % OUTER_SLOTS);
+    }
+
+    auto &head = heads_.at(slot);
+    item.slot = static_cast<uint16_t>(slot);
+    item.prev = NIL;
+    item.next = head;
+    if (head != NIL) {
+        entries_[head].prev = entry;
+    }
+    head = entry;
+}
+
+void TimerWheel::unlink(uint32_t entry) {
+    auto &item = entries_[entry];
+    if (item.prev != NIL) {
+        entries_[item.prev].next = item.next;
+    } else if (item.slot != NO_SLOT) {
+        heads_.at(item.slot) = item.next;
+    }
+    if (item.next != NIL) {
+        entries_[item.next].prev = item.prev;
+    }
+    item.prev = NIL;
+    item.next = NIL;
+    item.slot = NO_SLOT;
+}
+
+void TimerWheel::release(uint32_t entry) { free_.push_back(entry); }
+
+void TimerWheel::cascade(std::size_t outer_slot) {
+    auto entry = heads_.at(INNER_SLOTS + outer_slot);
+    heads_.at(INNER_SLOTS + outer_slot) = NIL;
+    while (entry != NIL) {
+        auto next = entries_[entry].next;
+        entries_[entry].prev = NIL;
+        entries_[entry].next = NIL;
+        entries_[entry].slot = NO_SLOT;
+        link(entry);
+        entry = next;
+    }
+}
@@ -0,0 +1,74 @@
+#pragma once
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+enum class epsp_timer_kind_t : uint8_t {
+    TIMER_PEER_ECHO,
+    TIMER_PEER_IDLE,
+    TIMER_PEER_HANDSHAKE,
+    TIMER_SERVER_ECHO,
+};
+
+struct TimerKey {
+    uint32_t owner;
+    epsp_timer_kind_t kind;
+
+    auto operator==(const TimerKey &) const -> bool = default;
+};
+
+// Two-level hashed timer wheel. Timers are plain keys in a pooled, intrusive
+// list per slot, so scheduling, rescheduling and cancelling are O(1) and the
+// owner decides what an expired key means.
+class TimerWheel {
+public:
+    using clock = std::chrono::steady_clock;
+
+    explicit TimerWheel(std::chrono::milliseconds tick,
+                        clock::time_point start = clock::now());
+
+    // Replaces any pending timer with the same key. Delays are rounded up to
+    // whole ticks; anything past the wheel's span is re-cascaded.
+    void schedule(TimerKey key, std::chrono::milliseconds delay);
+    void cancel(TimerKey key);
+    void cancel_owner(uint32_t owner);
+
+    // Runs every tick up to `now`, appending the keys that expired.
+    void advance(clock::time_point now, std::vector<TimerKey> &expired);
+
+    [[nodiscard]] auto size() const -> std::size_t { return index_.size(); }
+    [[nodiscard]] auto tick() const -> std::chrono::milliseconds {
+        return tick_;
+    }
+
+private:
+    static constexpr std::size_t INNER_SLOTS = 256;
+    static constexpr std::size_t OUTER_SLOTS = 64;
+    static constexpr uint32_t NIL = UINT32_MAX;
+    static constexpr uint16_t NO_SLOT = UINT16_MAX;
+
+    struct Entry {
+        TimerKey key;
+        uint64_t expires;
+        uint32_t prev;
+        uint32_t next;
+        uint16_t slot; // inner slots first, then outer slots
+    };
+
+    std::chrono::milliseconds tick_;
+    clock::time_point start_;
+    uint64_t now_tick_ = 0;
+
+    std::vector<Entry> entries_;
+    std::vector<uint32_t> free_;
+    std::unordered_map<uint64_t, uint32_t> index_;
+    std::array<uint32_t, INNER_SLOTS + OUTER_SLOTS> heads_;
+
+    static auto pack(TimerKey key) -> uint64_t;
+    void link(uint32_t entry);
+    void unlink(uint32_t entry);
+    void release(uint32_t entry);
+    void cascade(std::size_t outer_slot);
+};
@@ -0,0 +1,46 @@
+#include "wire.h"
+#include <charconv> // for Mac clang
+
+auto parse_wire_line(std::string_view line)
+    -> std::expected<WireRecord, epsp_wire_error_t> {
+    if (line.ends_with('\n')) {
+        line.remove_suffix(1);
+    }
+    if (line.ends_with('\r')) {
+        line.remove_suffix(1);
+    }
+    if (line.size() < 5 || line[3] != ' ') {
+        return std::unexpected(epsp_wire_error_t::WIRE_ERR_TOO_SHORT);
+    }
+
+    WireRecord record{};
+    const char *begin = line.data();
+    const char *end = line.data() + line.size();
+
+    auto [code_end, code_errc] = std::from_chars(begin, begin + 3, record.code);
+    if (code_errc != std::errc() || code_end != begin + 3) {
+        return std::unexpected(epsp_wire_error_t::WIRE_ERR_BAD_CODE);
+    }
+
+    auto [hop_end, hop_errc] = std::from_chars(begin + 4, end, record.hop);
+    if (hop_errc != std::errc() || (hop_end != end && *hop_end != ' ')) {
+        return std::unexpected(epsp_wire_error_t::WIRE_ERR_BAD_HOP);
+    }
+
+    if (hop_end != end) {
+        record.payload = line.substr(hop_end - begin + 1);
+    }
+    return record;
+}
+
+auto wire_error_string(epsp_wire_error_t error) -> std::string_view {
+    switch (error) {
+    case epsp_wire_error_t::WIRE_ERR_TOO_SHORT:
+        return "line too short";
+    case epsp_wire_error_t::WIRE_ERR_BAD_CODE:
+        return "invalid code";
+    case epsp_wire_error_t::WIRE_ERR_BAD_HOP:
+        return "invalid hop count";
+    }
+    return "unknown error";
+}
@@ -0,0 +1,23 @@
+#pragma once
+#include <cstdint>
+#include <expected>
+#include <string_view>
+
+// EPSP line layout: "<code:3> <hop> [payload]" with optional trailing CR/LF.
+enum class epsp_wire_error_t : uint8_t {
+    WIRE_ERR_TOO_SHORT,
+    WIRE_ERR_BAD_CODE,
+    WIRE_ERR_BAD_HOP,
+};
+
+struct WireRecord {
+    uint16_t code;
+    uint8_t hop;
+    std::string_view payload;
+};
+
+// Views into `line`; the caller keeps the backing storage alive.
+auto parse_wire_line(std::string_view line)
+    -> std::expected<WireRecord, epsp_wire_error_t>;
+
+auto wire_error_string(epsp_wire_error_t error) -> std::string_view;
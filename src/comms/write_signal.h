@@ -0,0 +1,52 @@
+#pragma once
+
+#include "handler_memory.h"
+
+#include <asio/awaitable.hpp>
+#include <asio/redirect_error.hpp>
+#include <asio/steady_timer.hpp>
+#include <asio/use_awaitable.hpp>
+
+// Parks a connection's writer coroutine until there is something to send.
+// A timer that never expires is the wait; cancelling it is the wake-up.
+// Writer and producers share one strand, so checking the queue and waiting
+// cannot interleave with a notify() and no wake-up is lost.
+//
+// `Executor` is the writer coroutine's executor type; wait() returns an
+// awaitable on it.
+template <typename Executor = asio::steady_timer::executor_type>
+class BasicWriteSignal {
+public:
+    explicit BasicWriteSignal(const Executor &executor)
+        : timer_(executor, Timer::time_point::max()) {}
+
+    void notify() { timer_.cancel(); }
+
+    // Wakes the writer for good; it exits instead of waiting again.
+    void close() {
+        closed_ = true;
+        timer_.cancel();
+    }
+    void reset() { closed_ = false; }
+    [[nodiscard]] auto closed() const -> bool { return closed_; }
+
+    // The timer op itself is the awaitable, so waiting adds no coroutine
+    // frame, and it lives in memory_ rather than on the heap.
+    auto wait() -> asio::awaitable<void, Executor> {
+        return timer_.async_wait(with_memory(
+            memory_,
+            asio::redirect_error(asio::use_awaitable_t<Executor>(), ignored_)));
+    }
+
+private:
+    using Timer = asio::basic_waitable_timer<
+        std::chrono::steady_clock,
+        asio::wait_traits<std::chrono::steady_clock>, Executor>;
+
+    Timer timer_;
+    HandlerMemory memory_;
+    asio::error_code ignored_;
+    bool closed_ = false;
+};
+
+using WriteSignal = BasicWriteSignal<>;
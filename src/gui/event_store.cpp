@@ -0,0 +1,333 @@
+#include "event_store.h"
+#include "../comms/detections.h"
+#include "../utils/region_index.h"
+#include <ctime>
+
+namespace {
+auto position(const Region *region) -> uint16_t {
+    return static_cast<uint16_t>(region - regions.data());
+}
+
+auto kind_index(epsp_event_kind_t kind) -> std::size_t {
+    return static_cast<std::size_t>(kind);
+}
+
+auto epoch_ns(std::chrono::system_clock::time_point time) -> int64_t {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               time.time_since_epoch())
+        .count();
+}
+
+// The region a 551 is filed under: one named like its hypocentre, else
+// the located region nearest its epicentre.
+auto quake_region(const IntensityReport &report) -> uint16_t {
+    auto named = find_area(report.hypocentre);
+    if (named != StoredEvent::NO_REGION || !report.epicentre) {
+        return named;
+    }
+    std::vector<RegionHit> hits;
+    region_index().nearest(report.epicentre->first, report.epicentre->second,
+                           1, hits);
+    return hits.empty() ? StoredEvent::NO_REGION : position(hits[0].region);
+}
+} // namespace
+
+auto find_area(std::string_view name) -> uint16_t {
+    static const auto areas = [] -> std::unordered_map<std::string_view,
+                                                       uint16_t> {
+        std::unordered_map<std::string_view, uint16_t> built;
+        for (const auto &region : regions) {
+            if (region.lat != 0.0 || region.lon != 0.0) {
+                built.emplace(region.area, position(&region));
+            }
+        }
+        return built;
+    }();
+    if (const auto *region = find_region(name)) {
+        return position(region);
+    }
+    auto found = areas.find(name);
+    return found != areas.end() ? found->second : StoredEvent::NO_REGION;
+}
+
+auto store_event(NetEvent event) -> StoredEvent {
+    StoredEvent stored{.received = event.received,
+                       .kind = event.kind,
+                       .region = StoredEvent::NO_REGION,
+                       .shindo = 0,
+                       .max_intensity = 0.0F,
+                       .payload = std::move(event.payload)};
+    switch (stored.kind) {
+    case epsp_event_kind_t::EVENT_EQK_DTCT:
+        if (const auto *region = detection_area(stored.payload)) {
+            stored.region = position(region);
+        }
+        break;
+    case epsp_event_kind_t::EVENT_EQK_INFO:
+        if (auto report = parse_intensity_report(stored.payload)) {
+            stored.max_intensity = report->max_intensity;
+            stored.shindo = shindo_class(report->max_intensity);
+            stored.region = quake_region(*report);
+        }
+        break;
+    default:
+        break;
+    }
+    return stored;
+}
+
+auto event_label(epsp_event_kind_t kind) -> std::string_view {
+    switch (kind) {
+    case epsp_event_kind_t::EVENT_EQK_INFO:
+        return "Earthquake";
+    case epsp_event_kind_t::EVENT_TSU_INFO:
+        return "Tsunami";
+    case epsp_event_kind_t::EVENT_EQK_DTCT:
+        return "Detection";
+    case epsp_event_kind_t::EVENT_PEER_CPR:
+        return "Report";
+    case epsp_event_kind_t::EVENT_SERVER_SESSION:
+        return "Connected as";
+    case epsp_event_kind_t::EVENT_SERVER_CLOSED:
+        return "Server closed";
+    }
+    return "Event";
+}
+
+EventStore::EventStore() : by_region_(regions.size()) {}
+
+void EventStore::add(NetEvent event) {
+    pending_.push_back(store_event(std::move(event)));
+}
+
+auto EventStore::flush() -> std::size_t {
+    if (pending_.empty()) {
+        return 0;
+    }
+    std::unique_lock<std::shared_mutex> lock(mutex_, std::try_to_lock);
+    if (!lock.owns_lock()) {
+        return 0;
+    }
+    auto count = pending_.size();
+    for (auto &event : pending_) {
+        store(std::move(event));
+    }
+    pending_.clear();
+    return count;
+}
+
+void EventStore::store(StoredEvent event) {
+    auto id = static_cast<uint32_t>(events_.size());
+    auto received = epoch_ns(event.received);
+    received_.push_back(received_.empty()
+                            ? received
+                            : std::max(received_.back(), received));
+    kind_.push_back(static_cast<uint8_t>(event.kind));
+    region_.push_back(event.region);
+    shindo_.push_back(event.shindo);
+    intensity_.push_back(event.max_intensity);
+    by_kind_[kind_index(event.kind)].push_back(id);
+    by_shindo_[event.shindo].push_back(id);
+    if (event.region < by_region_.size()) {
+        by_region_[event.region].push_back(id);
+    }
+    events_.push_back(std::move(event));
+}
+
+auto EventStore::query(const HistoryFilter &filter) const -> HistoryView {
+    auto started = std::chrono::steady_clock::now();
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    HistoryView view{.filter = filter,
+                     .events = events_.size(),
+                     .rows = {},
+                     .took = {}};
+
+    uint32_t first = 0;
+    if (filter.since) {
+        first = static_cast<uint32_t>(
+            std::ranges::lower_bound(received_, epoch_ns(*filter.since)) -
+            received_.begin());
+    }
+
+    // The lists whose union holds every match; a scan of all events from
+    // `first` when no field narrows it down further.
+    std::vector<const std::vector<uint32_t> *> lists;
+    std::size_t candidates = events_.size() - first;
+    bool scan = true;
+    auto consider = [&](std::vector<const std::vector<uint32_t> *> option)
+        -> void {
+        std::size_t total = 0;
+        for (const auto *list : option) {
+            total += list->size();
+        }
+        if (total < candidates) {
+            candidates = total;
+            lists = std::move(option);
+            scan = false;
+        }
+    };
+    if (filter.region < by_region_.size()) {
+        consider({&by_region_[filter.region]});
+    }
+    std::vector<const std::vector<uint32_t> *> option;
+    for (std::size_t kind = 0; kind < EVENT_KINDS; kind++) {
+        if ((filter.kinds >> kind & 1U) != 0) {
+            option.push_back(&by_kind_[kind]);
+        }
+    }
+    consider(std::move(option));
+    if (filter.min_shindo > 0) {
+        option.clear();
+        for (auto shindo = std::size_t{filter.min_shindo};
+             shindo < SHINDO_CLASSES; shindo++) {
+            option.push_back(&by_shindo_[shindo]);
+        }
+        consider(std::move(option));
+    }
+
+    auto keep = [&](uint32_t id) -> bool {
+        return (filter.kinds >> kind_[id] & 1U) != 0 &&
+               (filter.region == StoredEvent::NO_REGION ||
+                region_[id] == filter.region) &&
+               shindo_[id] >= filter.min_shindo;
+    };
+    view.rows.reserve(candidates);
+    if (scan) {
+        for (auto id = first; id < events_.size(); id++) {
+            if (keep(id)) {
+                view.rows.push_back(id);
+            }
+        }
+    } else {
+        for (const auto *list : lists) {
+            for (auto at = std::ranges::lower_bound(*list, first);
+                 at != list->end(); ++at) {
+                if (keep(*at)) {
+                    view.rows.push_back(*at);
+                }
+            }
+        }
+        // Kinds and classes do not overlap, so merging is sorting.
+        if (lists.size() > 1) {
+            std::ranges::sort(view.rows);
+        }
+    }
+
+    // Ids ascend with the receive time.
+    switch (filter.sort) {
+    case history_sort_t::SORT_NEWEST:
+        std::ranges::reverse(view.rows);
+        break;
+    case history_sort_t::SORT_OLDEST:
+        break;
+    case history_sort_t::SORT_STRONGEST:
+        std::ranges::reverse(view.rows);
+        std::ranges::stable_sort(view.rows, [this](uint32_t a, uint32_t b) {
+            return intensity_[a] > intensity_[b];
+        });
+        break;
+    }
+    view.took = std::chrono::steady_clock::now() - started;
+    return view;
+}
+
+HistoryQueries::HistoryQueries(const EventStore &store)
+    : store_(store), worker_([this] -> void { run(); }) {}
+
+HistoryQueries::~HistoryQueries() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    work_.notify_all();
+    worker_.join();
+}
+
+void HistoryQueries::set_wake(std::function<void()> wake) {
+    wake_ = std::move(wake);
+}
+
+void HistoryQueries::request(const HistoryFilter &filter) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        requested_ = filter;
+    }
+    work_.notify_one();
+}
+
+auto HistoryQueries::latest() const -> std::shared_ptr<const HistoryView> {
+    return latest_.load(std::memory_order_acquire);
+}
+
+void HistoryQueries::wait_idle() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    idle_.wait(lock, [this] -> bool { return !requested_ && !busy_; });
+}
+
+void HistoryQueries::run() {
+    while (true) {
+        HistoryFilter filter;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            work_.wait(lock, [this] -> bool {
+                return stopping_ || requested_.has_value();
+            });
+            if (stopping_) {
+                return;
+            }
+            filter = *requested_;
+            requested_.reset();
+            busy_ = true;
+        }
+        latest_.store(std::make_shared<const HistoryView>(
+                          store_.query(filter)),
+                      std::memory_order_release);
+        bool done = false;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            busy_ = false;
+            done = !requested_;
+        }
+        if (done) {
+            idle_.notify_all();
+        }
+        if (wake_) {
+            wake_();
+        }
+    }
+}
+
+auto format_history_row(const StoredEvent &event) -> std::string {
+    std::time_t received = std::chrono::system_clock::to_time_t(event.received);
+    std::tm local{};
+#if defined(_WIN32)
+    localtime_s(&local, &received);
+#else
+    localtime_r(&received, &local);
+#endif
+    std::array<char, 32> clock{};
+    std::strftime(clock.data(), clock.size(), "%m-%d %H:%M:%S", &local);
+    std::string text(clock.data());
+    text += "  ";
+    text += event_label(event.kind);
+    if (event.shindo > 0) {
+        text += ' ';
+        text += shindo_name(event.shindo);
+    }
+    text += ' ';
+    text += event.payload;
+    return text;
+}
+
+auto RowTextCache::text(const EventStore &store, uint32_t id)
+    -> const std::string & {
+    auto &slot = slots_[id % slots_.size()];
+    if (slot.id == id) {
+        stats_.hits++;
+        return slot.text;
+    }
+    stats_.misses++;
+    slot.id = id;
+    slot.text = format_history_row(store.at(id));
+    return slot.text;
+}
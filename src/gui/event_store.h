@@ -0,0 +1,179 @@
+#pragma once
+#include "../comms/event_channel.h"
+#include "../map/intensity_field.h"
+#include "../utils/region.h"
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+inline constexpr std::size_t EVENT_KINDS = 6;
+
+struct StoredEvent {
+    static constexpr uint16_t NO_REGION = UINT16_MAX;
+
+    std::chrono::system_clock::time_point received{};
+    epsp_event_kind_t kind = epsp_event_kind_t::EVENT_EQK_INFO;
+    uint16_t region = NO_REGION; // position in `regions`
+    uint8_t shindo = 0;          // shindo_class(); 551 only
+    float max_intensity = 0.0F;  // 551 only
+    std::string payload{};
+};
+
+// A NetEvent with what the history indexes it by: the area a 555 came
+// from, and the hypocentre and maximum intensity of a 551.
+auto store_event(NetEvent event) -> StoredEvent;
+// Table position of the located region named `name` ("石川能登"), or
+// of the region with that code ("010"); NO_REGION if neither.
+auto find_area(std::string_view name) -> uint16_t;
+auto event_label(epsp_event_kind_t kind) -> std::string_view;
+
+enum class history_sort_t : uint8_t {
+    SORT_NEWEST,
+    SORT_OLDEST,
+    SORT_STRONGEST, // maximum intensity, newest first among equals
+};
+
+struct HistoryFilter {
+    uint8_t kinds = 0xFF; // bit (1 << kind) per epsp_event_kind_t shown
+    uint16_t region = StoredEvent::NO_REGION; // NO_REGION: any
+    uint8_t min_shindo = 0;                   // 0: any, else 551 only
+    std::optional<std::chrono::system_clock::time_point> since{};
+    history_sort_t sort = history_sort_t::SORT_NEWEST;
+
+    auto operator==(const HistoryFilter &) const -> bool = default;
+};
+
+// The ids of the events a filter selects, in display order.
+struct HistoryView {
+    HistoryFilter filter;
+    std::size_t events = 0; // store size the view was computed over
+    std::vector<uint32_t> rows{};
+    std::chrono::nanoseconds took{};
+};
+
+// Every event the GUI has received, kept for the whole run. Ids are
+// positions in arrival order. Besides the events, the store keeps one
+// column per indexed field and posting lists of ids by kind, intensity
+// class and region; receive times, clamped to never decrease, are the
+// time index, so `since` is a binary search. A query starts from the
+// smallest list the filter allows and checks the other fields on the
+// columns, never on the payloads.
+//
+// The render thread adds and flushes; queries run on a worker under a
+// shared lock. flush() only tries the lock, so the render thread never
+// waits on a query: events stay pending until a frame gets it.
+class EventStore {
+public:
+    EventStore();
+
+    // Render thread.
+    void add(NetEvent event);
+    // Render thread. Stores the pending events unless a query holds the
+    // lock; returns how many were stored.
+    auto flush() -> std::size_t;
+    // Render thread, stored events only.
+    [[nodiscard]] auto size() const -> std::size_t { return events_.size(); }
+    [[nodiscard]] auto at(uint32_t id) const -> const StoredEvent & {
+        return events_[id];
+    }
+    [[nodiscard]] auto pending() const -> std::size_t {
+        return pending_.size();
+    }
+
+    // Any thread.
+    [[nodiscard]] auto query(const HistoryFilter &filter) const
+        -> HistoryView;
+
+private:
+    mutable std::shared_mutex mutex_;
+    std::vector<StoredEvent> events_;
+    // Columns, by id.
+    std::vector<int64_t> received_; // ns since the epoch, non-decreasing
+    std::vector<uint8_t> kind_;
+    std::vector<uint16_t> region_;
+    std::vector<uint8_t> shindo_;
+    std::vector<float> intensity_;
+    // Posting lists, ids ascending.
+    std::array<std::vector<uint32_t>, EVENT_KINDS> by_kind_;
+    std::array<std::vector<uint32_t>, SHINDO_CLASSES> by_shindo_;
+    std::vector<std::vector<uint32_t>> by_region_; // by table position
+
+    // Render thread only.
+    std::vector<StoredEvent> pending_;
+
+    void store(StoredEvent event); // caller holds the lock exclusively
+};
+
+// Runs history queries on one worker and publishes each result as an
+// immutable view the render thread swaps in with one atomic load. Only
+// the newest request matters: one still waiting is replaced, not queued.
+class HistoryQueries {
+public:
+    explicit HistoryQueries(const EventStore &store);
+    ~HistoryQueries();
+    HistoryQueries(const HistoryQueries &) = delete;
+    auto operator=(const HistoryQueries &) -> HistoryQueries & = delete;
+
+    // Runs on the worker after each view (e.g. glfwPostEmptyEvent). Set
+    // before the first request().
+    void set_wake(std::function<void()> wake);
+    // Any thread.
+    void request(const HistoryFilter &filter);
+    // Any thread; nullptr before the first view.
+    [[nodiscard]] auto latest() const -> std::shared_ptr<const HistoryView>;
+    // Blocks until no request is waiting or running.
+    void wait_idle();
+
+private:
+    const EventStore &store_;
+    std::function<void()> wake_;
+    std::atomic<std::shared_ptr<const HistoryView>> latest_;
+
+    std::mutex mutex_;
+    std::condition_variable work_;
+    std::condition_variable idle_;
+    std::optional<HistoryFilter> requested_;
+    bool busy_ = false;
+    bool stopping_ = false;
+    std::thread worker_;
+
+    void run();
+};
+
+// "10-17 12:34:56  Earthquake 5+ payload", in local time.
+auto format_history_row(const StoredEvent &event) -> std::string;
+
+struct RowTextStats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+};
+
+// Formatted rows by id, direct-mapped: a row is formatted when it scrolls
+// into view, and again only if another row has taken its slot since.
+// Render thread only.
+class RowTextCache {
+public:
+    static constexpr std::size_t SLOTS = 1024;
+
+    RowTextCache() : slots_(SLOTS) {}
+
+    auto text(const EventStore &store, uint32_t id) -> const std::string &;
+    [[nodiscard]] auto stats() const -> RowTextStats { return stats_; }
+
+private:
+    struct Slot {
+        uint32_t id = UINT32_MAX;
+        std::string text;
+    };
+    std::vector<Slot> slots_;
+    RowTextStats stats_;
+};
@@ -0,0 +1,243 @@
+#include "font_atlas.h"
+#include "../utils/mapped_file.h"
+#include "../utils/path.h"
+#include <bit>
+#include <cstring>
+#include <imgui_internal.h>
+
+// The loader below hooks ImFontLoader and the ImFontAtlas packing helpers,
+// which are internal and not stable across releases. Re-check them against
+// the new imgui_internal.h when bumping the wrap.
+static_assert(IMGUI_VERSION_NUM >= 19250 && IMGUI_VERSION_NUM < 19300,
+              "glyph cache loader written against imgui 1.92.5");
+
+namespace {
+const std::shared_ptr<spdlog::logger> font_logger =
+    spdlog::default_logger()->clone("\033[35mfont\033[0m");
+
+// First found wins: the font the build installs next to the binary, then
+// the usual places distributions install Noto CJK.
+const std::array<std::filesystem::path, 6> CJK_FONTS = {
+    "assets/NotoSansJP-Regular.ttf",
+    "assets/NotoSansCJK-Regular.ttc",
+    "/usr/share/fonts/opentype/noto/NotoSansCJK-Regular.ttc",
+    "/usr/share/fonts/noto-cjk/NotoSansCJK-Regular.ttc",
+    "/usr/share/fonts/google-noto-cjk/NotoSansCJK-Regular.ttc",
+    "/usr/share/fonts/OTF/NotoSansCJK-Regular.ttc",
+};
+
+// The first-use burst is over once nothing was rasterised for this long.
+constexpr std::chrono::seconds BURST_QUIET{5};
+
+GlyphCache cache;
+std::filesystem::path cache_file;
+std::chrono::steady_clock::time_point last_rasterized{};
+bool checkpointed = false;
+const ImFontLoader *inner = nullptr;
+ImFontLoader loader;
+// Per font source, set when ImGui initialises it.
+std::unordered_map<const ImFontConfig *, uint32_t> fingerprints;
+uint64_t rasterized = 0;
+MappedFile cjk_font; // the atlas reads it lazily, so it lives until exit
+
+template <typename T> void append(std::vector<uint8_t> &out, T value) {
+    auto bytes = std::bit_cast<std::array<uint8_t, sizeof(T)>>(value);
+    out.insert(out.end(), bytes.begin(), bytes.end());
+}
+
+auto source_init(ImFontAtlas *atlas, ImFontConfig *src) -> bool {
+    if (!inner->FontSrcInit(atlas, src)) {
+        return false;
+    }
+    // Everything besides the baked size that shapes a bitmap.
+    std::vector<uint8_t> options;
+    append(options, src->FontNo);
+    append(options, src->SizePixels);
+    append(options, static_cast<int>(src->OversampleH));
+    append(options, static_cast<int>(src->OversampleV));
+    append(options, static_cast<int>(src->PixelSnapH));
+    append(options, src->GlyphOffset.x);
+    append(options, src->GlyphOffset.y);
+    append(options, src->GlyphMinAdvanceX);
+    append(options, src->GlyphMaxAdvanceX);
+    append(options, src->GlyphExtraAdvanceX);
+    append(options, src->RasterizerMultiply);
+    append(options, src->FontLoaderFlags);
+    fingerprints[src] = font_fingerprint(
+        std::span(static_cast<const uint8_t *>(src->FontData),
+                  static_cast<std::size_t>(src->FontDataSize)),
+        options);
+    return true;
+}
+
+void source_destroy(ImFontAtlas *atlas, ImFontConfig *src) {
+    fingerprints.erase(src);
+    if (inner->FontSrcDestroy != nullptr) {
+        inner->FontSrcDestroy(atlas, src);
+    }
+}
+
+// Packs a cached bitmap into the atlas the way the stb_truetype loader
+// packs a fresh one.
+auto replay(ImFontAtlas *atlas, ImFontConfig *src, ImFontBaked *baked,
+            const CachedGlyph &cached, ImFontGlyph *out_glyph) -> bool {
+    out_glyph->AdvanceX = cached.advance;
+    out_glyph->X0 = cached.x0;
+    out_glyph->Y0 = cached.y0;
+    out_glyph->X1 = cached.x1;
+    out_glyph->Y1 = cached.y1;
+    if (!cached.visible) {
+        return true;
+    }
+    auto pack_id = ImFontAtlasPackAddRect(atlas, cached.width, cached.height);
+    if (pack_id == ImFontAtlasRectId_Invalid) {
+        return false;
+    }
+    auto *rect = ImFontAtlasPackGetRect(atlas, pack_id);
+    out_glyph->Visible = true;
+    out_glyph->PackId = pack_id;
+    ImFontAtlasBakedSetFontGlyphBitmap(atlas, baked, src, out_glyph, rect,
+                                       cached.alpha.data(),
+                                       ImTextureFormat_Alpha8, cached.width);
+    return true;
+}
+
+// Reads a freshly rasterised glyph back out of the atlas texture.
+auto capture(ImFontAtlas *atlas, const ImFontGlyph &glyph) -> CachedGlyph {
+    CachedGlyph cached{.advance = glyph.AdvanceX,
+                       .x0 = glyph.X0,
+                       .y0 = glyph.Y0,
+                       .x1 = glyph.X1,
+                       .y1 = glyph.Y1,
+                       .visible = glyph.Visible != 0,
+                       .width = 0,
+                       .height = 0,
+                       .alpha = {}};
+    if (!cached.visible) {
+        return cached;
+    }
+    const auto *rect = ImFontAtlasPackGetRect(atlas, glyph.PackId);
+    // GetPixelsAt() is not const.
+    auto *texture = atlas->TexData;
+    cached.width = rect->w;
+    cached.height = rect->h;
+    cached.alpha.resize(std::size_t{rect->w} * rect->h);
+    for (int y = 0; y < rect->h; y++) {
+        const auto *row = static_cast<const uint8_t *>(
+            texture->GetPixelsAt(rect->x, rect->y + y));
+        auto *out = &cached.alpha[static_cast<std::size_t>(y) * rect->w];
+        if (texture->Format == ImTextureFormat_Alpha8) {
+            std::memcpy(out, row, rect->w);
+            continue;
+        }
+        // RGBA32 atlases keep coverage in alpha.
+        for (int x = 0; x < rect->w; x++) {
+            out[x] = row[x * 4 + 3];
+        }
+    }
+    return cached;
+}
+
+auto load_glyph(ImFontAtlas *atlas, ImFontConfig *src, ImFontBaked *baked,
+                void *loader_data, ImWchar codepoint, ImFontGlyph *out_glyph,
+                float *out_advance_x) -> bool {
+    auto fingerprint = fingerprints.find(src);
+    // Advance-only queries bake nothing.
+    if (out_glyph == nullptr || fingerprint == fingerprints.end()) {
+        return inner->FontBakedLoadGlyph(atlas, src, baked, loader_data,
+                                         codepoint, out_glyph,
+                                         out_advance_x);
+    }
+    GlyphKey key{.font = fingerprint->second,
+                 .size = std::bit_cast<uint32_t>(baked->Size),
+                 .density = std::bit_cast<uint32_t>(baked->RasterizerDensity),
+                 .codepoint = codepoint};
+    if (const auto *cached = cache.find(key)) {
+        return replay(atlas, src, baked, *cached, out_glyph);
+    }
+    if (!inner->FontBakedLoadGlyph(atlas, src, baked, loader_data, codepoint,
+                                   out_glyph, out_advance_x)) {
+        return false;
+    }
+    rasterized++;
+    last_rasterized = std::chrono::steady_clock::now();
+    cache.insert(key, capture(atlas, *out_glyph));
+    return true;
+}
+} // namespace
+
+void install_glyph_cache(ImFontAtlas *atlas,
+                         const std::filesystem::path &cache_path) {
+    cache_file = cache_path;
+    if (cache.load(cache_path)) {
+        font_logger->info("Glyph cache: {} glyphs, {} KiB",
+                          cache.stats().glyphs,
+                          cache.stats().bitmap_bytes / 1024);
+    }
+    inner = ImFontAtlasGetFontLoaderForStbTruetype();
+    loader = *inner;
+    loader.Name = "stb_truetype, cached";
+    loader.FontSrcInit = source_init;
+    loader.FontSrcDestroy = source_destroy;
+    loader.FontBakedLoadGlyph = load_glyph;
+    atlas->SetFontLoader(&loader);
+}
+
+void save_glyph_cache() {
+    if (cache_file.empty() || !cache.dirty()) {
+        return;
+    }
+    std::string error;
+    if (!cache.save(cache_file, error)) {
+        font_logger->warn("Cannot save the glyph cache: {}", error);
+    }
+}
+
+void checkpoint_glyph_cache(std::chrono::steady_clock::time_point now) {
+    if (checkpointed || rasterized == 0 ||
+        now - last_rasterized < BURST_QUIET) {
+        return;
+    }
+    checkpointed = true;
+    save_glyph_cache();
+}
+
+auto add_ui_font(ImFontAtlas *atlas, float size) -> ImFont * {
+    auto exe_dir = get_executable_dir();
+    auto sans_path = exe_dir / "assets" / "NotoSans-Regular.ttf";
+    auto *font = atlas->AddFontFromFileTTF(sans_path.c_str(), size);
+    if (font == nullptr) {
+        return nullptr;
+    }
+
+    std::string error;
+    for (const auto &candidate : CJK_FONTS) {
+        auto path = candidate.is_absolute() ? candidate : exe_dir / candidate;
+        if (!std::filesystem::exists(path) || !cjk_font.open(path, error)) {
+            continue;
+        }
+        ImFontConfig config;
+        config.MergeMode = true;
+        config.FontDataOwnedByAtlas = false;
+        auto bytes = cjk_font.bytes();
+        // ImGui takes a mutable pointer but only reads it.
+        atlas->AddFontFromMemoryTTF(const_cast<uint8_t *>(bytes.data()),
+                                    static_cast<int>(bytes.size()), size,
+                                    &config);
+        font_logger->info("CJK glyphs from {}", path.string());
+        return font;
+    }
+    font_logger->warn("No CJK font found; Japanese names will not render");
+    return font;
+}
+
+auto font_stats(const ImFontAtlas *atlas) -> FontStats {
+    FontStats stats{.cache = cache.stats(), .rasterized = rasterized};
+    if (const auto *texture = atlas->TexData) {
+        stats.atlas_width = texture->Width;
+        stats.atlas_height = texture->Height;
+        stats.atlas_bytes = static_cast<std::size_t>(texture->Width) *
+                            texture->Height * texture->BytesPerPixel;
+    }
+    return stats;
+}
@@ -0,0 +1,36 @@
+#pragma once
+#include "glyph_cache.h"
+#include "imgui.h"
+#include <chrono>
+#include <filesystem>
+
+struct FontStats {
+    GlyphCacheStats cache;
+    uint64_t rasterized = 0; // glyphs the font loader baked this run
+    int atlas_width = 0;
+    int atlas_height = 0;
+    std::size_t atlas_bytes = 0;
+};
+
+// Loads `cache_path` (none if empty) and routes every glyph the atlas
+// needs through it: cached bitmaps are copied into the atlas, anything
+// else is rasterised by ImGui's stb_truetype loader and kept. ImGui 1.92
+// loads glyphs the first time a string uses them and updates the atlas
+// texture in place, so nothing is baked up front. Call before adding
+// fonts.
+void install_glyph_cache(ImFontAtlas *atlas,
+                         const std::filesystem::path &cache_path);
+// Writes glyphs rasterised since the last save. Deflates the whole cache,
+// so it runs at exit and in checkpoint_glyph_cache(), not per frame.
+void save_glyph_cache();
+// Saves once during the run, when the first-use burst of rasterising has
+// been quiet for a few seconds; glyphs after that wait for the save at
+// exit. Call from idle frames only.
+void checkpoint_glyph_cache(std::chrono::steady_clock::time_point now);
+
+// NotoSans with a CJK font merged in for Japanese names. The CJK font is
+// mapped, not read: only the pages of glyphs in use are touched. Without
+// one, Japanese text draws as missing glyphs and a warning is logged.
+auto add_ui_font(ImFontAtlas *atlas, float size) -> ImFont *;
+
+auto font_stats(const ImFontAtlas *atlas) -> FontStats;
@@ -0,0 +1,52 @@
+#include "frame_pacer.h"
+
+FramePacer::FramePacer(clock::time_point now) : last_frame_(now) {}
+
+auto FramePacer::mode(clock::time_point now) const -> epsp_frame_mode_t {
+    if (settle_ > 0 || animating_ || now < alert_until_) {
+        return epsp_frame_mode_t::FRAME_ACTIVE;
+    }
+    return epsp_frame_mode_t::FRAME_IDLE;
+}
+
+auto FramePacer::wait_timeout(clock::time_point now) const
+    -> std::chrono::duration<double> {
+    if (mode(now) == epsp_frame_mode_t::FRAME_ACTIVE) {
+        return std::chrono::duration<double>::zero();
+    }
+    return IDLE_TIMEOUT;
+}
+
+auto FramePacer::take_frame(clock::time_point now) -> bool {
+    bool posted = posted_.exchange(false, std::memory_order_acq_rel);
+    bool due = now >= due_;
+    if (due) {
+        due_ = clock::time_point::max();
+    }
+    return posted || due || waited_ == epsp_frame_mode_t::FRAME_ACTIVE ||
+           mode(now) == epsp_frame_mode_t::FRAME_ACTIVE;
+}
+
+void FramePacer::frame_rendered(clock::time_point now) {
+    auto index = static_cast<std::size_t>(waited_);
+    frames_[index]++;
+    elapsed_[index] += now - last_frame_;
+    last_frame_ = now;
+    if (settle_ > 0) {
+        settle_--;
+    }
+    waited_ = mode(now);
+}
+
+auto FramePacer::rates() const -> FrameRates {
+    auto per_minute = [this](epsp_frame_mode_t mode) -> double {
+        auto index = static_cast<std::size_t>(mode);
+        auto minutes =
+            std::chrono::duration<double, std::ratio<60>>(elapsed_[index]);
+        return minutes.count() > 0.0
+                   ? static_cast<double>(frames_[index]) / minutes.count()
+                   : 0.0;
+    };
+    return {.idle_per_minute = per_minute(epsp_frame_mode_t::FRAME_IDLE),
+            .active_per_minute = per_minute(epsp_frame_mode_t::FRAME_ACTIVE)};
+}
@@ -0,0 +1,73 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+enum class epsp_frame_mode_t : uint8_t {
+    FRAME_IDLE,   // nothing changing: block until input or a network event
+    FRAME_ACTIVE, // input settling, animation or alert: render every vsync
+};
+
+struct FrameRates {
+    double idle_per_minute = 0.0;
+    double active_per_minute = 0.0;
+};
+
+// Decides whether the render loop polls at vsync or blocks in
+// glfwWaitEventsTimeout. Knows nothing about GLFW or ImGui so the policy
+// can be tested on its own.
+class FramePacer {
+public:
+    using clock = std::chrono::steady_clock;
+
+    // ImGui needs a few frames after an input to settle hover and focus.
+    static constexpr uint32_t SETTLE_FRAMES = 3;
+    // Longest idle block. A wait that times out with nothing to show
+    // renders nothing, so this only bounds how long the loop sleeps.
+    static constexpr std::chrono::milliseconds IDLE_TIMEOUT{1000};
+    // How long an earthquake or tsunami event keeps the loop at full rate.
+    static constexpr std::chrono::seconds ALERT_HOLD{60};
+
+    explicit FramePacer(clock::time_point now = clock::now());
+
+    // The loop woke up: input, a posted empty event or the timeout.
+    void wake() { settle_ = SETTLE_FRAMES; }
+    // Set every frame from the UI state (dragging, scrolling, tweens).
+    void set_animating(bool animating) { animating_ = animating; }
+    void start_alert(clock::time_point now) { alert_until_ = now + ALERT_HOLD; }
+    // Any thread: a worker has something new to show (a tile, a history
+    // view, a detection snapshot). Worth one frame, not the settle frames.
+    void post() { posted_.store(true, std::memory_order_release); }
+    // Render thread: a frame is due at `at` even if nothing else happens,
+    // e.g. for a time filter that slides. The earliest request wins; the
+    // idle wait may overshoot it by up to IDLE_TIMEOUT.
+    void request_frame(clock::time_point at) { due_ = std::min(due_, at); }
+
+    // After the wait: whether to render. An idle wait that ended with no
+    // input, no network event and nothing posted would redraw the same
+    // frame, so it is skipped.
+    [[nodiscard]] auto take_frame(clock::time_point now) -> bool;
+
+    [[nodiscard]] auto mode(clock::time_point now) const -> epsp_frame_mode_t;
+    // Zero means poll and render at vsync.
+    [[nodiscard]] auto wait_timeout(clock::time_point now) const
+        -> std::chrono::duration<double>;
+
+    // Call after each rendered frame; charges it and the time since the
+    // previous one to the mode the loop was waiting in.
+    void frame_rendered(clock::time_point now);
+    [[nodiscard]] auto rates() const -> FrameRates;
+
+private:
+    uint32_t settle_ = SETTLE_FRAMES;
+    bool animating_ = false;
+    clock::time_point alert_until_{};
+    clock::time_point last_frame_;
+    epsp_frame_mode_t waited_ = epsp_frame_mode_t::FRAME_ACTIVE;
+    std::atomic<bool> posted_{false};
+    clock::time_point due_ = clock::time_point::max();
+    std::array<uint64_t, 2> frames_{};
+    std::array<clock::duration, 2> elapsed_{};
+};
@@ -0,0 +1,232 @@
+#include "glyph_cache.h"
+#include "../utils/byte_order.h"
+#include "../utils/region.h"
+#include <bit>
+#include <cstring>
+#include <fstream>
+#include <new>
+#include <zlib.h>
+
+namespace {
+constexpr std::string_view MAGIC = "EPSPGLY1";
+constexpr std::size_t HEADER_BYTES = MAGIC.size() + 3 * 4;
+constexpr std::size_t RECORD_BYTES = 4 * 4 + 5 * 4 + 1 + 2 * 2;
+constexpr std::size_t FINGERPRINT_BYTES = 64 * 1024;
+// Bounds on the size the header claims, checked before allocating: the
+// region glyphs at a few sizes take a few MB, and deflate never expands
+// by more than about 1032:1.
+constexpr uint64_t MAX_BODY_BYTES = 64 * 1024 * 1024;
+constexpr uint64_t MAX_DEFLATE_RATIO = 1032;
+
+void put_float(std::vector<uint8_t> &out, float value) {
+    put_le(out, std::bit_cast<uint32_t>(value), 4);
+}
+
+auto get_float(std::span<const uint8_t> in, std::size_t at) -> float {
+    return std::bit_cast<float>(static_cast<uint32_t>(get_le(in, at, 4)));
+}
+
+// Decodes one UTF-8 sequence at the front of `text`; U+FFFD for a bad one.
+auto next_codepoint(std::string_view &text) -> char32_t {
+    auto lead = static_cast<uint8_t>(text.front());
+    std::size_t length = lead < 0x80   ? 1
+                         : lead < 0xE0 ? 2
+                         : lead < 0xF0 ? 3
+                                       : 4;
+    if (lead >= 0x80 && lead < 0xC0) {
+        length = 1;
+    }
+    if (length > text.size()) {
+        text = {};
+        return U'�';
+    }
+    char32_t codepoint = length == 1 ? lead : lead & (0x7F >> length);
+    for (std::size_t i = 1; i < length; i++) {
+        codepoint = codepoint << 6 | (static_cast<uint8_t>(text[i]) & 0x3F);
+    }
+    text.remove_prefix(length);
+    return lead >= 0x80 && length == 1 ? U'�' : codepoint;
+}
+} // namespace
+
+auto GlyphCache::load(const std::filesystem::path &path) -> bool {
+    glyphs_.clear();
+    stats_ = {};
+    dirty_ = false;
+
+    std::ifstream file(path, std::ios::binary);
+    std::vector<uint8_t> bytes((std::istreambuf_iterator<char>(file)),
+                               std::istreambuf_iterator<char>());
+    if (bytes.size() < HEADER_BYTES ||
+        std::memcmp(bytes.data(), MAGIC.data(), MAGIC.size()) != 0) {
+        return false;
+    }
+    auto count = get_le(bytes, 8, 4);
+    auto body_size = get_le(bytes, 12, 4);
+    auto crc = static_cast<uint32_t>(get_le(bytes, 16, 4));
+    if (body_size < count * RECORD_BYTES || body_size > MAX_BODY_BYTES ||
+        body_size > (bytes.size() - HEADER_BYTES) * MAX_DEFLATE_RATIO) {
+        return false;
+    }
+    std::vector<uint8_t> body;
+    try {
+        body.resize(body_size);
+    } catch (const std::bad_alloc &) {
+        return false;
+    }
+    auto size = static_cast<uLongf>(body.size());
+    if (uncompress(body.data(), &size, bytes.data() + HEADER_BYTES,
+                   static_cast<uLong>(bytes.size() - HEADER_BYTES)) != Z_OK ||
+        size != body.size() ||
+        crc32(0, body.data(), static_cast<uInt>(body.size())) != crc) {
+        return false;
+    }
+
+    std::size_t at = 0;
+    for (uint64_t i = 0; i < count; i++) {
+        if (body.size() - at < RECORD_BYTES) {
+            glyphs_.clear();
+            return false;
+        }
+        GlyphKey key{.font = static_cast<uint32_t>(get_le(body, at, 4)),
+                     .size = static_cast<uint32_t>(get_le(body, at + 4, 4)),
+                     .density =
+                         static_cast<uint32_t>(get_le(body, at + 8, 4)),
+                     .codepoint =
+                         static_cast<uint32_t>(get_le(body, at + 12, 4))};
+        CachedGlyph glyph;
+        glyph.advance = get_float(body, at + 16);
+        glyph.x0 = get_float(body, at + 20);
+        glyph.y0 = get_float(body, at + 24);
+        glyph.x1 = get_float(body, at + 28);
+        glyph.y1 = get_float(body, at + 32);
+        glyph.visible = body[at + 36] != 0;
+        glyph.width = static_cast<uint16_t>(get_le(body, at + 37, 2));
+        glyph.height = static_cast<uint16_t>(get_le(body, at + 39, 2));
+        at += RECORD_BYTES;
+        auto pixels = std::size_t{glyph.width} * glyph.height;
+        if (body.size() - at < pixels) {
+            glyphs_.clear();
+            return false;
+        }
+        glyph.alpha.assign(body.begin() + static_cast<std::ptrdiff_t>(at),
+                           body.begin() +
+                               static_cast<std::ptrdiff_t>(at + pixels));
+        at += pixels;
+        stats_.bitmap_bytes += pixels;
+        glyphs_.insert_or_assign(key, std::move(glyph));
+    }
+    stats_.glyphs = glyphs_.size();
+    return true;
+}
+
+auto GlyphCache::save(const std::filesystem::path &path, std::string &error)
+    -> bool {
+    if (!dirty_) {
+        return true;
+    }
+    std::vector<uint8_t> body;
+    body.reserve(glyphs_.size() * RECORD_BYTES + stats_.bitmap_bytes);
+    for (const auto &[key, glyph] : glyphs_) {
+        put_le(body, key.font, 4);
+        put_le(body, key.size, 4);
+        put_le(body, key.density, 4);
+        put_le(body, key.codepoint, 4);
+        put_float(body, glyph.advance);
+        put_float(body, glyph.x0);
+        put_float(body, glyph.y0);
+        put_float(body, glyph.x1);
+        put_float(body, glyph.y1);
+        body.push_back(glyph.visible ? 1 : 0);
+        put_le(body, glyph.width, 2);
+        put_le(body, glyph.height, 2);
+        body.insert(body.end(), glyph.alpha.begin(), glyph.alpha.end());
+    }
+
+    std::vector<uint8_t> out;
+    out.insert(out.end(), MAGIC.begin(), MAGIC.end());
+    put_le(out, glyphs_.size(), 4);
+    put_le(out, body.size(), 4);
+    put_le(out, crc32(0, body.data(), static_cast<uInt>(body.size())), 4);
+    auto bound = compressBound(static_cast<uLong>(body.size()));
+    out.resize(HEADER_BYTES + bound);
+    auto size = static_cast<uLongf>(bound);
+    if (compress(out.data() + HEADER_BYTES, &size, body.data(),
+                 static_cast<uLong>(body.size())) != Z_OK) {
+        error = "cannot deflate the glyph cache";
+        return false;
+    }
+    out.resize(HEADER_BYTES + size);
+
+    std::filesystem::path temp_path = path;
+    temp_path += ".tmp";
+    {
+        std::ofstream file(temp_path, std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char *>(out.data()),
+                   static_cast<std::streamsize>(out.size()));
+        if (!file) {
+            error = "cannot write " + temp_path.string();
+            return false;
+        }
+    }
+    std::error_code ecode;
+    std::filesystem::rename(temp_path, path, ecode);
+    if (ecode) {
+        error = ecode.message();
+        return false;
+    }
+    dirty_ = false;
+    return true;
+}
+
+auto GlyphCache::find(const GlyphKey &key) -> const CachedGlyph * {
+    auto found = glyphs_.find(key);
+    if (found == glyphs_.end()) {
+        stats_.misses++;
+        return nullptr;
+    }
+    stats_.hits++;
+    return &found->second;
+}
+
+void GlyphCache::insert(const GlyphKey &key, CachedGlyph glyph) {
+    auto &slot = glyphs_.try_emplace(key).first->second;
+    stats_.bitmap_bytes += glyph.alpha.size() - slot.alpha.size();
+    slot = std::move(glyph);
+    stats_.glyphs = glyphs_.size();
+    dirty_ = true;
+}
+
+auto font_fingerprint(std::span<const uint8_t> data,
+                      std::span<const uint8_t> options) -> uint32_t {
+    auto head = data.first(std::min(data.size(), FINGERPRINT_BYTES));
+    auto crc = crc32(0, head.data(), static_cast<uInt>(head.size()));
+    std::array<uint8_t, 8> size{};
+    for (std::size_t i = 0; i < size.size(); i++) {
+        size[i] = static_cast<uint8_t>(uint64_t{data.size()} >> (8 * i));
+    }
+    crc = crc32(crc, size.data(), static_cast<uInt>(size.size()));
+    return static_cast<uint32_t>(
+        crc32(crc, options.data(), static_cast<uInt>(options.size())));
+}
+
+auto distinct_codepoints(std::string_view text) -> std::vector<char32_t> {
+    std::vector<char32_t> codepoints;
+    while (!text.empty()) {
+        codepoints.push_back(next_codepoint(text));
+    }
+    std::ranges::sort(codepoints);
+    auto [first, last] = std::ranges::unique(codepoints);
+    codepoints.erase(first, last);
+    return codepoints;
+}
+
+auto region_codepoints() -> std::vector<char32_t> {
+    std::string names;
+    for (const auto &region : regions) {
+        names += region.area;
+        names += region.pref;
+        names += region.regions;
+    }
+    return distinct_codepoints(names);
+}
@@ -0,0 +1,89 @@
+#pragma once
+#include <cstdint>
+#include <filesystem>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// One rasterised glyph at one baked size, as the font loader produced it.
+struct GlyphKey {
+    uint32_t font;    // font_fingerprint() of the source
+    uint32_t size;    // bit pattern of the baked size in pixels
+    uint32_t density; // bit pattern of the rasterizer density
+    uint32_t codepoint;
+
+    auto operator==(const GlyphKey &) const -> bool = default;
+};
+
+struct GlyphKeyHash {
+    auto operator()(const GlyphKey &key) const -> std::size_t {
+        auto mixed = (uint64_t{key.font} << 32 | key.codepoint) ^
+                     (uint64_t{key.size} << 16 | key.density) *
+                         0x9E3779B97F4A7C15ULL;
+        return static_cast<std::size_t>(mixed ^ (mixed >> 29));
+    }
+};
+
+struct CachedGlyph {
+    float advance = 0.0F;
+    float x0 = 0.0F; // quad relative to the pen, in pixels
+    float y0 = 0.0F;
+    float x1 = 0.0F;
+    float y1 = 0.0F;
+    bool visible = false;
+    uint16_t width = 0; // bitmap, oversampled as packed
+    uint16_t height = 0;
+    std::vector<uint8_t> alpha;
+};
+
+struct GlyphCacheStats {
+    std::size_t glyphs = 0;
+    std::size_t bitmap_bytes = 0;
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+};
+
+// Glyph bitmaps kept across runs, so a warm start bakes nothing: the font
+// loader asks here before rasterising and stores what it rasterised. The
+// file is little-endian:
+//
+//   "EPSPGLY1", u32 glyph count, u32 body size, u32 crc32 of the body,
+//   then the body deflated. Per glyph: u32 font, size, density,
+//   codepoint; f32 advance, x0, y0, x1, y1; u8 visible; u16 width,
+//   height; width * height bytes of alpha.
+//
+// Render thread only.
+class GlyphCache {
+public:
+    // Replaces the contents with `path`. A missing, corrupt or foreign
+    // file leaves the cache empty and returns false.
+    auto load(const std::filesystem::path &path) -> bool;
+    // Writes through a temporary file and a rename; a no-op when nothing
+    // changed since the last load or save.
+    auto save(const std::filesystem::path &path, std::string &error) -> bool;
+
+    // Counts a hit or a miss.
+    auto find(const GlyphKey &key) -> const CachedGlyph *;
+    void insert(const GlyphKey &key, CachedGlyph glyph);
+
+    [[nodiscard]] auto dirty() const -> bool { return dirty_; }
+    [[nodiscard]] auto stats() const -> GlyphCacheStats { return stats_; }
+
+private:
+    std::unordered_map<GlyphKey, CachedGlyph, GlyphKeyHash> glyphs_;
+    bool dirty_ = false;
+    GlyphCacheStats stats_;
+};
+
+// Identifies a font and the options that change its bitmaps. Reads the
+// first 64 KiB only: the table directory with its checksums is there, so
+// a mapped CJK font is not paged in just to be named.
+auto font_fingerprint(std::span<const uint8_t> data,
+                      std::span<const uint8_t> options) -> uint32_t;
+
+// Every distinct codepoint in `text` (UTF-8), ascending.
+auto distinct_codepoints(std::string_view text) -> std::vector<char32_t>;
+// The codepoints the region table's names need.
+auto region_codepoints() -> std::vector<char32_t>;
@@ -1,6 +1,12 @@
 #include "gui_main.h"
+#include "../comms/detections.h"
+#include "../comms/event_channel.h"
 #include "../utils/path.h"
+#include "../utils/region.h"
+#include "font_atlas.h"
+#include "frame_pacer.h"
 #include "history.h"
+#include "map_view.h"
 #include <GLFW/glfw3.h>
 #include <imgui.h>
 #include <imgui_impl_glfw.h>
@@ -12,15 +18,86 @@ const std::shared_ptr<spdlog::logger> gui_logger =
 namespace {
 GLFWwindow *window = nullptr;
 ImFont *font_sans;
+FramePacer pacer;
+GuiOptions gui_options;
+std::chrono::steady_clock::time_point fonts_started{};
 void glfw_error_callback(int error, const char *description) {
     gui_logger->error("GLFW error {}: {}", error, description);
 }
-void draw() { draw_history(); }
+
+// Installed before the ImGui backend, which chains to them. Any input
+// wakes the pacer so ImGui gets its settle frames.
+void install_wake_callbacks() {
+    glfwSetCursorPosCallback(
+        window, [](GLFWwindow *, double, double) -> void { pacer.wake(); });
+    glfwSetMouseButtonCallback(
+        window, [](GLFWwindow *, int, int, int) -> void { pacer.wake(); });
+    glfwSetScrollCallback(
+        window, [](GLFWwindow *, double, double) -> void { pacer.wake(); });
+    glfwSetKeyCallback(window, [](GLFWwindow *, int, int, int, int) -> void {
+        pacer.wake();
+    });
+    glfwSetCharCallback(
+        window, [](GLFWwindow *, unsigned int) -> void { pacer.wake(); });
+    glfwSetWindowFocusCallback(
+        window, [](GLFWwindow *, int) -> void { pacer.wake(); });
+    glfwSetFramebufferSizeCallback(
+        window, [](GLFWwindow *, int, int) -> void { pacer.wake(); });
+    glfwSetWindowRefreshCallback(window,
+                                 [](GLFWwindow *) -> void { pacer.wake(); });
+}
+
+auto is_alert(epsp_event_kind_t kind) -> bool {
+    return kind == epsp_event_kind_t::EVENT_EQK_INFO ||
+           kind == epsp_event_kind_t::EVENT_TSU_INFO;
+}
+
+void draw() {
+    draw_map();
+    draw_history();
+}
+
+// Every region name once, so the atlas holds what the table needs.
+// Rows scrolled out of view are still measured, which loads their glyphs.
+void draw_region_names() {
+    ImGui::SetNextWindowPos(ImVec2(320, 50));
+    ImGui::SetNextWindowSize(ImVec2(400, 600));
+    ImGui::Begin("Regions");
+    for (const auto &region : regions) {
+        ImGui::TextUnformatted(region.area.data(),
+                               region.area.data() + region.area.size());
+    }
+    ImGui::End();
+}
+
+void log_font_report() {
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - fonts_started);
+    auto fonts = font_stats(ImGui::GetIO().Fonts);
+    gui_logger->info("Fonts: {} region names drawn {} ms after font setup; "
+                     "{} glyphs rasterised, {} from the cache; atlas {}x{}, "
+                     "{} KiB",
+                     regions.size(), elapsed.count(), fonts.rasterized,
+                     fonts.cache.hits, fonts.atlas_width, fonts.atlas_height,
+                     fonts.atlas_bytes / 1024);
+}
 } // namespace
 
 auto get_font_sans() -> ImFont * { return font_sans; }
 
-auto init_gui() -> int {
+auto gui_frame_rates() -> FrameRates { return pacer.rates(); }
+
+void post_frame() {
+    pacer.post();
+    glfwPostEmptyEvent();
+}
+
+void request_frame_at(std::chrono::steady_clock::time_point at) {
+    pacer.request_frame(at);
+}
+
+auto init_gui(GuiOptions options) -> int {
+    gui_options = options;
     glfwSetErrorCallback(glfw_error_callback);
     if (!glfwInit()) {
         gui_logger->error("Failed to initialize GLFW");
@@ -41,6 +118,12 @@ auto init_gui() -> int {
     }
     glfwMakeContextCurrent(window);
     glfwSwapInterval(1);
+    // New network events wake a render thread blocked in glfwWait*.
+    net_events().set_wake([] -> void { glfwPostEmptyEvent(); });
+    // The 555 counts slide without new events; a changed snapshot is the
+    // only time-dependent text, so it wakes the loop itself.
+    detections().set_wake([] -> void { post_frame(); });
+    install_wake_callbacks();
 
     IMGUI_CHECKVERSION();
     ImGui::CreateContext();
@@ -49,26 +132,61 @@ auto init_gui() -> int {
     io.ConfigFlags |= ImGuiConfigFlags_NavEnableKeyboard;
     io.IniFilename = nullptr;
 
-    std::filesystem::path font_sans_path =
-        get_executable_dir() / "assets" / "NotoSans-Regular.ttf";
-
-    font_sans = io.Fonts->AddFontFromFileTTF((font_sans_path.c_str()), 16.0F);
+    // Glyphs are rasterised on first use; the cache makes later runs
+    // copy them instead. Without a cache directory they are only kept for
+    // this run.
+    fonts_started = std::chrono::steady_clock::now();
+    auto cache_dir = get_cache_dir();
+    install_glyph_cache(io.Fonts, cache_dir.empty()
+                                      ? std::filesystem::path{}
+                                      : cache_dir / "glyph_cache.bin");
+    font_sans = add_ui_font(io.Fonts, 16.0F);
 
     ImGui::StyleColorsDark();
 
     ImGui_ImplGlfw_InitForOpenGL(window, true);
     ImGui_ImplOpenGL3_Init(glsl_version);
+    init_map(options.map_budget_bytes);
+    init_history();
     return 0;
 }
 
 void gui_loop() {
+    std::vector<NetEvent> events;
+    events.reserve(EventChannel::CAPACITY);
+    auto next_report = FramePacer::clock::now() + std::chrono::minutes(1);
+    bool font_report = gui_options.font_report;
     while (!glfwWindowShouldClose(window)) {
-        glfwPollEvents();
+        // Idle: block until input, a network event or the timeout.
+        auto timeout = pacer.wait_timeout(FramePacer::clock::now());
+        if (timeout.count() > 0) {
+            glfwWaitEventsTimeout(timeout.count());
+        } else {
+            glfwPollEvents();
+        }
+
+        // Everything the io threads published since the last frame.
+        events.clear();
+        if (net_events().drain(events) > 0) {
+            add_history(events);
+            add_map_events(events);
+            pacer.wake();
+            if (std::ranges::any_of(events, is_alert, &NetEvent::kind)) {
+                pacer.start_alert(FramePacer::clock::now());
+            }
+        }
+        if (!pacer.take_frame(FramePacer::clock::now())) {
+            continue;
+        }
+
         ImGui_ImplOpenGL3_NewFrame();
         ImGui_ImplGlfw_NewFrame();
         ImGui::NewFrame();
 
         draw();
+        if (font_report) {
+            draw_region_names();
+        }
 
         ImGui::Render();
         int32_t display_w = 0;
@@ -80,10 +198,36 @@ void gui_loop() {
         ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
 
         glfwSwapBuffers(window);
+        if (font_report) {
+            log_font_report();
+            font_report = false;
+        }
+
+        pacer.set_animating(ImGui::IsAnyItemActive() ||
+                            ImGui::IsMouseDragging(ImGuiMouseButton_Left));
+        auto now = FramePacer::clock::now();
+        pacer.frame_rendered(now);
+        // Glyphs rasterised at startup survive a crash; saving deflates
+        // the cache, so never in the middle of an alert or a drag.
+        if (pacer.mode(now) == epsp_frame_mode_t::FRAME_IDLE) {
+            checkpoint_glyph_cache(now);
+        }
+        if (now >= next_report) {
+            auto rates = pacer.rates();
+            auto map = map_stats();
+            gui_logger->debug("Frames per minute: idle {:.1f}, active {:.1f}; "
+                              "map textures {} KiB in {} tiles",
+                              rates.idle_per_minute, rates.active_per_minute,
+                              map.resident_bytes / 1024, map.resident_tiles);
+            next_report = now + std::chrono::minutes(1);
+        }
     }
 }
 
 void cleanup_gui() {
+    cleanup_history();
+    cleanup_map();
+    save_glyph_cache();
     ImGui_ImplOpenGL3_Shutdown();
     ImGui_ImplGlfw_Shutdown();
     ImGui::DestroyContext();
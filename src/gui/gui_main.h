@@ -1,8 +1,25 @@
 #pragma once
+#include "../map/tile_streamer.h"
+#include "frame_pacer.h"
 #include "imgui.h"
 
 auto get_font_sans() -> ImFont *;
+// Rendered frames per minute in each pacing mode, since start.
+auto gui_frame_rates() -> FrameRates;
+// Any thread: wakes the render loop for one frame, e.g. when a worker's
+// result is ready.
+void post_frame();
+// Render thread: draws a frame at `at` even if the loop is idle.
+void request_frame_at(std::chrono::steady_clock::time_point at);
 
-auto init_gui() -> int;
+struct GuiOptions {
+    // Texture memory the map may keep resident.
+    std::size_t map_budget_bytes = TileStreamerOptions{}.budget_bytes;
+    // Draws every region name on the first frame, then logs how long the
+    // fonts took and how large the atlas grew.
+    bool font_report = false;
+};
+
+auto init_gui(GuiOptions options = {}) -> int;
 void gui_loop();
 void cleanup_gui();
@@ -1,8 +1,154 @@
 #include "history.h"
+#include "../comms/detections.h"
+#include "event_store.h"
 #include "gui_main.h"
-#include "imgui.h"
+#include <array>
+#include <imgui.h>
+
+namespace {
+// Offered by the "Since" combo; zero is no limit.
+constexpr std::array<std::chrono::hours, 4> SINCE_SPANS = {
+    std::chrono::hours(0), std::chrono::hours(1), std::chrono::hours(24),
+    std::chrono::hours(24 * 7)};
+constexpr std::array<const char *, SINCE_SPANS.size()> SINCE_NAMES = {
+    "Any time", "Last hour", "Last day", "Last week"};
+// The since cutoff is taken when the view is requested, and a quiet box
+// requests nothing else, so a selected span asks again this often.
+constexpr std::chrono::minutes SINCE_SLIDE{1};
+constexpr std::array<const char *, 3> SORT_NAMES = {"Newest", "Oldest",
+                                                    "Strongest"};
+
+EventStore store;
+std::unique_ptr<HistoryQueries> queries;
+RowTextCache row_text;
+
+// As set in the panel.
+HistoryFilter filter;
+int since_index = 0;
+std::chrono::steady_clock::time_point next_slide{};
+std::array<char, 64> region_text{};
+bool region_unknown = false;
+
+auto since_span() -> std::chrono::hours {
+    return SINCE_SPANS[static_cast<std::size_t>(since_index)];
+}
+
+// Asks for the view again; `since` is taken from now, so a span keeps
+// sliding as events arrive and every SINCE_SLIDE without them.
+void request_view() {
+    auto query = filter;
+    if (auto span = since_span(); span.count() > 0) {
+        query.since = std::chrono::system_clock::now() - span;
+        next_slide = std::chrono::steady_clock::now() + SINCE_SLIDE;
+        request_frame_at(next_slide);
+    }
+    queries->request(query);
+}
+
+void draw_filters() {
+    bool changed = false;
+    for (std::size_t kind = 0; kind < EVENT_KINDS; kind++) {
+        auto bit = static_cast<uint8_t>(1U << kind);
+        bool shown = (filter.kinds & bit) != 0;
+        std::string label(event_label(static_cast<epsp_event_kind_t>(kind)));
+        if (ImGui::Checkbox(label.c_str(), &shown)) {
+            filter.kinds ^= bit;
+            changed = true;
+        }
+        if (kind % 2 == 0) {
+            ImGui::SameLine(ImGui::GetContentRegionAvail().x / 2);
+        }
+    }
+
+    auto shindo = shindo_name(filter.min_shindo);
+    if (ImGui::BeginCombo("Intensity",
+                          shindo.empty() ? "Any" : shindo.data())) {
+        for (uint8_t option = 0; option < SHINDO_CLASSES; option++) {
+            auto name = shindo_name(option);
+            if (ImGui::Selectable(option == 0 ? "Any" : name.data(),
+                                  option == filter.min_shindo)) {
+                filter.min_shindo = option;
+                changed = true;
+            }
+        }
+        ImGui::EndCombo();
+    }
+
+    if (ImGui::InputTextWithHint("Region", "code or name", region_text.data(),
+                                 region_text.size())) {
+        std::string_view text(region_text.data());
+        auto region = text.empty() ? StoredEvent::NO_REGION : find_area(text);
+        region_unknown = !text.empty() && region == StoredEvent::NO_REGION;
+        // An unknown name keeps the last region until it matches one.
+        if (!region_unknown && region != filter.region) {
+            filter.region = region;
+            changed = true;
+        }
+    }
+    if (region_unknown) {
+        ImGui::TextDisabled("No such region");
+    }
+
+    changed |= ImGui::Combo("Since", &since_index, SINCE_NAMES.data(),
+                            static_cast<int>(SINCE_NAMES.size()));
+    auto sort = static_cast<int>(filter.sort);
+    if (ImGui::Combo("Sort", &sort, SORT_NAMES.data(),
+                     static_cast<int>(SORT_NAMES.size()))) {
+        filter.sort = static_cast<history_sort_t>(sort);
+        changed = true;
+    }
+    if (changed) {
+        request_view();
+    }
+}
+
+// Only the rows in view are laid out, each formatted once while its cache
+// slot lasts, so the panel costs the same at 50 events or 50,000.
+void draw_rows(const HistoryView &view, float footer) {
+    ImGui::TextDisabled("%zu of %zu events (%.1f ms)", view.rows.size(),
+                        view.events,
+                        std::chrono::duration<double, std::milli>(view.took)
+                            .count());
+    ImGui::BeginChild("Rows", ImVec2(0.0F, -footer), ImGuiChildFlags_None,
+                      ImGuiWindowFlags_HorizontalScrollbar);
+    ImGuiListClipper clipper;
+    clipper.Begin(static_cast<int>(view.rows.size()));
+    while (clipper.Step()) {
+        for (int row = clipper.DisplayStart; row < clipper.DisplayEnd; row++) {
+            const auto &text = row_text.text(
+                store, view.rows[static_cast<std::size_t>(row)]);
+            ImGui::TextUnformatted(text.data(), text.data() + text.size());
+            if (ImGui::BeginItemTooltip()) {
+                ImGui::PushTextWrapPos(ImGui::GetFontSize() * 30.0F);
+                ImGui::TextUnformatted(text.data(), text.data() + text.size());
+                ImGui::PopTextWrapPos();
+                ImGui::EndTooltip();
+            }
+        }
+    }
+    ImGui::EndChild();
+}
+} // namespace
+
+void init_history() {
+    queries = std::make_unique<HistoryQueries>(store);
+    queries->set_wake([] -> void { post_frame(); });
+    request_view();
+}
+
+void add_history(std::span<NetEvent> events) {
+    for (const auto &event : events) {
+        store.add(event);
+    }
+}
 
 void draw_history() {
+    // Pending events wait for a frame in which no query holds the store.
+    bool slide = since_span().count() > 0 &&
+                 std::chrono::steady_clock::now() >= next_slide;
+    if (store.flush() > 0 || slide) {
+        request_view();
+    }
 
     static float_t width = 300.0F;
     static bool open = true;
@@ -23,5 +169,33 @@ void draw_history() {
         ImGui::Text("History");
         ImGui::PopFont();
     }
+    // Felt reports per region over the last 10 s / 60 s / 300 s, and the
+    // last minute's reports as a share of the region's active peers: a real
+    // quake is felt by many of them at once.
+    for (const auto &area : detections().latest().regions) {
+        auto name = static_cast<int>(area.region->area.size());
+        if (area.peers == 0) {
+            ImGui::Text("%.*s  %u / %u / %u  (peers unknown)", name,
+                        area.region->area.data(), area.counts[0],
+                        area.counts[1], area.counts[2]);
+            continue;
+        }
+        ImGui::Text("%.*s  %u / %u / %u  (%u peers, %.0f%%)", name,
+                    area.region->area.data(), area.counts[0], area.counts[1],
+                    area.counts[2], area.peers,
+                    100.0 * area.counts[1] / area.peers);
+    }
+    draw_filters();
+    auto dropped = net_events().stats().dropped;
+    if (auto view = queries ? queries->latest() : nullptr) {
+        draw_rows(*view, dropped > 0 ? ImGui::GetTextLineHeightWithSpacing()
+                                     : 0.0F);
+    }
+    if (dropped > 0) {
+        ImGui::TextDisabled("%llu events dropped",
+                            static_cast<unsigned long long>(dropped));
+    }
     ImGui::End();
 }
+
+void cleanup_history() { queries.reset(); }
@@ -1,3 +1,10 @@
 #pragma once
+#include "../comms/event_channel.h"
+#include <span>
 
+// Starts the query worker; it wakes the render thread with each result.
+void init_history();
+// Render thread only: appends one frame's drained events.
+void add_history(std::span<NetEvent> events);
 void draw_history();
+void cleanup_history();
@@ -0,0 +1,270 @@
+#include "map_view.h"
+#include "../comms/detections.h"
+#include "../map/projection.h"
+#include "../utils/path.h"
+#include "gui_main.h"
+#include <GLFW/glfw3.h>
+#include <imgui.h>
+
+#ifndef GL_CLAMP_TO_EDGE
+#define GL_CLAMP_TO_EDGE 0x812F
+#endif
+
+namespace {
+class GlTextureBackend : public TextureBackend {
+public:
+    auto create(const TileImage &image) -> uint64_t override {
+        GLuint texture = 0;
+        glGenTextures(1, &texture);
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        // Rows are width * 3 bytes, not 4-byte aligned.
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB,
+                     static_cast<GLsizei>(image.width),
+                     static_cast<GLsizei>(image.height), 0, GL_RGB,
+                     GL_UNSIGNED_BYTE, image.rgb.data());
+        return texture;
+    }
+    void destroy(uint64_t texture) override {
+        auto name = static_cast<GLuint>(texture);
+        glDeleteTextures(1, &name);
+    }
+};
+
+// The intensity surface: one RGBA texture, written a tile at a time.
+class GlOverlayBackend : public OverlayBackend {
+public:
+    auto create(uint32_t width, uint32_t height) -> uint64_t override {
+        GLuint texture = 0;
+        glGenTextures(1, &texture);
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        std::vector<uint8_t> clear(std::size_t{width} * height * 4, 0);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, static_cast<GLsizei>(width),
+                     static_cast<GLsizei>(height), 0, GL_RGBA,
+                     GL_UNSIGNED_BYTE, clear.data());
+        return texture;
+    }
+    void update(uint64_t texture, uint32_t x, uint32_t y, uint32_t width,
+                uint32_t height, std::span<const uint8_t> rgba) override {
+        glBindTexture(GL_TEXTURE_2D, static_cast<GLuint>(texture));
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, static_cast<GLint>(x),
+                        static_cast<GLint>(y), static_cast<GLsizei>(width),
+                        static_cast<GLsizei>(height), GL_RGBA,
+                        GL_UNSIGNED_BYTE, rgba.data());
+    }
+    void destroy(uint64_t texture) override {
+        auto name = static_cast<GLuint>(texture);
+        glDeleteTextures(1, &name);
+    }
+};
+
+GlTextureBackend backend;
+GlOverlayBackend overlay_backend;
+std::unique_ptr<TileStreamer> streamer;
+std::unique_ptr<IntensityField> intensity;
+// Occurrence time of the quake on the surface; its updates merge.
+std::string intensity_time;
+std::vector<IntensityPoint> intensity_points;
+MapViewport view;
+bool fitted = false;
+std::vector<TileDraw> draws;
+ScreenPoints markers;
+
+constexpr float DOT_RADIUS = 2.0F;
+constexpr float DETECTION_RADIUS_MAX = 12.0F;
+constexpr ImU32 DOT_COLOUR = IM_COL32(200, 200, 210, 160);
+constexpr ImU32 DETECTION_COLOUR = IM_COL32(255, 120, 40, 230);
+// The DETECTION_WINDOWS entry markers are sized by.
+constexpr std::size_t DETECTION_WINDOW = 1;
+
+// Level-0 map pixel under a screen point.
+auto to_map(ImVec2 point) -> std::pair<double, double> {
+    return {view.center_x + (point.x - view.width / 2.0) / view.zoom,
+            view.center_y + (point.y - view.height / 2.0) / view.zoom};
+}
+
+void handle_input() {
+    ImGuiIO &io = ImGui::GetIO();
+    if (io.WantCaptureMouse) {
+        return;
+    }
+    if (ImGui::IsMouseDragging(ImGuiMouseButton_Left)) {
+        view.center_x -= io.MouseDelta.x / view.zoom;
+        view.center_y -= io.MouseDelta.y / view.zoom;
+    }
+    if (io.MouseWheel != 0.0F) {
+        // Keep the point under the cursor fixed while zooming.
+        auto [before_x, before_y] = to_map(io.MousePos);
+        view.zoom = std::clamp(view.zoom * std::pow(1.2, io.MouseWheel),
+                               1.0 / 64.0, 4.0);
+        auto [after_x, after_y] = to_map(io.MousePos);
+        view.center_x += before_x - after_x;
+        view.center_y += before_y - after_y;
+    }
+}
+
+void add_images(ImDrawList *draw_list, const std::vector<TileDraw> &quads) {
+    for (const auto &draw : quads) {
+        draw_list->AddImage(static_cast<ImTextureID>(draw.texture),
+                            ImVec2(draw.rect[0], draw.rect[1]),
+                            ImVec2(draw.rect[2], draw.rect[3]),
+                            ImVec2(draw.uv[0], draw.uv[1]),
+                            ImVec2(draw.uv[2], draw.uv[3]));
+    }
+}
+
+void add_square(ImDrawList *draw_list, float x, float y, float radius,
+                ImU32 colour) {
+    draw_list->PrimRect(ImVec2(x - radius, y - radius),
+                        ImVec2(x + radius, y + radius), colour);
+}
+
+// A dot per region the level of detail admits, and a larger one for each
+// region with recent 555 reports whatever the zoom. Everything goes into
+// one vertex reservation: a single draw command however many markers.
+void draw_markers(ImDrawList *draw_list) {
+    const auto &projection = region_projection();
+    projection.transform(view, DETECTION_RADIUS_MAX, markers);
+    const auto &snapshot = detections().latest();
+
+    auto quads = static_cast<int>(markers.size() + snapshot.regions.size());
+    if (quads == 0) {
+        return;
+    }
+    draw_list->PrimReserve(quads * 6, quads * 4);
+    for (std::size_t i = 0; i < markers.size(); i++) {
+        add_square(draw_list, markers.x[i], markers.y[i], DOT_RADIUS,
+                   DOT_COLOUR);
+    }
+    int unused = 0;
+    for (const auto &area : snapshot.regions) {
+        auto count = area.counts[DETECTION_WINDOW];
+        auto at = projection.to_screen(
+            view, static_cast<std::size_t>(area.region - regions.data()));
+        if (count == 0 || !at) {
+            unused++;
+            continue;
+        }
+        auto radius = std::min(
+            DETECTION_RADIUS_MAX,
+            3.0F + 2.0F * std::log2(1.0F + static_cast<float>(count)));
+        add_square(draw_list, at->first, at->second, radius,
+                   DETECTION_COLOUR);
+    }
+    draw_list->PrimUnreserve(unused * 6, unused * 4);
+}
+} // namespace
+
+void init_map(std::size_t budget_bytes) {
+    streamer = std::make_unique<TileStreamer>(
+        backend, TileStreamerOptions{.budget_bytes = budget_bytes});
+    streamer->set_wake([] -> void { post_frame(); });
+    // The pack built with the client opens instantly; the PNG is the
+    // fallback for trees built without it.
+    auto assets = get_executable_dir() / "assets";
+    auto pack = assets / "japan_z6.pack";
+    streamer->start(std::filesystem::exists(pack) ? pack
+                                                  : assets / "japan_z6.png");
+
+    auto grid = japan_map_grid();
+    intensity = std::make_unique<IntensityField>(overlay_backend,
+                                                 grid.width(), grid.height());
+    intensity->set_wake([] -> void { post_frame(); });
+}
+
+void add_map_events(std::span<const NetEvent> events) {
+    if (!intensity) {
+        return;
+    }
+    bool changed = false;
+    auto grid = japan_map_grid();
+    for (const auto &event : events) {
+        if (event.kind != epsp_event_kind_t::EVENT_EQK_INFO) {
+            continue;
+        }
+        auto report = parse_intensity_report(event.payload);
+        if (!report) {
+            continue;
+        }
+        // A new quake replaces the surface; a later report of the same one
+        // adds to it.
+        if (report->time != intensity_time) {
+            intensity_time = report->time;
+            intensity_points.clear();
+        }
+        for (const auto &seen : report->observations) {
+            auto [x, y] = mercator_px(grid, seen.lat, seen.lon);
+            IntensityPoint point{.x = static_cast<float>(x),
+                                 .y = static_cast<float>(y),
+                                 .intensity = seen.intensity};
+            auto same = std::ranges::find_if(
+                intensity_points,
+                [&point](const IntensityPoint &other) -> bool {
+                    return other.x == point.x && other.y == point.y;
+                });
+            if (same == intensity_points.end()) {
+                intensity_points.push_back(point);
+            } else {
+                same->intensity = std::max(same->intensity, point.intensity);
+            }
+        }
+        changed = true;
+    }
+    if (changed) {
+        intensity->set_points(intensity_points);
+    }
+}
+
+void draw_map() {
+    if (!streamer) {
+        return;
+    }
+    ImGuiIO &io = ImGui::GetIO();
+    view.width = io.DisplaySize.x;
+    view.height = io.DisplaySize.y;
+    if (!fitted) {
+        auto [width, height] = streamer->image_size();
+        // Fit once both are known: with no window size yet the zoom would
+        // come out 0 and the map would stay blank until a scroll.
+        if (height == 0 || view.width <= 0.0F || view.height <= 0.0F) {
+            return;
+        }
+        // Whole map, fitted to the window height.
+        view.center_x = width / 2.0;
+        view.center_y = height / 2.0;
+        view.zoom = view.height / height;
+        fitted = true;
+    }
+    handle_input();
+
+    streamer->frame(view, draws);
+    auto *draw_list = ImGui::GetBackgroundDrawList();
+    add_images(draw_list, draws);
+    // Between the map and the markers.
+    draws.clear();
+    intensity->frame(view, draws);
+    add_images(draw_list, draws);
+    draw_markers(draw_list);
+}
+
+auto map_stats() -> MapStats {
+    return streamer ? streamer->stats() : MapStats{};
+}
+
+auto intensity_stats() -> IntensityStats {
+    return intensity ? intensity->stats() : IntensityStats{};
+}
+
+void cleanup_map() {
+    intensity.reset();
+    streamer.reset();
+}
@@ -0,0 +1,15 @@
+#pragma once
+#include "../comms/event_channel.h"
+#include "../map/intensity_field.h"
+#include "../map/tile_streamer.h"
+#include <span>
+
+// Starts streaming the map asset; needs the GL context current.
+void init_map(std::size_t budget_bytes);
+// Draws the visible tiles behind every window and handles pan and zoom.
+void draw_map();
+// Render thread: 551 reports redraw the intensity surface.
+void add_map_events(std::span<const NetEvent> events);
+auto map_stats() -> MapStats;
+auto intensity_stats() -> IntensityStats;
+void cleanup_map();
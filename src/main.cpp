@@ -1,38 +1,123 @@
+#include "comms/event_channel.h"
 #include "comms/handshake.h"
+#include "comms/io_pool.h"
 #include "comms/peer.h"
-#include "gui/gui_main.h"
+#include "utils/process.h"
 #include <asio/connect.hpp>
+#include <asio/signal_set.hpp>
+#include <charconv>
+#include <csignal>
+#include <span>
+
+#ifndef EPSP_NODE_ONLY
+#include "gui/gui_main.h"
+#endif
 
 const std::shared_ptr<spdlog::logger> main_logger =
     spdlog::default_logger()->clone("\033[31mmain\033[0m");
 
-int main(int /*argc*/, char ** /*argv*/) {
-    if (init_gui() == 1) {
+namespace {
+// `--flag N` with a positive N; nullopt if absent or invalid.
+auto flag_value(std::span<char *> args, std::string_view flag)
+    -> std::optional<std::size_t> {
+    for (std::size_t i = 1; i + 1 < args.size(); i++) {
+        std::string_view arg(args[i]);
+        if (arg != flag) {
+            continue;
+        }
+        std::string_view value(args[i + 1]);
+        std::size_t number = 0;
+        auto [end, ecode] =
+            std::from_chars(value.data(), value.data() + value.size(), number);
+        if (ecode == std::errc{} && number > 0) {
+            return number;
+        }
+        main_logger->warn("Ignoring {} {}", flag, value);
+    }
+    return std::nullopt;
+}
+
+#ifndef EPSP_NODE_ONLY
+auto has_flag(std::span<char *> args, std::string_view flag) -> bool {
+    return std::ranges::any_of(args.subspan(1), [flag](char *arg) -> bool {
+        return std::string_view(arg) == flag;
+    });
+}
+#endif
+
+// Headless: park the main thread until SIGINT or SIGTERM.
+void wait_for_shutdown() {
+    asio::io_context signal_context;
+    asio::signal_set signals(signal_context, SIGINT, SIGTERM);
+    signals.async_wait([](asio::error_code ecode, int signal) -> void {
+        if (!ecode) {
+            main_logger->info("Signal {}, shutting down", signal);
+        }
+    });
+    signal_context.run();
+}
+} // namespace
+
+int main(int argc, char **argv) {
+    auto launched = std::chrono::steady_clock::now();
+    auto args = std::span(argv, argc);
+
+#ifdef EPSP_NODE_ONLY
+    bool headless = true;
+#else
+    bool headless = has_flag(args, "--headless");
+    GuiOptions gui_options;
+    // `--map-budget MiB` caps the map's resident textures.
+    if (auto budget = flag_value(args, "--map-budget")) {
+        gui_options.map_budget_bytes = *budget * 1024 * 1024;
+    }
+    gui_options.font_report = has_flag(args, "--font-report");
+    if (!headless && init_gui(gui_options) == 1) {
         main_logger->info("Failed to init GUI");
         return 1;
     }
+#endif
 
-    auto peer_io_context = init_peer_connection();
-    auto peer_work = asio::make_work_guard(*peer_io_context.io_context);
-    std::shared_ptr<asio::io_context> server_io_context =
-        init_server_connection("localhost", peer_io_context.connection_peer);
+    // Nothing drains the GUI's event channel without a GUI.
+    net_events().set_consumer(!headless);
 
-    std::thread server_thread([server_io_context]() -> void {
-        main_logger->info("Starting server thread");
-        server_io_context->run();
-        main_logger->info("Server thread stopped");
-    });
-    std::thread peer_thread([peer_io_context]() -> void {
-        main_logger->info("Starting peer thread");
-        peer_io_context.io_context->run();
-        main_logger->info("Peer thread stopped");
-    });
+    // The server connection and every peer share one pool; each connection
+    // keeps its handlers ordered on its own strand.
+    IoPool io_pool(
+        flag_value(args, "--threads").value_or(IoPool::default_threads()));
+    auto peer = init_peer_connection(io_pool.context());
+    auto server = init_server_connection(*io_pool.context(),
+                                         default_bootstrap_options(),
+                                         peer.connection_peer);
+    io_pool.start();
+
+    auto startup = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - launched);
+    main_logger->info("Started {} in {} ms, RSS {} KiB",
+                      headless ? "headless" : "with GUI", startup.count(),
+                      resident_set_bytes() / 1024);
 
-    gui_loop();
-    cleanup_gui();
+    if (headless) {
+        wait_for_shutdown();
+    } else {
+#ifndef EPSP_NODE_ONLY
+        gui_loop();
+#endif
+    }
 
-    server_thread.join();
-    peer_work.reset();
-    peer_thread.join();
+    // Both only post their closes; stop() lets the pool run them (and the
+    // coroutines they end) before it gives up and stops the io_context.
+    server->stop();
+    peer.connection_peer->stop_all();
+    io_pool.stop();
+#ifndef EPSP_NODE_ONLY
+    // Only now: until the io threads are gone they may still wake the
+    // render loop through GLFW.
+    if (!headless) {
+        cleanup_gui();
+    }
+#endif
+    main_logger->info("Stopped, RSS {} KiB",
+                      resident_set_bytes() / 1024);
     return 0;
 }
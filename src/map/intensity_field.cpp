@@ -0,0 +1,496 @@
+#include "intensity_field.h"
+#include "../utils/region.h"
+#include <charconv>
+
+namespace {
+// Upper bound of each class, as instrumental intensity: "1" .. "4", "5-",
+// "5+", "6-", "6+"; anything above is "7".
+constexpr std::array<float, 8> CLASS_BOUNDS = {1.5F,  2.5F, 3.5F, 4.5F,
+                                               5.0F,  5.5F, 6.0F, 6.5F};
+// JMA's intensity colours, "1" to "7".
+constexpr std::array<std::array<uint8_t, 3>, 9> CLASS_COLOURS = {{
+    {242, 242, 255},
+    {0, 170, 255},
+    {0, 65, 255},
+    {250, 230, 150},
+    {255, 230, 0},
+    {255, 153, 0},
+    {255, 40, 0},
+    {165, 0, 33},
+    {180, 0, 104},
+}};
+// Below this the surface is transparent.
+constexpr float MIN_INTENSITY = 0.5F;
+constexpr float MAX_ALPHA = 170.0F;
+// Keeps the weight finite on top of an observation.
+constexpr float WEIGHT_EPSILON = 1.0F;
+
+constexpr std::size_t RGBA = 4;
+
+auto split(std::string_view text, char separator)
+    -> std::vector<std::string_view> {
+    std::vector<std::string_view> fields;
+    while (true) {
+        auto end = text.find(separator);
+        fields.push_back(text.substr(0, end));
+        if (end == std::string_view::npos) {
+            return fields;
+        }
+        text.remove_prefix(end + 1);
+    }
+}
+
+// "N34.0" / "E135.6"; south and west are negative.
+auto parse_coordinate(std::string_view text, char positive, char negative)
+    -> std::optional<double> {
+    if (text.size() < 2 || (text[0] != positive && text[0] != negative)) {
+        return std::nullopt;
+    }
+    double value = 0.0;
+    auto [end, error] =
+        std::from_chars(text.data() + 1, text.data() + text.size(), value);
+    if (error != std::errc{} || end != text.data() + text.size()) {
+        return std::nullopt;
+    }
+    return text[0] == positive ? value : -value;
+}
+
+auto located(const Region &region) -> bool {
+    return region.lat != 0.0 || region.lon != 0.0;
+}
+
+// Where names in a 551 report land: located regions by area name, and each
+// prefecture at the mean of its located regions.
+struct Places {
+    std::unordered_map<std::string_view, std::pair<double, double>> area;
+    std::unordered_map<std::string_view, std::pair<double, double>> pref;
+};
+
+auto places() -> const Places & {
+    static const Places places = [] -> Places {
+        Places built;
+        std::unordered_map<std::string_view, std::array<double, 3>> sums;
+        for (const auto &region : regions) {
+            if (!located(region)) {
+                continue;
+            }
+            built.area.emplace(region.area,
+                               std::pair{region.lat, region.lon});
+            auto &sum = sums[region.pref];
+            sum[0] += region.lat;
+            sum[1] += region.lon;
+            sum[2] += 1.0;
+        }
+        for (const auto &[pref, sum] : sums) {
+            built.pref.emplace(pref,
+                               std::pair{sum[0] / sum[2], sum[1] / sum[2]});
+        }
+        return built;
+    }();
+    return places;
+}
+
+// "奈良県" -> "奈良"; the table keeps prefectures without their suffix,
+// except 北海道.
+auto prefecture_key(std::string_view name) -> std::string_view {
+    for (std::string_view suffix : {"都", "府", "県"}) {
+        if (name.ends_with(suffix) && name.size() > suffix.size()) {
+            return name.substr(0, name.size() - suffix.size());
+        }
+    }
+    return name;
+}
+
+// One row of cells: accumulates every candidate's weight into `num`,
+// `den` and the strongest taper into `reach`. Branch-free over the cells
+// so the compiler vectorises it.
+void weigh_row(const float *__restrict cell_x, std::size_t count, float px,
+               float dy2, float value, float inv_r2, float *__restrict num,
+               float *__restrict den, float *__restrict reach) {
+    for (std::size_t i = 0; i < count; i++) {
+        float dx = cell_x[i] - px;
+        float d2 = dx * dx + dy2;
+        float taper = std::max(0.0F, 1.0F - d2 * inv_r2);
+        float weight = taper * taper / (d2 + WEIGHT_EPSILON);
+        num[i] += weight * value;
+        den[i] += weight;
+        reach[i] = std::max(reach[i], taper);
+    }
+}
+} // namespace
+
+auto parse_shindo(std::string_view text) -> std::optional<float> {
+    static constexpr std::array<std::pair<std::string_view, float>, 13>
+        classes = {{{"1", 1.0F},
+                    {"2", 2.0F},
+                    {"3", 3.0F},
+                    {"4", 4.0F},
+                    {"5-", 4.75F},
+                    {"5弱", 4.75F},
+                    {"5+", 5.25F},
+                    {"5強", 5.25F},
+                    {"6-", 5.75F},
+                    {"6弱", 5.75F},
+                    {"6+", 6.25F},
+                    {"6強", 6.25F},
+                    {"7", 6.75F}}};
+    for (const auto &[name, value] : classes) {
+        if (text == name) {
+            return value;
+        }
+    }
+    return std::nullopt;
+}
+
+auto shindo_class(float intensity) -> uint8_t {
+    if (intensity < MIN_INTENSITY) {
+        return 0;
+    }
+    // Counts bounds instead of branching.
+    uint8_t shindo = 1;
+    for (auto bound : CLASS_BOUNDS) {
+        shindo += static_cast<uint8_t>(intensity >= bound);
+    }
+    return shindo;
+}
+
+auto shindo_name(uint8_t shindo) -> std::string_view {
+    static constexpr std::array<std::string_view, SHINDO_CLASSES> names = {
+        "", "1", "2", "3", "4", "5-", "5+", "6-", "6+", "7"};
+    return shindo < names.size() ? names[shindo] : "";
+}
+
+auto parse_intensity_report(std::string_view payload)
+    -> std::optional<IntensityReport> {
+    auto colon = payload.find(':');
+    auto header = split(payload.substr(0, colon), ',');
+    if (header.size() < 10 || header[0].empty()) {
+        return std::nullopt;
+    }
+    IntensityReport report;
+    report.time = std::string(header[0]);
+    report.hypocentre = std::string(header[4]);
+    report.max_intensity = parse_shindo(header[1]).value_or(0.0F);
+    auto lat = parse_coordinate(header[8], 'N', 'S');
+    auto lon = parse_coordinate(header[9], 'E', 'W');
+    if (lat && lon) {
+        report.epicentre = std::pair{*lat, *lon};
+    }
+    if (colon == std::string_view::npos) {
+        return report;
+    }
+
+    const auto &where = places();
+    std::optional<std::pair<double, double>> pref;
+    std::optional<float> scale;
+    for (auto entry : split(payload.substr(colon + 1), ',')) {
+        if (entry.empty()) {
+            continue;
+        }
+        auto name = entry.substr(1);
+        switch (entry[0]) {
+        case '-': {
+            auto found = where.pref.find(prefecture_key(name));
+            pref = found != where.pref.end()
+                       ? std::optional{found->second}
+                       : std::nullopt;
+            break;
+        }
+        case '+':
+            scale = parse_shindo(name);
+            break;
+        case '*': {
+            if (!scale) {
+                break;
+            }
+            auto found = where.area.find(name);
+            auto at = found != where.area.end() ? std::optional{found->second}
+                                                : pref;
+            if (!at) {
+                break;
+            }
+            auto same = std::ranges::find_if(
+                report.observations,
+                [&at](const IntensityObservation &seen) -> bool {
+                    return seen.lat == at->first && seen.lon == at->second;
+                });
+            if (same == report.observations.end()) {
+                report.observations.push_back(
+                    {.lat = at->first, .lon = at->second, .intensity = *scale});
+            } else {
+                same->intensity = std::max(same->intensity, *scale);
+            }
+            break;
+        }
+        default:
+            break;
+        }
+    }
+    return report;
+}
+
+IntensityField::IntensityField(OverlayBackend &backend, uint32_t width,
+                               uint32_t height, IntensityFieldOptions options)
+    : backend_(backend), options_(options),
+      cells_x_((width + options.cell_px - 1) / options.cell_px),
+      cells_y_((height + options.cell_px - 1) / options.cell_px),
+      columns_((cells_x_ + options.tile_cells - 1) / options.tile_cells),
+      rows_((cells_y_ + options.tile_cells - 1) / options.tile_cells),
+      points_(std::make_shared<const std::vector<IntensityPoint>>()),
+      queued_(std::size_t{columns_} * rows_, 0),
+      generation_(std::size_t{columns_} * rows_, 0) {
+    auto threads = options_.threads;
+    if (threads == 0) {
+        threads = std::max(std::thread::hardware_concurrency(), 1U);
+    }
+    for (unsigned i = 0; i < threads; i++) {
+        workers_.emplace_back([this] -> void { run(); });
+    }
+}
+
+IntensityField::~IntensityField() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    work_.notify_all();
+    for (auto &worker : workers_) {
+        worker.join();
+    }
+    if (created_) {
+        backend_.destroy(texture_);
+    }
+}
+
+void IntensityField::set_wake(std::function<void()> wake) {
+    wake_ = std::move(wake);
+}
+
+auto IntensityField::tile_extent(uint32_t x, uint32_t y) const
+    -> std::pair<uint32_t, uint32_t> {
+    return {std::min(options_.tile_cells, cells_x_ - x * options_.tile_cells),
+            std::min(options_.tile_cells, cells_y_ - y * options_.tile_cells)};
+}
+
+void IntensityField::mark(float x, float y) {
+    auto reach = options_.radius_px;
+    auto span = static_cast<float>(options_.cell_px * options_.tile_cells);
+    auto first_x = static_cast<int64_t>(std::floor((x - reach) / span));
+    auto last_x = static_cast<int64_t>(std::floor((x + reach) / span));
+    auto first_y = static_cast<int64_t>(std::floor((y - reach) / span));
+    auto last_y = static_cast<int64_t>(std::floor((y + reach) / span));
+    first_x = std::max<int64_t>(first_x, 0);
+    first_y = std::max<int64_t>(first_y, 0);
+    last_x = std::min<int64_t>(last_x, int64_t{columns_} - 1);
+    last_y = std::min<int64_t>(last_y, int64_t{rows_} - 1);
+    for (auto ty = first_y; ty <= last_y; ty++) {
+        for (auto tx = first_x; tx <= last_x; tx++) {
+            auto tile = static_cast<uint32_t>(ty * columns_ + tx);
+            generation_[tile]++;
+            if (queued_[tile] == 0) {
+                queued_[tile] = 1;
+                queue_.push_back(tile);
+            }
+        }
+    }
+}
+
+void IntensityField::set_points(std::vector<IntensityPoint> points) {
+    std::ranges::sort(points);
+    // Only what changed moves the surface: a point in one set and not the
+    // other, by position and value.
+    std::vector<IntensityPoint> changed;
+    std::ranges::set_symmetric_difference(shown_, points,
+                                          std::back_inserter(changed));
+    if (changed.empty()) {
+        return;
+    }
+    auto shared = std::make_shared<const std::vector<IntensityPoint>>(points);
+    shown_ = std::move(points);
+    marked_ = clock::now();
+    stats_.last_update.reset();
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        points_ = std::move(shared);
+        for (const auto &point : changed) {
+            mark(point.x, point.y);
+        }
+    }
+    work_.notify_all();
+}
+
+void IntensityField::render_tile(std::span<const IntensityPoint> points,
+                                 uint32_t x, uint32_t y,
+                                 std::vector<uint8_t> &rgba) const {
+    auto [cells_w, cells_h] = tile_extent(x, y);
+    rgba.assign(std::size_t{cells_w} * cells_h * RGBA, 0);
+
+    auto cell = static_cast<float>(options_.cell_px);
+    auto reach = options_.radius_px;
+    auto r2 = reach * reach;
+    auto left = static_cast<float>(x * options_.tile_cells) * cell;
+    auto top = static_cast<float>(y * options_.tile_cells) * cell;
+    auto right = left + static_cast<float>(cells_w) * cell;
+    auto bottom = top + static_cast<float>(cells_h) * cell;
+
+    // Candidates: points within reach of the tile's rectangle, as SoA.
+    std::vector<float> px;
+    std::vector<float> py;
+    std::vector<float> value;
+    for (const auto &point : points) {
+        auto dx = std::max({left - point.x, 0.0F, point.x - right});
+        auto dy = std::max({top - point.y, 0.0F, point.y - bottom});
+        if (dx * dx + dy * dy < r2) {
+            px.push_back(point.x);
+            py.push_back(point.y);
+            value.push_back(point.intensity);
+        }
+    }
+    if (px.empty()) {
+        return;
+    }
+
+    std::vector<float> cell_x(cells_w);
+    for (uint32_t i = 0; i < cells_w; i++) {
+        cell_x[i] = left + (static_cast<float>(i) + 0.5F) * cell;
+    }
+    std::vector<float> num(cells_w);
+    std::vector<float> den(cells_w);
+    std::vector<float> reach_max(cells_w);
+    auto inv_r2 = 1.0F / r2;
+    for (uint32_t row = 0; row < cells_h; row++) {
+        auto cell_y = top + (static_cast<float>(row) + 0.5F) * cell;
+        std::ranges::fill(num, 0.0F);
+        std::ranges::fill(den, 0.0F);
+        std::ranges::fill(reach_max, 0.0F);
+        for (std::size_t p = 0; p < px.size(); p++) {
+            auto dy = cell_y - py[p];
+            if (dy * dy >= r2) {
+                continue;
+            }
+            weigh_row(cell_x.data(), cells_w, px[p], dy * dy, value[p],
+                      inv_r2, num.data(), den.data(), reach_max.data());
+        }
+        auto *out = &rgba[std::size_t{row} * cells_w * RGBA];
+        for (uint32_t i = 0; i < cells_w; i++) {
+            auto shindo =
+                shindo_class(den[i] > 0.0F ? num[i] / den[i] : 0.0F);
+            if (shindo == 0) {
+                continue;
+            }
+            const auto &colour = CLASS_COLOURS[shindo - 1];
+            out[i * RGBA + 0] = colour[0];
+            out[i * RGBA + 1] = colour[1];
+            out[i * RGBA + 2] = colour[2];
+            // Opaque out to half the reach, then fading to its edge.
+            out[i * RGBA + 3] = static_cast<uint8_t>(
+                std::min(1.0F, reach_max[i] * 2.0F) * MAX_ALPHA);
+        }
+    }
+}
+
+void IntensityField::run() {
+    std::vector<uint8_t> rgba;
+    while (true) {
+        uint32_t tile = 0;
+        uint64_t generation = 0;
+        std::shared_ptr<const std::vector<IntensityPoint>> points;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            work_.wait(lock, [this] -> bool {
+                return stopping_ || !queue_.empty();
+            });
+            if (stopping_) {
+                return;
+            }
+            tile = queue_.back();
+            queue_.pop_back();
+            queued_[tile] = 0;
+            generation = generation_[tile];
+            points = points_;
+            busy_++;
+        }
+        render_tile(*points, tile % columns_, tile / columns_, rgba);
+        bool done = false;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            busy_--;
+            // Marked again meanwhile: already queued with newer points.
+            if (generation_[tile] == generation) {
+                finished_.push_back({.tile = tile, .rgba = std::move(rgba)});
+                computed_++;
+            } else {
+                discarded_++;
+            }
+            done = queue_.empty() && busy_ == 0;
+        }
+        if (done) {
+            idle_.notify_all();
+        }
+        if (wake_) {
+            wake_();
+        }
+    }
+}
+
+void IntensityField::wait_idle() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    idle_.wait(lock,
+               [this] -> bool { return queue_.empty() && busy_ == 0; });
+}
+
+void IntensityField::frame(const MapViewport &view,
+                           std::vector<TileDraw> &draws) {
+    bool settled = false;
+    uploading_.clear();
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::swap(uploading_, finished_);
+        settled = queue_.empty() && busy_ == 0;
+    }
+    if (!uploading_.empty() && !created_) {
+        texture_ = backend_.create(cells_x_, cells_y_);
+        created_ = true;
+        stats_.texture_bytes = std::size_t{cells_x_} * cells_y_ * RGBA;
+    }
+    for (const auto &done : uploading_) {
+        auto x = done.tile % columns_;
+        auto y = done.tile / columns_;
+        auto [cells_w, cells_h] = tile_extent(x, y);
+        backend_.update(texture_, x * options_.tile_cells,
+                        y * options_.tile_cells, cells_w, cells_h, done.rgba);
+        stats_.tiles_uploaded++;
+    }
+    if (settled && !uploading_.empty()) {
+        stats_.last_update =
+            std::chrono::duration_cast<std::chrono::microseconds>(
+                clock::now() - marked_);
+    }
+
+    if (!created_ || shown_.empty() || view.zoom <= 0.0) {
+        return;
+    }
+    auto to_screen_x = [&view](double x0) -> float {
+        return static_cast<float>((x0 - view.center_x) * view.zoom +
+                                  view.width / 2.0);
+    };
+    auto to_screen_y = [&view](double y0) -> float {
+        return static_cast<float>((y0 - view.center_y) * view.zoom +
+                                  view.height / 2.0);
+    };
+    // The last cell overhangs the map when the size is not a multiple.
+    auto span_x = static_cast<double>(cells_x_) * options_.cell_px;
+    auto span_y = static_cast<double>(cells_y_) * options_.cell_px;
+    draws.push_back({.texture = texture_,
+                     .rect = {to_screen_x(0.0), to_screen_y(0.0),
+                              to_screen_x(span_x), to_screen_y(span_y)},
+                     .uv = {0.0F, 0.0F, 1.0F, 1.0F}});
+}
+
+auto IntensityField::stats() const -> IntensityStats {
+    auto stats = stats_;
+    std::lock_guard<std::mutex> lock(mutex_);
+    stats.tiles_computed = computed_;
+    stats.tiles_discarded = discarded_;
+    return stats;
+}
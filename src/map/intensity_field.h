@@ -0,0 +1,175 @@
+#pragma once
+#include "tile_streamer.h"
+#include "viewport.h"
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+// One observed intensity, placed where the region table can put it.
+struct IntensityObservation {
+    double lat;
+    double lon;
+    float intensity;
+};
+
+// The parts of a 551 report the map draws.
+struct IntensityReport {
+    std::string time; // occurrence time; identical for updates of one quake
+    std::string hypocentre;
+    float max_intensity = 0.0F;
+    std::optional<std::pair<double, double>> epicentre; // lat, lon
+    // Strongest intensity per location.
+    std::vector<IntensityObservation> observations;
+};
+
+// A JMA intensity class ("1".."4", "5-"/"5弱", "5+"/"5強", .., "7") as the
+// middle of its instrumental intensity range, so it can be interpolated.
+auto parse_shindo(std::string_view text) -> std::optional<float>;
+
+// Classes shindo_class() returns: 0 for none, then "1" .. "7".
+inline constexpr std::size_t SHINDO_CLASSES = 10;
+// The class an intensity falls in, by JMA's instrumental bounds.
+auto shindo_class(float intensity) -> uint8_t;
+// "1" .. "7" as 551 writes them; empty for class 0.
+auto shindo_name(uint8_t shindo) -> std::string_view;
+
+// A 551 payload: "time,scale,tsunami,type,hypocentre,depth,magnitude,
+// corrected,N34.0,E135.6,issuer:" then the observations, as "-prefecture",
+// "+scale" and "*station" entries. Stations are placed at a region of the
+// same name or, failing that, at the centre of their prefecture's regions.
+auto parse_intensity_report(std::string_view payload)
+    -> std::optional<IntensityReport>;
+
+// An observation in level-0 map pixels.
+struct IntensityPoint {
+    float x;
+    float y;
+    float intensity;
+
+    auto operator<=>(const IntensityPoint &) const = default;
+};
+
+// Creates and updates the overlay texture; GL in the GUI, a CPU image in
+// the tests.
+class OverlayBackend {
+public:
+    virtual ~OverlayBackend() = default;
+    // A transparent RGBA8 texture.
+    virtual auto create(uint32_t width, uint32_t height) -> uint64_t = 0;
+    virtual void update(uint64_t texture, uint32_t x, uint32_t y,
+                        uint32_t width, uint32_t height,
+                        std::span<const uint8_t> rgba) = 0;
+    virtual void destroy(uint64_t texture) = 0;
+};
+
+struct IntensityFieldOptions {
+    uint32_t cell_px = 8; // map pixels per cell of the surface
+    uint32_t tile_cells = 64;
+    // How far an observation reaches, in map pixels (~100 km at 35°N on
+    // the bundled map).
+    float radius_px = 200.0F;
+    unsigned threads = 0; // 0: every core
+};
+
+struct IntensityStats {
+    uint64_t tiles_computed = 0;
+    uint64_t tiles_discarded = 0; // superseded while being computed
+    uint64_t tiles_uploaded = 0;
+    std::size_t texture_bytes = 0;
+    // From the last set_points() to its last tile reaching the texture.
+    std::optional<std::chrono::microseconds> last_update;
+};
+
+// An interpolated intensity surface over the map, drawn as one texture.
+// The surface is a grid of cells cut into tiles. Each cell is an inverse
+// distance weighting of the observations within reach, tapered to zero at
+// the edge so the surface has no seams, and coloured by intensity class.
+// New observations mark only the tiles within reach of a point that was
+// added, moved or changed. A pool of workers recomputes those; the render
+// thread writes each finished tile into the texture as a sub-update.
+// A tile marked again while being computed has its stale result dropped.
+class IntensityField {
+public:
+    using clock = std::chrono::steady_clock;
+
+    // `width` x `height` level-0 map pixels.
+    IntensityField(OverlayBackend &backend, uint32_t width, uint32_t height,
+                   IntensityFieldOptions options = {});
+    ~IntensityField();
+    IntensityField(const IntensityField &) = delete;
+    auto operator=(const IntensityField &) -> IntensityField & = delete;
+
+    // Runs on a worker whenever a tile is done (e.g. glfwPostEmptyEvent).
+    // Set before the first set_points().
+    void set_wake(std::function<void()> wake);
+
+    // Render thread. Replaces the observations.
+    void set_points(std::vector<IntensityPoint> points);
+    // Render thread, once per frame: writes finished tiles into the
+    // texture and, while there is a surface, adds its quad to `draws`.
+    void frame(const MapViewport &view, std::vector<TileDraw> &draws);
+    // Render thread.
+    [[nodiscard]] auto stats() const -> IntensityStats;
+
+    // Blocks until no tile is queued or being computed.
+    void wait_idle();
+
+    [[nodiscard]] auto columns() const -> uint32_t { return columns_; }
+    [[nodiscard]] auto rows() const -> uint32_t { return rows_; }
+    // Surface size in cells.
+    [[nodiscard]] auto cells_x() const -> uint32_t { return cells_x_; }
+    [[nodiscard]] auto cells_y() const -> uint32_t { return cells_y_; }
+    // Cells of tile (x, y); edge tiles are cut short.
+    [[nodiscard]] auto tile_extent(uint32_t x, uint32_t y) const
+        -> std::pair<uint32_t, uint32_t>;
+    // Computes tile (x, y) for `points` into `rgba`; any thread.
+    void render_tile(std::span<const IntensityPoint> points, uint32_t x,
+                     uint32_t y, std::vector<uint8_t> &rgba) const;
+
+private:
+    struct Finished {
+        uint32_t tile;
+        std::vector<uint8_t> rgba;
+    };
+
+    OverlayBackend &backend_;
+    IntensityFieldOptions options_;
+    uint32_t cells_x_;
+    uint32_t cells_y_;
+    uint32_t columns_;
+    uint32_t rows_;
+    std::function<void()> wake_;
+
+    // Shared with the workers.
+    mutable std::mutex mutex_;
+    std::condition_variable work_;
+    std::condition_variable idle_;
+    std::shared_ptr<const std::vector<IntensityPoint>> points_;
+    std::vector<uint32_t> queue_;
+    std::vector<uint8_t> queued_;      // by tile
+    std::vector<uint64_t> generation_; // by tile; bumped when marked
+    std::vector<Finished> finished_;
+    unsigned busy_ = 0;
+    uint64_t computed_ = 0;
+    uint64_t discarded_ = 0;
+    bool stopping_ = false;
+    std::vector<std::thread> workers_;
+
+    // Render thread only.
+    std::vector<IntensityPoint> shown_; // sorted
+    std::vector<Finished> uploading_;
+    uint64_t texture_ = 0;
+    bool created_ = false;
+    clock::time_point marked_{};
+    IntensityStats stats_;
+
+    void run();
+    // Queues the tiles within reach of (x, y); caller holds mutex_.
+    void mark(float x, float y);
+};
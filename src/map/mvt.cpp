@@ -0,0 +1,358 @@
+#include "mvt.h"
+#include <bit>
+#include <zlib.h>
+
+namespace {
+enum epsp_pb_wire_t : uint8_t {
+    PB_VARINT = 0,
+    PB_FIXED64 = 1,
+    PB_BYTES = 2,
+    PB_FIXED32 = 5,
+};
+
+// Reads protobuf fields in order; any malformed input sets `bad`.
+class PbReader {
+public:
+    explicit PbReader(std::span<const uint8_t> data) : data_(data) {}
+
+    [[nodiscard]] auto bad() const -> bool { return bad_; }
+    [[nodiscard]] auto done() const -> bool {
+        return bad_ || pos_ >= data_.size();
+    }
+
+    // Advances to the next field; false at the end or on error.
+    auto next() -> bool {
+        if (done()) {
+            return false;
+        }
+        auto key = varint();
+        field_ = static_cast<uint32_t>(key >> 3);
+        wire_ = static_cast<uint8_t>(key & 7);
+        return !bad_;
+    }
+    [[nodiscard]] auto field() const -> uint32_t { return field_; }
+    [[nodiscard]] auto wire() const -> uint8_t { return wire_; }
+
+    auto varint() -> uint64_t {
+        uint64_t value = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            if (pos_ >= data_.size()) {
+                break;
+            }
+            auto byte = data_[pos_++];
+            value |= uint64_t{byte & 0x7FU} << shift;
+            if ((byte & 0x80U) == 0) {
+                return value;
+            }
+        }
+        bad_ = true;
+        return 0;
+    }
+
+    auto bytes() -> std::span<const uint8_t> {
+        auto size = varint();
+        if (bad_ || size > data_.size() - pos_) {
+            bad_ = true;
+            return {};
+        }
+        auto out = data_.subspan(pos_, size);
+        pos_ += size;
+        return out;
+    }
+
+    auto fixed(std::size_t size) -> uint64_t {
+        if (size > data_.size() - pos_) {
+            bad_ = true;
+            return 0;
+        }
+        uint64_t value = 0;
+        for (std::size_t i = 0; i < size; i++) {
+            value |= uint64_t{data_[pos_ + i]} << (8 * i);
+        }
+        pos_ += size;
+        return value;
+    }
+
+    void skip() {
+        switch (wire_) {
+        case PB_VARINT:
+            varint();
+            break;
+        case PB_FIXED64:
+            fixed(8);
+            break;
+        case PB_BYTES:
+            bytes();
+            break;
+        case PB_FIXED32:
+            fixed(4);
+            break;
+        default:
+            bad_ = true;
+        }
+    }
+
+private:
+    std::span<const uint8_t> data_;
+    std::size_t pos_ = 0;
+    uint32_t field_ = 0;
+    uint8_t wire_ = 0;
+    bool bad_ = false;
+};
+
+auto zigzag(uint64_t value) -> int64_t {
+    return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+auto gunzip(std::span<const uint8_t> data, std::vector<uint8_t> &out)
+    -> bool {
+    z_stream stream{};
+    // 32: detect the gzip or zlib header.
+    if (inflateInit2(&stream, 32 + MAX_WBITS) != Z_OK) {
+        return false;
+    }
+    out.resize(data.size() * 4);
+    stream.next_in = const_cast<Bytef *>(data.data());
+    stream.avail_in = static_cast<uInt>(data.size());
+    int status = Z_OK;
+    while (status == Z_OK) {
+        if (stream.total_out == out.size()) {
+            out.resize(out.size() * 2);
+        }
+        stream.next_out = out.data() + stream.total_out;
+        stream.avail_out = static_cast<uInt>(out.size() - stream.total_out);
+        status = inflate(&stream, Z_NO_FLUSH);
+    }
+    out.resize(stream.total_out);
+    inflateEnd(&stream);
+    return status == Z_STREAM_END;
+}
+
+auto decode_value(std::span<const uint8_t> data) -> MvtValue {
+    PbReader reader(data);
+    MvtValue value;
+    while (reader.next()) {
+        switch (reader.field()) {
+        case 1: {
+            auto text = reader.bytes();
+            value = std::string(text.begin(), text.end());
+            break;
+        }
+        case 2: {
+            auto bits = static_cast<uint32_t>(reader.fixed(4));
+            value = static_cast<double>(std::bit_cast<float>(bits));
+            break;
+        }
+        case 3:
+            value = std::bit_cast<double>(reader.fixed(8));
+            break;
+        case 4:
+            value = static_cast<int64_t>(reader.varint());
+            break;
+        case 5:
+            value = reader.varint();
+            break;
+        case 6:
+            value = zigzag(reader.varint());
+            break;
+        case 7:
+            value = reader.varint() != 0;
+            break;
+        default:
+            reader.skip();
+        }
+    }
+    return value;
+}
+
+// Packed varints of `data` into `out`.
+auto decode_packed(std::span<const uint8_t> data, std::vector<uint32_t> &out)
+    -> bool {
+    PbReader reader(data);
+    out.clear();
+    while (!reader.done()) {
+        out.push_back(static_cast<uint32_t>(reader.varint()));
+    }
+    return !reader.bad();
+}
+
+// Turns the command stream into parts: MoveTo starts one, LineTo extends
+// it and ClosePath repeats its first point.
+auto decode_geometry(std::span<const uint32_t> commands, MvtFeature &feature)
+    -> bool {
+    int32_t x = 0;
+    int32_t y = 0;
+    std::size_t i = 0;
+    while (i < commands.size()) {
+        auto id = commands[i] & 7;
+        auto count = commands[i] >> 3;
+        i++;
+        if (id == 7) {
+            if (feature.parts.empty() || feature.parts.back().empty()) {
+                return false;
+            }
+            auto first = feature.parts.back().front();
+            feature.parts.back().push_back(first);
+            continue;
+        }
+        if ((id != 1 && id != 2) ||
+            commands.size() - i < std::size_t{count} * 2) {
+            return false;
+        }
+        for (uint32_t n = 0; n < count; n++) {
+            x += static_cast<int32_t>(zigzag(commands[i++]));
+            y += static_cast<int32_t>(zigzag(commands[i++]));
+            if (id == 1) {
+                feature.parts.emplace_back();
+            } else if (feature.parts.empty()) {
+                return false;
+            }
+            feature.parts.back().push_back({x, y});
+        }
+    }
+    return true;
+}
+
+auto decode_feature(std::span<const uint8_t> data, MvtFeature &feature,
+                    std::vector<uint32_t> &scratch) -> bool {
+    PbReader reader(data);
+    while (reader.next()) {
+        switch (reader.field()) {
+        case 2: {
+            if (!decode_packed(reader.bytes(), scratch) ||
+                scratch.size() % 2 != 0) {
+                return false;
+            }
+            for (std::size_t i = 0; i < scratch.size(); i += 2) {
+                feature.tags.emplace_back(scratch[i], scratch[i + 1]);
+            }
+            break;
+        }
+        case 3: {
+            auto type = reader.varint();
+            feature.type = type <= MVT_POLYGON
+                               ? static_cast<epsp_mvt_geom_t>(type)
+                               : MVT_UNKNOWN;
+            break;
+        }
+        case 4:
+            if (!decode_packed(reader.bytes(), scratch) ||
+                !decode_geometry(scratch, feature)) {
+                return false;
+            }
+            break;
+        default:
+            reader.skip();
+        }
+    }
+    return !reader.bad();
+}
+
+auto layer_name(std::span<const uint8_t> data) -> std::string_view {
+    PbReader reader(data);
+    while (reader.next()) {
+        if (reader.field() == 1 && reader.wire() == PB_BYTES) {
+            auto name = reader.bytes();
+            return {reinterpret_cast<const char *>(name.data()), name.size()};
+        }
+        reader.skip();
+    }
+    return {};
+}
+
+auto decode_layer(std::span<const uint8_t> data, MvtLayer &layer) -> bool {
+    PbReader reader(data);
+    std::vector<uint32_t> scratch;
+    while (reader.next()) {
+        switch (reader.field()) {
+        case 1: {
+            auto name = reader.bytes();
+            layer.name.assign(name.begin(), name.end());
+            break;
+        }
+        case 2:
+            if (!decode_feature(reader.bytes(), layer.features.emplace_back(),
+                                scratch)) {
+                return false;
+            }
+            break;
+        case 3: {
+            auto key = reader.bytes();
+            layer.keys.emplace_back(key.begin(), key.end());
+            break;
+        }
+        case 4:
+            layer.values.push_back(decode_value(reader.bytes()));
+            break;
+        case 5:
+            layer.extent = static_cast<uint32_t>(reader.varint());
+            break;
+        default:
+            reader.skip();
+        }
+    }
+    return !reader.bad() && layer.extent > 0;
+}
+} // namespace
+
+auto MvtLayer::int_property(const MvtFeature &feature, std::string_view key,
+                            int64_t fallback) const -> int64_t {
+    for (auto [k, v] : feature.tags) {
+        if (k >= keys.size() || v >= values.size() || keys[k] != key) {
+            continue;
+        }
+        return std::visit(
+            [fallback](const auto &value) -> int64_t {
+                using T = std::decay_t<decltype(value)>;
+                if constexpr (std::is_same_v<T, std::monostate> ||
+                              std::is_same_v<T, std::string>) {
+                    return fallback;
+                } else {
+                    return static_cast<int64_t>(value);
+                }
+            },
+            values[v]);
+    }
+    return fallback;
+}
+
+auto MvtTile::layer(std::string_view name) const -> const MvtLayer * {
+    auto found = std::ranges::find(layers, name, &MvtLayer::name);
+    return found == layers.end() ? nullptr : &*found;
+}
+
+auto decode_mvt(std::span<const uint8_t> data, MvtTile &tile,
+                std::string &error, std::span<const std::string_view> wanted)
+    -> bool {
+    tile.layers.clear();
+    std::vector<uint8_t> inflated;
+    if (data.size() >= 2 && data[0] == 0x1F && data[1] == 0x8B) {
+        if (!gunzip(data, inflated)) {
+            error = "bad gzip stream";
+            return false;
+        }
+        data = inflated;
+    }
+
+    PbReader reader(data);
+    while (reader.next()) {
+        if (reader.field() != 3 || reader.wire() != PB_BYTES) {
+            reader.skip();
+            continue;
+        }
+        auto bytes = reader.bytes();
+        if (!wanted.empty() &&
+            std::ranges::find(wanted, layer_name(bytes)) == wanted.end()) {
+            continue;
+        }
+        if (!decode_layer(bytes, tile.layers.emplace_back())) {
+            error = "malformed layer";
+            return false;
+        }
+    }
+    if (reader.bad()) {
+        error = "malformed tile";
+        return false;
+    }
+    return true;
+}
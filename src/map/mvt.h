@@ -0,0 +1,57 @@
+#pragma once
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include <variant>
+#include <vector>
+
+// Mapbox Vector Tile (protobuf, optionally gzipped) decoding: just enough
+// for the map generator to rasterize layers of a local .pbf tile.
+
+enum epsp_mvt_geom_t : uint8_t {
+    MVT_UNKNOWN = 0,
+    MVT_POINT = 1,
+    MVT_LINESTRING = 2,
+    MVT_POLYGON = 3,
+};
+
+using MvtValue = std::variant<std::monostate, std::string, double, int64_t,
+                              uint64_t, bool>;
+
+struct MvtPoint {
+    int32_t x; // tile units, 0..extent, y down; may overshoot the buffer
+    int32_t y;
+};
+
+struct MvtFeature {
+    epsp_mvt_geom_t type = MVT_UNKNOWN;
+    std::vector<std::pair<uint32_t, uint32_t>> tags; // key, value indices
+    // Lines, or polygon rings (exterior then holes; rings are closed).
+    std::vector<std::vector<MvtPoint>> parts;
+};
+
+struct MvtLayer {
+    std::string name;
+    uint32_t extent = 4096;
+    std::vector<std::string> keys;
+    std::vector<MvtValue> values;
+    std::vector<MvtFeature> features;
+
+    // A numeric property of `feature` as an integer, else `fallback`.
+    [[nodiscard]] auto int_property(const MvtFeature &feature,
+                                    std::string_view key,
+                                    int64_t fallback = 0) const -> int64_t;
+};
+
+struct MvtTile {
+    std::vector<MvtLayer> layers;
+
+    [[nodiscard]] auto layer(std::string_view name) const -> const MvtLayer *;
+};
+
+// Decodes `data` into `tile`, keeping only the layers named in `wanted`
+// (all of them when empty). Gzipped input is inflated first.
+auto decode_mvt(std::span<const uint8_t> data, MvtTile &tile,
+                std::string &error,
+                std::span<const std::string_view> wanted = {}) -> bool;
@@ -0,0 +1,341 @@
+#include "mvt_raster.h"
+#include <condition_variable>
+#include <fstream>
+#include <numbers>
+
+namespace {
+constexpr Rgb BACKGROUND = {15, 20, 35};
+constexpr Rgb WATER = {42, 54, 76};
+constexpr Rgb COUNTRY_BORDER = {255, 255, 255};
+constexpr int COUNTRY_BORDER_WIDTH = 2;
+constexpr Rgb PREFECTURE_BORDER = {153, 153, 153};
+constexpr int PREFECTURE_BORDER_WIDTH = 1;
+
+constexpr std::array<std::string_view, 2> BASEMAP_LAYERS = {"water",
+                                                            "boundary"};
+
+auto read_file(const std::filesystem::path &path, std::vector<uint8_t> &out)
+    -> bool {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        return false;
+    }
+    out.assign(std::istreambuf_iterator<char>(file),
+               std::istreambuf_iterator<char>());
+    return true;
+}
+} // namespace
+
+Canvas::Canvas(uint32_t width, uint32_t height, Rgb background)
+    : width_(width), height_(height),
+      rgb_(std::size_t{width} * height * 3) {
+    for (std::size_t i = 0; i < rgb_.size(); i += 3) {
+        std::ranges::copy(background, &rgb_[i]);
+    }
+}
+
+auto Canvas::pixel(uint32_t x, uint32_t y) const -> Rgb {
+    const auto *p = &rgb_[(std::size_t{y} * width_ + x) * 3];
+    return {p[0], p[1], p[2]};
+}
+
+void Canvas::span(uint32_t y, int x0, int x1, Rgb colour) {
+    x0 = std::max(x0, 0);
+    x1 = std::min(x1, static_cast<int>(width_));
+    if (x0 >= x1) {
+        return;
+    }
+    auto *p = &rgb_[(std::size_t{y} * width_ + static_cast<uint32_t>(x0)) * 3];
+    for (int x = x0; x < x1; x++, p += 3) {
+        std::ranges::copy(colour, p);
+    }
+}
+
+void Canvas::fill_polygon(std::span<const std::vector<PointF>> rings,
+                          Rgb colour) {
+    edges_.clear();
+    for (const auto &ring : rings) {
+        for (std::size_t i = 0; i < ring.size(); i++) {
+            // Rings are closed implicitly.
+            auto a = ring[i];
+            auto b = ring[(i + 1) % ring.size()];
+            if (a.y == b.y) {
+                continue;
+            }
+            if (a.y > b.y) {
+                std::swap(a, b);
+            }
+            edges_.push_back({.y0 = a.y,
+                              .y1 = b.y,
+                              .x0 = a.x,
+                              .slope = (b.x - a.x) / (b.y - a.y)});
+        }
+    }
+    if (edges_.empty()) {
+        return;
+    }
+    std::ranges::sort(edges_, {}, &Edge::y0);
+
+    // Scan pixel centres, keeping the edges that straddle the current one.
+    auto top = std::max(std::ceil(edges_.front().y0 - 0.5F), 0.0F);
+    std::size_t next = 0;
+    active_.clear();
+    for (auto y = static_cast<uint32_t>(top); y < height_; y++) {
+        auto centre = static_cast<float>(y) + 0.5F;
+        while (next < edges_.size() && edges_[next].y0 <= centre) {
+            active_.push_back(next++);
+        }
+        std::erase_if(active_, [this, centre](std::size_t i) -> bool {
+            return edges_[i].y1 <= centre;
+        });
+        if (active_.empty() && next == edges_.size()) {
+            break;
+        }
+        crossings_.clear();
+        for (auto i : active_) {
+            const auto &edge = edges_[i];
+            crossings_.push_back(edge.x0 + (centre - edge.y0) * edge.slope);
+        }
+        std::ranges::sort(crossings_);
+        for (std::size_t i = 0; i + 1 < crossings_.size(); i += 2) {
+            span(y, static_cast<int>(std::ceil(crossings_[i] - 0.5F)),
+                 static_cast<int>(std::ceil(crossings_[i + 1] - 0.5F)),
+                 colour);
+        }
+    }
+}
+
+void Canvas::brush(int x, int y, Rgb colour, int width) {
+    auto low = -(width - 1) / 2;
+    for (auto dy = low; dy < low + width; dy++) {
+        auto row = y + dy;
+        if (row < 0 || row >= static_cast<int>(height_)) {
+            continue;
+        }
+        span(static_cast<uint32_t>(row), x + low, x + low + width, colour);
+    }
+}
+
+void Canvas::draw_line(std::span<const PointF> points, Rgb colour,
+                       int width) {
+    for (std::size_t i = 0; i + 1 < points.size(); i++) {
+        // Bresenham between the pixels holding the two ends.
+        auto x0 = static_cast<int>(std::floor(points[i].x));
+        auto y0 = static_cast<int>(std::floor(points[i].y));
+        auto x1 = static_cast<int>(std::floor(points[i + 1].x));
+        auto y1 = static_cast<int>(std::floor(points[i + 1].y));
+        auto dx = std::abs(x1 - x0);
+        auto dy = -std::abs(y1 - y0);
+        auto sx = x0 < x1 ? 1 : -1;
+        auto sy = y0 < y1 ? 1 : -1;
+        auto err = dx + dy;
+        while (true) {
+            brush(x0, y0, colour, width);
+            if (x0 == x1 && y0 == y1) {
+                break;
+            }
+            auto twice = 2 * err;
+            if (twice >= dy) {
+                err += dy;
+                x0 += sx;
+            }
+            if (twice <= dx) {
+                err += dx;
+                y0 += sy;
+            }
+        }
+    }
+}
+
+void render_basemap(const MvtTile &tile, Canvas &canvas) {
+    std::vector<std::vector<PointF>> parts;
+    auto scaled = [&parts](const MvtFeature &feature, float scale) -> void {
+        parts.resize(feature.parts.size());
+        for (std::size_t i = 0; i < parts.size(); i++) {
+            parts[i].clear();
+            for (auto point : feature.parts[i]) {
+                parts[i].push_back({static_cast<float>(point.x) * scale,
+                                    static_cast<float>(point.y) * scale});
+            }
+        }
+    };
+
+    if (const auto *water = tile.layer("water")) {
+        auto scale = static_cast<float>(canvas.width()) /
+                     static_cast<float>(water->extent);
+        for (const auto &feature : water->features) {
+            if (feature.type != MVT_POLYGON) {
+                continue;
+            }
+            scaled(feature, scale);
+            canvas.fill_polygon(parts, WATER);
+        }
+    }
+
+    if (const auto *boundary = tile.layer("boundary")) {
+        auto scale = static_cast<float>(canvas.width()) /
+                     static_cast<float>(boundary->extent);
+        for (const auto &feature : boundary->features) {
+            if (feature.type != MVT_LINESTRING ||
+                boundary->int_property(feature, "maritime") == 1) {
+                continue;
+            }
+            auto admin = boundary->int_property(feature, "admin_level");
+            if (admin != 2 && admin != 4) {
+                continue;
+            }
+            scaled(feature, scale);
+            for (const auto &line : parts) {
+                if (admin == 2) {
+                    canvas.draw_line(line, COUNTRY_BORDER,
+                                     COUNTRY_BORDER_WIDTH);
+                } else {
+                    canvas.draw_line(line, PREFECTURE_BORDER,
+                                     PREFECTURE_BORDER_WIDTH);
+                }
+            }
+        }
+    }
+}
+
+auto mvt_grid(double lat_min, double lat_max, double lon_min, double lon_max,
+              uint32_t zoom) -> MvtGrid {
+    auto tile = [zoom](double lat, double lon) -> std::pair<uint32_t,
+                                                            uint32_t> {
+        auto n = std::ldexp(1.0, static_cast<int>(zoom));
+        auto rad = lat * std::numbers::pi / 180.0;
+        auto x = (lon + 180.0) / 360.0 * n;
+        auto y = (1.0 - std::asinh(std::tan(rad)) / std::numbers::pi) / 2.0 *
+                 n;
+        return {static_cast<uint32_t>(x), static_cast<uint32_t>(y)};
+    };
+    // Tile y grows southwards.
+    auto [x_min, y_max] = tile(lat_min, lon_min);
+    auto [x_max, y_min] = tile(lat_max, lon_max);
+    return {.dir = {},
+            .zoom = zoom,
+            .x_min = x_min,
+            .x_max = x_max,
+            .y_min = y_min,
+            .y_max = y_max};
+}
+
+auto build_pyramid(const MvtGrid &grid, unsigned threads, TilePyramid &pyramid,
+                   const std::atomic<bool> &cancel, std::string &error)
+    -> bool {
+    if (pyramid.width(0) != grid.width() ||
+        pyramid.height(0) != grid.height()) {
+        error = "pyramid does not match the grid";
+        return false;
+    }
+    auto columns = grid.x_max - grid.x_min + 1;
+    auto rows = grid.y_max - grid.y_min + 1;
+    auto total = columns * rows;
+    // Workers run at most one row of tiles ahead of the one being
+    // streamed, so two rows of canvases are alive at a time.
+    constexpr uint32_t AHEAD = 2;
+
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::vector<std::optional<Canvas>> slots(std::size_t{columns} * AHEAD);
+    std::vector<uint32_t> finished(AHEAD, 0);
+    uint32_t streaming = 0; // row of tiles being streamed
+    bool failed = false;
+    std::atomic<uint32_t> next{0};
+
+    auto work = [&] -> void {
+        MvtTile tile;
+        std::vector<uint8_t> bytes;
+        std::string reason;
+        while (true) {
+            auto index = next.fetch_add(1, std::memory_order_relaxed);
+            if (index >= total) {
+                return;
+            }
+            auto row = index / columns;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                changed.wait(lock, [&] -> bool {
+                    return failed || row < streaming + AHEAD;
+                });
+                if (failed) {
+                    return;
+                }
+            }
+            Canvas canvas(grid.tile_px, grid.tile_px, BACKGROUND);
+            auto path = grid.dir / std::to_string(grid.zoom) /
+                        std::to_string(grid.x_min + index % columns) /
+                        (std::to_string(grid.y_min + row) + ".pbf");
+            bool ok = true;
+            if (read_file(path, bytes)) {
+                ok = decode_mvt(bytes, tile, reason, BASEMAP_LAYERS);
+                if (ok) {
+                    render_basemap(tile, canvas);
+                }
+            }
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!ok) {
+                error = path.string() + ": " + reason;
+                failed = true;
+            } else {
+                slots[index % slots.size()].emplace(std::move(canvas));
+                finished[row % AHEAD]++;
+            }
+            changed.notify_all();
+        }
+    };
+
+    if (threads == 0) {
+        threads = std::max(std::thread::hardware_concurrency(), 1U);
+    }
+    std::vector<std::thread> workers;
+    for (unsigned i = 0; i < std::min(threads, total); i++) {
+        workers.emplace_back(work);
+    }
+
+    std::size_t band = 0;
+    uint32_t tile_row = 0;
+    auto next_row = [&](std::span<uint8_t> rgb) -> bool {
+        if (tile_row == 0) {
+            std::unique_lock<std::mutex> lock(mutex);
+            changed.wait(lock, [&] -> bool {
+                return failed || finished[streaming % AHEAD] == columns ||
+                       cancel.load(std::memory_order_relaxed);
+            });
+            if (failed || cancel.load(std::memory_order_relaxed)) {
+                return false;
+            }
+            band = (streaming % AHEAD) * columns;
+        }
+        for (uint32_t column = 0; column < columns; column++) {
+            std::ranges::copy(slots[band + column]->row(tile_row),
+                              rgb.begin() + std::size_t{column} *
+                                                grid.tile_px * 3);
+        }
+        if (++tile_row == grid.tile_px) {
+            tile_row = 0;
+            std::lock_guard<std::mutex> lock(mutex);
+            for (uint32_t column = 0; column < columns; column++) {
+                slots[band + column].reset();
+            }
+            finished[streaming % AHEAD] = 0;
+            streaming++;
+            changed.notify_all();
+        }
+        return true;
+    };
+    auto built = build_pyramid(next_row, pyramid, cancel);
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        failed = failed || !built;
+        if (!built && error.empty()) {
+            error = "cancelled";
+        }
+    }
+    changed.notify_all();
+    for (auto &worker : workers) {
+        worker.join();
+    }
+    return built;
+}
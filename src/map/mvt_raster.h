@@ -0,0 +1,84 @@
+#pragma once
+#include "mvt.h"
+#include "tile_pyramid.h"
+#include <array>
+#include <filesystem>
+
+using Rgb = std::array<uint8_t, 3>;
+
+struct PointF {
+    float x;
+    float y;
+};
+
+// An RGB image that map geometry is painted onto.
+class Canvas {
+public:
+    Canvas(uint32_t width, uint32_t height, Rgb background);
+
+    [[nodiscard]] auto width() const -> uint32_t { return width_; }
+    [[nodiscard]] auto height() const -> uint32_t { return height_; }
+    [[nodiscard]] auto row(uint32_t y) const -> std::span<const uint8_t> {
+        return {&rgb_[std::size_t{y} * width_ * 3], std::size_t{width_} * 3};
+    }
+    [[nodiscard]] auto pixel(uint32_t x, uint32_t y) const -> Rgb;
+
+    // Even-odd fill of all `rings` together, so holes stay unpainted.
+    // Pixels whose centres are inside are painted.
+    void fill_polygon(std::span<const std::vector<PointF>> rings, Rgb colour);
+    // A polyline `width` pixels thick.
+    void draw_line(std::span<const PointF> points, Rgb colour, int width);
+
+private:
+    struct Edge {
+        float y0; // y0 < y1
+        float y1;
+        float x0;
+        float slope; // dx / dy
+    };
+
+    uint32_t width_;
+    uint32_t height_;
+    std::vector<uint8_t> rgb_;
+    // Reused between fills.
+    std::vector<Edge> edges_;
+    std::vector<std::size_t> active_;
+    std::vector<float> crossings_;
+
+    void span(uint32_t y, int x0, int x1, Rgb colour);
+    void brush(int x, int y, Rgb colour, int width);
+};
+
+// Paints the basemap layers of `tile` (water, then country and prefecture
+// borders) in the style download.py used, scaled to cover `canvas`.
+void render_basemap(const MvtTile &tile, Canvas &canvas);
+
+// A block of z/x/y.pbf tiles under `dir`, one `tile_px` square each in the
+// stitched image.
+struct MvtGrid {
+    std::filesystem::path dir;
+    uint32_t zoom = 6;
+    uint32_t x_min = 0;
+    uint32_t x_max = 0;
+    uint32_t y_min = 0;
+    uint32_t y_max = 0;
+    uint32_t tile_px = 1024;
+
+    [[nodiscard]] auto width() const -> uint32_t {
+        return (x_max - x_min + 1) * tile_px;
+    }
+    [[nodiscard]] auto height() const -> uint32_t {
+        return (y_max - y_min + 1) * tile_px;
+    }
+};
+
+// The tiles covering a lat/lon box at `zoom`.
+auto mvt_grid(double lat_min, double lat_max, double lon_min, double lon_max,
+              uint32_t zoom) -> MvtGrid;
+
+// Rasterizes `grid` one row of tiles at a time, the tiles of a row in
+// parallel on `threads` threads, and streams the rows into `pyramid`
+// (sized grid.width() x grid.height()). Missing tiles stay background.
+auto build_pyramid(const MvtGrid &grid, unsigned threads, TilePyramid &pyramid,
+                   const std::atomic<bool> &cancel, std::string &error)
+    -> bool;
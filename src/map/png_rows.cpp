@@ -0,0 +1,168 @@
+#include "png_rows.h"
+#include <cstring>
+#include <fstream>
+
+namespace {
+constexpr std::array<uint8_t, 8> SIGNATURE = {0x89, 'P',  'N',  'G',
+                                              '\r', '\n', 0x1a, '\n'};
+constexpr uint8_t COLOR_RGB = 2;
+constexpr uint8_t COLOR_RGBA = 6;
+
+auto read_u32(const uint8_t *data) -> uint32_t {
+    return (static_cast<uint32_t>(data[0]) << 24) |
+           (static_cast<uint32_t>(data[1]) << 16) |
+           (static_cast<uint32_t>(data[2]) << 8) | data[3];
+}
+
+auto paeth(int a, int b, int c) -> uint8_t {
+    int p = a + b - c;
+    int pa = std::abs(p - a);
+    int pb = std::abs(p - b);
+    int pc = std::abs(p - c);
+    if (pa <= pb && pa <= pc) {
+        return static_cast<uint8_t>(a);
+    }
+    return static_cast<uint8_t>(pb <= pc ? b : c);
+}
+} // namespace
+
+auto PngRows::open(const std::filesystem::path &path, std::string &error)
+    -> std::optional<PngRows> {
+    std::ifstream stream(path, std::ios::binary);
+    if (!stream) {
+        error = "cannot open " + path.string();
+        return std::nullopt;
+    }
+    std::vector<uint8_t> file((std::istreambuf_iterator<char>(stream)),
+                              std::istreambuf_iterator<char>());
+    return open(std::move(file), error);
+}
+
+auto PngRows::open(std::vector<uint8_t> file, std::string &error)
+    -> std::optional<PngRows> {
+    // Signature, then IHDR: length, type, 13 bytes of header, CRC.
+    if (file.size() < 8 + 25 ||
+        std::memcmp(file.data(), SIGNATURE.data(), SIGNATURE.size()) != 0 ||
+        std::memcmp(file.data() + 12, "IHDR", 4) != 0) {
+        error = "not a PNG file";
+        return std::nullopt;
+    }
+    const uint8_t *header = file.data() + 16;
+    uint8_t depth = header[8];
+    uint8_t color = header[9];
+    uint8_t interlace = header[12];
+    if (depth != 8 || (color != COLOR_RGB && color != COLOR_RGBA) ||
+        interlace != 0) {
+        error = "only 8-bit RGB/RGBA non-interlaced PNGs are supported";
+        return std::nullopt;
+    }
+
+    std::optional<PngRows> rows(PngRows{});
+    rows->width_ = read_u32(header);
+    rows->height_ = read_u32(header + 4);
+    rows->channels_ = color == COLOR_RGBA ? 4 : 3;
+    rows->file_ = std::move(file);
+    rows->row_.resize(1 + rows->width_ * rows->channels_);
+    rows->previous_.assign(rows->row_.size(), 0);
+    auto stream = std::make_unique<z_stream>();
+    if (inflateInit(stream.get()) != Z_OK) {
+        error = "inflateInit failed";
+        return std::nullopt;
+    }
+    rows->zlib_.reset(stream.release());
+    return rows;
+}
+
+// Points zlib at the next IDAT chunk's data.
+auto PngRows::next_idat() -> bool {
+    while (chunk_ + 12 <= file_.size()) {
+        auto length = read_u32(&file_[chunk_]);
+        const auto *type = &file_[chunk_ + 4];
+        auto data = chunk_ + 8;
+        if (data + length + 4 > file_.size()) {
+            return false;
+        }
+        chunk_ = data + length + 4; // skip the CRC
+        if (std::memcmp(type, "IDAT", 4) == 0 && length > 0) {
+            zlib_->next_in = &file_[data];
+            zlib_->avail_in = length;
+            return true;
+        }
+        if (std::memcmp(type, "IEND", 4) == 0) {
+            return false;
+        }
+    }
+    return false;
+}
+
+auto PngRows::inflate_into(std::span<uint8_t> out) -> bool {
+    zlib_->next_out = out.data();
+    zlib_->avail_out = static_cast<uInt>(out.size());
+    while (zlib_->avail_out > 0) {
+        if (zlib_->avail_in == 0 && !next_idat()) {
+            return false;
+        }
+        auto result = inflate(zlib_.get(), Z_NO_FLUSH);
+        if (result == Z_STREAM_END) {
+            return zlib_->avail_out == 0;
+        }
+        if (result != Z_OK && result != Z_BUF_ERROR) {
+            return false;
+        }
+    }
+    return true;
+}
+
+auto PngRows::next_row(std::span<uint8_t> rgb) -> bool {
+    if (rows_read_ >= height_ || rgb.size() < std::size_t{width_} * 3 ||
+        !inflate_into(row_)) {
+        return false;
+    }
+
+    // Undo the row filter in place, bytes left to right.
+    auto *line = row_.data() + 1;
+    const auto *above = previous_.data() + 1;
+    auto bytes = row_.size() - 1;
+    auto stride = channels_;
+    switch (row_[0]) {
+    case 0:
+        break;
+    case 1:
+        for (std::size_t i = stride; i < bytes; i++) {
+            line[i] = static_cast<uint8_t>(line[i] + line[i - stride]);
+        }
+        break;
+    case 2:
+        for (std::size_t i = 0; i < bytes; i++) {
+            line[i] = static_cast<uint8_t>(line[i] + above[i]);
+        }
+        break;
+    case 3:
+        for (std::size_t i = 0; i < bytes; i++) {
+            int left = i >= stride ? line[i - stride] : 0;
+            line[i] = static_cast<uint8_t>(line[i] + (left + above[i]) / 2);
+        }
+        break;
+    case 4:
+        for (std::size_t i = 0; i < bytes; i++) {
+            int left = i >= stride ? line[i - stride] : 0;
+            int corner = i >= stride ? above[i - stride] : 0;
+            line[i] = static_cast<uint8_t>(line[i] +
+                                           paeth(left, above[i], corner));
+        }
+        break;
+    default:
+        return false;
+    }
+
+    if (channels_ == 3) {
+        std::memcpy(rgb.data(), line, bytes);
+    } else {
+        for (std::size_t x = 0; x < width_; x++) {
+            std::memcpy(&rgb[x * 3], &line[x * 4], 3);
+        }
+    }
+    std::swap(row_, previous_);
+    rows_read_++;
+    return true;
+}
@@ -0,0 +1,54 @@
+#pragma once
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+#include <zlib.h>
+
+// Decodes an 8-bit RGB or RGBA, non-interlaced PNG one row at a time, so
+// the full image never has to be in memory. Rows come out as RGB.
+class PngRows {
+public:
+    // nullopt (and `error` set) if the file cannot be read or the format is
+    // not supported.
+    static auto open(const std::filesystem::path &path, std::string &error)
+        -> std::optional<PngRows>;
+    static auto open(std::vector<uint8_t> file, std::string &error)
+        -> std::optional<PngRows>;
+
+
+    [[nodiscard]] auto width() const -> uint32_t { return width_; }
+    [[nodiscard]] auto height() const -> uint32_t { return height_; }
+
+    // Writes the next row (width * 3 bytes) into `rgb`. False at the end of
+    // the image or on corrupt data.
+    auto next_row(std::span<uint8_t> rgb) -> bool;
+
+private:
+    // zlib keeps a pointer back to its z_stream, so it must not move.
+    struct InflateEnd {
+        void operator()(z_stream *stream) const {
+            inflateEnd(stream);
+            delete stream;
+        }
+    };
+
+    PngRows() = default;
+
+    std::vector<uint8_t> file_;
+    std::size_t chunk_ = 8; // next chunk to feed to inflate
+    std::unique_ptr<z_stream, InflateEnd> zlib_;
+    uint32_t width_ = 0;
+    uint32_t height_ = 0;
+    uint32_t rows_read_ = 0;
+    std::size_t channels_ = 3;
+    // Filter byte plus pixels; the previous row is kept for unfiltering.
+    std::vector<uint8_t> row_;
+    std::vector<uint8_t> previous_;
+
+    auto inflate_into(std::span<uint8_t> out) -> bool;
+    auto next_idat() -> bool;
+};
@@ -0,0 +1,159 @@
+#include "projection.h"
+#include <numbers>
+
+namespace {
+// The area download.py fetched.
+constexpr double LAT_MIN = 23.0;
+constexpr double LAT_MAX = 47.0;
+constexpr double LON_MIN = 121.0;
+constexpr double LON_MAX = 150.0;
+
+// Mip levels the level of detail is worked out for; from level 0 up
+// (zoom >= 1) every region is drawn.
+constexpr int LOD_LEVELS = 6;
+// Regions projected per batch; the screen positions and inside flags of a
+// batch sit in small stack arrays until the visible ones are copied out.
+constexpr std::size_t CHUNK = 64;
+
+// Map pixels to screen pixels, flagging the points inside the bounds.
+void screen_kernel(const float *__restrict x, const float *__restrict y,
+                   std::size_t count, float center_x, float center_y,
+                   float zoom, float left, float top, float right,
+                   float bottom, float *__restrict out_x,
+                   float *__restrict out_y, uint8_t *__restrict inside) {
+    for (std::size_t i = 0; i < count; i++) {
+        float sx = (x[i] - center_x) * zoom;
+        float sy = (y[i] - center_y) * zoom;
+        out_x[i] = sx;
+        out_y[i] = sy;
+        inside[i] = static_cast<uint8_t>((sx >= left) & (sx <= right) &
+                                         (sy >= top) & (sy <= bottom));
+    }
+}
+} // namespace
+
+auto japan_map_grid(uint32_t zoom) -> MvtGrid {
+    return mvt_grid(LAT_MIN, LAT_MAX, LON_MIN, LON_MAX, zoom);
+}
+
+auto mercator_px(const MvtGrid &grid, double lat, double lon)
+    -> std::pair<double, double> {
+    auto world = std::ldexp(static_cast<double>(grid.tile_px),
+                            static_cast<int>(grid.zoom));
+    auto rad = lat * std::numbers::pi / 180.0;
+    auto x = (lon + 180.0) / 360.0 * world;
+    auto y = (1.0 - std::asinh(std::tan(rad)) / std::numbers::pi) / 2.0 *
+             world;
+    return {x - static_cast<double>(grid.x_min) * grid.tile_px,
+            y - static_cast<double>(grid.y_min) * grid.tile_px};
+}
+
+RegionProjection::RegionProjection(const MvtGrid &grid) {
+    struct Point {
+        double x;
+        double y;
+        float min_zoom;
+        uint16_t region;
+    };
+    std::vector<Point> points;
+    for (std::size_t i = 0; i < regions.size(); i++) {
+        const auto &region = regions[i];
+        if (region.lat == 0.0 && region.lon == 0.0) {
+            continue;
+        }
+        auto [x, y] = mercator_px(grid, region.lat, region.lon);
+        points.push_back({x, y, 1.0F, static_cast<uint16_t>(i)});
+    }
+
+    // Coarsest level first: a region joins a level when it keeps its
+    // spacing from every region already on it, and stays on finer ones.
+    std::vector<const Point *> placed;
+    for (int level = LOD_LEVELS - 1; level > 0; level--) {
+        auto zoom = std::ldexp(1.0F, -level);
+        auto spacing = static_cast<double>(MARKER_SPACING / zoom);
+        for (auto &point : points) {
+            if (point.min_zoom <= zoom) {
+                continue;
+            }
+            bool clear = std::ranges::none_of(
+                placed, [&point, spacing](const Point *other) -> bool {
+                    return std::hypot(point.x - other->x,
+                                      point.y - other->y) < spacing;
+                });
+            if (clear) {
+                point.min_zoom = zoom;
+                placed.push_back(&point);
+            }
+        }
+    }
+
+    std::ranges::stable_sort(points, {}, &Point::min_zoom);
+    slot_.fill(UINT16_MAX);
+    for (const auto &point : points) {
+        slot_[point.region] = static_cast<uint16_t>(region_.size());
+        x_.push_back(static_cast<float>(point.x));
+        y_.push_back(static_cast<float>(point.y));
+        min_zoom_.push_back(point.min_zoom);
+        region_.push_back(point.region);
+    }
+}
+
+void RegionProjection::transform(const MapViewport &view, float margin,
+                                 ScreenPoints &out) const {
+    out.x.clear();
+    out.y.clear();
+    out.region.clear();
+    auto zoom = static_cast<float>(view.zoom);
+    // Level of detail: the prefix drawn at this zoom.
+    auto count = static_cast<std::size_t>(
+        std::ranges::upper_bound(min_zoom_, zoom) - min_zoom_.begin());
+
+    auto half_w = view.width / 2.0F;
+    auto half_h = view.height / 2.0F;
+    std::array<float, CHUNK> sx{};
+    std::array<float, CHUNK> sy{};
+    std::array<uint8_t, CHUNK> inside{};
+    for (std::size_t first = 0; first < count; first += CHUNK) {
+        auto n = std::min(CHUNK, count - first);
+        // Relative to the screen centre, so the kernel needs no offset.
+        screen_kernel(&x_[first], &y_[first], n,
+                      static_cast<float>(view.center_x),
+                      static_cast<float>(view.center_y), zoom,
+                      -half_w - margin, -half_h - margin, half_w + margin,
+                      half_h + margin, sx.data(), sy.data(), inside.data());
+        for (std::size_t i = 0; i < n; i++) {
+            if (inside[i] != 0) {
+                out.x.push_back(sx[i] + half_w);
+                out.y.push_back(sy[i] + half_h);
+                out.region.push_back(region_[first + i]);
+            }
+        }
+    }
+}
+
+auto RegionProjection::to_screen(const MapViewport &view,
+                                 std::size_t region) const
+    -> std::optional<std::pair<float, float>> {
+    if (region >= slot_.size() || slot_[region] == UINT16_MAX) {
+        return std::nullopt;
+    }
+    auto i = slot_[region];
+    return std::pair{
+        static_cast<float>((x_[i] - view.center_x) * view.zoom +
+                           view.width / 2.0),
+        static_cast<float>((y_[i] - view.center_y) * view.zoom +
+                           view.height / 2.0)};
+}
+
+auto RegionProjection::min_zoom(std::size_t region) const
+    -> std::optional<float> {
+    if (region >= slot_.size() || slot_[region] == UINT16_MAX) {
+        return std::nullopt;
+    }
+    return min_zoom_[slot_[region]];
+}
+
+auto region_projection() -> const RegionProjection & {
+    static const RegionProjection projection(japan_map_grid());
+    return projection;
+}
@@ -0,0 +1,62 @@
+#pragma once
+#include "../utils/region.h"
+#include "mvt_raster.h"
+#include "viewport.h"
+#include <optional>
+
+inline constexpr uint32_t JAPAN_MAP_ZOOM = 6;
+
+// The tile block download.py fetched for Japan. At JAPAN_MAP_ZOOM its
+// pixels are the bundled map's: Web Mercator, 1024 px per tile, origin at
+// the block's top-left.
+auto japan_map_grid(uint32_t zoom = JAPAN_MAP_ZOOM) -> MvtGrid;
+
+// Level-0 map pixel of a point in `grid`.
+auto mercator_px(const MvtGrid &grid, double lat, double lon)
+    -> std::pair<double, double>;
+
+// Screen positions from RegionProjection::transform(), by point.
+struct ScreenPoints {
+    std::vector<float> x;
+    std::vector<float> y;
+    std::vector<uint16_t> region; // position in `regions`
+
+    [[nodiscard]] auto size() const -> std::size_t { return region.size(); }
+};
+
+// Every located region projected into map pixels once, kept as float SoA.
+// Each region also gets the lowest zoom it is drawn at, chosen greedily so
+// markers stay MARKER_SPACING screen pixels apart on every mip level. The
+// points are sorted by that zoom: level of detail is a binary search for a
+// prefix, and a branch-free kernel maps the prefix to the screen.
+class RegionProjection {
+public:
+    static constexpr float MARKER_SPACING = 14.0F;
+
+    explicit RegionProjection(const MvtGrid &grid);
+
+    // Regions inside `view` (grown by `margin` pixels) that its zoom's level
+    // of detail admits.
+    void transform(const MapViewport &view, float margin,
+                   ScreenPoints &out) const;
+    // Any located region, whatever the level of detail.
+    [[nodiscard]] auto to_screen(const MapViewport &view,
+                                 std::size_t region) const
+        -> std::optional<std::pair<float, float>>;
+
+    [[nodiscard]] auto size() const -> std::size_t { return region_.size(); }
+    // The zoom from which region `region` is drawn; nullopt if unlocated.
+    [[nodiscard]] auto min_zoom(std::size_t region) const
+        -> std::optional<float>;
+
+private:
+    std::vector<float> x_;
+    std::vector<float> y_;
+    std::vector<float> min_zoom_; // ascending
+    std::vector<uint16_t> region_;
+    // By table position: index into the arrays above, or UINT16_MAX.
+    std::array<uint16_t, regions.size()> slot_{};
+};
+
+// The projection onto japan_map_grid(); built on first use, then read-only.
+auto region_projection() -> const RegionProjection &;
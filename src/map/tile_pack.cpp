@@ -0,0 +1,127 @@
+#include "tile_pack.h"
+#include "../utils/byte_order.h"
+#include <cstring>
+#include <fstream>
+
+namespace {
+constexpr std::string_view MAGIC = "EPSPTPK1";
+constexpr std::size_t HEADER_BYTES = MAGIC.size() + 4 * 4;
+constexpr std::size_t ENTRY_BYTES = 8 + 4;
+} // namespace
+
+auto write_tile_pack(const TilePyramid &pyramid,
+                     const std::filesystem::path &path, std::string &error)
+    -> bool {
+    std::vector<uint8_t> head;
+    head.insert(head.end(), MAGIC.begin(), MAGIC.end());
+    put_le(head, pyramid.tile_size(), 4);
+    put_le(head, pyramid.width(0), 4);
+    put_le(head, pyramid.height(0), 4);
+    put_le(head, pyramid.tile_count(), 4);
+
+    // Tiles in index order, so a view's tiles sit close together.
+    std::vector<std::span<const uint8_t>> blobs;
+    blobs.reserve(pyramid.tile_count());
+    for (uint8_t level = 0; level < pyramid.levels(); level++) {
+        for (uint32_t y = 0; y < pyramid.rows(level); y++) {
+            for (uint32_t x = 0; x < pyramid.columns(level); x++) {
+                blobs.push_back(
+                    pyramid.deflated({.level = level,
+                                      .x = static_cast<uint16_t>(x),
+                                      .y = static_cast<uint16_t>(y)}));
+            }
+        }
+    }
+    uint64_t offset = HEADER_BYTES + blobs.size() * ENTRY_BYTES;
+    for (auto blob : blobs) {
+        put_le(head, blob.empty() ? 0 : offset, 8);
+        put_le(head, blob.size(), 4);
+        offset += blob.size();
+    }
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char *>(head.data()),
+               static_cast<std::streamsize>(head.size()));
+    for (auto blob : blobs) {
+        file.write(reinterpret_cast<const char *>(blob.data()),
+                   static_cast<std::streamsize>(blob.size()));
+    }
+    file.close();
+    if (!file) {
+        error = "cannot write " + path.string();
+        return false;
+    }
+    return true;
+}
+
+TilePack::TilePack(uint32_t width, uint32_t height, uint32_t tile_size,
+                   MappedFile file)
+    : TileSource(width, height, tile_size), file_(std::move(file)) {}
+
+auto TilePack::open(const std::filesystem::path &path, std::string &error)
+    -> std::unique_ptr<TilePack> {
+    MappedFile file;
+    if (!file.open(path, error)) {
+        return nullptr;
+    }
+    auto bytes = file.bytes();
+    if (bytes.size() < HEADER_BYTES ||
+        std::memcmp(bytes.data(), MAGIC.data(), MAGIC.size()) != 0) {
+        error = "not a tile pack";
+        return nullptr;
+    }
+    auto tile_size = static_cast<uint32_t>(get_le(bytes, 8, 4));
+    auto width = static_cast<uint32_t>(get_le(bytes, 12, 4));
+    auto height = static_cast<uint32_t>(get_le(bytes, 16, 4));
+    auto tiles = get_le(bytes, 20, 4);
+    if (tile_size == 0 || width == 0 || height == 0 ||
+        width > UINT16_MAX * uint64_t{tile_size} ||
+        height > UINT16_MAX * uint64_t{tile_size}) {
+        error = "bad tile pack header";
+        return nullptr;
+    }
+
+    std::unique_ptr<TilePack> pack(
+        new TilePack(width, height, tile_size, std::move(file)));
+    if (tiles != pack->tile_count() ||
+        bytes.size() < HEADER_BYTES + tiles * ENTRY_BYTES) {
+        error = "bad tile pack index";
+        return nullptr;
+    }
+    pack->index_.resize(tiles);
+    for (std::size_t i = 0; i < tiles; i++) {
+        auto at = HEADER_BYTES + i * ENTRY_BYTES;
+        Entry entry{.offset = get_le(bytes, at, 8),
+                    .size = static_cast<uint32_t>(get_le(bytes, at + 8, 4))};
+        if (entry.offset > bytes.size() ||
+            entry.size > bytes.size() - entry.offset) {
+            error = "tile pack is truncated";
+            return nullptr;
+        }
+        pack->compressed_bytes_ += entry.size;
+        pack->index_[i] = entry;
+    }
+    return pack;
+}
+
+auto TilePack::ready(TileKey key) const -> bool {
+    auto index = tile_index(key);
+    return index && index_[*index].size > 0;
+}
+
+auto TilePack::decode(TileKey key, TileImage &image) const -> bool {
+    auto index = tile_index(key);
+    if (!index || index_[*index].size == 0) {
+        return false;
+    }
+    const auto &entry = index_[*index];
+    auto [width, height] = tile_extent(key);
+    image.width = width;
+    image.height = height;
+    image.rgb.resize(std::size_t{width} * height * 3);
+    auto size = static_cast<uLongf>(image.rgb.size());
+    return uncompress(image.rgb.data(), &size,
+                      file_.bytes().data() + entry.offset,
+                      static_cast<uLong>(entry.size)) == Z_OK &&
+           size == image.rgb.size();
+}
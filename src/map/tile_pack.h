@@ -0,0 +1,47 @@
+#pragma once
+#include "../utils/mapped_file.h"
+#include "tile_pyramid.h"
+#include <filesystem>
+#include <string>
+
+// A tile pack is a pyramid frozen into one file the client maps instead of
+// decoding a PNG. Little-endian:
+//
+//   "EPSPTPK1", u32 tile_size, u32 width, u32 height, u32 tile count
+//   index:  per tile in TileSource order, u64 offset, u32 size
+//           (size 0: no tile)
+//   data:   the zlib streams the index points at
+//
+// Levels and tile sizes follow from width, height and tile_size.
+
+// Writes every stored tile of `pyramid` to `path`.
+auto write_tile_pack(const TilePyramid &pyramid,
+                     const std::filesystem::path &path, std::string &error)
+    -> bool;
+
+// A pack mapped read-only; tiles are inflated straight from the mapping,
+// so opening costs the header and index only.
+class TilePack : public TileSource {
+public:
+    static auto open(const std::filesystem::path &path, std::string &error)
+        -> std::unique_ptr<TilePack>;
+
+    [[nodiscard]] auto ready(TileKey key) const -> bool override;
+    auto decode(TileKey key, TileImage &image) const -> bool override;
+    [[nodiscard]] auto compressed_bytes() const -> std::size_t override {
+        return compressed_bytes_;
+    }
+
+private:
+    struct Entry {
+        uint64_t offset;
+        uint32_t size;
+    };
+
+    MappedFile file_;
+    std::vector<Entry> index_;
+    std::size_t compressed_bytes_ = 0;
+
+    TilePack(uint32_t width, uint32_t height, uint32_t tile_size,
+             MappedFile file);
+};
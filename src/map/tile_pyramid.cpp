@@ -0,0 +1,198 @@
+#include "tile_pyramid.h"
+#include <cstring>
+
+TilePyramid::TilePyramid(uint32_t width, uint32_t height, uint32_t tile_size)
+    : TileSource(width, height, tile_size),
+      tiles_(std::make_unique<Tile[]>(tile_count())) {}
+
+auto TilePyramid::tile(TileKey key) const -> Tile * {
+    auto index = tile_index(key);
+    return index ? &tiles_[*index] : nullptr;
+}
+
+auto TilePyramid::deflated(TileKey key) const -> std::span<const uint8_t> {
+    const auto *slot = tile(key);
+    if (slot == nullptr || !slot->ready.load(std::memory_order_acquire)) {
+        return {};
+    }
+    return slot->deflated;
+}
+
+auto TilePyramid::store(TileKey key, uint32_t width, uint32_t height,
+                        std::span<const uint8_t> rgb) -> bool {
+    auto *slot = tile(key);
+    if (slot == nullptr || slot->ready.load(std::memory_order_relaxed)) {
+        return slot != nullptr;
+    }
+    // Map tiles are mostly flat colour; the fastest level is plenty.
+    auto bound = compressBound(static_cast<uLong>(rgb.size()));
+    slot->deflated.resize(bound);
+    auto size = static_cast<uLongf>(bound);
+    if (compress2(slot->deflated.data(), &size, rgb.data(),
+                  static_cast<uLong>(rgb.size()), Z_BEST_SPEED) != Z_OK) {
+        // Never ready; the view keeps drawing an ancestor in its place.
+        slot->deflated = {};
+        return false;
+    }
+    slot->deflated.resize(size);
+    slot->deflated.shrink_to_fit();
+    slot->width = width;
+    slot->height = height;
+    compressed_bytes_.fetch_add(size, std::memory_order_relaxed);
+    slot->ready.store(true, std::memory_order_release);
+    return true;
+}
+
+auto TilePyramid::ready(TileKey key) const -> bool {
+    const auto *slot = tile(key);
+    return slot != nullptr && slot->ready.load(std::memory_order_acquire);
+}
+
+auto TilePyramid::decode(TileKey key, TileImage &image) const -> bool {
+    const auto *slot = tile(key);
+    if (slot == nullptr || !slot->ready.load(std::memory_order_acquire)) {
+        return false;
+    }
+    image.width = slot->width;
+    image.height = slot->height;
+    image.rgb.resize(std::size_t{slot->width} * slot->height * 3);
+    auto size = static_cast<uLongf>(image.rgb.size());
+    return uncompress(image.rgb.data(), &size, slot->deflated.data(),
+                      static_cast<uLong>(slot->deflated.size())) == Z_OK &&
+           size == image.rgb.size();
+}
+
+namespace {
+// One level's share of the streaming build.
+struct LevelBuilder {
+    uint8_t level;
+    uint32_t width;
+    uint32_t height;
+    uint32_t rows_in = 0;
+    uint32_t strip_rows = 0;
+    uint16_t strip = 0;
+    std::vector<uint8_t> strip_rgb{}; // tile_size rows
+    std::vector<uint8_t> pending{};   // an unpaired row for the next level
+    std::vector<uint8_t> down{};      // the next level's row being made
+    bool has_pending = false;
+};
+
+// Averages two rows 2x2 into `out`; an odd last column pairs with itself.
+void downsample(std::span<const uint8_t> top, std::span<const uint8_t> bottom,
+                uint32_t width, std::span<uint8_t> out) {
+    uint32_t half = (width + 1) / 2;
+    for (uint32_t x = 0; x < half; x++) {
+        auto left = std::size_t{x} * 2 * 3;
+        auto right = std::min<std::size_t>(std::size_t{x} * 2 + 1, width - 1) *
+                     3;
+        for (std::size_t c = 0; c < 3; c++) {
+            out[std::size_t{x} * 3 + c] = static_cast<uint8_t>(
+                (top[left + c] + top[right + c] + bottom[left + c] +
+                 bottom[right + c] + 2) /
+                4);
+        }
+    }
+}
+
+class PyramidBuilder {
+public:
+    explicit PyramidBuilder(TilePyramid &pyramid) : pyramid_(pyramid) {
+        auto tile_size = pyramid.tile_size();
+        for (uint8_t level = 0; level < pyramid.levels(); level++) {
+            LevelBuilder builder{.level = level,
+                                 .width = pyramid.width(level),
+                                 .height = pyramid.height(level)};
+            builder.strip_rgb.resize(std::size_t{builder.width} * tile_size *
+                                     3);
+            builder.pending.resize(std::size_t{builder.width} * 3);
+            builder.down.resize(std::size_t{(builder.width + 1) / 2} * 3);
+            levels_.push_back(std::move(builder));
+        }
+        tile_rgb_.reserve(std::size_t{tile_size} * tile_size * 3);
+    }
+
+    // False once any tile failed to deflate.
+    [[nodiscard]] auto ok() const -> bool { return ok_; }
+
+    void push_row(uint8_t level, std::span<const uint8_t> row) {
+        auto &builder = levels_[level];
+        auto stride = std::size_t{builder.width} * 3;
+        std::memcpy(&builder.strip_rgb[builder.strip_rows * stride],
+                    row.data(), stride);
+        builder.strip_rows++;
+        builder.rows_in++;
+        bool last = builder.rows_in == builder.height;
+        if (builder.strip_rows == pyramid_.tile_size() || last) {
+            flush_strip(builder);
+        }
+
+        if (std::size_t{level} + 1 >= levels_.size()) {
+            return;
+        }
+        if (!builder.has_pending && !last) {
+            std::memcpy(builder.pending.data(), row.data(), stride);
+            builder.has_pending = true;
+            return;
+        }
+        // Pair with the pending row, or with itself for an odd last row.
+        std::span<const uint8_t> top =
+            builder.has_pending ? std::span<const uint8_t>(builder.pending)
+                                : row;
+        builder.has_pending = false;
+        downsample(top, row, builder.width, builder.down);
+        push_row(static_cast<uint8_t>(level + 1), builder.down);
+    }
+
+private:
+    TilePyramid &pyramid_;
+    std::vector<LevelBuilder> levels_;
+    std::vector<uint8_t> tile_rgb_;
+    bool ok_ = true;
+
+    void flush_strip(LevelBuilder &builder) {
+        auto tile_size = pyramid_.tile_size();
+        auto stride = std::size_t{builder.width} * 3;
+        for (uint32_t column = 0; column * tile_size < builder.width;
+             column++) {
+            auto x0 = column * tile_size;
+            auto width = std::min(tile_size, builder.width - x0);
+            tile_rgb_.resize(std::size_t{width} * builder.strip_rows * 3);
+            for (uint32_t y = 0; y < builder.strip_rows; y++) {
+                std::memcpy(&tile_rgb_[std::size_t{y} * width * 3],
+                            &builder.strip_rgb[y * stride + x0 * 3],
+                            std::size_t{width} * 3);
+            }
+            ok_ &= pyramid_.store({.level = builder.level,
+                                   .x = static_cast<uint16_t>(column),
+                                   .y = builder.strip},
+                                  width, builder.strip_rows, tile_rgb_);
+        }
+        builder.strip_rows = 0;
+        builder.strip++;
+    }
+};
+} // namespace
+
+auto build_pyramid(const RowSource &next_row, TilePyramid &pyramid,
+                   const std::atomic<bool> &cancel) -> bool {
+    PyramidBuilder builder(pyramid);
+    std::vector<uint8_t> row(std::size_t{pyramid.width(0)} * 3);
+    for (uint32_t y = 0; y < pyramid.height(0); y++) {
+        if (cancel.load(std::memory_order_relaxed) || !next_row(row)) {
+            return false;
+        }
+        builder.push_row(0, row);
+    }
+    return builder.ok();
+}
+
+auto build_pyramid(PngRows &rows, TilePyramid &pyramid,
+                   const std::atomic<bool> &cancel) -> bool {
+    if (rows.width() != pyramid.width(0) ||
+        rows.height() != pyramid.height(0)) {
+        return false;
+    }
+    return build_pyramid(
+        [&rows](std::span<uint8_t> rgb) -> bool { return rows.next_row(rgb); },
+        pyramid, cancel);
+}
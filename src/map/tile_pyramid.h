@@ -0,0 +1,59 @@
+#pragma once
+#include "png_rows.h"
+#include "tile_source.h"
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <span>
+#include <vector>
+
+// Every tile of every mip level of one image, each kept deflated. The
+// builder stores tiles while readers decode the ones already stored, so a
+// view can show the top of the map before the bottom is decoded.
+class TilePyramid : public TileSource {
+public:
+    static constexpr uint32_t DEFAULT_TILE_SIZE = 256;
+
+    TilePyramid(uint32_t width, uint32_t height,
+                uint32_t tile_size = DEFAULT_TILE_SIZE);
+
+    // Builder thread. Each tile is stored once; false if it could not be
+    // deflated, which leaves it never ready.
+    auto store(TileKey key, uint32_t width, uint32_t height,
+               std::span<const uint8_t> rgb) -> bool;
+    // The stored zlib stream; empty until ready().
+    [[nodiscard]] auto deflated(TileKey key) const
+        -> std::span<const uint8_t>;
+
+    [[nodiscard]] auto ready(TileKey key) const -> bool override;
+    auto decode(TileKey key, TileImage &image) const -> bool override;
+    [[nodiscard]] auto compressed_bytes() const -> std::size_t override {
+        return compressed_bytes_.load(std::memory_order_relaxed);
+    }
+
+private:
+    struct Tile {
+        std::vector<uint8_t> deflated;
+        uint32_t width = 0;
+        uint32_t height = 0;
+        std::atomic<bool> ready{false};
+    };
+
+    std::unique_ptr<Tile[]> tiles_;
+    std::atomic<std::size_t> compressed_bytes_{0};
+
+    [[nodiscard]] auto tile(TileKey key) const -> Tile *;
+};
+
+// Fills `rgb` with the next level-0 row; false on error.
+using RowSource = std::function<bool(std::span<uint8_t> rgb)>;
+
+// Streams every level-0 row through all levels of `pyramid`: each level
+// keeps one strip of tile_size rows and a 2x2 box filter feeds the next.
+// Peak memory is about two level-0 strips. Stops early when `cancel` is set;
+// false on a read error, a cancel or a tile that failed to deflate.
+auto build_pyramid(const RowSource &next_row, TilePyramid &pyramid,
+                   const std::atomic<bool> &cancel) -> bool;
+auto build_pyramid(PngRows &rows, TilePyramid &pyramid,
+                   const std::atomic<bool> &cancel) -> bool;
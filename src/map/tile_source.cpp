@@ -0,0 +1,30 @@
+#include "tile_source.h"
+
+TileSource::TileSource(uint32_t width, uint32_t height, uint32_t tile_size)
+    : tile_size_(tile_size) {
+    while (true) {
+        Level level{.width = width,
+                    .height = height,
+                    .columns = (width + tile_size - 1) / tile_size,
+                    .rows = (height + tile_size - 1) / tile_size,
+                    .first = tiles_};
+        tiles_ += std::size_t{level.columns} * level.rows;
+        levels_.push_back(level);
+        if (width <= tile_size && height <= tile_size) {
+            break;
+        }
+        width = (width + 1) / 2;
+        height = (height + 1) / 2;
+    }
+}
+
+auto TileSource::tile_index(TileKey key) const -> std::optional<std::size_t> {
+    if (key.level >= levels_.size()) {
+        return std::nullopt;
+    }
+    const auto &level = levels_[key.level];
+    if (key.x >= level.columns || key.y >= level.rows) {
+        return std::nullopt;
+    }
+    return level.first + std::size_t{key.y} * level.columns + key.x;
+}
@@ -0,0 +1,84 @@
+#pragma once
+#include <algorithm>
+#include <compare>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+struct TileKey {
+    uint8_t level; // 0 = full resolution, each level halves
+    uint16_t x;
+    uint16_t y;
+
+    auto operator<=>(const TileKey &) const = default;
+};
+
+struct TileKeyHash {
+    auto operator()(const TileKey &key) const -> std::size_t {
+        return (std::size_t{key.level} << 32) | (std::size_t{key.x} << 16) |
+               key.y;
+    }
+};
+
+struct TileImage {
+    uint32_t width = 0; // edge tiles are smaller than the tile size
+    uint32_t height = 0;
+    std::vector<uint8_t> rgb;
+};
+
+// A mip pyramid of RGB tiles. Each level halves the one above (rounding
+// up) down to the first level that fits in one tile; tiles are numbered
+// level by level, row by row.
+class TileSource {
+public:
+    virtual ~TileSource() = default;
+
+    [[nodiscard]] auto tile_size() const -> uint32_t { return tile_size_; }
+    [[nodiscard]] auto levels() const -> uint8_t {
+        return static_cast<uint8_t>(levels_.size());
+    }
+    [[nodiscard]] auto width(uint8_t level) const -> uint32_t {
+        return levels_[level].width;
+    }
+    [[nodiscard]] auto height(uint8_t level) const -> uint32_t {
+        return levels_[level].height;
+    }
+    [[nodiscard]] auto columns(uint8_t level) const -> uint32_t {
+        return levels_[level].columns;
+    }
+    [[nodiscard]] auto rows(uint8_t level) const -> uint32_t {
+        return levels_[level].rows;
+    }
+    // Pixels of one tile; edge tiles are cut short.
+    [[nodiscard]] auto tile_extent(TileKey key) const
+        -> std::pair<uint32_t, uint32_t> {
+        const auto &level = levels_[key.level];
+        return {std::min(tile_size_, level.width - key.x * tile_size_),
+                std::min(tile_size_, level.height - key.y * tile_size_)};
+    }
+    [[nodiscard]] auto tile_count() const -> std::size_t { return tiles_; }
+    // Position in the numbering; nullopt outside the pyramid.
+    [[nodiscard]] auto tile_index(TileKey key) const
+        -> std::optional<std::size_t>;
+
+    // Any thread.
+    [[nodiscard]] virtual auto ready(TileKey key) const -> bool = 0;
+    virtual auto decode(TileKey key, TileImage &image) const -> bool = 0;
+    [[nodiscard]] virtual auto compressed_bytes() const -> std::size_t = 0;
+
+protected:
+    TileSource(uint32_t width, uint32_t height, uint32_t tile_size);
+
+private:
+    struct Level {
+        uint32_t width;
+        uint32_t height;
+        uint32_t columns;
+        uint32_t rows;
+        std::size_t first; // index of the level's first tile
+    };
+
+    uint32_t tile_size_;
+    std::vector<Level> levels_;
+    std::size_t tiles_ = 0;
+};
@@ -0,0 +1,366 @@
+#include "tile_streamer.h"
+#include "tile_pack.h"
+
+namespace {
+const std::shared_ptr<spdlog::logger> map_logger =
+    spdlog::default_logger()->clone("\033[36mmap\033[0m");
+
+// GPUs keep RGB8 textures as RGBA8.
+constexpr std::size_t TEXTURE_BYTES_PER_PIXEL = 4;
+} // namespace
+
+TileStreamer::TileStreamer(TextureBackend &backend,
+                           TileStreamerOptions options)
+    : backend_(backend), options_(options) {}
+
+TileStreamer::~TileStreamer() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    cancel_.store(true, std::memory_order_relaxed);
+    work_.notify_all();
+    if (worker_.joinable()) {
+        worker_.join();
+    }
+    for (const auto &[key, tile] : resident_) {
+        backend_.destroy(tile.texture);
+    }
+}
+
+void TileStreamer::set_wake(std::function<void()> wake) {
+    wake_ = std::move(wake);
+}
+
+void TileStreamer::start(std::filesystem::path map) {
+    started_ = clock::now();
+    worker_ = std::thread(
+        [this, map = std::move(map)] mutable -> void { run(std::move(map)); });
+}
+
+auto TileStreamer::image_size() const -> std::pair<uint32_t, uint32_t> {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!source_) {
+        return {0, 0};
+    }
+    return {source_->width(0), source_->height(0)};
+}
+
+auto TileStreamer::level_for(double zoom, uint8_t levels) -> uint8_t {
+    // The coarsest level whose texels are still no larger than a pixel.
+    if (zoom >= 1.0 || levels == 0) {
+        return 0;
+    }
+    auto level = static_cast<int>(std::floor(std::log2(1.0 / zoom)));
+    return static_cast<uint8_t>(std::clamp(level, 0, levels - 1));
+}
+
+auto TileStreamer::load(const std::filesystem::path &map)
+    -> std::shared_ptr<TileSource> {
+    std::string error;
+    auto loading = clock::now();
+    auto elapsed = [&loading] -> long long {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(
+                   clock::now() - loading)
+            .count();
+    };
+
+    if (map.extension() == ".pack") {
+        std::shared_ptr<TileSource> pack = TilePack::open(map, error);
+        if (!pack) {
+            map_logger->error("Cannot load map {}: {}", map.string(), error);
+            return nullptr;
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            source_ = pack;
+        }
+        map_logger->info("Map {}x{} mapped in {} ms, {} levels, {} KiB",
+                         pack->width(0), pack->height(0), elapsed(),
+                         pack->levels(), pack->compressed_bytes() / 1024);
+        return pack;
+    }
+
+    auto rows = PngRows::open(map, error);
+    if (!rows) {
+        map_logger->error("Cannot load map {}: {}", map.string(), error);
+        return nullptr;
+    }
+    auto pyramid = std::make_shared<TilePyramid>(
+        rows->width(), rows->height(), options_.tile_size);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        source_ = pyramid;
+    }
+    // Once per strip of level-0 rows, decode what the view asked for and
+    // wake it to ask for the tiles the last strip finished, so the top of
+    // the map shows while the rest is still being tiled.
+    uint32_t row = 0;
+    auto next_row = [&](std::span<uint8_t> rgb) -> bool {
+        if (row++ % options_.tile_size == 0) {
+            decode_pending(*pyramid);
+            if (wake_) {
+                wake_();
+            }
+        }
+        return rows->next_row(rgb);
+    };
+    if (!build_pyramid(next_row, *pyramid, cancel_)) {
+        if (!cancel_.load(std::memory_order_relaxed)) {
+            map_logger->error("Cannot tile map image: {}", map.string());
+        }
+        return nullptr;
+    }
+    map_logger->info("Map {}x{} tiled in {} ms, {} levels, {} KiB deflated",
+                     rows->width(), rows->height(), elapsed(),
+                     pyramid->levels(), pyramid->compressed_bytes() / 1024);
+    return pyramid;
+}
+
+auto TileStreamer::take_pending() -> TileKey {
+    auto key = pending_.back();
+    pending_.pop_back();
+    in_flight_.insert(key);
+    return key;
+}
+
+void TileStreamer::decode(const TileSource &source, TileKey key) {
+    TileImage image;
+    if (!source.decode(key, image)) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        in_flight_.erase(key);
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        decoded_.emplace_back(key, std::move(image));
+    }
+    if (wake_) {
+        wake_();
+    }
+}
+
+void TileStreamer::decode_pending(const TileSource &source) {
+    while (true) {
+        TileKey key{};
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (stopping_ || pending_.empty()) {
+                return;
+            }
+            key = take_pending();
+        }
+        decode(source, key);
+    }
+}
+
+void TileStreamer::run(std::filesystem::path map) {
+    auto source = load(map);
+    if (!source) {
+        return;
+    }
+    if (wake_) {
+        wake_();
+    }
+
+    while (true) {
+        TileKey key{};
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            work_.wait(lock, [this] -> bool {
+                return stopping_ || !pending_.empty();
+            });
+            if (stopping_) {
+                return;
+            }
+            key = take_pending();
+        }
+        decode(*source, key);
+    }
+}
+
+void TileStreamer::upload_decoded() {
+    uploading_.clear();
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::swap(uploading_, decoded_);
+        for (const auto &[key, image] : uploading_) {
+            in_flight_.erase(key);
+        }
+    }
+    stats_.decodes += uploading_.size();
+    for (auto &[key, image] : uploading_) {
+        if (resident_.contains(key)) {
+            continue;
+        }
+        lru_.push_front(key);
+        auto bytes =
+            std::size_t{image.width} * image.height * TEXTURE_BYTES_PER_PIXEL;
+        resident_.emplace(key, Resident{.texture = backend_.create(image),
+                                        .width = image.width,
+                                        .height = image.height,
+                                        .bytes = bytes,
+                                        .used = 0,
+                                        .lru = lru_.begin()});
+        stats_.resident_bytes += bytes;
+        stats_.uploads++;
+    }
+}
+
+auto TileStreamer::touch(TileKey key) -> const Resident * {
+    auto found = resident_.find(key);
+    if (found == resident_.end()) {
+        return nullptr;
+    }
+    auto &tile = found->second;
+    tile.used = frame_;
+    lru_.splice(lru_.begin(), lru_, tile.lru);
+    return &tile;
+}
+
+void TileStreamer::evict() {
+    // Never evicts a tile drawn this frame, even over budget.
+    while (stats_.resident_bytes > options_.budget_bytes && !lru_.empty()) {
+        auto key = lru_.back();
+        auto found = resident_.find(key);
+        if (found->second.used == frame_) {
+            break;
+        }
+        backend_.destroy(found->second.texture);
+        stats_.resident_bytes -= found->second.bytes;
+        stats_.evictions++;
+        resident_.erase(found);
+        lru_.pop_back();
+    }
+}
+
+void TileStreamer::frame(const MapViewport &view,
+                         std::vector<TileDraw> &draws) {
+    frame_++;
+    draws.clear();
+    upload_decoded();
+
+    std::shared_ptr<TileSource> source;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        source = source_;
+    }
+    if (!source || view.zoom <= 0.0) {
+        return;
+    }
+
+    auto level = level_for(view.zoom, source->levels());
+    auto tile_size = static_cast<double>(source->tile_size());
+    // Level-0 pixels per pixel of this level.
+    auto step = static_cast<double>(1U << level);
+    auto to_screen_x = [&view](double x0) -> float {
+        return static_cast<float>((x0 - view.center_x) * view.zoom +
+                                  view.width / 2.0);
+    };
+    auto to_screen_y = [&view](double y0) -> float {
+        return static_cast<float>((y0 - view.center_y) * view.zoom +
+                                  view.height / 2.0);
+    };
+
+    // Visible tile range at this level.
+    auto half_w = view.width / 2.0 / view.zoom;
+    auto half_h = view.height / 2.0 / view.zoom;
+    auto first_x = std::floor((view.center_x - half_w) / step / tile_size);
+    auto last_x = std::floor((view.center_x + half_w) / step / tile_size);
+    auto first_y = std::floor((view.center_y - half_h) / step / tile_size);
+    auto last_y = std::floor((view.center_y + half_h) / step / tile_size);
+    first_x = std::max(first_x, 0.0);
+    first_y = std::max(first_y, 0.0);
+    last_x = std::min(last_x, source->columns(level) - 1.0);
+    last_y = std::min(last_y, source->rows(level) - 1.0);
+
+    missing_.clear();
+    bool covered = true;
+    for (auto y = first_y; y <= last_y; y++) {
+        for (auto x = first_x; x <= last_x; x++) {
+            TileKey key{.level = level,
+                        .x = static_cast<uint16_t>(x),
+                        .y = static_cast<uint16_t>(y)};
+            // Level pixels this tile spans.
+            auto px0 = x * tile_size;
+            auto py0 = y * tile_size;
+            auto px1 = std::min(px0 + tile_size,
+                                static_cast<double>(source->width(level)));
+            auto py1 = std::min(py0 + tile_size,
+                                static_cast<double>(source->height(level)));
+            std::array<float, 4> rect = {
+                to_screen_x(px0 * step), to_screen_y(py0 * step),
+                to_screen_x(px1 * step), to_screen_y(py1 * step)};
+
+            if (const auto *tile = touch(key)) {
+                draws.push_back({.texture = tile->texture,
+                                 .rect = rect,
+                                 .uv = {0.0F, 0.0F, 1.0F, 1.0F}});
+                continue;
+            }
+            if (source->ready(key)) {
+                missing_.push_back(key);
+            }
+
+            // Stand in with the part of the nearest resident ancestor that
+            // covers this tile.
+            const Resident *cover = nullptr;
+            auto ancestor = key;
+            while (cover == nullptr && ancestor.level + 1 < source->levels()) {
+                ancestor = {.level = static_cast<uint8_t>(ancestor.level + 1),
+                            .x = static_cast<uint16_t>(ancestor.x / 2),
+                            .y = static_cast<uint16_t>(ancestor.y / 2)};
+                cover = touch(ancestor);
+            }
+            if (cover == nullptr) {
+                covered = false;
+                continue;
+            }
+            auto shrink = static_cast<double>(1U << (ancestor.level - level));
+            auto ax0 = ancestor.x * tile_size;
+            auto ay0 = ancestor.y * tile_size;
+            draws.push_back(
+                {.texture = cover->texture,
+                 .rect = rect,
+                 .uv = {static_cast<float>((px0 / shrink - ax0) / cover->width),
+                        static_cast<float>((py0 / shrink - ay0) /
+                                           cover->height),
+                        static_cast<float>((px1 / shrink - ax0) / cover->width),
+                        static_cast<float>((py1 / shrink - ay0) /
+                                           cover->height)}});
+        }
+    }
+
+    if (!missing_.empty()) {
+        // The worker takes from the back: nearest the centre first.
+        auto center_tile_x = view.center_x / step / tile_size - 0.5;
+        auto center_tile_y = view.center_y / step / tile_size - 0.5;
+        auto distance = [center_tile_x, center_tile_y](TileKey key) -> double {
+            return std::hypot(key.x - center_tile_x, key.y - center_tile_y);
+        };
+        std::ranges::sort(missing_, std::ranges::greater{}, distance);
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            pending_.clear();
+            for (auto key : missing_) {
+                if (!in_flight_.contains(key)) {
+                    pending_.push_back(key);
+                }
+            }
+        }
+        work_.notify_one();
+    }
+
+    evict();
+    stats_.resident_tiles = resident_.size();
+    stats_.compressed_bytes = source->compressed_bytes();
+    if (!stats_.first_frame && covered && !draws.empty()) {
+        stats_.first_frame =
+            std::chrono::duration_cast<std::chrono::milliseconds>(
+                clock::now() - started_);
+        map_logger->info("First map frame after {} ms",
+                         stats_.first_frame->count());
+    }
+}
+
+auto TileStreamer::stats() const -> MapStats { return stats_; }
@@ -0,0 +1,128 @@
+#pragma once
+#include "tile_pyramid.h"
+#include "viewport.h"
+#include <chrono>
+#include <condition_variable>
+#include <filesystem>
+#include <functional>
+#include <list>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+
+// One textured quad for the frame, in screen pixels. A missing tile is
+// drawn from the part of a resident ancestor that covers it.
+struct TileDraw {
+    uint64_t texture;
+    std::array<float, 4> rect; // x0, y0, x1, y1
+    std::array<float, 4> uv;   // u0, v0, u1, v1
+};
+
+// Creates and frees GPU textures; GL in the GUI, a counter in the tests.
+class TextureBackend {
+public:
+    virtual ~TextureBackend() = default;
+    virtual auto create(const TileImage &image) -> uint64_t = 0;
+    virtual void destroy(uint64_t texture) = 0;
+};
+
+struct TileStreamerOptions {
+    std::size_t budget_bytes = std::size_t{64} * 1024 * 1024;
+    uint32_t tile_size = TilePyramid::DEFAULT_TILE_SIZE;
+};
+
+struct MapStats {
+    std::size_t resident_bytes = 0; // textures, counted as RGBA8
+    std::size_t resident_tiles = 0;
+    std::size_t compressed_bytes = 0; // every level, deflated
+    uint64_t decodes = 0; // tiles the worker inflated
+    uint64_t uploads = 0;
+    uint64_t evictions = 0;
+    // From start() to the first frame with every visible tile covered.
+    std::optional<std::chrono::milliseconds> first_frame;
+};
+
+// Streams the map from a tile pack (mapped as is) or a PNG (the worker
+// builds the deflated pyramid in one pass). The worker inflates the tiles
+// the render thread asks for, between strips while a PNG is still being
+// tiled. The render thread uploads them and keeps textures in an LRU
+// under a byte budget.
+// Everything here is GL-free; the backend owns the textures.
+class TileStreamer {
+public:
+    using clock = std::chrono::steady_clock;
+
+    TileStreamer(TextureBackend &backend, TileStreamerOptions options = {});
+    ~TileStreamer();
+    TileStreamer(const TileStreamer &) = delete;
+    auto operator=(const TileStreamer &) -> TileStreamer & = delete;
+
+    // Runs on the worker whenever a tile is ready (e.g. glfwPostEmptyEvent).
+    void set_wake(std::function<void()> wake);
+    // A .pack file is mapped, anything else is decoded as a PNG.
+    void start(std::filesystem::path map);
+    // Size of the level-0 image once known, else {0, 0}.
+    [[nodiscard]] auto image_size() const -> std::pair<uint32_t, uint32_t>;
+
+    // Render thread, once per frame: uploads what the worker finished,
+    // requests what is missing, evicts over budget and fills `draws`.
+    void frame(const MapViewport &view, std::vector<TileDraw> &draws);
+    // Render thread.
+    [[nodiscard]] auto stats() const -> MapStats;
+
+    // The mip level whose texels are closest to, but not smaller than, one
+    // screen pixel.
+    static auto level_for(double zoom, uint8_t levels) -> uint8_t;
+
+private:
+    struct Resident {
+        uint64_t texture;
+        uint32_t width;
+        uint32_t height;
+        std::size_t bytes;
+        uint64_t used; // frame number
+        std::list<TileKey>::iterator lru;
+    };
+
+    TextureBackend &backend_;
+    TileStreamerOptions options_;
+    std::function<void()> wake_;
+
+    // Shared with the worker.
+    mutable std::mutex mutex_;
+    std::condition_variable work_;
+    std::shared_ptr<TileSource> source_;
+    std::vector<TileKey> pending_; // newest request last
+    // Taken by the worker and not uploaded yet; frames do not ask again.
+    std::unordered_set<TileKey, TileKeyHash> in_flight_;
+    std::vector<std::pair<TileKey, TileImage>> decoded_;
+    bool stopping_ = false;
+    std::atomic<bool> cancel_{false};
+    std::thread worker_;
+
+    // Render thread only.
+    std::unordered_map<TileKey, Resident, TileKeyHash> resident_;
+    std::list<TileKey> lru_; // most recently used first
+    std::vector<std::pair<TileKey, TileImage>> uploading_;
+    std::vector<TileKey> missing_;
+    uint64_t frame_ = 0;
+    clock::time_point started_{};
+    MapStats stats_;
+
+    void run(std::filesystem::path map);
+    // Worker: opens or builds the tiles, publishing them in source_.
+    auto load(const std::filesystem::path &map) -> std::shared_ptr<TileSource>;
+    // Worker, holding mutex_: takes the newest request and marks it in
+    // flight.
+    auto take_pending() -> TileKey;
+    // Worker: inflates one tile and hands it to the render thread.
+    void decode(const TileSource &source, TileKey key);
+    // Worker: decodes every pending request without waiting for more.
+    void decode_pending(const TileSource &source);
+    void upload_decoded();
+    void evict();
+    // Marks a resident tile as drawn this frame; nullptr if not resident.
+    auto touch(TileKey key) -> const Resident *;
+};
@@ -0,0 +1,11 @@
+#pragma once
+
+// What the map shows: the level-0 pixel at the centre of the screen and
+// how many screen pixels one level-0 pixel takes.
+struct MapViewport {
+    double center_x = 0.0;
+    double center_y = 0.0;
+    double zoom = 1.0;
+    float width = 0.0F;
+    float height = 0.0F;
+};
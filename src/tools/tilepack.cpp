@@ -0,0 +1,112 @@
+// epsp-tilepack: builds the client's map tile pack at build time.
+//
+//   epsp-tilepack --tiles DIR [--zoom Z] [--threads N] --out japan_z6.pack
+//       rasterizes DIR/Z/X/Y.pbf vector tiles covering Japan
+//   epsp-tilepack --png japan_z6.png --out japan_z6.pack
+//       tiles an existing map image
+#include "../map/projection.h"
+#include "../map/tile_pack.h"
+#include <charconv>
+#include <span>
+
+const std::shared_ptr<spdlog::logger> tool_logger =
+    spdlog::default_logger()->clone("\033[32mtilepack\033[0m");
+
+namespace {
+auto flag_text(std::span<char *> args, std::string_view flag)
+    -> std::optional<std::string_view> {
+    for (std::size_t i = 1; i + 1 < args.size(); i++) {
+        if (std::string_view(args[i]) == flag) {
+            return args[i + 1];
+        }
+    }
+    return std::nullopt;
+}
+
+auto flag_number(std::span<char *> args, std::string_view flag,
+                 uint32_t fallback) -> uint32_t {
+    auto text = flag_text(args, flag);
+    if (!text) {
+        return fallback;
+    }
+    uint32_t number = 0;
+    auto [end, ecode] =
+        std::from_chars(text->data(), text->data() + text->size(), number);
+    if (ecode != std::errc{}) {
+        tool_logger->warn("Ignoring {} {}", flag, *text);
+        return fallback;
+    }
+    return number;
+}
+
+void usage() {
+    std::cerr << "usage: epsp-tilepack --tiles DIR [--zoom Z] [--threads N]"
+                 " --out FILE\n"
+                 "       epsp-tilepack --png FILE --out FILE\n"
+                 "  --tile-size PX  pack tile size (default 256)\n";
+}
+} // namespace
+
+int main(int argc, char **argv) {
+    auto args = std::span(argv, argc);
+    auto tiles = flag_text(args, "--tiles");
+    auto png = flag_text(args, "--png");
+    auto out = flag_text(args, "--out");
+    auto tile_size =
+        flag_number(args, "--tile-size", TilePyramid::DEFAULT_TILE_SIZE);
+    if (!out || tiles.has_value() == png.has_value() || tile_size == 0) {
+        usage();
+        return 2;
+    }
+    auto started = std::chrono::steady_clock::now();
+    std::atomic<bool> cancel{false};
+    std::string error;
+    std::unique_ptr<TilePyramid> pyramid;
+
+    if (tiles) {
+        auto grid =
+            japan_map_grid(flag_number(args, "--zoom", JAPAN_MAP_ZOOM));
+        grid.dir = *tiles;
+        if (!std::filesystem::is_directory(grid.dir /
+                                           std::to_string(grid.zoom))) {
+            tool_logger->error("No z{} tiles under {}", grid.zoom, *tiles);
+            return 1;
+        }
+        auto threads = flag_number(args, "--threads", 0);
+        tool_logger->info("Rasterizing {}x{} tiles of z{} into {}x{} px",
+                          grid.x_max - grid.x_min + 1,
+                          grid.y_max - grid.y_min + 1, grid.zoom,
+                          grid.width(), grid.height());
+        pyramid = std::make_unique<TilePyramid>(grid.width(), grid.height(),
+                                                tile_size);
+        if (!build_pyramid(grid, threads, *pyramid, cancel, error)) {
+            tool_logger->error("{}", error);
+            return 1;
+        }
+    } else {
+        auto rows = PngRows::open(std::filesystem::path(*png), error);
+        if (!rows) {
+            tool_logger->error("{}: {}", *png, error);
+            return 1;
+        }
+        pyramid = std::make_unique<TilePyramid>(rows->width(), rows->height(),
+                                                tile_size);
+        if (!build_pyramid(*rows, *pyramid, cancel)) {
+            tool_logger->error("{}: corrupt image", *png);
+            return 1;
+        }
+    }
+
+    if (!write_tile_pack(*pyramid, std::filesystem::path(*out), error)) {
+        tool_logger->error("{}", error);
+        return 1;
+    }
+    tool_logger->info(
+        "Wrote {}: {} levels, {} tiles, {} KiB in {} ms", *out,
+        pyramid->levels(), pyramid->tile_count(),
+        pyramid->compressed_bytes() / 1024,
+        std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - started)
+            .count());
+    return 0;
+}
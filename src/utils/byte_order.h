@@ -0,0 +1,26 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+// Little-endian fields of the on-disk formats (tile pack, glyph cache),
+// independent of the host's byte order.
+
+// Appends the low `bytes` bytes of `value`.
+inline void put_le(std::vector<uint8_t> &out, uint64_t value,
+                   std::size_t bytes) {
+    for (std::size_t i = 0; i < bytes; i++) {
+        out.push_back(static_cast<uint8_t>(value >> (8 * i)));
+    }
+}
+
+// Reads `bytes` bytes at `at`; the caller checks the bounds.
+inline auto get_le(std::span<const uint8_t> in, std::size_t at,
+                   std::size_t bytes) -> uint64_t {
+    uint64_t value = 0;
+    for (std::size_t i = 0; i < bytes; i++) {
+        value |= uint64_t{in[at + i]} << (8 * i);
+    }
+    return value;
+}
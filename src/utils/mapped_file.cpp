@@ -0,0 +1,77 @@
+#include "mapped_file.h"
+#include <utility>
+
+#ifdef _WIN32
+#include <fstream>
+#else
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::~MappedFile() { close(); }
+
+MappedFile::MappedFile(MappedFile &&other) noexcept
+    : bytes_(std::exchange(other.bytes_, {})),
+      copy_(std::move(other.copy_)),
+      mapped_(std::exchange(other.mapped_, false)) {}
+
+auto MappedFile::operator=(MappedFile &&other) noexcept -> MappedFile & {
+    if (this != &other) {
+        close();
+        bytes_ = std::exchange(other.bytes_, {});
+        copy_ = std::move(other.copy_);
+        mapped_ = std::exchange(other.mapped_, false);
+    }
+    return *this;
+}
+
+void MappedFile::close() {
+#ifndef _WIN32
+    if (mapped_) {
+        munmap(const_cast<uint8_t *>(bytes_.data()), bytes_.size());
+    }
+#endif
+    mapped_ = false;
+    bytes_ = {};
+    copy_.clear();
+}
+
+auto MappedFile::open(const std::filesystem::path &path, std::string &error)
+    -> bool {
+    close();
+#ifdef _WIN32
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        error = "cannot open " + path.string();
+        return false;
+    }
+    copy_.assign(std::istreambuf_iterator<char>(file),
+                 std::istreambuf_iterator<char>());
+    bytes_ = copy_;
+#else
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        error = path.string() + ": " + std::strerror(errno);
+        return false;
+    }
+    struct stat info{};
+    if (fstat(fd, &info) == 0 && info.st_size > 0) {
+        auto size = static_cast<std::size_t>(info.st_size);
+        void *map = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map != MAP_FAILED) {
+            bytes_ = {static_cast<const uint8_t *>(map), size};
+            mapped_ = true;
+        }
+    }
+    ::close(fd);
+#endif
+    if (bytes_.empty()) {
+        error = "cannot map " + path.string();
+        return false;
+    }
+    return true;
+}
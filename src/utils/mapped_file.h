@@ -0,0 +1,32 @@
+#pragma once
+#include <cstdint>
+#include <filesystem>
+#include <span>
+#include <string>
+#include <vector>
+
+// A whole file, read-only: mapped where the platform has mmap, otherwise
+// read into memory. Pages are only touched when read.
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile();
+    MappedFile(MappedFile &&other) noexcept;
+    auto operator=(MappedFile &&other) noexcept -> MappedFile &;
+    MappedFile(const MappedFile &) = delete;
+    auto operator=(const MappedFile &) -> MappedFile & = delete;
+
+    // False with `error` set if the file cannot be opened or is empty.
+    auto open(const std::filesystem::path &path, std::string &error) -> bool;
+
+    [[nodiscard]] auto bytes() const -> std::span<const uint8_t> {
+        return bytes_;
+    }
+
+private:
+    std::span<const uint8_t> bytes_;
+    std::vector<uint8_t> copy_; // no mmap
+    bool mapped_ = false;
+
+    void close();
+};
@@ -1,4 +1,5 @@
 #include "path.h"
+#include <cstdlib>
 
 #ifdef _WIN32
 #include <windows.h>
@@ -54,3 +55,35 @@ auto get_executable_dir() -> std::filesystem::path {
 
     return std::filesystem::path(path).parent_path();
 }
+
+auto get_cache_dir() -> std::filesystem::path {
+    // Relative values are invalid per the XDG spec and are ignored.
+    auto from_env = [](const char *name) -> std::filesystem::path {
+        const char *value = std::getenv(name);
+        if (value == nullptr) {
+            return {};
+        }
+        std::filesystem::path path(value);
+        return path.is_absolute() ? path : std::filesystem::path{};
+    };
+
+#if defined(_WIN32)
+    auto base = from_env("LOCALAPPDATA");
+#else
+    auto base = from_env("XDG_CACHE_HOME");
+    if (base.empty()) {
+        auto home = from_env("HOME");
+        if (!home.empty()) {
+            base = home / ".cache";
+        }
+    }
+#endif
+    if (base.empty()) {
+        return {};
+    }
+
+    auto dir = base / "epsp";
+    std::error_code ecode;
+    std::filesystem::create_directories(dir, ecode);
+    return ecode ? std::filesystem::path{} : dir;
+}
@@ -2,3 +2,7 @@
 #include <filesystem>
 
 auto get_executable_dir() -> std::filesystem::path;
+// Per-user cache directory for the client, created on first use:
+// $XDG_CACHE_HOME/epsp, else ~/.cache/epsp (%LOCALAPPDATA%\epsp on
+// Windows). Empty when none can be found or created.
+auto get_cache_dir() -> std::filesystem::path;
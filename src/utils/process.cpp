@@ -0,0 +1,21 @@
+#include "process.h"
+
+#if defined(__linux__)
+#include <fstream>
+#include <unistd.h>
+#endif
+
+auto resident_set_bytes() -> std::size_t {
+#if defined(__linux__)
+    // statm: total and resident size, in pages.
+    std::ifstream statm("/proc/self/statm");
+    std::size_t total = 0;
+    std::size_t resident = 0;
+    if (!(statm >> total >> resident)) {
+        return 0;
+    }
+    return resident * static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+#else
+    return 0;
+#endif
+}
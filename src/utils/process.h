@@ -0,0 +1,5 @@
+#pragma once
+#include <cstddef>
+
+// Resident set size of this process; 0 where it cannot be read.
+auto resident_set_bytes() -> std::size_t;
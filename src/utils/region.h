@@ -1,16 +1,21 @@
 #pragma once
+#include <array>
+#include <cstdint>
+#include <string_view>
 
-using Region = struct {
-    std::string code;
+// Plain literals only, so the whole table is constant-initialised: no
+// static constructors and no heap in any translation unit including it.
+struct Region {
+    std::string_view code;
     int code_num;
-    std::string regions;
-    std::string pref;
-    std::string area;
+    std::string_view regions;
+    std::string_view pref;
+    std::string_view area;
     double lat;
     double lon;
 };
 
-inline const std::vector<Region> regions = {
+inline constexpr auto regions = std::to_array<Region>({
     {"900", 900, "未設定", "", "地域未設定", 0.0, 0.0},
     {"901", 901, "不明", "", "地域不明", 0.0, 0.0},
     {"905", 905, "外国", "", "日本以外", 0.0, 0.0},
@@ -380,4 +385,61 @@ inline const std::vector<Region> regions = {
     {"884", 884, "EEW 短縮用震央地名", "", "シベリア南部", 0.0, 0.0},
     {"885", 885, "EEW 短縮用震央地名", "", "フィリピン北", 0.0, 0.0},
     {"886", 886, "EEW 短縮用震央地名", "", "中国東部", 0.0, 0.0},
-};
+});
+
+namespace region_detail {
+constexpr int MAX_CODE = 999;
+constexpr uint16_t NO_REGION = UINT16_MAX;
+using Index = std::array<uint16_t, MAX_CODE + 1>;
+
+// Direct index from code_num to table position. Any throw below makes the
+// constexpr initialiser fail, so a bad table does not build.
+consteval auto build_index() -> Index {
+    Index index{};
+    index.fill(NO_REGION);
+    for (std::size_t i = 0; i < regions.size(); i++) {
+        const auto &region = regions[i];
+        if (region.code_num < 0 || region.code_num > MAX_CODE) {
+            throw "region code out of range";
+        }
+        int parsed = 0;
+        for (char digit : region.code) {
+            parsed = parsed * 10 + (digit - '0');
+        }
+        if (region.code.size() != 3 || parsed != region.code_num) {
+            throw "region code does not match code_num";
+        }
+        auto &slot = index[static_cast<std::size_t>(region.code_num)];
+        if (slot != NO_REGION) {
+            throw "duplicate region code";
+        }
+        slot = static_cast<uint16_t>(i);
+    }
+    return index;
+}
+inline constexpr Index index = build_index();
+} // namespace region_detail
+
+// O(1); nullptr for codes not in the table.
+constexpr auto find_region(int code_num) -> const Region * {
+    if (code_num < 0 || code_num > region_detail::MAX_CODE) {
+        return nullptr;
+    }
+    auto slot = region_detail::index[static_cast<std::size_t>(code_num)];
+    return slot == region_detail::NO_REGION ? nullptr : &regions[slot];
+}
+
+// Three-digit code as sent on the wire, e.g. "010".
+constexpr auto find_region(std::string_view code) -> const Region * {
+    if (code.size() != 3) {
+        return nullptr;
+    }
+    int code_num = 0;
+    for (char digit : code) {
+        if (digit < '0' || digit > '9') {
+            return nullptr;
+        }
+        code_num = code_num * 10 + (digit - '0');
+    }
+    return find_region(code_num);
+}
@@ -0,0 +1,195 @@
+#include "region_index.h"
+#include <numbers>
+
+namespace {
+constexpr double DEG = std::numbers::pi / 180.0;
+constexpr double KM_PER_DEG = RegionIndex::EARTH_RADIUS_KM * DEG;
+constexpr double HALF_CIRCUMFERENCE_KM =
+    RegionIndex::EARTH_RADIUS_KM * std::numbers::pi;
+// Points handed to the kernel per call; keeps the output on the stack.
+constexpr std::size_t CHUNK = 64;
+
+// Squared chord between unit vectors. Unlike 1 - dot it keeps its digits
+// at short range.
+void chord2_kernel(const double *__restrict x, const double *__restrict y,
+                   const double *__restrict z, std::size_t count,
+                   double query_x, double query_y, double query_z,
+                   double *__restrict out) {
+    for (std::size_t i = 0; i < count; i++) {
+        double dx = x[i] - query_x;
+        double dy = y[i] - query_y;
+        double dz = z[i] - query_z;
+        out[i] = dx * dx + dy * dy + dz * dz;
+    }
+}
+
+auto chord2_to_km(double chord2) -> double {
+    return 2.0 * RegionIndex::EARTH_RADIUS_KM *
+           std::asin(std::min(1.0, std::sqrt(chord2) / 2.0));
+}
+
+auto cell_index(double value, double origin, std::size_t cells)
+    -> std::size_t {
+    auto cell = static_cast<std::ptrdiff_t>(
+        std::floor((value - origin) / RegionIndex::CELL_DEG));
+    return static_cast<std::size_t>(
+        std::clamp<std::ptrdiff_t>(cell, 0,
+                                   static_cast<std::ptrdiff_t>(cells) - 1));
+}
+} // namespace
+
+RegionIndex::RegionIndex() {
+    std::vector<uint16_t> located;
+    double lat_max = -90.0;
+    double lon_max = -180.0;
+    lat0_ = 90.0;
+    lon0_ = 180.0;
+    for (std::size_t i = 0; i < regions.size(); i++) {
+        const auto &region = regions[i];
+        if (region.lat == 0.0 && region.lon == 0.0) {
+            continue;
+        }
+        located.push_back(static_cast<uint16_t>(i));
+        lat0_ = std::min(lat0_, region.lat);
+        lon0_ = std::min(lon0_, region.lon);
+        lat_max = std::max(lat_max, region.lat);
+        lon_max = std::max(lon_max, region.lon);
+    }
+    if (located.empty()) {
+        cell_start_.assign(1, 0);
+        return;
+    }
+    lat0_ = std::floor(lat0_ / CELL_DEG) * CELL_DEG;
+    lon0_ = std::floor(lon0_ / CELL_DEG) * CELL_DEG;
+    rows_ = static_cast<std::size_t>((lat_max - lat0_) / CELL_DEG) + 1;
+    cols_ = static_cast<std::size_t>((lon_max - lon0_) / CELL_DEG) + 1;
+
+    // Counting sort by cell, so each grid row's cells are contiguous.
+    auto cell_of = [this](const Region &region) -> std::size_t {
+        return cell_index(region.lat, lat0_, rows_) * cols_ +
+               cell_index(region.lon, lon0_, cols_);
+    };
+    cell_start_.assign(rows_ * cols_ + 1, 0);
+    for (auto i : located) {
+        cell_start_[cell_of(regions[i]) + 1]++;
+    }
+    for (std::size_t cell = 0; cell < rows_ * cols_; cell++) {
+        cell_start_[cell + 1] += cell_start_[cell];
+    }
+    auto next = cell_start_;
+    x_.resize(located.size());
+    y_.resize(located.size());
+    z_.resize(located.size());
+    region_.resize(located.size());
+    for (auto i : located) {
+        const auto &region = regions[i];
+        auto slot = next[cell_of(region)]++;
+        x_[slot] = std::cos(region.lat * DEG) * std::cos(region.lon * DEG);
+        y_[slot] = std::cos(region.lat * DEG) * std::sin(region.lon * DEG);
+        z_[slot] = std::sin(region.lat * DEG);
+        region_[slot] = i;
+    }
+}
+
+void RegionIndex::scan(std::size_t first, std::size_t last, double query_x,
+                       double query_y, double query_z, double limit,
+                       std::vector<RegionHit> &hits) const {
+    std::array<double, CHUNK> chord2{};
+    for (std::size_t start = first; start < last; start += CHUNK) {
+        auto count = std::min(CHUNK, last - start);
+        chord2_kernel(&x_[start], &y_[start], &z_[start], count, query_x,
+                      query_y, query_z, chord2.data());
+        for (std::size_t i = 0; i < count; i++) {
+            if (chord2[i] <= limit) {
+                hits.push_back({.region = &regions[region_[start + i]],
+                                .km = chord2_to_km(chord2[i])});
+            }
+        }
+    }
+}
+
+void RegionIndex::within_radius(double lat, double lon, double km,
+                                std::vector<RegionHit> &hits) const {
+    hits.clear();
+    if (region_.empty() || km < 0.0) {
+        return;
+    }
+    double query_x = std::cos(lat * DEG) * std::cos(lon * DEG);
+    double query_y = std::cos(lat * DEG) * std::sin(lon * DEG);
+    double query_z = std::sin(lat * DEG);
+    double half_angle = std::min(km, HALF_CIRCUMFERENCE_KM) /
+                        RegionIndex::EARTH_RADIUS_KM / 2.0;
+    double limit = 4.0 * std::sin(half_angle) * std::sin(half_angle);
+
+    // Grid rows the radius can reach.
+    double dlat = km / KM_PER_DEG;
+    double lat_lo = lat - dlat;
+    double lat_hi = lat + dlat;
+    if (lat_hi < lat0_ ||
+        lat_lo >= lat0_ + static_cast<double>(rows_) * CELL_DEG) {
+        return;
+    }
+    auto row_lo = cell_index(lat_lo, lat0_, rows_);
+    auto row_hi = cell_index(lat_hi, lat0_, rows_);
+
+    // Columns: the longitude span widens towards the poles; past a pole or
+    // half the globe every column qualifies.
+    double widest = std::max(std::abs(lat_lo), std::abs(lat_hi));
+    double dlon = widest < 90.0 ? dlat / std::cos(widest * DEG) : 360.0;
+    std::array<std::pair<std::size_t, std::size_t>, 3> spans{};
+    std::size_t span_count = 0;
+    if (dlon >= 180.0) {
+        spans[span_count++] = {0, cols_ - 1};
+    } else {
+        // The same range shifted by a full turn catches the antimeridian.
+        for (double shift : {-360.0, 0.0, 360.0}) {
+            double lon_lo = lon + shift - dlon;
+            double lon_hi = lon + shift + dlon;
+            if (lon_hi < lon0_ ||
+                lon_lo >= lon0_ + static_cast<double>(cols_) * CELL_DEG) {
+                continue;
+            }
+            spans[span_count++] = {cell_index(lon_lo, lon0_, cols_),
+                                   cell_index(lon_hi, lon0_, cols_)};
+        }
+    }
+
+    for (auto row = row_lo; row <= row_hi; row++) {
+        for (std::size_t span = 0; span < span_count; span++) {
+            auto [col_lo, col_hi] = spans[span];
+            scan(cell_start_[row * cols_ + col_lo],
+                 cell_start_[row * cols_ + col_hi + 1], query_x, query_y,
+                 query_z, limit, hits);
+        }
+    }
+    std::ranges::sort(hits, {}, &RegionHit::km);
+}
+
+void RegionIndex::nearest(double lat, double lon, std::size_t k,
+                          std::vector<RegionHit> &hits) const {
+    // Grow the radius until it holds k regions (or the whole globe).
+    double km = 100.0;
+    while (true) {
+        within_radius(lat, lon, km, hits);
+        if (hits.size() >= k || km >= HALF_CIRCUMFERENCE_KM) {
+            break;
+        }
+        km *= 2.0;
+    }
+    hits.resize(std::min(k, hits.size()));
+}
+
+auto haversine_km(double lat1, double lon1, double lat2, double lon2)
+    -> double {
+    double dlat = std::sin((lat2 - lat1) * DEG / 2.0);
+    double dlon = std::sin((lon2 - lon1) * DEG / 2.0);
+    double a = dlat * dlat +
+               std::cos(lat1 * DEG) * std::cos(lat2 * DEG) * dlon * dlon;
+    return 2.0 * RegionIndex::EARTH_RADIUS_KM *
+           std::asin(std::min(1.0, std::sqrt(a)));
+}
+
+auto region_index() -> const RegionIndex & {
+    static const RegionIndex index;
+    return index;
+}
@@ -0,0 +1,55 @@
+#pragma once
+#include "region.h"
+#include <array>
+#include <cstdint>
+#include <vector>
+
+struct RegionHit {
+    const Region *region;
+    double km;
+};
+
+// Static spatial index over the region centroids (placeholders at 0,0 are
+// left out). Centroids are bucketed on a 1-degree lat/lon grid and stored
+// as unit vectors in structure-of-arrays form, cell by cell, so a query
+// runs one branch-free chord-distance loop per grid row that the compiler
+// vectorises.
+class RegionIndex {
+public:
+    static constexpr double EARTH_RADIUS_KM = 6371.0;
+    static constexpr double CELL_DEG = 1.0;
+
+    RegionIndex();
+
+    // Every region within `km` of (lat, lon), nearest first.
+    void within_radius(double lat, double lon, double km,
+                       std::vector<RegionHit> &hits) const;
+    // The `k` nearest regions, nearest first.
+    void nearest(double lat, double lon, std::size_t k,
+                 std::vector<RegionHit> &hits) const;
+
+    [[nodiscard]] auto size() const -> std::size_t { return region_.size(); }
+
+private:
+    double lat0_ = 0.0;
+    double lon0_ = 0.0;
+    std::size_t rows_ = 0;
+    std::size_t cols_ = 0;
+    // cell_start_[c] .. cell_start_[c + 1] are the points of cell c.
+    std::vector<uint32_t> cell_start_;
+    std::vector<double> x_;
+    std::vector<double> y_;
+    std::vector<double> z_;
+    std::vector<uint16_t> region_;
+
+    void scan(std::size_t first, std::size_t last, double query_x,
+              double query_y, double query_z, double limit,
+              std::vector<RegionHit> &hits) const;
+};
+
+// Great-circle distance, for callers without an index.
+auto haversine_km(double lat1, double lon1, double lat2, double lon2)
+    -> double;
+
+// Built on first use; queries are safe from any thread.
+auto region_index() -> const RegionIndex &;
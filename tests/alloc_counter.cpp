@@ -0,0 +1,68 @@
+#include "alloc_counter.h"
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+// operator new below is malloc-backed, so free() is the matching release.
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+namespace {
+thread_local bool counting = false;
+std::atomic<uint64_t> allocations{0};
+} // namespace
+
+void count_allocations(bool enabled) { counting = enabled; }
+
+auto counted_allocations() -> uint64_t { return allocations.load(); }
+
+void reset_allocations() { allocations.store(0); }
+
+// Every plain form is replaced so no pointer from a sanitizer's new reaches
+// free().
+auto operator new(std::size_t size, const std::nothrow_t & /*tag*/) noexcept
+    -> void * {
+    if (counting) {
+        allocations.fetch_add(1, std::memory_order_relaxed);
+    }
+    return std::malloc(size == 0 ? 1 : size);
+}
+auto operator new(std::size_t size) -> void * {
+    if (void *pointer = operator new(size, std::nothrow)) {
+        return pointer;
+    }
+    throw std::bad_alloc();
+}
+auto operator new[](std::size_t size) -> void * { return operator new(size); }
+auto operator new[](std::size_t size, const std::nothrow_t &tag) noexcept
+    -> void * {
+    return operator new(size, tag);
+}
+void operator delete(void *pointer) noexcept { std::free(pointer); }
+void operator delete(void *pointer, std::size_t /*size*/) noexcept {
+    std::free(pointer);
+}
+void operator delete(void *pointer, const std::nothrow_t & /*tag*/) noexcept {
+    std::free(pointer);
+}
+void operator delete[](void *pointer) noexcept { std::free(pointer); }
+void operator delete[](void *pointer, std::size_t /*size*/) noexcept {
+    std::free(pointer);
+}
+void operator delete[](void *pointer, const std::nothrow_t & /*tag*/) noexcept {
+    std::free(pointer);
+}
+
+#if defined(__GLIBC__)
+// Asio's recycling allocator calls aligned_alloc directly where the C
+// library has it, bypassing operator new; count those too.
+extern "C" auto aligned_alloc(std::size_t alignment, std::size_t size) noexcept
+    -> void * {
+    if (counting) {
+        allocations.fetch_add(1, std::memory_order_relaxed);
+    }
+    void *pointer = nullptr;
+    return posix_memalign(&pointer, alignment, size) == 0 ? pointer : nullptr;
+}
+#endif
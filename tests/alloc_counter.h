@@ -0,0 +1,8 @@
+#pragma once
+#include <cstdint>
+
+// Counts heap allocations made on threads that opted in; every test in the
+// binary shares the replaced operator new in alloc_counter.cpp.
+void count_allocations(bool enabled); // calling thread only
+auto counted_allocations() -> uint64_t;
+void reset_allocations();
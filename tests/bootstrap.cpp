@@ -0,0 +1,156 @@
+#include "../src/comms/bootstrap.h"
+#include "asio.hpp"
+#include <catch2/catch_test_macros.hpp>
+#include <future>
+
+namespace {
+// Stand-in EPSP server that greets every connection with 211 after `delay`.
+class DelayedServer {
+public:
+    explicit DelayedServer(std::chrono::milliseconds delay)
+        : acceptor_(io_context_,
+                    asio::ip::tcp::endpoint(
+                        asio::ip::make_address("127.0.0.1"), 0)),
+          delay_(delay) {
+        thread_ = std::thread([this] -> void {
+            while (true) {
+                asio::ip::tcp::socket socket(io_context_);
+                asio::error_code ecode;
+                acceptor_.accept(socket, ecode);
+                if (ecode || stopping_) {
+                    return;
+                }
+                std::this_thread::sleep_for(delay_);
+                asio::write(socket, asio::buffer("211 1\r\n", 7), ecode);
+                sockets_.push_back(std::move(socket));
+            }
+        });
+    }
+
+    ~DelayedServer() {
+        // A blocking accept() is not woken by close(); connect to release it.
+        stopping_ = true;
+        asio::ip::tcp::socket wake(io_context_);
+        asio::error_code ecode;
+        wake.connect(acceptor_.local_endpoint(), ecode);
+        thread_.join();
+    }
+    DelayedServer(const DelayedServer &) = delete;
+    auto operator=(const DelayedServer &) -> DelayedServer & = delete;
+
+    auto address() -> ServerAddress {
+        return {.host = "127.0.0.1",
+                .service = std::to_string(acceptor_.local_endpoint().port())};
+    }
+
+private:
+    asio::io_context io_context_;
+    asio::ip::tcp::acceptor acceptor_;
+    std::chrono::milliseconds delay_;
+    std::vector<asio::ip::tcp::socket> sockets_;
+    std::atomic<bool> stopping_{false};
+    std::thread thread_;
+};
+
+auto run_bootstrap(BootstrapOptions options) -> BootstrapResult {
+    asio::io_context io_context;
+    std::promise<BootstrapResult> done;
+    auto bootstrap = ServerBootstrap::create(io_context, std::move(options));
+    bootstrap->start(
+        [&done](BootstrapResult result, asio::ip::tcp::socket) -> void {
+            done.set_value(std::move(result));
+        });
+    io_context.run_for(std::chrono::seconds(5));
+    return done.get_future().get();
+}
+} // namespace
+
+TEST_CASE("Race servers and cache the fastest", "[connection][bootstrap]") {
+    DelayedServer slow(std::chrono::milliseconds(600));
+    DelayedServer fast(std::chrono::milliseconds(50));
+    DelayedServer medium(std::chrono::milliseconds(300));
+
+    auto cache_path =
+        std::filesystem::temp_directory_path() / "epsp_bootstrap_test.txt";
+    std::filesystem::remove(cache_path);
+
+    // All three are 127.0.0.1, so the cache tells them apart by port. Once
+    // it holds that host, the second run resolves none of them.
+    auto slow_address = slow.address();
+    auto fast_address = fast.address();
+    auto medium_address = medium.address();
+    BootstrapOptions options{
+        .servers = {slow_address, fast_address, medium_address},
+        .cache_path = cache_path,
+        .stagger = std::chrono::milliseconds(10),
+        .attempt_timeout = std::chrono::milliseconds(2000)};
+
+    auto result = run_bootstrap(options);
+    REQUIRE_FALSE(result.error);
+    REQUIRE(std::to_string(result.server.endpoint.port()) ==
+            fast_address.service);
+    REQUIRE(result.received.starts_with("211"));
+
+    auto cached = load_server_cache(cache_path);
+    REQUIRE_FALSE(cached.empty());
+    REQUIRE(cached.front().endpoint == result.server.endpoint);
+    REQUIRE(cached.front().rtt >= std::chrono::milliseconds(50));
+
+    // Second start: cache hit, the fastest server is tried first without DNS.
+    options.stagger = std::chrono::milliseconds(1000);
+    auto second = run_bootstrap(options);
+    REQUIRE_FALSE(second.error);
+    REQUIRE(second.server.endpoint == result.server.endpoint);
+
+    std::filesystem::remove(cache_path);
+}
+
+TEST_CASE("Fail when no server answers", "[connection][bootstrap]") {
+    asio::io_context io_context;
+    asio::ip::tcp::acceptor closed(
+        io_context,
+        asio::ip::tcp::endpoint(asio::ip::make_address("127.0.0.1"), 0));
+    auto port = closed.local_endpoint().port();
+    closed.close();
+
+    auto result = run_bootstrap(
+        {.servers = {{.host = "127.0.0.1", .service = std::to_string(port)}},
+         .stagger = std::chrono::milliseconds(10),
+         .attempt_timeout = std::chrono::milliseconds(500)});
+    REQUIRE(result.error);
+}
+
+TEST_CASE("Launch resolved servers behind a hanging cached one",
+          "[connection][bootstrap]") {
+    DelayedServer hanging(std::chrono::milliseconds(2000));
+    DelayedServer fresh(std::chrono::milliseconds(0));
+
+    auto cache_path = std::filesystem::temp_directory_path() /
+                      "epsp_bootstrap_hanging_test.txt";
+    auto hanging_address = hanging.address();
+    save_server_cache(
+        cache_path,
+        {{.host = hanging_address.host,
+          .endpoint = asio::ip::tcp::endpoint(
+              asio::ip::make_address(hanging_address.host),
+              static_cast<uint16_t>(std::stoi(hanging_address.service))),
+          .rtt = std::chrono::microseconds(1)}});
+
+    // The stagger fires before DNS answers for localhost; its results must
+    // still start right away rather than wait out the cached attempt.
+    auto fresh_address = fresh.address();
+    fresh_address.host = "localhost";
+    auto started = std::chrono::steady_clock::now();
+    auto result =
+        run_bootstrap({.servers = {hanging_address, fresh_address},
+                       .cache_path = cache_path,
+                       .stagger = std::chrono::milliseconds(0),
+                       .attempt_timeout = std::chrono::milliseconds(4000)});
+    REQUIRE_FALSE(result.error);
+    REQUIRE(std::to_string(result.server.endpoint.port()) ==
+            fresh_address.service);
+    REQUIRE(std::chrono::steady_clock::now() - started <
+            std::chrono::milliseconds(1000));
+
+    std::filesystem::remove(cache_path);
+}
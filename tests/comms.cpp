@@ -2,6 +2,7 @@
 #include "../src/comms/peer.h"
 #include "asio.hpp"
 #include <catch2/catch_test_macros.hpp>
+#include <future>
 #include <mutex>
 
 TEST_CASE("Connection works", "[connection][network]") {
@@ -64,3 +65,103 @@ TEST_CASE("Connection works", "[connection][network]") {
         client_thread.join();
     }
 }
+
+TEST_CASE("Connect to 235 peers in parallel", "[connection][network]") {
+    using asio::ip::tcp;
+    asio::io_context listen_context;
+    auto loopback = asio::ip::make_address("127.0.0.1");
+
+    // Accepting peer: the kernel completes the handshake on listen().
+    tcp::acceptor accepting(listen_context, tcp::endpoint(loopback, 0));
+
+    // Refusing peer: a port that was bound and then released.
+    tcp::acceptor closed(listen_context, tcp::endpoint(loopback, 0));
+    auto refused_endpoint = closed.local_endpoint();
+    closed.close();
+
+    // Blackholed peer: a zero backlog filled by one connection drops SYNs.
+    tcp::acceptor blackhole(listen_context);
+    blackhole.open(tcp::v4());
+    blackhole.bind(tcp::endpoint(loopback, 0));
+    blackhole.listen(0);
+    tcp::socket filler(listen_context);
+    filler.connect(blackhole.local_endpoint());
+
+    auto peer = init_peer_connection();
+    auto work = asio::make_work_guard(*peer.io_context);
+    std::thread peer_thread([&peer] -> void { peer.io_context->run(); });
+
+    std::promise<std::vector<PeerConnectResult>> done;
+    auto started = std::chrono::steady_clock::now();
+    peer.connection_peer->connect_all(
+        {{.peer_id = 1, .endpoint = accepting.local_endpoint()},
+         {.peer_id = 2, .endpoint = refused_endpoint},
+         {.peer_id = 3, .endpoint = blackhole.local_endpoint()}},
+        PeerConnectOptions{.attempt_timeout = std::chrono::milliseconds(300),
+                           .budget = std::chrono::milliseconds(2000)},
+        [&done](const std::vector<PeerConnectResult> &results) -> void {
+            done.set_value(results);
+        });
+
+    auto future = done.get_future();
+    REQUIRE(future.wait_for(std::chrono::seconds(5)) ==
+            std::future_status::ready);
+    auto elapsed = std::chrono::steady_clock::now() - started;
+    auto results = future.get();
+
+    peer.connection_peer->stop_all();
+    work.reset();
+    peer.io_context->stop();
+    peer_thread.join();
+
+    REQUIRE(results.size() == 3);
+    REQUIRE(results[0].connected);
+    REQUIRE_FALSE(results[1].connected);
+    REQUIRE(results[1].completed);
+    REQUIRE_FALSE(results[2].connected);
+    REQUIRE(results[2].completed);
+    REQUIRE(results[2].latency >= std::chrono::milliseconds(300));
+    // The blackholed attempt is bounded by its own deadline, not the budget.
+    REQUIRE(elapsed < std::chrono::milliseconds(1500));
+}
+
+TEST_CASE("Close a server that stalls the handshake", "[connection][network]") {
+    using asio::ip::tcp;
+    asio::io_context io_context;
+    tcp::acceptor acceptor(
+        io_context, tcp::endpoint(asio::ip::make_address("127.0.0.1"), 0));
+    reset_peer_id();
+
+    auto server = ConnectionServer::create(io_context, nullptr);
+    server->set_handshake_timeout(std::chrono::milliseconds(200));
+    server->socket().connect(acceptor.local_endpoint());
+    tcp::socket remote(io_context);
+    acceptor.accept(remote);
+    asio::post(server->strand(), [server] -> void { server->start(); });
+    std::thread client_thread([&io_context] -> void { io_context.run(); });
+
+    asio::streambuf buffer;
+    std::istream input(&buffer);
+    std::string line;
+    auto exchange = [&](std::string_view message) -> void {
+        asio::write(remote, asio::buffer(message));
+        asio::read_until(remote, buffer, '\n');
+        std::getline(input, line);
+    };
+    // Two server lines in separate writes, each answered in turn.
+    exchange("211 1\r\n");
+    REQUIRE(line.starts_with("131"));
+    exchange("212 1 0.35:P2PDemo:0.0\r\n");
+    REQUIRE(line.starts_with("113"));
+
+    // Then nothing: the client gives up after the handshake timeout.
+    auto stalled = std::chrono::steady_clock::now();
+    asio::error_code ecode;
+    asio::read(remote, buffer, ecode);
+    auto waited = std::chrono::steady_clock::now() - stalled;
+    client_thread.join();
+
+    REQUIRE(ecode == asio::error::eof);
+    REQUIRE(waited >= std::chrono::milliseconds(150));
+    REQUIRE(waited < std::chrono::seconds(2));
+}
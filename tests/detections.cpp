@@ -0,0 +1,220 @@
+#include "../src/comms/detections.h"
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include <random>
+
+namespace {
+using std::chrono::milliseconds;
+using std::chrono::seconds;
+const auto start =
+    DetectionAggregator::clock::time_point{} + std::chrono::hours(1);
+
+auto find_area(const DetectionSnapshot &snapshot, const Region *region)
+    -> const RegionDetections * {
+    for (const auto &area : snapshot.regions) {
+        if (area.region == region) {
+            return &area;
+        }
+    }
+    return nullptr;
+}
+} // namespace
+
+TEST_CASE("Read the area code from a 555 payload", "[comms][detections]") {
+    REQUIRE(detection_area("sig:2026/01/01 00-00-00:key:ksig:kexp:250") ==
+            find_region(250));
+    REQUIRE(detection_area("2026/01/01 00-00-00,355") == find_region(355));
+    REQUIRE(detection_area("355") == find_region(355));
+    REQUIRE(detection_area("sig:abc") == nullptr);
+    REQUIRE(detection_area("") == nullptr);
+}
+
+TEST_CASE("Read the region peer counts from a 247 payload",
+          "[comms][detections]") {
+    std::vector<RegionPeers> peers;
+    REQUIRE(parse_region_peers("250,40;355,3;999,7", peers));
+    // 999 is no region.
+    REQUIRE(peers.size() == 2);
+    REQUIRE(peers[0].region == find_region(250));
+    REQUIRE(peers[0].peers == 40);
+    REQUIRE(peers[1].region == find_region(355));
+    REQUIRE(peers[1].peers == 3);
+
+    REQUIRE(parse_region_peers("", peers));
+    REQUIRE(peers.empty());
+    REQUIRE_FALSE(parse_region_peers("250", peers));
+    REQUIRE_FALSE(parse_region_peers("250,x", peers));
+}
+
+TEST_CASE("Slide the windows and swap snapshots", "[comms][detections]") {
+    DetectionAggregator aggregator;
+    const auto &tokyo = *find_region(250);
+    REQUIRE(aggregator.latest().regions.empty());
+
+    aggregator.record(tokyo, start);
+    aggregator.record(tokyo, start + milliseconds(500));
+    std::array peers = {RegionPeers{.region = &tokyo, .peers = 40}};
+    aggregator.set_active_peers(peers);
+    // Unpublished records are not visible yet.
+    REQUIRE(aggregator.latest().regions.empty());
+
+    aggregator.publish(start + seconds(1));
+    const auto *area = find_area(aggregator.latest(), &tokyo);
+    REQUIRE(area != nullptr);
+    REQUIRE(area->counts == std::array<uint32_t, 3>{2, 2, 2});
+    REQUIRE(area->peers == 40);
+
+    aggregator.publish(start + seconds(10));
+    area = find_area(aggregator.latest(), &tokyo);
+    REQUIRE(area->counts == std::array<uint32_t, 3>{0, 2, 2});
+
+    aggregator.publish(start + seconds(300));
+    REQUIRE(aggregator.latest().regions.empty());
+    REQUIRE(aggregator.latest().total == 2);
+
+    // Back after a long gap: the old buckets must not leak in.
+    aggregator.record(tokyo, start + seconds(1000));
+    aggregator.publish(start + seconds(1000));
+    area = find_area(aggregator.latest(), &tokyo);
+    REQUIRE(area->counts == std::array<uint32_t, 3>{1, 1, 1});
+}
+
+TEST_CASE("Slide the windows from the clock's epoch", "[comms][detections]") {
+    // steady_clock counts from boot on Linux, so the windows can reach
+    // back before zero during the first five minutes.
+    DetectionAggregator aggregator;
+    const auto &tokyo = *find_region(250);
+    const auto epoch = DetectionAggregator::clock::time_point{};
+    aggregator.record(tokyo, epoch + seconds(2));
+
+    bool matched = true;
+    for (int64_t now = 2; now <= 400; now++) {
+        aggregator.publish(epoch + seconds(now));
+        std::array<uint32_t, 3> expected{};
+        for (std::size_t w = 0; w < DETECTION_WINDOWS.size(); w++) {
+            expected[w] = now - DETECTION_WINDOWS[w].count() < 2 ? 1 : 0;
+        }
+        const auto *area = find_area(aggregator.latest(), &tokyo);
+        auto counts =
+            area != nullptr ? area->counts : std::array<uint32_t, 3>{};
+        matched &= counts == expected;
+    }
+    REQUIRE(matched);
+}
+
+TEST_CASE("Wake only when the counts change", "[comms][detections]") {
+    DetectionAggregator aggregator;
+    int wakes = 0;
+    aggregator.set_wake([&wakes] -> void { wakes++; });
+    const auto &tokyo = *find_region(250);
+
+    aggregator.publish(start);
+    REQUIRE(wakes == 0);
+    aggregator.record(tokyo, start);
+    aggregator.publish(start + milliseconds(500));
+    REQUIRE(wakes == 1);
+    // Same counts until the report leaves the 10 s window.
+    aggregator.publish(start + seconds(5));
+    REQUIRE(wakes == 1);
+    aggregator.publish(start + seconds(10));
+    REQUIRE(wakes == 2);
+    aggregator.publish(start + seconds(300));
+    REQUIRE(wakes == 3);
+    aggregator.publish(start + seconds(400));
+    REQUIRE(wakes == 3);
+}
+
+TEST_CASE("Replay a burst of 100k reports", "[comms][detections]") {
+    // 100k reports over 400 s: a quake felt in a few neighbouring areas
+    // around t = 100 s on top of background noise everywhere else.
+    constexpr int reports = 100'000;
+    std::mt19937 random(555);
+    std::uniform_int_distribution<std::size_t> any_region(0,
+                                                          regions.size() - 1);
+    std::exponential_distribution<double> burst_delay(1.0 / 20.0);
+    std::uniform_real_distribution<double> noise_time(0.0, 400.0);
+    std::array<const Region *, 4> felt = {find_region(200), find_region(205),
+                                          find_region(250), find_region(241)};
+
+    std::vector<std::pair<milliseconds, const Region *>> replay;
+    for (int i = 0; i < reports; i++) {
+        bool in_burst = i % 10 != 0;
+        double at = in_burst ? 100.0 + burst_delay(random) : noise_time(random);
+        const Region *region = in_burst ? felt.at(static_cast<std::size_t>(i) %
+                                                  felt.size())
+                                        : &regions[any_region(random)];
+        replay.emplace_back(milliseconds(static_cast<int64_t>(at * 1000.0)),
+                            region);
+    }
+    std::ranges::sort(replay, {}, &decltype(replay)::value_type::first);
+
+    // Publishes at `now` and compares the felt areas with a recount of the
+    // replay.
+    DetectionAggregator aggregator;
+    auto next_publish = milliseconds(250);
+    bool matched = true;
+    auto check = [&aggregator, &replay, &felt, &matched](milliseconds now)
+        -> void {
+        aggregator.publish(start + now);
+        const auto &snapshot = aggregator.latest();
+        auto now_second = std::chrono::floor<seconds>(now);
+        for (const auto *region : felt) {
+            std::array<uint32_t, 3> expected{};
+            for (const auto &[at, from] : replay) {
+                auto second = std::chrono::floor<seconds>(at);
+                if (at >= now) {
+                    break;
+                }
+                for (std::size_t w = 0; w < DETECTION_WINDOWS.size(); w++) {
+                    if (from == region &&
+                        second > now_second - DETECTION_WINDOWS[w]) {
+                        expected[w]++;
+                    }
+                }
+            }
+            const auto *area = find_area(snapshot, region);
+            auto counts = area != nullptr ? area->counts
+                                          : std::array<uint32_t, 3>{};
+            matched &= counts == expected;
+        }
+    };
+
+    std::size_t checks = 0;
+    for (const auto &[at, region] : replay) {
+        while (at >= next_publish) {
+            // A full recount is slow; compare every 5 s of replay.
+            if (next_publish % milliseconds(5000) == milliseconds(0)) {
+                check(next_publish);
+                checks++;
+            } else {
+                aggregator.publish(start + next_publish);
+            }
+            next_publish += milliseconds(250);
+        }
+        aggregator.record(*region, start + at);
+    }
+    check(next_publish);
+
+    REQUIRE(checks > 50);
+    REQUIRE(matched);
+    REQUIRE(aggregator.latest().total == reports);
+}
+
+TEST_CASE("Benchmark detection aggregation",
+          "[!benchmark][comms][detections]") {
+    DetectionAggregator aggregator;
+    const auto &tokyo = *find_region(250);
+    auto now = start;
+
+    BENCHMARK("record 100k reports") {
+        for (int i = 0; i < 100'000; i++) {
+            aggregator.record(tokyo, now);
+            now += std::chrono::microseconds(100);
+        }
+        return now;
+    };
+    BENCHMARK("publish a snapshot") {
+        aggregator.publish(now);
+        return aggregator.latest().regions.size();
+    };
+}
@@ -0,0 +1,149 @@
+#include "../src/comms/event_channel.h"
+#include "../src/comms/mpsc_ring.h"
+#include "alloc_counter.h"
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include <thread>
+
+TEST_CASE("Pop in push order until empty", "[comms][event_channel]") {
+    MpscRing<int> ring(4);
+    REQUIRE(ring.capacity() == 4);
+    for (int i = 0; i < 4; i++) {
+        REQUIRE(ring.try_push(int{i}));
+    }
+    REQUIRE_FALSE(ring.try_push(4));
+
+    for (int i = 0; i < 4; i++) {
+        REQUIRE(ring.try_pop() == i);
+    }
+    REQUIRE_FALSE(ring.try_pop().has_value());
+
+    // Wraps around the same cells.
+    REQUIRE(ring.try_push(5));
+    REQUIRE(ring.try_pop() == 5);
+}
+
+TEST_CASE("Keep each producer's order under contention",
+          "[comms][event_channel]") {
+    constexpr int producers = 4;
+    constexpr int per_producer = 100'000;
+    MpscRing<std::pair<int, int>> ring(256);
+
+    std::vector<std::thread> threads;
+    for (int id = 0; id < producers; id++) {
+        threads.emplace_back([&ring, id] -> void {
+            for (int seq = 0; seq < per_producer; seq++) {
+                while (!ring.try_push({id, seq})) {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+
+    std::vector<int> next(producers, 0);
+    int popped = 0;
+    bool ordered = true;
+    while (popped < producers * per_producer) {
+        auto item = ring.try_pop();
+        if (!item) {
+            std::this_thread::yield();
+            continue;
+        }
+        auto [id, seq] = *item;
+        ordered &= seq == next[id];
+        next[id] = seq + 1;
+        popped++;
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+
+    REQUIRE(ordered);
+    REQUIRE_FALSE(ring.try_pop().has_value());
+}
+
+TEST_CASE("Count overflow and wake once per drain", "[comms][event_channel]") {
+    EventChannel channel(8);
+    int wakes = 0;
+    channel.set_wake([&wakes] -> void { wakes++; });
+
+    for (int i = 0; i < 10; i++) {
+        channel.publish({.kind = epsp_event_kind_t::EVENT_EQK_INFO,
+                         .payload = std::to_string(i)});
+    }
+    REQUIRE(wakes == 1);
+    REQUIRE(channel.stats().published == 8);
+    REQUIRE(channel.stats().dropped == 2);
+
+    std::vector<NetEvent> batch;
+    REQUIRE(channel.drain(batch) == 8);
+    REQUIRE(batch.front().payload == "0");
+    REQUIRE(batch.back().payload == "7");
+
+    // Drained: the next event wakes the render thread again.
+    channel.publish({.kind = epsp_event_kind_t::EVENT_TSU_INFO});
+    REQUIRE(wakes == 2);
+    REQUIRE(channel.stats().wakes == 2);
+}
+
+TEST_CASE("Discard events without a consumer", "[comms][event_channel]") {
+    EventChannel channel(8);
+    int wakes = 0;
+    channel.set_wake([&wakes] -> void { wakes++; });
+    channel.set_consumer(false);
+
+    for (int i = 0; i < 10; i++) {
+        REQUIRE_FALSE(
+            channel.publish({.kind = epsp_event_kind_t::EVENT_EQK_INFO}));
+    }
+    REQUIRE(wakes == 0);
+    REQUIRE(channel.stats().published == 0);
+    REQUIRE(channel.stats().dropped == 0);
+    std::vector<NetEvent> batch;
+    REQUIRE(channel.drain(batch) == 0);
+}
+
+TEST_CASE("Publish payloads into reused cell buffers",
+          "[comms][event_channel]") {
+    EventChannel channel(4);
+    const std::string payload(200, 'x');
+    std::vector<NetEvent> batch;
+    batch.reserve(8);
+
+    auto round = [&] -> uint64_t {
+        reset_allocations();
+        count_allocations(true);
+        for (int i = 0; i < 4; i++) {
+            channel.publish(epsp_event_kind_t::EVENT_EQK_INFO, {}, payload);
+        }
+        count_allocations(false);
+        channel.drain(batch);
+        return counted_allocations();
+    };
+
+    REQUIRE(round() == 4); // first use sizes each cell
+    REQUIRE(round() == 0);
+    REQUIRE(batch.size() == 8);
+    REQUIRE(batch.back().payload == payload);
+}
+
+TEST_CASE("Map relay codes to event kinds", "[comms][event_channel]") {
+    REQUIRE(relay_event_kind(551) == epsp_event_kind_t::EVENT_EQK_INFO);
+    REQUIRE(relay_event_kind(555) == epsp_event_kind_t::EVENT_EQK_DTCT);
+    REQUIRE_FALSE(relay_event_kind(611).has_value());
+}
+
+TEST_CASE("Benchmark event channel", "[!benchmark][comms][event_channel]") {
+    EventChannel channel(EventChannel::CAPACITY);
+    std::vector<NetEvent> batch;
+    batch.reserve(EventChannel::CAPACITY);
+
+    // One frame's worth: a full ring published, then drained in one go.
+    BENCHMARK("publish and drain 1024 events") {
+        for (std::size_t i = 0; i < EventChannel::CAPACITY; i++) {
+            channel.publish({.kind = epsp_event_kind_t::EVENT_EQK_DTCT});
+        }
+        batch.clear();
+        return channel.drain(batch);
+    };
+}
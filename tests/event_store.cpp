@@ -0,0 +1,259 @@
+#include "../src/gui/event_store.h"
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+namespace {
+using namespace std::chrono_literals;
+
+const auto START = std::chrono::system_clock::time_point(1'700'000'000s);
+
+constexpr std::string_view NARA_QUAKE =
+    "17日08時05分,4,0,4,奈良県,10km,4.8,0,N34.4,E135.9,気象庁:"
+    "-奈良県,+4,*奈良市,+3,*五條市";
+constexpr std::string_view STRONG_QUAKE =
+    "01日16時10分,6+,0,4,石川能登,10km,7.6,0,N37.5,E137.3,気象庁:"
+    "-石川県,+6+,*輪島市";
+
+auto kind_bit(epsp_event_kind_t kind) -> uint8_t {
+    return static_cast<uint8_t>(1U << static_cast<unsigned>(kind));
+}
+
+auto ids(const HistoryView &view) -> std::vector<uint32_t> {
+    return view.rows;
+}
+
+// A day of traffic: mostly 555s from every located region, a 551 in
+// every hundred events, now and then a 552 or a 556.
+void fill(EventStore &store, std::size_t count) {
+    std::vector<std::string_view> codes;
+    for (const auto &region : regions) {
+        if (region.lat != 0.0 || region.lon != 0.0) {
+            codes.push_back(region.code);
+        }
+    }
+    uint32_t seed = 12345;
+    for (std::size_t i = 0; i < count; i++) {
+        seed = seed * 1664525 + 1013904223;
+        NetEvent event{.kind = epsp_event_kind_t::EVENT_EQK_DTCT,
+                       .received = START + std::chrono::seconds(i),
+                       .payload = "2024/01/01 16:10:00,"};
+        if (i % 100 == 0) {
+            event.kind = epsp_event_kind_t::EVENT_EQK_INFO;
+            event.payload = seed % 8 == 0 ? STRONG_QUAKE : NARA_QUAKE;
+        } else if (i % 97 == 0) {
+            event.kind = epsp_event_kind_t::EVENT_TSU_INFO;
+            event.payload = "解除";
+        } else if (i % 31 == 0) {
+            event.kind = epsp_event_kind_t::EVENT_PEER_CPR;
+            event.payload = "ok";
+        } else {
+            event.payload += codes[seed % codes.size()];
+        }
+        store.add(std::move(event));
+    }
+    store.flush();
+}
+} // namespace
+
+TEST_CASE("Index events by what the history filters on", "[history]") {
+    auto detection = store_event({.kind = epsp_event_kind_t::EVENT_EQK_DTCT,
+                                  .received = START,
+                                  .payload = "2024/01/01 16:10:00,010"});
+    REQUIRE(detection.region == find_area("010"));
+    REQUIRE(regions[detection.region].area == "北海道 石狩");
+    REQUIRE(detection.shindo == 0);
+
+    auto quake = store_event({.kind = epsp_event_kind_t::EVENT_EQK_INFO,
+                              .received = START,
+                              .payload = std::string(NARA_QUAKE)});
+    REQUIRE(quake.max_intensity == 4.0F);
+    REQUIRE(shindo_name(quake.shindo) == "4");
+    // No region is named 奈良県; the nearest to the epicentre is in Nara.
+    REQUIRE(quake.region != StoredEvent::NO_REGION);
+    REQUIRE(regions[quake.region].pref == "奈良");
+    auto strong = store_event({.kind = epsp_event_kind_t::EVENT_EQK_INFO,
+                               .received = START,
+                               .payload = std::string(STRONG_QUAKE)});
+    REQUIRE(shindo_name(strong.shindo) == "6+");
+    REQUIRE(strong.region == find_area("石川能登"));
+
+    REQUIRE(find_area("no such place") == StoredEvent::NO_REGION);
+    REQUIRE(shindo_class(0.2F) == 0);
+    REQUIRE(shindo_class(*parse_shindo("5-")) == 5);
+    REQUIRE(shindo_class(*parse_shindo("7")) == 9);
+    REQUIRE(format_history_row(strong).ends_with("  Earthquake 6+ " +
+                                                 std::string(STRONG_QUAKE)));
+}
+
+TEST_CASE("Filter and sort the history", "[history]") {
+    EventStore store;
+    fill(store, 1000);
+    REQUIRE(store.size() == 1000);
+    REQUIRE(store.pending() == 0);
+
+    auto all = store.query({});
+    REQUIRE(all.rows.size() == 1000);
+    REQUIRE(all.rows.front() == 999);
+    REQUIRE(all.rows.back() == 0);
+    HistoryFilter oldest{.sort = history_sort_t::SORT_OLDEST};
+    REQUIRE(store.query(oldest).rows.front() == 0);
+
+    // Every filter agrees with a plain scan of the events.
+    auto scan = [&store](auto &&keep) -> std::vector<uint32_t> {
+        std::vector<uint32_t> rows;
+        for (auto id = static_cast<uint32_t>(store.size()); id-- > 0;) {
+            if (keep(store.at(id))) {
+                rows.push_back(id);
+            }
+        }
+        return rows;
+    };
+    HistoryFilter quakes{.kinds = kind_bit(epsp_event_kind_t::EVENT_EQK_INFO)};
+    REQUIRE(ids(store.query(quakes)).size() == 10);
+    quakes.kinds |= kind_bit(epsp_event_kind_t::EVENT_TSU_INFO);
+    REQUIRE(ids(store.query(quakes)) ==
+            scan([](const StoredEvent &event) -> bool {
+                return event.kind == epsp_event_kind_t::EVENT_EQK_INFO ||
+                       event.kind == epsp_event_kind_t::EVENT_TSU_INFO;
+            }));
+
+    auto ishikari = find_area("北海道 石狩");
+    REQUIRE(ids(store.query({.region = ishikari})) ==
+            scan([ishikari](const StoredEvent &event) -> bool {
+                return event.region == ishikari;
+            }));
+
+    HistoryFilter strong{.min_shindo = 7};
+    auto strong_rows = ids(store.query(strong));
+    REQUIRE_FALSE(strong_rows.empty());
+    REQUIRE(strong_rows == scan([](const StoredEvent &event) -> bool {
+                return event.shindo >= 7;
+            }));
+
+    HistoryFilter recent{.since = START + 900s};
+    REQUIRE(store.query(recent).rows.size() == 100);
+    recent.kinds = kind_bit(epsp_event_kind_t::EVENT_EQK_DTCT);
+    REQUIRE(ids(store.query(recent)) ==
+            scan([](const StoredEvent &event) -> bool {
+                return event.received >= START + 900s &&
+                       event.kind == epsp_event_kind_t::EVENT_EQK_DTCT;
+            }));
+    REQUIRE(store.query({.kinds = 0}).rows.empty());
+
+    // Strongest first; the newest of equals first.
+    auto ranked = store.query({.sort = history_sort_t::SORT_STRONGEST}).rows;
+    REQUIRE(store.at(ranked[0]).shindo == 8);
+    REQUIRE(ranked[0] == strong_rows[0]);
+    REQUIRE(std::ranges::is_sorted(ranked, [&store](uint32_t a, uint32_t b) {
+        return store.at(a).max_intensity > store.at(b).max_intensity;
+    }));
+}
+
+TEST_CASE("Query on a worker while events arrive", "[history]") {
+    EventStore store;
+    HistoryQueries queries(store);
+    REQUIRE(queries.latest() == nullptr);
+    int wakes = 0;
+    std::mutex wake_mutex;
+    queries.set_wake([&] -> void {
+        std::lock_guard<std::mutex> lock(wake_mutex);
+        wakes++;
+    });
+
+    fill(store, 500);
+    HistoryFilter quakes{.kinds = kind_bit(epsp_event_kind_t::EVENT_EQK_INFO)};
+    queries.request(quakes);
+    queries.wait_idle();
+    auto view = queries.latest();
+    REQUIRE(view != nullptr);
+    REQUIRE(view->filter == quakes);
+    REQUIRE(view->events == 500);
+    REQUIRE(view->rows.size() == 5);
+
+    // Appends land between queries; the next view sees them.
+    store.add({.kind = epsp_event_kind_t::EVENT_EQK_INFO,
+               .received = START + 600s,
+               .payload = std::string(NARA_QUAKE)});
+    REQUIRE(store.flush() == 1);
+    queries.request(quakes);
+    queries.wait_idle();
+    REQUIRE(queries.latest()->rows.size() == 6);
+    REQUIRE(queries.latest()->rows.front() == 500);
+    // The old view is still whole for whoever holds it.
+    REQUIRE(view->rows.size() == 5);
+
+    // A burst of requests ends with the last one's view.
+    for (uint8_t shindo = 0; shindo < SHINDO_CLASSES; shindo++) {
+        queries.request({.min_shindo = shindo});
+    }
+    queries.wait_idle();
+    REQUIRE(queries.latest()->filter.min_shindo == SHINDO_CLASSES - 1);
+    std::lock_guard<std::mutex> lock(wake_mutex);
+    REQUIRE(wakes >= 3);
+}
+
+TEST_CASE("Format rows once while they stay in view", "[history]") {
+    EventStore store;
+    fill(store, 3000);
+    RowTextCache cache;
+    const auto &text = cache.text(store, 42);
+    REQUIRE(text == format_history_row(store.at(42)));
+    REQUIRE(cache.text(store, 42) == text);
+    REQUIRE(cache.stats().hits == 1);
+    REQUIRE(cache.stats().misses == 1);
+    // Another row in the same slot replaces it.
+    cache.text(store, 42 + RowTextCache::SLOTS);
+    cache.text(store, 42);
+    REQUIRE(cache.stats().misses == 3);
+}
+
+TEST_CASE("Benchmark the history", "[!benchmark][history]") {
+    constexpr std::size_t EVENTS = 100'000;
+    BENCHMARK("store 100k events") {
+        EventStore store;
+        fill(store, EVENTS);
+        return store.size();
+    };
+
+    EventStore store;
+    fill(store, EVENTS);
+    BENCHMARK("all, newest first") {
+        return store.query({}).rows.size();
+    };
+    BENCHMARK("one region") {
+        return store.query({.region = find_area("北海道 石狩")}).rows.size();
+    };
+    BENCHMARK("earthquakes of 5- and over") {
+        return store.query({.min_shindo = 5}).rows.size();
+    };
+    BENCHMARK("the last hour of detections") {
+        return store
+            .query({.kinds = kind_bit(epsp_event_kind_t::EVENT_EQK_DTCT),
+                    .since = START + std::chrono::seconds(EVENTS) - 1h})
+            .rows.size();
+    };
+    BENCHMARK("all, strongest first") {
+        return store.query({.sort = history_sort_t::SORT_STRONGEST})
+            .rows.size();
+    };
+
+    // What a frame costs: the 40 rows a scrolled panel shows.
+    auto rows = store.query({}).rows;
+    RowTextCache cache;
+    std::size_t scroll = 0;
+    BENCHMARK("format a freshly scrolled page") {
+        scroll = (scroll + 40) % (rows.size() - 40);
+        std::size_t bytes = 0;
+        for (std::size_t i = scroll; i < scroll + 40; i++) {
+            bytes += cache.text(store, rows[i]).size();
+        }
+        return bytes;
+    };
+    BENCHMARK("draw a page already formatted") {
+        std::size_t bytes = 0;
+        for (std::size_t i = 0; i < 40; i++) {
+            bytes += cache.text(store, rows[i]).size();
+        }
+        return bytes;
+    };
+}
@@ -0,0 +1,115 @@
+#include "../src/gui/frame_pacer.h"
+#include <catch2/catch_test_macros.hpp>
+
+namespace {
+using std::chrono::milliseconds;
+const auto start = FramePacer::clock::time_point{} + std::chrono::hours(1);
+
+// Waits like gui_loop: one frame per vsync while active; while idle, each
+// wait times out with nothing to show. Returns the time after `duration`.
+auto run_for(FramePacer &pacer, FramePacer::clock::time_point now,
+             milliseconds duration) -> FramePacer::clock::time_point {
+    auto end = now + duration;
+    while (now < end) {
+        auto timeout = pacer.wait_timeout(now);
+        now += timeout.count() > 0
+                   ? std::chrono::duration_cast<milliseconds>(timeout)
+                   : milliseconds(16);
+        if (pacer.take_frame(now)) {
+            pacer.frame_rendered(now);
+        }
+    }
+    return now;
+}
+} // namespace
+
+TEST_CASE("Settle after input, then go idle", "[gui][frame_pacer]") {
+    FramePacer pacer(start);
+    auto now = start;
+    for (uint32_t i = 0; i < FramePacer::SETTLE_FRAMES; i++) {
+        REQUIRE(pacer.mode(now) == epsp_frame_mode_t::FRAME_ACTIVE);
+        REQUIRE(pacer.wait_timeout(now).count() == 0.0);
+        now += milliseconds(16);
+        pacer.frame_rendered(now);
+    }
+    REQUIRE(pacer.mode(now) == epsp_frame_mode_t::FRAME_IDLE);
+    REQUIRE(pacer.wait_timeout(now) == FramePacer::IDLE_TIMEOUT);
+
+    pacer.wake();
+    REQUIRE(pacer.mode(now) == epsp_frame_mode_t::FRAME_ACTIVE);
+
+    pacer.set_animating(true);
+    now = run_for(pacer, now, milliseconds(100));
+    REQUIRE(pacer.mode(now) == epsp_frame_mode_t::FRAME_ACTIVE);
+    pacer.set_animating(false);
+    now = run_for(pacer, now, milliseconds(100));
+    REQUIRE(pacer.mode(now) == epsp_frame_mode_t::FRAME_IDLE);
+}
+
+TEST_CASE("Hold full rate through an alert", "[gui][frame_pacer]") {
+    FramePacer pacer(start);
+    auto now = run_for(pacer, start, milliseconds(100));
+    REQUIRE(pacer.mode(now) == epsp_frame_mode_t::FRAME_IDLE);
+
+    pacer.start_alert(now);
+    now = run_for(pacer, now, FramePacer::ALERT_HOLD - milliseconds(100));
+    REQUIRE(pacer.mode(now) == epsp_frame_mode_t::FRAME_ACTIVE);
+    now = run_for(pacer, now, milliseconds(200));
+    REQUIRE(pacer.mode(now) == epsp_frame_mode_t::FRAME_IDLE);
+}
+
+TEST_CASE("Skip idle frames with nothing to show", "[gui][frame_pacer]") {
+    FramePacer pacer(start);
+    auto now = run_for(pacer, start, milliseconds(100));
+    REQUIRE(pacer.mode(now) == epsp_frame_mode_t::FRAME_IDLE);
+    now += FramePacer::IDLE_TIMEOUT;
+    REQUIRE_FALSE(pacer.take_frame(now));
+
+    // A posted result is worth one frame, without the settle frames.
+    pacer.post();
+    REQUIRE(pacer.take_frame(now));
+    pacer.frame_rendered(now);
+    REQUIRE(pacer.mode(now) == epsp_frame_mode_t::FRAME_IDLE);
+    REQUIRE_FALSE(pacer.take_frame(now));
+
+    pacer.wake();
+    REQUIRE(pacer.take_frame(now));
+}
+
+TEST_CASE("Draw a requested frame while idle", "[gui][frame_pacer]") {
+    FramePacer pacer(start);
+    auto now = run_for(pacer, start, milliseconds(100));
+    pacer.request_frame(now + std::chrono::minutes(1));
+    pacer.request_frame(now + std::chrono::minutes(2));
+
+    // The earliest request is drawn once, at the first wait after it.
+    now = run_for(pacer, now, std::chrono::seconds(59));
+    REQUIRE_FALSE(pacer.take_frame(now));
+    now += std::chrono::seconds(1);
+    REQUIRE(pacer.take_frame(now));
+    pacer.frame_rendered(now);
+    now += std::chrono::seconds(90);
+    REQUIRE_FALSE(pacer.take_frame(now));
+}
+
+TEST_CASE("Report frames per minute by mode", "[gui][frame_pacer]") {
+    FramePacer pacer(start);
+    auto now = run_for(pacer, start, std::chrono::minutes(10));
+    // Posted every 10 s, e.g. by sliding detection counts.
+    for (int i = 0; i < 60; i++) {
+        now += std::chrono::seconds(10);
+        pacer.post();
+        if (pacer.take_frame(now)) {
+            pacer.frame_rendered(now);
+        }
+    }
+    pacer.start_alert(now);
+    run_for(pacer, now, FramePacer::ALERT_HOLD);
+
+    // Idle: only the posted frames; timeouts alone draw nothing. Active:
+    // one frame per 16 ms vsync.
+    auto rates = pacer.rates();
+    REQUIRE(rates.idle_per_minute > 2.5);
+    REQUIRE(rates.idle_per_minute < 3.5);
+    REQUIRE(rates.active_per_minute > 3700.0);
+}
@@ -0,0 +1,70 @@
+#include "../src/comms/framer.h"
+#include <catch2/catch_test_macros.hpp>
+#include <cstring>
+
+namespace {
+void feed(LineFramer &framer, std::string_view data) {
+    auto area = framer.write_area();
+    REQUIRE(area.size() >= data.size());
+    std::memcpy(area.data(), data.data(), data.size());
+    framer.commit(data.size());
+}
+} // namespace
+
+TEST_CASE("Split every complete line in one pass", "[comms][framer]") {
+    LineFramer framer;
+    std::vector<std::string_view> lines;
+
+    feed(framer, "211 1\r\n551 1 a\r\n555 2 b\r\n556 1");
+    REQUIRE(framer.take_lines(lines) == epsp_framer_t::FRAMER_OK);
+
+    REQUIRE(lines.size() == 3);
+    REQUIRE(lines[0] == "211 1");
+    REQUIRE(lines[1] == "551 1 a");
+    REQUIRE(lines[2] == "555 2 b");
+    REQUIRE(framer.buffered() == 5);
+}
+
+TEST_CASE("Keep partial line across reads", "[comms][framer]") {
+    LineFramer framer(64, 32);
+    std::vector<std::string_view> lines;
+
+    feed(framer, "551 1 part");
+    REQUIRE(framer.take_lines(lines) == epsp_framer_t::FRAMER_OK);
+    REQUIRE(lines.empty());
+
+    feed(framer, "ial\r\n611 1\n");
+    REQUIRE(framer.take_lines(lines) == epsp_framer_t::FRAMER_OK);
+    REQUIRE(lines.size() == 2);
+    REQUIRE(lines[0] == "551 1 partial");
+    REQUIRE(lines[1] == "611 1");
+    REQUIRE(framer.buffered() == 0);
+}
+
+TEST_CASE("Reuse buffer space after compaction", "[comms][framer]") {
+    LineFramer framer(32, 16);
+    std::vector<std::string_view> lines;
+
+    for (int i = 0; i < 100; i++) {
+        lines.clear();
+        feed(framer, "551 1 abcdef\r\n55");
+        REQUIRE(framer.take_lines(lines) == epsp_framer_t::FRAMER_OK);
+        feed(framer, "5 1 g\r\n");
+        REQUIRE(framer.take_lines(lines) == epsp_framer_t::FRAMER_OK);
+        REQUIRE(lines.size() == 2);
+        REQUIRE(lines[1] == "555 1 g");
+    }
+}
+
+TEST_CASE("Reject line above maximum length", "[comms][framer]") {
+    LineFramer framer(64, 16);
+    std::vector<std::string_view> lines;
+
+    feed(framer, "551 1 0123456789abcdef");
+    REQUIRE(framer.take_lines(lines) == epsp_framer_t::FRAMER_LINE_TOO_LONG);
+
+    framer.reset();
+    lines.clear();
+    feed(framer, "551 1 0123456789abcdef\r\n");
+    REQUIRE(framer.take_lines(lines) == epsp_framer_t::FRAMER_LINE_TOO_LONG);
+}
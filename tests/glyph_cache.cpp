@@ -0,0 +1,172 @@
+#include "../src/gui/glyph_cache.h"
+#include <bit>
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include <fstream>
+
+namespace {
+auto key_for(char32_t codepoint, float size) -> GlyphKey {
+    return {.font = 0xF0F0,
+            .size = std::bit_cast<uint32_t>(size),
+            .density = std::bit_cast<uint32_t>(1.0F),
+            .codepoint = static_cast<uint32_t>(codepoint)};
+}
+
+// A square bitmap the size of an em, as a CJK glyph would fill it.
+auto glyph_for(char32_t codepoint, float size) -> CachedGlyph {
+    auto side = static_cast<uint16_t>(size);
+    CachedGlyph glyph{.advance = size,
+                      .x0 = 0.5F,
+                      .y0 = -size,
+                      .x1 = size - 0.5F,
+                      .y1 = 1.0F,
+                      .visible = true,
+                      .width = side,
+                      .height = side,
+                      .alpha = {}};
+    glyph.alpha.resize(std::size_t{side} * side);
+    for (std::size_t i = 0; i < glyph.alpha.size(); i++) {
+        glyph.alpha[i] = static_cast<uint8_t>((i * 31 + codepoint) & 0xFF);
+    }
+    return glyph;
+}
+
+// The region table's glyphs at the two sizes the GUI draws.
+void fill(GlyphCache &cache) {
+    for (auto size : {16.0F, 28.0F}) {
+        for (auto codepoint : region_codepoints()) {
+            cache.insert(key_for(codepoint, size),
+                         glyph_for(codepoint, size));
+        }
+    }
+}
+} // namespace
+
+TEST_CASE("Collect the codepoints region names need", "[font]") {
+    auto codepoints = distinct_codepoints("奈良 奈良県 abc");
+    REQUIRE(codepoints == std::vector<char32_t>{U' ', U'a', U'b', U'c',
+                                                U'奈', U'県', U'良'});
+    // A truncated sequence is replaced, not read past.
+    REQUIRE(distinct_codepoints("\xE5\xA5") == std::vector<char32_t>{U'�'});
+
+    auto table = region_codepoints();
+    REQUIRE(table.size() > 200);
+    REQUIRE(std::ranges::is_sorted(table));
+    REQUIRE(std::ranges::binary_search(table, U'北'));
+}
+
+TEST_CASE("Persist glyphs across runs", "[font]") {
+    auto path = std::filesystem::temp_directory_path() / "epsp_glyphs.bin";
+    std::filesystem::remove(path);
+
+    GlyphCache cold;
+    REQUIRE_FALSE(cold.load(path));
+    REQUIRE(cold.find(key_for(U'震', 16.0F)) == nullptr);
+    REQUIRE(cold.stats().misses == 1);
+    fill(cold);
+    CachedGlyph space_glyph;
+    space_glyph.advance = 4.0F;
+    cold.insert(key_for(U' ', 16.0F), space_glyph);
+    REQUIRE(cold.dirty());
+    std::string error;
+    REQUIRE(cold.save(path, error));
+    REQUIRE_FALSE(cold.dirty());
+    REQUIRE_FALSE(std::filesystem::exists(path.string() + ".tmp"));
+
+    GlyphCache warm;
+    REQUIRE(warm.load(path));
+    REQUIRE(warm.stats().glyphs == cold.stats().glyphs);
+    REQUIRE(warm.stats().bitmap_bytes == cold.stats().bitmap_bytes);
+    const auto *glyph = warm.find(key_for(U'震', 28.0F));
+    REQUIRE(glyph != nullptr);
+    auto expected = glyph_for(U'震', 28.0F);
+    REQUIRE(glyph->width == 28);
+    REQUIRE(glyph->y0 == expected.y0);
+    REQUIRE(glyph->alpha == expected.alpha);
+    const auto *space = warm.find(key_for(U' ', 16.0F));
+    REQUIRE(space != nullptr);
+    REQUIRE_FALSE(space->visible);
+    REQUIRE(space->advance == 4.0F);
+    // Another size is another glyph.
+    REQUIRE(warm.find(key_for(U'震', 20.0F)) == nullptr);
+    REQUIRE(warm.stats().hits == 2);
+    REQUIRE_FALSE(warm.dirty());
+
+    // A damaged file is ignored rather than half loaded.
+    {
+        std::fstream file(path, std::ios::binary | std::ios::in |
+                                    std::ios::out);
+        file.seekp(40);
+        file.put('\x55');
+    }
+    GlyphCache damaged;
+    REQUIRE_FALSE(damaged.load(path));
+    REQUIRE(damaged.stats().glyphs == 0);
+
+    // So is a header claiming a 4 GiB body, without trying to allocate it.
+    {
+        std::fstream file(path, std::ios::binary | std::ios::in |
+                                    std::ios::out);
+        file.seekp(12);
+        file.write("\xFF\xFF\xFF\xFF", 4);
+    }
+    GlyphCache oversized;
+    REQUIRE_FALSE(oversized.load(path));
+    REQUIRE(oversized.stats().glyphs == 0);
+    std::filesystem::remove(path);
+}
+
+TEST_CASE("Fingerprint fonts by their head and options", "[font]") {
+    std::vector<uint8_t> font(200 * 1024);
+    for (std::size_t i = 0; i < font.size(); i++) {
+        font[i] = static_cast<uint8_t>(i * 7);
+    }
+    std::vector<uint8_t> options = {1, 2, 3};
+    auto base = font_fingerprint(font, options);
+    REQUIRE(font_fingerprint(font, options) == base);
+
+    options[0] = 9;
+    REQUIRE(font_fingerprint(font, options) != base);
+    options[0] = 1;
+    auto edited = font;
+    edited[100] ^= 1;
+    REQUIRE(font_fingerprint(edited, options) != base);
+    edited = font;
+    edited.push_back(0);
+    REQUIRE(font_fingerprint(edited, options) != base);
+    // Past the head only the size counts: the directory's checksums
+    // already name the tables.
+    edited = font;
+    edited[150 * 1024] ^= 1;
+    REQUIRE(font_fingerprint(edited, options) == base);
+}
+
+TEST_CASE("Benchmark the glyph cache", "[!benchmark][font]") {
+    auto path =
+        std::filesystem::temp_directory_path() / "epsp_glyphs_bench.bin";
+    GlyphCache cache;
+    fill(cache);
+    std::string error;
+    REQUIRE(cache.save(path, error));
+
+    BENCHMARK("save the region table's glyphs") {
+        GlyphCache fresh;
+        fill(fresh);
+        return fresh.save(path, error);
+    };
+    BENCHMARK("warm start: load them") {
+        GlyphCache warm;
+        return warm.load(path);
+    };
+    auto codepoints = region_codepoints();
+    BENCHMARK("look up every glyph") {
+        std::size_t found = 0;
+        for (auto size : {16.0F, 28.0F}) {
+            for (auto codepoint : codepoints) {
+                found += cache.find(key_for(codepoint, size)) != nullptr;
+            }
+        }
+        return found;
+    };
+    std::filesystem::remove(path);
+}
@@ -0,0 +1,138 @@
+#include "../src/comms/framer.h"
+#include "../src/comms/handler_memory.h"
+#include "../src/comms/outbound.h"
+#include "alloc_counter.h"
+#include <asio/io_context.hpp>
+#include <asio/ip/tcp.hpp>
+#include <asio/write.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include <span>
+
+namespace {
+using asio::ip::tcp;
+
+// Pre-encoded lines over loopback through two self-rearming loops, one
+// HandlerMemory each. The peer sessions are checked end to end in
+// peer_sessions.cpp.
+struct RelayLoop {
+    tcp::socket sender;
+    tcp::socket receiver;
+    HandlerMemory read_memory;
+    HandlerMemory write_memory;
+    LineFramer framer;
+    std::vector<std::string_view> lines;
+    SharedMessage message;
+    std::vector<asio::const_buffer> gather;
+    std::size_t batch;
+    std::size_t total;
+    std::size_t to_send;
+    std::size_t received = 0;
+    bool failed = false;
+
+    RelayLoop(asio::io_context &io_context, std::size_t total,
+              std::size_t batch)
+        : sender(io_context), receiver(io_context),
+          message(std::make_shared<const std::string>(
+              "551 3 2024/01/01 12:00:00,3,1,4,Ishikawa,10km,5.3,1,N37.5,"
+              "E137.2,Noto\r\n")),
+          batch(batch), total(total), to_send(total) {
+        gather.reserve(batch);
+    }
+
+    void write() {
+        if (to_send == 0) {
+            return;
+        }
+        auto count = std::min(batch, to_send);
+        to_send -= count;
+        gather.assign(count, asio::buffer(*message));
+        asio::async_write(
+            sender, std::span<const asio::const_buffer>(gather),
+            bind_memory(write_memory,
+                        [this](asio::error_code ecode, std::size_t) -> void {
+                            failed |= static_cast<bool>(ecode);
+                            write();
+                        }));
+    }
+
+    void read() {
+        auto area = framer.write_area();
+        receiver.async_read_some(
+            asio::buffer(area.data(), area.size()),
+            bind_memory(read_memory, [this](asio::error_code ecode,
+                                            std::size_t bytes) -> void {
+                if (ecode) {
+                    failed = true;
+                    return;
+                }
+                framer.commit(bytes);
+                lines.clear();
+                framer.take_lines(lines);
+                received += lines.size();
+                // Count once the first reads have sized every buffer.
+                if (received >= total / 100) {
+                    count_allocations(true);
+                }
+                if (received < total) {
+                    read();
+                }
+            }));
+    }
+};
+} // namespace
+
+TEST_CASE("Reuse one block across a self-rearming loop",
+          "[comms][handler_memory]") {
+    constexpr std::size_t total = 100'000;
+    asio::io_context io_context;
+    tcp::acceptor acceptor(io_context,
+                           tcp::endpoint(asio::ip::address_v4::loopback(), 0));
+
+    RelayLoop loop(io_context, total, 64);
+    loop.sender.connect(acceptor.local_endpoint());
+    acceptor.accept(loop.receiver);
+    loop.lines.reserve(EPSP_RECV_CAPACITY);
+
+    reset_allocations();
+    loop.read();
+    loop.write();
+    io_context.run();
+    count_allocations(false);
+
+    REQUIRE_FALSE(loop.failed);
+    REQUIRE(loop.received == total);
+    REQUIRE(counted_allocations() == 0);
+    REQUIRE(loop.read_memory.reused() > 0);
+    REQUIRE(loop.write_memory.reused() > 0);
+    REQUIRE(loop.read_memory.fallbacks() == 0);
+    REQUIRE(loop.write_memory.fallbacks() == 0);
+}
+
+TEST_CASE("Fall back to the heap when both blocks are taken",
+          "[comms][handler_memory]") {
+    HandlerMemory memory;
+    HandlerAllocator<int> allocator(memory);
+
+    int *first = allocator.allocate(4);
+    int *second = allocator.allocate(4);
+    int *third = allocator.allocate(4);
+    REQUIRE(first != second);
+    REQUIRE(third != first);
+    REQUIRE(third != second);
+    REQUIRE(memory.reused() == 2);
+    REQUIRE(memory.fallbacks() == 1);
+
+    allocator.deallocate(third, 4);
+    allocator.deallocate(second, 4);
+    allocator.deallocate(first, 4);
+    REQUIRE(allocator.allocate(HandlerMemory::CAPACITY / sizeof(int)) ==
+            first);
+    allocator.deallocate(first, HandlerMemory::CAPACITY / sizeof(int));
+    REQUIRE(memory.reused() == 3);
+
+    // Too big for a block, even a free one.
+    int *large = allocator.allocate(HandlerMemory::CAPACITY);
+    REQUIRE(large != first);
+    REQUIRE(memory.fallbacks() == 2);
+    allocator.deallocate(large, HandlerMemory::CAPACITY);
+}
@@ -0,0 +1,245 @@
+#include "../src/map/intensity_field.h"
+#include "../src/map/projection.h"
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+namespace {
+// Keeps the texture as a CPU image so sub-updates can be checked.
+class ImageBackend : public OverlayBackend {
+public:
+    uint32_t width = 0;
+    uint32_t height = 0;
+    std::vector<uint8_t> rgba;
+    std::size_t creates = 0;
+    std::size_t updates = 0;
+
+    auto create(uint32_t w, uint32_t h) -> uint64_t override {
+        width = w;
+        height = h;
+        rgba.assign(std::size_t{w} * h * 4, 0);
+        creates++;
+        return 7;
+    }
+    void update(uint64_t texture, uint32_t x, uint32_t y, uint32_t w,
+                uint32_t h, std::span<const uint8_t> pixels) override {
+        REQUIRE(texture == 7);
+        REQUIRE(pixels.size() == std::size_t{w} * h * 4);
+        for (uint32_t row = 0; row < h; row++) {
+            std::ranges::copy(pixels.subspan(std::size_t{row} * w * 4, w * 4),
+                              rgba.begin() +
+                                  static_cast<std::ptrdiff_t>(
+                                      (std::size_t{y + row} * width + x) * 4));
+        }
+        updates++;
+    }
+    void destroy(uint64_t texture) override { REQUIRE(texture == 7); }
+};
+
+// The surface `field` would hold for `points`, computed from scratch.
+auto full_image(const IntensityField &field,
+                std::span<const IntensityPoint> points)
+    -> std::vector<uint8_t> {
+    std::vector<uint8_t> image(std::size_t{field.cells_x()} *
+                               field.cells_y() * 4);
+    std::vector<uint8_t> tile;
+    for (uint32_t y = 0; y < field.rows(); y++) {
+        for (uint32_t x = 0; x < field.columns(); x++) {
+            field.render_tile(points, x, y, tile);
+            auto [w, h] = field.tile_extent(x, y);
+            for (uint32_t row = 0; row < h; row++) {
+                auto cell_y = y * 64 + row;
+                std::copy_n(&tile[std::size_t{row} * w * 4], w * 4,
+                            &image[(std::size_t{cell_y} * field.cells_x() +
+                                    x * 64) *
+                                   4]);
+            }
+        }
+    }
+    return image;
+}
+
+// Dozens of observations spread over Honshu, the way a 551 reports them.
+auto sample_points(std::size_t count) -> std::vector<IntensityPoint> {
+    std::vector<IntensityPoint> points;
+    uint32_t seed = 12345;
+    for (std::size_t i = 0; i < count; i++) {
+        seed = seed * 1664525 + 1013904223;
+        auto x = 2000.0F + static_cast<float>(seed % 3000);
+        seed = seed * 1664525 + 1013904223;
+        auto y = 2500.0F + static_cast<float>(seed % 2000);
+        points.push_back({.x = x,
+                          .y = y,
+                          .intensity = 1.0F + static_cast<float>(i % 6)});
+    }
+    return points;
+}
+} // namespace
+
+TEST_CASE("Parse the intensities of a 551 report", "[map]") {
+    REQUIRE(parse_shindo("3") == 3.0F);
+    REQUIRE(parse_shindo("5-") == parse_shindo("5弱"));
+    REQUIRE(*parse_shindo("6+") > *parse_shindo("6-"));
+    REQUIRE_FALSE(parse_shindo("8"));
+
+    auto report = parse_intensity_report(
+        "17日08時05分,4,0,4,奈良県,10km,4.8,0,N34.4,E135.9,気象庁:"
+        "-奈良県,+4,*奈良市,+3,*五條市,-大阪府,+2,"
+        "*大阪北部,*堺市,+1,*岸和田市");
+    REQUIRE(report);
+    REQUIRE(report->time == "17日08時05分");
+    REQUIRE(report->max_intensity == 4.0F);
+    REQUIRE(report->epicentre);
+    REQUIRE(report->epicentre->first == 34.4);
+    REQUIRE(report->epicentre->second == 135.9);
+    // Nara's two stations share its centre and keep the stronger. 大阪北部
+    // is a region of its own; Osaka's other stations share its centre.
+    REQUIRE(report->observations.size() == 3);
+    REQUIRE(report->observations[0].intensity == 4.0F);
+    REQUIRE(report->observations[1].lat == 34.816);
+    REQUIRE(report->observations[1].intensity == 2.0F);
+    REQUIRE(report->observations[2].intensity == 2.0F);
+
+    // A hypocentre-only report has no observations.
+    auto bare = parse_intensity_report(
+        "17日08時05分,-1,0,2,,,,0,,,気象庁:");
+    REQUIRE(bare);
+    REQUIRE_FALSE(bare->epicentre);
+    REQUIRE(bare->observations.empty());
+    REQUIRE_FALSE(parse_intensity_report("garbage"));
+}
+
+TEST_CASE("Interpolate intensity between observations", "[map]") {
+    ImageBackend backend;
+    IntensityField field(backend, 1024, 1024,
+                         {.cell_px = 8, .tile_cells = 64, .threads = 1});
+    REQUIRE(field.cells_x() == 128);
+    REQUIRE(field.columns() == 2);
+
+    std::vector<IntensityPoint> one{{.x = 300, .y = 300, .intensity = 4.0F}};
+    std::vector<uint8_t> tile;
+    field.render_tile(one, 0, 0, tile);
+    auto at = [&tile](uint32_t cx, uint32_t cy) -> const uint8_t * {
+        return &tile[(std::size_t{cy} * 64 + cx) * 4];
+    };
+    // Class "4" on top of the point, transparent beyond its reach.
+    REQUIRE(at(37, 37)[0] == 250);
+    REQUIRE(at(37, 37)[3] > 0);
+    REQUIRE(at(0, 63)[3] == 0);
+
+    // Between a 2 and a 6-, the surface climbs towards the stronger one.
+    std::vector<IntensityPoint> two{{.x = 100, .y = 260, .intensity = 2.0F},
+                                    {.x = 400, .y = 260, .intensity = 5.75F}};
+    field.render_tile(two, 0, 0, tile);
+    REQUIRE(at(12, 32)[2] == 255); // blue: "2"
+    REQUIRE(at(50, 32)[0] == 255); // "6-" is red
+    REQUIRE(at(50, 32)[1] == 40);
+}
+
+TEST_CASE("Recompute only the tiles new observations reach", "[map]") {
+    ImageBackend backend;
+    auto grid = japan_map_grid();
+    IntensityField field(backend, grid.width(), grid.height(),
+                         {.threads = 2});
+    REQUIRE(field.cells_x() == 768);
+    REQUIRE(field.columns() == 12);
+    std::vector<TileDraw> draws;
+    MapViewport view{.center_x = 3072,
+                     .center_y = 3072,
+                     .zoom = 0.1,
+                     .width = 1280,
+                     .height = 720};
+
+    // Nothing to draw until there are observations.
+    field.frame(view, draws);
+    REQUIRE(draws.empty());
+    REQUIRE(backend.creates == 0);
+
+    auto points = sample_points(40);
+    field.set_points(points);
+    field.wait_idle();
+    field.frame(view, draws);
+    REQUIRE(draws.size() == 1);
+    REQUIRE(backend.creates == 1);
+    auto first = field.stats();
+    REQUIRE(first.tiles_uploaded == first.tiles_computed);
+    REQUIRE(first.tiles_computed < field.columns() * field.rows());
+    REQUIRE(first.last_update);
+    REQUIRE(backend.rgba == full_image(field, points));
+
+    // The same set again is a no-op; one more point touches a few tiles.
+    field.set_points(points);
+    field.wait_idle();
+    REQUIRE(field.stats().tiles_computed == first.tiles_computed);
+    points.push_back({.x = 4200, .y = 3300, .intensity = 5.25F});
+    field.set_points(points);
+    field.wait_idle();
+    field.frame(view, draws);
+    auto second = field.stats();
+    REQUIRE(second.tiles_computed - first.tiles_computed <= 4);
+    REQUIRE(second.tiles_computed > first.tiles_computed);
+    REQUIRE(backend.rgba == full_image(field, points));
+
+    // Updates racing the workers still settle on the latest points.
+    for (int round = 0; round < 5; round++) {
+        points[static_cast<std::size_t>(round)].intensity = 6.75F;
+        field.set_points(points);
+        field.frame(view, draws);
+    }
+    field.wait_idle();
+    field.frame(view, draws);
+    REQUIRE(backend.rgba == full_image(field, points));
+
+    // Clearing the observations clears the texture and stops drawing it.
+    field.set_points({});
+    field.wait_idle();
+    draws.clear();
+    field.frame(view, draws);
+    REQUIRE(draws.empty());
+    REQUIRE(std::ranges::all_of(
+        backend.rgba, [](uint8_t byte) -> bool { return byte == 0; }));
+}
+
+TEST_CASE("Benchmark the intensity surface", "[!benchmark][map]") {
+    ImageBackend backend;
+    auto grid = japan_map_grid();
+    auto points = sample_points(60);
+    std::vector<TileDraw> draws;
+    MapViewport view{};
+    view.zoom = 0.1;
+
+    IntensityField field(backend, grid.width(), grid.height());
+    std::vector<uint8_t> tile;
+    BENCHMARK("whole surface, one thread, 590k cells") {
+        std::size_t painted = 0;
+        for (uint32_t y = 0; y < field.rows(); y++) {
+            for (uint32_t x = 0; x < field.columns(); x++) {
+                field.render_tile(points, x, y, tile);
+                painted += tile[3];
+            }
+        }
+        return painted;
+    };
+    BENCHMARK("whole surface on the pool") {
+        field.set_points({});
+        field.wait_idle();
+        field.set_points(points);
+        field.wait_idle();
+        field.frame(view, draws);
+        return field.stats().tiles_computed;
+    };
+    int step = 0;
+    BENCHMARK("one new observation") {
+        auto more = points;
+        more.push_back({.x = 3000.0F + static_cast<float>(step++ % 100),
+                        .y = 3000.0F,
+                        .intensity = 3.0F});
+        field.set_points(std::move(more));
+        field.wait_idle();
+        field.frame(view, draws);
+        return field.stats().tiles_computed;
+    };
+    BENCHMARK("frame with nothing finished") {
+        field.frame(view, draws);
+        return draws.size();
+    };
+}
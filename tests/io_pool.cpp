@@ -0,0 +1,161 @@
+#include "../src/comms/io_pool.h"
+#include "remote_peer.h"
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include <functional>
+#include <future>
+#include <latch>
+
+namespace {
+// Answers our handshake, waits until every remote is connected, floods
+// `lines` unique 551 reports and returns how many 551s the other remotes
+// relayed to it.
+auto flood(RemotePeer &remote, std::latch &connected, std::size_t lines,
+           std::size_t expected) -> std::size_t {
+    bool handshake = remote.accept();
+    connected.count_down();
+    if (!handshake) {
+        return 0;
+    }
+    connected.wait();
+
+    std::string reports;
+    for (std::size_t seq = 0; seq < lines; seq++) {
+        reports += "551 1 r" + std::to_string(remote.peer_id()) + "-" +
+                   std::to_string(seq) + "\r\n";
+    }
+    if (!remote.send(reports)) {
+        return 0;
+    }
+    return remote.expect("551", expected);
+}
+
+// Connects `remotes` peers through one ConnectionPeer on a `threads` pool
+// and returns the total number of relayed lines they received.
+auto relay_round(std::size_t threads, std::size_t remotes, std::size_t lines)
+    -> std::size_t {
+    IoPool io_pool(threads);
+    auto peer = init_peer_connection(io_pool.context());
+    peer.connection_peer->set_outbound_policy(
+        {.high_watermark = 64 * 1024 * 1024, .low_watermark = 1024 * 1024});
+
+    std::vector<std::unique_ptr<RemotePeer>> peers;
+    std::vector<PeerCandidate> candidates;
+    for (std::size_t i = 0; i < remotes; i++) {
+        peers.push_back(std::make_unique<RemotePeer>(100 + i));
+        candidates.push_back(peers.back()->candidate());
+    }
+
+    std::latch connected(static_cast<std::ptrdiff_t>(remotes));
+    std::vector<std::future<std::size_t>> received;
+    for (auto &remote : peers) {
+        received.push_back(std::async(std::launch::async,
+                                      [&remote, &connected, lines,
+                                       remotes] -> std::size_t {
+                                          return flood(*remote, connected,
+                                                       lines,
+                                                       (remotes - 1) * lines);
+                                      }));
+    }
+
+    io_pool.start();
+    peer.connection_peer->connect_all(
+        std::move(candidates), PeerConnectOptions{},
+        [](const std::vector<PeerConnectResult> &) -> void {});
+
+    // Watchdog: a stuck relay fails the count instead of hanging the run.
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(30);
+    std::size_t total = 0;
+    for (std::size_t i = 0; i < received.size(); i++) {
+        if (received[i].wait_until(deadline) != std::future_status::ready) {
+            for (auto &remote : peers) {
+                remote->abort();
+            }
+        }
+        total += received[i].get();
+    }
+
+    peer.connection_peer->stop_all();
+    io_pool.stop();
+    return total;
+}
+} // namespace
+
+TEST_CASE("Run posted work on every pool thread", "[comms][io_pool]") {
+    IoPool io_pool(4);
+    REQUIRE(io_pool.threads() == 4);
+    io_pool.start();
+
+    constexpr int tasks = 1000;
+    std::atomic<int> done{0};
+    std::promise<void> finished;
+    for (int i = 0; i < tasks; i++) {
+        asio::post(*io_pool.context(), [&done, &finished] -> void {
+            if (done.fetch_add(1) + 1 == tasks) {
+                finished.set_value();
+            }
+        });
+    }
+    REQUIRE(finished.get_future().wait_for(std::chrono::seconds(5)) ==
+            std::future_status::ready);
+    io_pool.stop();
+    REQUIRE(done.load() == tasks);
+    REQUIRE(IoPool::default_threads() >= 2);
+}
+
+TEST_CASE("Drain queued work before stopping", "[comms][io_pool]") {
+    IoPool io_pool(2);
+    io_pool.start();
+
+    // A close that needs one more round trip through the pool, as
+    // stop_all()'s do.
+    std::atomic<bool> closed{false};
+    asio::steady_timer timer(*io_pool.context(), std::chrono::milliseconds(50));
+    timer.async_wait([&io_pool, &closed](asio::error_code) -> void {
+        asio::post(*io_pool.context(), [&closed] -> void { closed = true; });
+    });
+    io_pool.stop();
+    REQUIRE(closed.load());
+
+    // Work that never runs out is stopped at the deadline.
+    IoPool busy(1);
+    busy.start();
+    asio::steady_timer forever(*busy.context());
+    std::function<void(asio::error_code)> rearm =
+        [&forever, &rearm](asio::error_code) -> void {
+        forever.expires_after(std::chrono::milliseconds(5));
+        forever.async_wait(rearm);
+    };
+    rearm({});
+    auto started = std::chrono::steady_clock::now();
+    busy.stop(std::chrono::milliseconds(100));
+    REQUIRE(std::chrono::steady_clock::now() - started <
+            std::chrono::seconds(2));
+}
+
+TEST_CASE("Relay across peers on a thread pool", "[comms][io_pool]") {
+    constexpr std::size_t remotes = 4;
+    constexpr std::size_t lines = 2000;
+    auto level = spdlog::get_level();
+    spdlog::set_level(spdlog::level::warn);
+
+    auto received = relay_round(4, remotes, lines);
+
+    spdlog::set_level(level);
+    REQUIRE(received == remotes * (remotes - 1) * lines);
+}
+
+TEST_CASE("Benchmark relay throughput by io threads",
+          "[!benchmark][comms][io_pool]") {
+    auto level = spdlog::get_level();
+    spdlog::set_level(spdlog::level::warn);
+
+    // 8 remotes flooding 5000 reports each: 280k relayed lines per run.
+    for (std::size_t threads : {1, 2, 4, 8}) {
+        BENCHMARK("relay with " + std::to_string(threads) + " threads") {
+            return relay_round(threads, 8, 5000);
+        };
+    }
+
+    spdlog::set_level(level);
+}
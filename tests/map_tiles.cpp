@@ -0,0 +1,360 @@
+#include "../src/map/tile_pack.h"
+#include "../src/map/tile_streamer.h"
+#include "../src/utils/path.h"
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include <fstream>
+
+namespace {
+// Pixel (x, y) of the synthetic test image.
+auto pixel(uint32_t x, uint32_t y, std::size_t channel) -> uint8_t {
+    return static_cast<uint8_t>((x * 7 + y * 13 + channel * 50) ^ (x * y));
+}
+
+void put_u32(std::vector<uint8_t> &out, uint32_t value) {
+    for (int shift = 24; shift >= 0; shift -= 8) {
+        out.push_back(static_cast<uint8_t>(value >> shift));
+    }
+}
+
+void put_chunk(std::vector<uint8_t> &out, std::string_view type,
+               std::span<const uint8_t> data) {
+    put_u32(out, static_cast<uint32_t>(data.size()));
+    auto start = out.size();
+    out.insert(out.end(), type.begin(), type.end());
+    out.insert(out.end(), data.begin(), data.end());
+    put_u32(out, static_cast<uint32_t>(
+                     crc32(0, &out[start], static_cast<uInt>(out.size() -
+                                                             start))));
+}
+
+// Encodes the test image, cycling through all five row filters.
+auto make_png(uint32_t width, uint32_t height, std::size_t channels)
+    -> std::vector<uint8_t> {
+    std::vector<uint8_t> raw;
+    std::vector<uint8_t> above(width * channels, 0);
+    std::vector<uint8_t> line(width * channels);
+    for (uint32_t y = 0; y < height; y++) {
+        for (uint32_t x = 0; x < width; x++) {
+            for (std::size_t c = 0; c < channels; c++) {
+                line[x * channels + c] = c < 3 ? pixel(x, y, c) : 255;
+            }
+        }
+        auto filter = static_cast<uint8_t>(y % 5);
+        raw.push_back(filter);
+        for (std::size_t i = 0; i < line.size(); i++) {
+            int left = i >= channels ? line[i - channels] : 0;
+            int up = above[i];
+            int corner = i >= channels ? above[i - channels] : 0;
+            int predict = 0;
+            switch (filter) {
+            case 1:
+                predict = left;
+                break;
+            case 2:
+                predict = up;
+                break;
+            case 3:
+                predict = (left + up) / 2;
+                break;
+            case 4: {
+                int p = left + up - corner;
+                int pa = std::abs(p - left);
+                int pb = std::abs(p - up);
+                int pc = std::abs(p - corner);
+                predict = pa <= pb && pa <= pc ? left : pb <= pc ? up : corner;
+                break;
+            }
+            default:
+                break;
+            }
+            raw.push_back(static_cast<uint8_t>(line[i] - predict));
+        }
+        above = line;
+    }
+
+    std::vector<uint8_t> deflated(compressBound(raw.size()));
+    auto size = static_cast<uLongf>(deflated.size());
+    compress(deflated.data(), &size, raw.data(), raw.size());
+    deflated.resize(size);
+
+    std::vector<uint8_t> png = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+    std::vector<uint8_t> header;
+    put_u32(header, width);
+    put_u32(header, height);
+    header.insert(header.end(),
+                  {8, static_cast<uint8_t>(channels == 4 ? 6 : 2), 0, 0, 0});
+    put_chunk(png, "IHDR", header);
+    // Split the stream so rows straddle IDAT chunks.
+    auto half = deflated.size() / 2;
+    put_chunk(png, "IDAT", std::span(deflated).first(half));
+    put_chunk(png, "IDAT", std::span(deflated).subspan(half));
+    put_chunk(png, "IEND", {});
+    return png;
+}
+
+auto write_png(uint32_t width, uint32_t height) -> std::filesystem::path {
+    auto path = std::filesystem::temp_directory_path() /
+                ("epsp_map_" + std::to_string(width) + "x" +
+                 std::to_string(height) + ".png");
+    auto png = make_png(width, height, 3);
+    std::ofstream(path, std::ios::binary)
+        .write(reinterpret_cast<const char *>(png.data()),
+               static_cast<std::streamsize>(png.size()));
+    return path;
+}
+
+// Stands in for GL: hands out ids and tracks what is alive.
+class CountingBackend : public TextureBackend {
+public:
+    auto create(const TileImage &image) -> uint64_t override {
+        bytes_ += image.rgb.size();
+        live_++;
+        return ++next_;
+    }
+    void destroy(uint64_t /*texture*/) override { live_--; }
+    [[nodiscard]] auto live() const -> std::size_t { return live_; }
+    [[nodiscard]] auto created() const -> uint64_t { return next_; }
+
+private:
+    uint64_t next_ = 0;
+    std::size_t live_ = 0;
+    std::size_t bytes_ = 0;
+};
+
+// Renders frames until every visible tile has a texture of its own.
+auto settle(TileStreamer &streamer, const MapViewport &view,
+            std::vector<TileDraw> &draws) -> bool {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(20);
+    std::size_t last_uploads = SIZE_MAX;
+    while (std::chrono::steady_clock::now() < deadline) {
+        streamer.frame(view, draws);
+        auto uploads = streamer.stats().uploads;
+        bool own = !draws.empty() &&
+                   std::ranges::all_of(draws, [](const TileDraw &draw) -> bool {
+                       return draw.uv == std::array{0.0F, 0.0F, 1.0F, 1.0F};
+                   });
+        // Tiles are served while a PNG is still being tiled, so the top of
+        // the view can settle before its bottom exists; the first covered
+        // frame comes only once the build has finished.
+        bool covered = streamer.stats().first_frame.has_value();
+        if (own && covered && uploads == last_uploads) {
+            return true;
+        }
+        last_uploads = uploads;
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    return false;
+}
+} // namespace
+
+TEST_CASE("Decode every PNG row filter", "[map]") {
+    for (std::size_t channels : {3, 4}) {
+        std::string error;
+        auto rows = PngRows::open(make_png(37, 29, channels), error);
+        REQUIRE(rows.has_value());
+        REQUIRE(rows->width() == 37);
+        REQUIRE(rows->height() == 29);
+
+        std::vector<uint8_t> row(37 * 3);
+        bool exact = true;
+        for (uint32_t y = 0; y < 29; y++) {
+            REQUIRE(rows->next_row(row));
+            for (uint32_t x = 0; x < 37; x++) {
+                for (std::size_t c = 0; c < 3; c++) {
+                    exact &= row[x * 3 + c] == pixel(x, y, c);
+                }
+            }
+        }
+        REQUIRE(exact);
+        REQUIRE_FALSE(rows->next_row(row));
+    }
+
+    std::string error;
+    REQUIRE_FALSE(PngRows::open(std::vector<uint8_t>(64, 0), error));
+    REQUIRE_FALSE(error.empty());
+}
+
+TEST_CASE("Build mip levels from streamed rows", "[map]") {
+    std::string error;
+    auto rows = PngRows::open(make_png(600, 300, 3), error);
+    REQUIRE(rows.has_value());
+    TilePyramid pyramid(600, 300, 128);
+    // 600x300, 300x150, 150x75, 75x38.
+    REQUIRE(pyramid.levels() == 4);
+    REQUIRE(pyramid.width(3) == 75);
+    REQUIRE(pyramid.height(3) == 38);
+    REQUIRE(pyramid.columns(0) == 5);
+    REQUIRE(pyramid.rows(0) == 3);
+
+    std::atomic<bool> cancel{false};
+    REQUIRE(build_pyramid(*rows, pyramid, cancel));
+
+    TileImage image;
+    // Interior level-0 tile: a straight copy of the source.
+    REQUIRE(pyramid.decode({.level = 0, .x = 1, .y = 1}, image));
+    REQUIRE(image.width == 128);
+    REQUIRE(image.height == 128);
+    REQUIRE(image.rgb[(5 * 128 + 9) * 3] == pixel(128 + 9, 128 + 5, 0));
+
+    // Corner tile: clipped to the image.
+    REQUIRE(pyramid.decode({.level = 0, .x = 4, .y = 2}, image));
+    REQUIRE(image.width == 600 - 4 * 128);
+    REQUIRE(image.height == 300 - 2 * 128);
+
+    // Level 1: a rounded 2x2 average.
+    REQUIRE(pyramid.decode({.level = 1, .x = 0, .y = 0}, image));
+    int sum = pixel(20, 10, 1) + pixel(21, 10, 1) + pixel(20, 11, 1) +
+              pixel(21, 11, 1);
+    REQUIRE(image.rgb[(5 * 128 + 10) * 3 + 1] == (sum + 2) / 4);
+
+    // The last level is one tile.
+    REQUIRE(pyramid.ready({.level = 3, .x = 0, .y = 0}));
+    REQUIRE_FALSE(pyramid.ready({.level = 3, .x = 1, .y = 0}));
+    REQUIRE(pyramid.compressed_bytes() > 0);
+}
+
+TEST_CASE("Pick the mip level for a zoom", "[map]") {
+    REQUIRE(TileStreamer::level_for(2.0, 6) == 0);
+    REQUIRE(TileStreamer::level_for(1.0, 6) == 0);
+    REQUIRE(TileStreamer::level_for(0.5, 6) == 1);
+    REQUIRE(TileStreamer::level_for(0.3, 6) == 1);
+    REQUIRE(TileStreamer::level_for(0.001, 6) == 5);
+}
+
+TEST_CASE("Stream visible tiles under a budget", "[map]") {
+    auto path = write_png(1024, 1024);
+    CountingBackend backend;
+    {
+        // Room for about 12 full 128px tiles.
+        TileStreamer streamer(backend, {.budget_bytes = 12 * 128 * 128 * 4,
+                                        .tile_size = 128});
+        streamer.start(path);
+        std::vector<TileDraw> draws;
+
+        // Whole image in a 256px window: level 2, 2x2 tiles.
+        MapViewport overview{.center_x = 512,
+                             .center_y = 512,
+                             .zoom = 0.25,
+                             .width = 256,
+                             .height = 256};
+        REQUIRE(settle(streamer, overview, draws));
+        REQUIRE(draws.size() == 4);
+        REQUIRE(draws[0].rect == std::array{0.0F, 0.0F, 128.0F, 128.0F});
+        REQUIRE(streamer.stats().first_frame.has_value());
+
+        // Zoomed to level 0: drawn from the overview until decoded.
+        MapViewport close{.center_x = 200,
+                          .center_y = 200,
+                          .zoom = 1.0,
+                          .width = 256,
+                          .height = 256};
+        streamer.frame(close, draws);
+        REQUIRE_FALSE(draws.empty());
+        REQUIRE(draws[0].uv != std::array{0.0F, 0.0F, 1.0F, 1.0F});
+        REQUIRE(settle(streamer, close, draws));
+        REQUIRE(draws.size() == 9);
+
+        // Pan across the image: the LRU keeps textures within budget.
+        for (double x = 200; x <= 900; x += 100) {
+            close.center_x = x;
+            close.center_y = x;
+            REQUIRE(settle(streamer, close, draws));
+            REQUIRE(streamer.stats().resident_bytes <= 12 * 128 * 128 * 4);
+        }
+        auto stats = streamer.stats();
+        REQUIRE(stats.evictions > 0);
+        REQUIRE(backend.live() == stats.resident_tiles);
+    }
+    // Destroying the streamer frees every texture.
+    REQUIRE(backend.live() == 0);
+    std::filesystem::remove(path);
+}
+
+TEST_CASE("Decode each tile once while frames keep coming", "[map]") {
+    auto path = write_png(2048, 2048);
+    CountingBackend backend;
+    {
+        // Room for every level-0 tile, so nothing is evicted and decoded
+        // again.
+        TileStreamer streamer(backend);
+        streamer.start(path);
+        std::vector<TileDraw> draws;
+
+        MapViewport view{.center_x = 256,
+                         .center_y = 256,
+                         .zoom = 1.0,
+                         .width = 512,
+                         .height = 512};
+        // Once settled the whole pyramid is built, so every tile in the
+        // drag can be requested.
+        REQUIRE(settle(streamer, view, draws));
+        // A drag across level 0: every frame asks again for whatever is
+        // still missing, including tiles the worker is decoding.
+        for (; view.center_x <= 1792; view.center_x += 4) {
+            view.center_y = view.center_x;
+            streamer.frame(view, draws);
+        }
+        REQUIRE(settle(streamer, view, draws));
+
+        auto stats = streamer.stats();
+        REQUIRE(stats.evictions == 0);
+        REQUIRE(stats.decodes == stats.uploads);
+        REQUIRE(backend.created() == stats.uploads);
+    }
+    std::filesystem::remove(path);
+}
+
+TEST_CASE("Benchmark map startup", "[!benchmark][map]") {
+    auto path = get_executable_dir() / "assets" / "japan_z6.png";
+    if (!std::filesystem::exists(path)) {
+        WARN("no map asset next to the test binary");
+        return;
+    }
+    MapViewport overview{.center_x = 3072,
+                         .center_y = 3072,
+                         .zoom = 720.0 / 6144.0,
+                         .width = 1280,
+                         .height = 720};
+
+    // The old path: inflate the whole image into one buffer.
+    BENCHMARK("decode the full PNG") {
+        std::string error;
+        auto rows = PngRows::open(path, error);
+        std::vector<uint8_t> image(std::size_t{rows->width()} *
+                                   rows->height() * 3);
+        for (uint32_t y = 0; y < rows->height(); y++) {
+            rows->next_row(std::span(image).subspan(
+                std::size_t{y} * rows->width() * 3));
+        }
+        return image.size();
+    };
+    BENCHMARK("first tiled frame") {
+        CountingBackend backend;
+        TileStreamer streamer(backend);
+        streamer.start(path);
+        std::vector<TileDraw> draws;
+        settle(streamer, overview, draws);
+        return streamer.stats().resident_bytes;
+    };
+
+    // What epsp-tilepack ships next to the client.
+    auto pack = std::filesystem::temp_directory_path() / "epsp_japan_z6.pack";
+    {
+        std::string error;
+        auto rows = PngRows::open(path, error);
+        TilePyramid pyramid(rows->width(), rows->height());
+        std::atomic<bool> cancel{false};
+        REQUIRE(build_pyramid(*rows, pyramid, cancel));
+        REQUIRE(write_tile_pack(pyramid, pack, error));
+    }
+    BENCHMARK("first frame from the tile pack") {
+        CountingBackend backend;
+        TileStreamer streamer(backend);
+        streamer.start(pack);
+        std::vector<TileDraw> draws;
+        settle(streamer, overview, draws);
+        return streamer.stats().resident_bytes;
+    };
+    std::filesystem::remove(pack);
+}
@@ -120,3 +120,91 @@ TEST_CASE("Run Full Handshake", "[comms][message]") {
     response = states.handle_message(message);
     REQUIRE(response == "stop");
 }
+
+TEST_CASE("Process Region Peer Counts", "[comms][message]") {
+    auto peer_dummy = init_peer_connection();
+    ServerStates states(epsp_state_server_t::EPSP_STATE_SERVER_ACTIVE,
+                        peer_dummy.connection_peer);
+
+    // No reply, and the session stays up.
+    REQUIRE(states.handle_message("247 1 250,40;355,3\r\n").empty());
+    REQUIRE(states.handle_message("247 1 250,40;355\r\n").empty());
+
+    // The counts reach the snapshot next to the 555 reports.
+    auto now = DetectionAggregator::clock::now();
+    detections().record(*find_region(355), now);
+    detections().publish(now);
+    const RegionDetections *area = nullptr;
+    for (const auto &region : detections().latest().regions) {
+        if (region.region == find_region(355)) {
+            area = &region;
+        }
+    }
+    REQUIRE(area != nullptr);
+    REQUIRE(area->peers == 3);
+}
+
+TEST_CASE("Process Peer Protocol Request", "[comms][message]") {
+    PeerStates states;
+    epsp_state_peer_t state = epsp_state_peer_t::EPSP_STATE_PEER_DISCONNECTED;
+
+    auto reply = states.handle_message("614 1 0.38:P2PDemo:0.0\r", state);
+
+    REQUIRE(reply.has_value());
+    REQUIRE(reply->target == epsp_peer_target_t::TARGET_UNICAST);
+    REQUIRE(reply->code ==
+            std::to_underlying(epsp_peer_code_t::EPSP_PEER_PRTL_REP));
+    REQUIRE(state == epsp_state_peer_t::EPSP_STATE_PEER_WAIT_PID_RQST);
+}
+
+TEST_CASE("Relay peer earthquake info", "[comms][message]") {
+    PeerStates states;
+    epsp_state_peer_t state = epsp_state_peer_t::EPSP_STATE_PEER_CONNECTED;
+
+    auto reply = states.handle_message("551 2 data\r", state);
+
+    REQUIRE(reply.has_value());
+    REQUIRE(reply->target == epsp_peer_target_t::TARGET_BROADCAST);
+    REQUIRE(reply->code == 551);
+    REQUIRE(reply->hop == 3);
+    REQUIRE(reply->payload == "data");
+    REQUIRE(state == epsp_state_peer_t::EPSP_STATE_PEER_CONNECTED);
+}
+
+TEST_CASE("Relay each report only once", "[comms][message]") {
+    PeerStates states;
+    epsp_state_peer_t state = epsp_state_peer_t::EPSP_STATE_PEER_CONNECTED;
+
+    REQUIRE(states.handle_message("551 2 data\r", state).has_value());
+    // Same report from another neighbour, further along the flood.
+    REQUIRE_FALSE(states.handle_message("551 4 data\r", state).has_value());
+    REQUIRE(states.handle_message("552 2 data\r", state).has_value());
+    REQUIRE(states.relay_stats().hits == 1);
+    REQUIRE(states.relay_stats().misses == 2);
+
+    // Echoes are never deduplicated.
+    REQUIRE(states.handle_message("611 1\r", state).has_value());
+    REQUIRE(states.handle_message("611 1\r", state).has_value());
+}
+
+TEST_CASE("Drop peer code outside its state", "[comms][message]") {
+    PeerStates states;
+    epsp_state_peer_t state = epsp_state_peer_t::EPSP_STATE_PEER_DISCONNECTED;
+
+    REQUIRE_FALSE(states.handle_message("551 2 data\r", state).has_value());
+    REQUIRE_FALSE(states.handle_message("634 1\r", state).has_value());
+    REQUIRE(state == epsp_state_peer_t::EPSP_STATE_PEER_DISCONNECTED);
+}
+
+TEST_CASE("Encode peer reply once", "[comms][message]") {
+    PeerStates::PeerReply reply{.target = epsp_peer_target_t::TARGET_BROADCAST,
+                                .code = 551,
+                                .hop = 3,
+                                .payload = "data"};
+
+    SharedMessage message = encode_peer_reply(reply);
+    SharedMessage shared = message;
+
+    REQUIRE(*message == "551 3 data\r\n");
+    REQUIRE(shared.get() == message.get());
+}
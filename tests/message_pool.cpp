@@ -0,0 +1,45 @@
+#include "../src/comms/message_pool.h"
+#include "../src/comms/outbound.h"
+#include <catch2/catch_test_macros.hpp>
+
+TEST_CASE("Reuse a buffer once every copy is gone", "[comms][message_pool]") {
+    MessagePool pool;
+
+    auto first = pool.acquire();
+    *first = "551 1 2024/01/01 12:00:00,3,1,4,Ishikawa,10km,5.3\r\n";
+    const auto *storage = first.get();
+    SharedMessage queued = std::move(first);
+    SharedMessage in_flight = queued;
+
+    // Still held by a queue and a write.
+    auto second = pool.acquire();
+    REQUIRE(second.get() != storage);
+    REQUIRE(pool.size() == 2);
+
+    queued.reset();
+    in_flight.reset();
+    second.reset();
+    auto reused = pool.acquire();
+    REQUIRE(reused.get() == storage);
+    REQUIRE(reused->empty());
+    REQUIRE(reused->capacity() >= 50);
+    REQUIRE(pool.reused() == 1);
+}
+
+TEST_CASE("Hand out one-off buffers past the limit",
+          "[comms][message_pool]") {
+    MessagePool pool(2);
+
+    auto first = pool.acquire();
+    auto second = pool.acquire();
+    auto third = pool.acquire();
+    REQUIRE(pool.size() == 2);
+    REQUIRE(pool.fallbacks() == 1);
+
+    // The one-off buffer is not the pool's to reuse.
+    third.reset();
+    first.reset();
+    REQUIRE(pool.acquire() != nullptr);
+    REQUIRE(pool.reused() == 1);
+    REQUIRE(pool.fallbacks() == 1);
+}
@@ -0,0 +1,66 @@
+#include "../src/comms/outbound.h"
+#include <catch2/catch_test_macros.hpp>
+
+namespace {
+auto make_message(std::size_t size) -> SharedMessage {
+    return std::make_shared<const std::string>(size, 'x');
+}
+} // namespace
+
+TEST_CASE("Coalesce queued messages into one flush", "[comms][outbound]") {
+    OutboundQueue queue;
+    std::vector<SharedMessage> batch;
+
+    queue.push(make_message(10));
+    REQUIRE(queue.begin_flush(batch));
+    REQUIRE(batch.size() == 1);
+
+    queue.push(make_message(10));
+    queue.push(make_message(10));
+    queue.push(make_message(10));
+    std::vector<SharedMessage> next;
+    REQUIRE_FALSE(queue.begin_flush(next));
+    REQUIRE(queue.stats().queue_depth == 3);
+
+    queue.end_flush(batch);
+    REQUIRE(queue.begin_flush(next));
+    REQUIRE(next.size() == 3);
+    queue.end_flush(next);
+
+    REQUIRE(queue.stats().flushes == 2);
+    REQUIRE(queue.stats().flushed_messages == 4);
+    REQUIRE(queue.stats().flushed_bytes == 40);
+    REQUIRE(queue.stats().last_flush_messages == 3);
+    REQUIRE(queue.stats().max_queue_depth == 3);
+}
+
+TEST_CASE("Drop oldest above high watermark", "[comms][outbound]") {
+    OutboundQueue queue(OutboundPolicy{
+        .high_watermark = 100,
+        .low_watermark = 40,
+        .slow_consumer = epsp_slow_consumer_t::SLOW_CONSUMER_DROP_OLDEST});
+
+    for (int i = 0; i < 10; i++) {
+        REQUIRE(queue.push(make_message(10)) ==
+                epsp_queue_push_t::QUEUE_PUSH_OK);
+    }
+    REQUIRE(queue.push(make_message(10)) ==
+            epsp_queue_push_t::QUEUE_PUSH_DROPPED);
+
+    REQUIRE(queue.stats().queued_bytes == 40);
+    REQUIRE(queue.stats().queue_depth == 4);
+    REQUIRE(queue.stats().dropped_messages == 7);
+    REQUIRE_FALSE(queue.congested());
+}
+
+TEST_CASE("Disconnect slow consumer", "[comms][outbound]") {
+    OutboundQueue queue(OutboundPolicy{
+        .high_watermark = 100,
+        .low_watermark = 40,
+        .slow_consumer = epsp_slow_consumer_t::SLOW_CONSUMER_DISCONNECT});
+
+    REQUIRE(queue.push(make_message(100)) == epsp_queue_push_t::QUEUE_PUSH_OK);
+    REQUIRE(queue.push(make_message(1)) ==
+            epsp_queue_push_t::QUEUE_PUSH_DISCONNECT);
+    REQUIRE(queue.congested());
+}
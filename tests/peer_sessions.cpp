@@ -0,0 +1,231 @@
+#include "../src/comms/event_channel.h"
+#include "../src/comms/io_pool.h"
+#include "alloc_counter.h"
+#include "remote_peer.h"
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include <future>
+#include <latch>
+
+namespace {
+// One ConnectionPeer on a single io thread with two remotes: reports sent
+// by `source` are relayed by the real peer sessions to `sink`.
+class RelayLink {
+public:
+    RelayLink() : io_pool_(1), source_(201), sink_(202) {
+        peer_ = init_peer_connection(io_pool_.context()).connection_peer;
+        peer_->set_outbound_policy(
+            {.high_watermark = 64 * 1024 * 1024, .low_watermark = 1024 * 1024});
+        auto source = std::async(std::launch::async,
+                                 [this] -> bool { return source_.accept(); });
+        auto sink = std::async(std::launch::async,
+                               [this] -> bool { return sink_.accept(); });
+        io_pool_.start();
+        peer_->connect_all({source_.candidate(), sink_.candidate()},
+                           PeerConnectOptions{},
+                           [](const std::vector<PeerConnectResult> &) -> void {
+                           });
+        connected_ = source.get() && sink.get();
+    }
+    ~RelayLink() {
+        source_.abort();
+        sink_.abort();
+        peer_->stop_all();
+        io_pool_.stop();
+    }
+    RelayLink(const RelayLink &) = delete;
+    auto operator=(const RelayLink &) -> RelayLink & = delete;
+
+    [[nodiscard]] auto connected() const -> bool { return connected_; }
+
+    // Sends `count` new 551 reports in one write and returns how many
+    // reached the sink.
+    auto relay(std::size_t count) -> std::size_t {
+        batch_.clear();
+        for (std::size_t i = 0; i < count; i++) {
+            batch_ += "551 1 2024/01/01 12:00:00,3,1,4,Ishikawa,10km,5.3,1,"
+                      "N37.5,E137.2,";
+            batch_ += std::to_string(seq_++) + "\r\n";
+        }
+        if (!source_.send(batch_)) {
+            return 0;
+        }
+        return sink_.expect("551", count);
+    }
+
+    // Turns allocation counting on or off on the io thread.
+    void count_io_allocations(bool enabled) {
+        std::latch done(1);
+        asio::post(*io_pool_.context(), [enabled, &done] -> void {
+            count_allocations(enabled);
+            done.count_down();
+        });
+        done.wait();
+    }
+
+private:
+    IoPool io_pool_;
+    std::shared_ptr<ConnectionPeer> peer_;
+    RemotePeer source_;
+    RemotePeer sink_;
+    bool connected_ = false;
+    std::string batch_;
+    // Reports must be new, or the seen cache drops them. Starting at seven
+    // digits keeps every line the same length.
+    uint64_t seq_ = 1'000'000;
+};
+
+// One ConnectionPeer with millisecond liveness timers and one remote, which
+// the test drives by hand.
+class LivenessLink {
+public:
+    explicit LivenessLink(LivenessOptions options)
+        : io_pool_(1), remote_(301) {
+        peer_ = init_peer_connection(io_pool_.context()).connection_peer;
+        peer_->set_liveness_options(options);
+        io_pool_.start();
+        peer_->connect_all({remote_.candidate()}, PeerConnectOptions{},
+                           [](const std::vector<PeerConnectResult> &) -> void {
+                           });
+    }
+    ~LivenessLink() {
+        remote_.abort();
+        peer_->stop_all();
+        io_pool_.stop();
+    }
+    LivenessLink(const LivenessLink &) = delete;
+    auto operator=(const LivenessLink &) -> LivenessLink & = delete;
+
+    auto remote() -> RemotePeer & { return remote_; }
+
+    auto stats() -> std::vector<PeerLiveness> {
+        std::promise<std::vector<PeerLiveness>> done;
+        peer_->liveness_stats(
+            [&done](std::vector<PeerLiveness> stats) -> void {
+                done.set_value(std::move(stats));
+            });
+        return done.get_future().get();
+    }
+
+private:
+    IoPool io_pool_;
+    std::shared_ptr<ConnectionPeer> peer_;
+    RemotePeer remote_;
+};
+} // namespace
+
+TEST_CASE("Relay reports through the peer sessions", "[comms][peer]") {
+    auto level = spdlog::get_level();
+    spdlog::set_level(spdlog::level::warn);
+    {
+        RelayLink link;
+        REQUIRE(link.connected());
+        REQUIRE(link.relay(1) == 1);
+        REQUIRE(link.relay(10'000) == 10'000);
+    }
+    spdlog::set_level(level);
+}
+
+TEST_CASE("Relay reports without per-message allocations", "[comms][peer]") {
+    constexpr std::size_t total = 100'000;
+    constexpr std::size_t batch = 100;
+    auto level = spdlog::get_level();
+    spdlog::set_level(spdlog::level::warn);
+    {
+        RelayLink link;
+        REQUIRE(link.connected());
+
+        // The GUI side: drain the events so the ring cells are reused.
+        std::vector<NetEvent> events;
+        auto relay = [&] -> bool {
+            bool relayed = link.relay(batch) == batch;
+            events.clear();
+            net_events().drain(events);
+            return relayed;
+        };
+        // First use sizes the pools, queues and event cells.
+        bool warmed = true;
+        for (std::size_t i = 0; i < EventChannel::CAPACITY * 2 / batch; i++) {
+            warmed &= relay();
+        }
+        REQUIRE(warmed);
+
+        reset_allocations();
+        link.count_io_allocations(true);
+        bool relayed = true;
+        for (std::size_t sent = 0; sent < total; sent += batch) {
+            relayed &= relay();
+        }
+        link.count_io_allocations(false);
+
+        REQUIRE(relayed);
+        REQUIRE(counted_allocations() == 0);
+    }
+    spdlog::set_level(level);
+}
+
+TEST_CASE("Echo peers and report the round trip", "[comms][peer]") {
+    LivenessLink link({.tick = std::chrono::milliseconds(5),
+                       .echo_interval = std::chrono::milliseconds(50),
+                       .idle_timeout = std::chrono::milliseconds(5000),
+                       .handshake_timeout = std::chrono::milliseconds(5000)});
+    REQUIRE(link.remote().accept());
+
+    // The echo timer sends 611; answering it gives the peer an RTT.
+    REQUIRE(link.remote().expect("611"));
+    REQUIRE(link.remote().send("631 1\r\n"));
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+    std::vector<PeerLiveness> stats;
+    do {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        stats = link.stats();
+    } while (!stats.empty() && stats.front().rtt.count() == 0 &&
+             std::chrono::steady_clock::now() < deadline);
+
+    REQUIRE(stats.size() == 1);
+    REQUIRE(stats.front().peer_id == link.remote().peer_id());
+    REQUIRE(stats.front().rtt.count() > 0);
+    REQUIRE(stats.front().idle < std::chrono::seconds(2));
+}
+
+TEST_CASE("Evict a peer that goes silent", "[comms][peer]") {
+    LivenessLink link({.tick = std::chrono::milliseconds(5),
+                       .echo_interval = std::chrono::milliseconds(20),
+                       .idle_timeout = std::chrono::milliseconds(150),
+                       .handshake_timeout = std::chrono::milliseconds(5000)});
+    REQUIRE(link.remote().accept());
+    REQUIRE(link.stats().size() == 1);
+
+    // Echoes go unanswered until the idle timer drops the peer.
+    REQUIRE(link.remote().closed_within(std::chrono::seconds(3)));
+    REQUIRE(link.stats().empty());
+}
+
+TEST_CASE("Evict a peer that never completes the handshake",
+          "[comms][peer]") {
+    LivenessLink link({.tick = std::chrono::milliseconds(5),
+                       .echo_interval = std::chrono::milliseconds(5000),
+                       .idle_timeout = std::chrono::milliseconds(5000),
+                       .handshake_timeout = std::chrono::milliseconds(100)});
+    REQUIRE(link.remote().accept_silently());
+
+    REQUIRE(link.remote().closed_within(std::chrono::seconds(3)));
+    REQUIRE(link.stats().empty());
+}
+
+// Runs the shipped ConnectionPeer sessions; build it against another
+// revision's src/comms to compare session implementations.
+TEST_CASE("Benchmark peer sessions", "[!benchmark][comms][peer]") {
+    auto level = spdlog::get_level();
+    spdlog::set_level(spdlog::level::warn);
+    {
+        RelayLink link;
+        REQUIRE(link.connected());
+
+        // Throughput: 10k reports pipelined through the relay.
+        BENCHMARK("relay 10k reports") { return link.relay(10'000); };
+        // Latency: one report at a time.
+        BENCHMARK("relay 1 report") { return link.relay(1); };
+    }
+    spdlog::set_level(level);
+}
@@ -0,0 +1,134 @@
+#include "../src/map/projection.h"
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+namespace {
+auto position(std::string_view code) -> std::size_t {
+    return static_cast<std::size_t>(find_region(code) - regions.data());
+}
+} // namespace
+
+TEST_CASE("Project onto the map's pixel grid", "[map]") {
+    // download.py's block: tiles 53..58 x 22..27 at zoom 6.
+    auto grid = japan_map_grid();
+    REQUIRE(grid.x_min == 53);
+    REQUIRE(grid.y_min == 22);
+    REQUIRE(grid.width() == 6144);
+    REQUIRE(grid.height() == 6144);
+
+    // Where the equator meets the antimeridian: a tile corner.
+    auto [x, y] = mercator_px(grid, 0.0, 180.0);
+    REQUIRE(std::abs(x - (64 - 53) * 1024.0) < 1e-6);
+    REQUIRE(std::abs(y - (32 - 22) * 1024.0) < 1e-6);
+    // Tokyo station, as download.py's latlon_to_tile scales it.
+    auto [tokyo_x, tokyo_y] = mercator_px(grid, 35.681, 139.767);
+    REQUIRE(std::abs(tokyo_x - 3939.8) < 0.1);
+    REQUIRE(std::abs(tokyo_y - 3278.7) < 0.1);
+}
+
+TEST_CASE("Transform regions to the screen", "[map]") {
+    RegionProjection projection(japan_map_grid());
+    REQUIRE(projection.size() > 100);
+    REQUIRE_FALSE(projection.to_screen({}, position("900")));
+
+    // Zoomed in: every region, each where to_screen() puts it.
+    MapViewport view{.center_x = 3072,
+                     .center_y = 3072,
+                     .zoom = 1.0,
+                     .width = 6144,
+                     .height = 6144};
+    ScreenPoints points;
+    projection.transform(view, 0.0F, points);
+    REQUIRE(points.size() == projection.size());
+    for (std::size_t i = 0; i < points.size(); i++) {
+        auto at = projection.to_screen(view, points.region[i]);
+        REQUIRE(at);
+        REQUIRE(std::abs(points.x[i] - at->first) < 0.01F);
+        REQUIRE(std::abs(points.y[i] - at->second) < 0.01F);
+    }
+
+    // A small window around Tokyo sees only its neighbours.
+    auto tokyo = position("250");
+    auto [tx, ty] = mercator_px(japan_map_grid(), regions[tokyo].lat,
+                                regions[tokyo].lon);
+    MapViewport kanto{.center_x = tx,
+                      .center_y = ty,
+                      .zoom = 2.0,
+                      .width = 200,
+                      .height = 200};
+    projection.transform(kanto, 0.0F, points);
+    REQUIRE(std::ranges::find(points.region, tokyo) != points.region.end());
+    REQUIRE(points.size() < 20);
+    for (std::size_t i = 0; i < points.size(); i++) {
+        REQUIRE(points.x[i] >= 0.0F);
+        REQUIRE(points.x[i] <= 200.0F);
+    }
+}
+
+TEST_CASE("Thin markers out by level of detail", "[map]") {
+    RegionProjection projection(japan_map_grid());
+    MapViewport view{.center_x = 3072,
+                     .center_y = 3072,
+                     .zoom = 1.0,
+                     .width = 6144,
+                     .height = 6144};
+    ScreenPoints points;
+    std::size_t previous = SIZE_MAX;
+    for (double zoom : {1.0, 0.5, 0.25, 0.125, 0.0625, 0.03125}) {
+        view.zoom = zoom;
+        view.width = static_cast<float>(6144 * zoom);
+        view.height = view.width;
+        projection.transform(view, 0.0F, points);
+        REQUIRE(!points.region.empty());
+        REQUIRE(points.size() <= previous);
+        previous = points.size();
+        if (zoom == 1.0) {
+            continue;
+        }
+        // Shown markers keep their distance.
+        for (std::size_t i = 0; i < points.size(); i++) {
+            for (std::size_t j = i + 1; j < points.size(); j++) {
+                REQUIRE(std::hypot(points.x[i] - points.x[j],
+                                   points.y[i] - points.y[j]) >=
+                        RegionProjection::MARKER_SPACING - 0.01F);
+            }
+            REQUIRE(*projection.min_zoom(points.region[i]) <= zoom);
+        }
+    }
+    REQUIRE(previous < projection.size() / 4);
+}
+
+TEST_CASE("Benchmark region projection", "[!benchmark][map]") {
+    MapViewport view{.center_x = 3072,
+                     .center_y = 3072,
+                     .zoom = 0.3,
+                     .width = 1280,
+                     .height = 720};
+    BENCHMARK("Mercator per frame") {
+        // The per-frame trig the cache replaces.
+        auto grid = japan_map_grid();
+        float sum = 0.0F;
+        for (const auto &region : regions) {
+            if (region.lat == 0.0 && region.lon == 0.0) {
+                continue;
+            }
+            auto [x, y] = mercator_px(grid, region.lat, region.lon);
+            sum += static_cast<float>((x - view.center_x) * view.zoom +
+                                      (y - view.center_y) * view.zoom);
+        }
+        return sum;
+    };
+    const auto &projection = region_projection();
+    ScreenPoints points;
+    BENCHMARK("cached transform with level of detail") {
+        projection.transform(view, 12.0F, points);
+        return points.size();
+    };
+    view.zoom = 1.0;
+    view.width = 6144;
+    view.height = 6144;
+    BENCHMARK("cached transform, every region") {
+        projection.transform(view, 12.0F, points);
+        return points.size();
+    };
+}
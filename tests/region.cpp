@@ -0,0 +1,72 @@
+#include "../src/utils/region.h"
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+namespace {
+static_assert(regions.size() == 369);
+static_assert(find_region(355)->area == "長野南部");
+static_assert(find_region("010")->code_num == 10);
+static_assert(find_region(999) == nullptr);
+
+// The table as it was before: a std::vector of std::string records built
+// by a static constructor.
+struct HeapRegion {
+    std::string code;
+    int code_num;
+    std::string regions;
+    std::string pref;
+    std::string area;
+    double lat;
+    double lon;
+};
+
+auto heap_regions() -> std::vector<HeapRegion> {
+    std::vector<HeapRegion> table;
+    table.reserve(regions.size());
+    for (const auto &region : regions) {
+        table.push_back({.code = std::string(region.code),
+                         .code_num = region.code_num,
+                         .regions = std::string(region.regions),
+                         .pref = std::string(region.pref),
+                         .area = std::string(region.area),
+                         .lat = region.lat,
+                         .lon = region.lon});
+    }
+    return table;
+}
+} // namespace
+
+TEST_CASE("Look up regions by code", "[utils][region]") {
+    for (const auto &region : regions) {
+        REQUIRE(find_region(region.code_num) == &region);
+        REQUIRE(find_region(region.code) == &region);
+    }
+    REQUIRE(find_region(-1) == nullptr);
+    REQUIRE(find_region(1000) == nullptr);
+    REQUIRE(find_region("10") == nullptr);
+    REQUIRE(find_region("1x0") == nullptr);
+    REQUIRE(find_region(356) == nullptr);
+}
+
+TEST_CASE("Benchmark region table", "[!benchmark][utils][region]") {
+    // What every including translation unit used to pay at start-up.
+    BENCHMARK("build the heap table") { return heap_regions(); };
+
+    auto table = heap_regions();
+    BENCHMARK("look up every code by linear scan") {
+        std::size_t found = 0;
+        for (const auto &region : regions) {
+            auto match = std::ranges::find(table, region.code_num,
+                                           &HeapRegion::code_num);
+            found += match != table.end() ? 1 : 0;
+        }
+        return found;
+    };
+    BENCHMARK("look up every code by index") {
+        std::size_t found = 0;
+        for (const auto &region : regions) {
+            found += find_region(region.code_num) != nullptr ? 1 : 0;
+        }
+        return found;
+    };
+}
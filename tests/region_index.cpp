@@ -0,0 +1,108 @@
+#include "../src/utils/region_index.h"
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include <random>
+
+namespace {
+// Haversine over every located row, nearest first: what callers would do
+// without the index.
+void brute_within(double lat, double lon, double km,
+                  std::vector<RegionHit> &hits) {
+    hits.clear();
+    for (const auto &region : regions) {
+        if (region.lat == 0.0 && region.lon == 0.0) {
+            continue;
+        }
+        auto distance = haversine_km(lat, lon, region.lat, region.lon);
+        if (distance <= km) {
+            hits.push_back({.region = &region, .km = distance});
+        }
+    }
+    std::ranges::sort(hits, {}, &RegionHit::km);
+}
+
+auto same_hits(const std::vector<RegionHit> &lhs,
+               const std::vector<RegionHit> &rhs) -> bool {
+    if (lhs.size() != rhs.size()) {
+        return false;
+    }
+    for (std::size_t i = 0; i < lhs.size(); i++) {
+        if (std::abs(lhs[i].km - rhs[i].km) > 1e-6) {
+            return false;
+        }
+    }
+    return true;
+}
+} // namespace
+
+TEST_CASE("Find regions around a point", "[utils][region_index]") {
+    const auto &index = region_index();
+    auto located =
+        std::ranges::count_if(regions, [](const Region &region) -> bool {
+            return region.lat != 0.0 || region.lon != 0.0;
+        });
+    REQUIRE(index.size() == static_cast<std::size_t>(located));
+
+    std::vector<RegionHit> hits;
+    index.nearest(35.699, 139.502, 1, hits);
+    REQUIRE(hits.size() == 1);
+    REQUIRE(hits[0].region->code == "250");
+    REQUIRE(hits[0].km < 1e-6);
+
+    index.within_radius(0.0, -30.0, 500.0, hits);
+    REQUIRE(hits.empty());
+    index.nearest(0.0, -30.0, 3, hits);
+    REQUIRE(hits.size() == 3);
+    index.nearest(35.0, 135.0, 10'000, hits);
+    REQUIRE(hits.size() == index.size());
+}
+
+TEST_CASE("Match brute force on random queries", "[utils][region_index]") {
+    const auto &index = region_index();
+    std::mt19937 random(551);
+    std::uniform_real_distribution<double> lat(20.0, 50.0);
+    std::uniform_real_distribution<double> lon(118.0, 160.0);
+    std::uniform_real_distribution<double> radius(1.0, 800.0);
+
+    std::vector<RegionHit> expected;
+    std::vector<RegionHit> hits;
+    bool matched = true;
+    for (int i = 0; i < 2000; i++) {
+        double qlat = lat(random);
+        double qlon = lon(random);
+        double km = radius(random);
+        brute_within(qlat, qlon, km, expected);
+        index.within_radius(qlat, qlon, km, hits);
+        matched &= same_hits(hits, expected);
+
+        brute_within(qlat, qlon, 1e9, expected);
+        expected.resize(5);
+        index.nearest(qlat, qlon, 5, hits);
+        matched &= same_hits(hits, expected);
+    }
+    REQUIRE(matched);
+}
+
+TEST_CASE("Benchmark region index", "[!benchmark][utils][region_index]") {
+    const auto &index = region_index();
+    std::vector<RegionHit> hits;
+
+    // Around an epicenter off Ibaraki.
+    BENCHMARK("brute force within 150 km") {
+        brute_within(36.3, 140.9, 150.0, hits);
+        return hits.size();
+    };
+    BENCHMARK("index within 150 km") {
+        index.within_radius(36.3, 140.9, 150.0, hits);
+        return hits.size();
+    };
+    BENCHMARK("brute force 5 nearest") {
+        brute_within(36.3, 140.9, 1e9, hits);
+        hits.resize(5);
+        return hits.size();
+    };
+    BENCHMARK("index 5 nearest") {
+        index.nearest(36.3, 140.9, 5, hits);
+        return hits.size();
+    };
+}
@@ -0,0 +1,111 @@
+#pragma once
+#include "../src/comms/peer.h"
+#include "asio.hpp"
+#include <future>
+#include <sys/socket.h>
+
+// Blocking stand-in for a remote peer, driven from its own thread: it
+// accepts our connection, answers the handshake and then reads and writes
+// raw lines.
+class RemotePeer {
+public:
+    explicit RemotePeer(uint32_t peer_id)
+        : peer_id_(peer_id),
+          acceptor_(io_context_,
+                    asio::ip::tcp::endpoint(
+                        asio::ip::make_address("127.0.0.1"), 0)),
+          socket_(io_context_) {}
+
+    [[nodiscard]] auto candidate() const -> PeerCandidate {
+        return {.peer_id = peer_id_, .endpoint = acceptor_.local_endpoint()};
+    }
+
+    // Accepts the ConnectionPeer's connection and completes the handshake.
+    auto accept() -> bool {
+        return accept_silently() && expect("614") && send("634 1 0.38:test:1\r\n") &&
+               expect("612") &&
+               send("632 1 " + std::to_string(peer_id_) + "\r\n") &&
+               send("611 1\r\n") && expect("631");
+    }
+
+    // Accepts the connection but leaves the handshake unanswered.
+    auto accept_silently() -> bool {
+        asio::error_code ecode;
+        acceptor_.accept(socket_, ecode);
+        if (ecode) {
+            return false;
+        }
+        handle_.store(socket_.native_handle());
+        return true;
+    }
+
+    // Reads and drops lines until the ConnectionPeer closes the socket.
+    auto closed_within(std::chrono::milliseconds timeout) -> bool {
+        auto closed = std::async(std::launch::async, [this] -> bool {
+            std::string line;
+            while (read_line(line)) {
+            }
+            return true;
+        });
+        if (closed.wait_for(timeout) == std::future_status::ready) {
+            return true;
+        }
+        abort();
+        return false;
+    }
+
+    auto read_line(std::string &line) -> bool {
+        asio::error_code ecode;
+        asio::read_until(socket_, buffer_, '\n', ecode);
+        if (ecode) {
+            return false;
+        }
+        std::istream stream(&buffer_);
+        std::getline(stream, line);
+        return true;
+    }
+
+    // Skips anything else (e.g. echoes) until a line starting with `code`.
+    auto expect(std::string_view code) -> bool {
+        std::string line;
+        while (read_line(line)) {
+            if (line.starts_with(code)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Reads until `count` lines starting with `code` have arrived.
+    auto expect(std::string_view code, std::size_t count) -> std::size_t {
+        std::size_t received = 0;
+        std::string line;
+        while (received < count && read_line(line)) {
+            received += line.starts_with(code) ? 1 : 0;
+        }
+        return received;
+    }
+
+    auto send(const std::string &data) -> bool {
+        asio::error_code ecode;
+        asio::write(socket_, asio::buffer(data), ecode);
+        return !ecode;
+    }
+
+    // Wakes a blocked read from another thread.
+    void abort() {
+        if (auto handle = handle_.load(); handle >= 0) {
+            ::shutdown(handle, SHUT_RDWR);
+        }
+    }
+
+    [[nodiscard]] auto peer_id() const -> uint32_t { return peer_id_; }
+
+private:
+    uint32_t peer_id_;
+    asio::io_context io_context_;
+    asio::ip::tcp::acceptor acceptor_;
+    asio::ip::tcp::socket socket_;
+    asio::streambuf buffer_;
+    std::atomic<int> handle_{-1};
+};
@@ -0,0 +1,61 @@
+#include "../src/comms/seen_cache.h"
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include <string>
+
+namespace {
+const auto start = SeenCache::clock::time_point{} + std::chrono::hours(1);
+} // namespace
+
+TEST_CASE("Drop duplicates within the TTL", "[comms][seen]") {
+    SeenCache cache(64, std::chrono::seconds(10));
+
+    REQUIRE(cache.insert(551, "report", start));
+    REQUIRE_FALSE(cache.insert(551, "report", start));
+    REQUIRE(cache.insert(552, "report", start));
+    REQUIRE(cache.insert(551, "other", start));
+
+    REQUIRE_FALSE(
+        cache.insert(551, "report", start + std::chrono::seconds(9)));
+    REQUIRE(cache.insert(551, "report", start + std::chrono::seconds(10)));
+
+    REQUIRE(cache.stats().hits == 2);
+    REQUIRE(cache.stats().misses == 4);
+}
+
+TEST_CASE("Stay bounded under a flood", "[comms][seen]") {
+    SeenCache cache(1024, std::chrono::minutes(1));
+
+    for (int i = 0; i < 100'000; i++) {
+        REQUIRE(cache.insert(555, std::to_string(i), start));
+    }
+    REQUIRE(cache.stats().evictions > 0);
+
+    // The most recent sightings survive the churn.
+    REQUIRE_FALSE(cache.insert(555, "99999", start));
+
+    cache.clear();
+    REQUIRE(cache.insert(555, "99999", start));
+    REQUIRE(cache.stats().misses == 1);
+}
+
+TEST_CASE("Benchmark duplicate suppression", "[!benchmark][comms][seen]") {
+    // One in four lines is new; the rest repeat a recent report, as when
+    // every neighbour forwards the same flood.
+    std::vector<std::string> lines;
+    lines.reserve(1 << 20);
+    for (std::size_t i = 0; i < lines.capacity(); i++) {
+        auto report = i % 4 == 0 ? i : i - (i % 4);
+        lines.push_back("2024/01/01 00:00:00,37.5,141.2,M" +
+                        std::to_string(report));
+    }
+
+    BENCHMARK("SeenCache 1M mixed lines") {
+        SeenCache cache;
+        std::size_t relayed = 0;
+        for (const auto &line : lines) {
+            relayed += cache.insert(551, line, start) ? 1 : 0;
+        }
+        return relayed;
+    };
+}
@@ -0,0 +1,85 @@
+#include "../src/comms/slot_map.h"
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include <memory>
+#include <unordered_map>
+
+TEST_CASE("Resolve live handles only", "[comms][slot_map]") {
+    SlotMap<int> map;
+    auto first = map.insert(1);
+    auto second = map.insert(2);
+    auto third = map.insert(3);
+    REQUIRE(map.size() == 3);
+
+    REQUIRE(map.erase(first));
+    REQUIRE_FALSE(map.erase(first));
+    REQUIRE(map.get(first) == nullptr);
+    REQUIRE(*map.get(second) == 2);
+    REQUIRE(*map.get(third) == 3);
+
+    // The freed slot is reused under a new generation.
+    auto fourth = map.insert(4);
+    REQUIRE(fourth.index == first.index);
+    REQUIRE_FALSE(fourth == first);
+    REQUIRE(map.get(first) == nullptr);
+    REQUIRE(*map.get(fourth) == 4);
+
+    REQUIRE(map.handle_at(fourth.index) == fourth);
+    REQUIRE(map.handle_at(99) == SlotHandle{});
+    REQUIRE(map.get(SlotHandle{}) == nullptr);
+}
+
+TEST_CASE("Keep values dense across erases", "[comms][slot_map]") {
+    SlotMap<int> map;
+    std::vector<SlotHandle> handles;
+    for (int i = 0; i < 100; i++) {
+        handles.push_back(map.insert(i));
+    }
+    for (int i = 0; i < 100; i += 2) {
+        REQUIRE(map.erase(handles[i]));
+    }
+
+    REQUIRE(map.size() == 50);
+    int sum = 0;
+    for (int value : map) {
+        REQUIRE(value % 2 == 1);
+        sum += value;
+    }
+    REQUIRE(sum == 2500);
+    for (int i = 1; i < 100; i += 2) {
+        REQUIRE(*map.get(handles[i]) == i);
+    }
+
+    map.clear();
+    REQUIRE(map.empty());
+    REQUIRE(map.get(handles[1]) == nullptr);
+}
+
+TEST_CASE("Benchmark broadcast scan", "[!benchmark][comms][slot_map]") {
+    struct Peer {
+        bool connected = true;
+        uint64_t sent = 0;
+    };
+    constexpr uint32_t peers = 64;
+
+    std::unordered_map<uint32_t, std::shared_ptr<Peer>> by_id;
+    SlotMap<std::shared_ptr<Peer>> slots;
+    for (uint32_t pid = 0; pid < peers; pid++) {
+        by_id.emplace(pid * 7919, std::make_shared<Peer>());
+        slots.insert(std::make_shared<Peer>());
+    }
+
+    BENCHMARK("unordered_map broadcast") {
+        for (auto &[pid, peer] : by_id) {
+            peer->sent += peer->connected ? 1 : 0;
+        }
+        return by_id.size();
+    };
+
+    BENCHMARK("SlotMap broadcast") {
+        for (auto &peer : slots) {
+            peer->sent += peer->connected ? 1 : 0;
+        }
+        return slots.size();
+    };
+}
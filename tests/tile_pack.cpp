@@ -0,0 +1,446 @@
+#include "../src/map/mvt_raster.h"
+#include "../src/map/tile_pack.h"
+#include "../src/utils/path.h"
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include <fstream>
+
+namespace {
+// Just enough protobuf to write vector tiles.
+struct Pb {
+    std::vector<uint8_t> out;
+
+    void varint(uint64_t value) {
+        while (value >= 0x80) {
+            out.push_back(static_cast<uint8_t>(value | 0x80));
+            value >>= 7;
+        }
+        out.push_back(static_cast<uint8_t>(value));
+    }
+    void field(uint32_t number, uint64_t value) {
+        varint(uint64_t{number} << 3);
+        varint(value);
+    }
+    void bytes(uint32_t number, std::span<const uint8_t> data) {
+        varint((uint64_t{number} << 3) | 2);
+        varint(data.size());
+        out.insert(out.end(), data.begin(), data.end());
+    }
+    void text(uint32_t number, std::string_view data) {
+        bytes(number, {reinterpret_cast<const uint8_t *>(data.data()),
+                       data.size()});
+    }
+    void packed(uint32_t number, std::span<const uint32_t> values) {
+        Pb inner;
+        for (auto value : values) {
+            inner.varint(value);
+        }
+        bytes(number, inner.out);
+    }
+};
+
+auto zigzag(int32_t value) -> uint32_t {
+    return (static_cast<uint32_t>(value) << 1) ^
+           static_cast<uint32_t>(value >> 31);
+}
+
+// Geometry commands for closed rings or open lines of absolute points.
+auto commands(const std::vector<std::vector<MvtPoint>> &parts, bool close)
+    -> std::vector<uint32_t> {
+    std::vector<uint32_t> out;
+    MvtPoint at{0, 0};
+    for (const auto &part : parts) {
+        auto points = close ? part.size() - 1 : part.size();
+        for (std::size_t i = 0; i < points; i++) {
+            if (i < 2) {
+                out.push_back(i == 0 ? (1 << 3) | 1
+                                     : static_cast<uint32_t>(
+                                           ((points - 1) << 3) | 2));
+            }
+            out.push_back(zigzag(part[i].x - at.x));
+            out.push_back(zigzag(part[i].y - at.y));
+            at = part[i];
+        }
+        if (close) {
+            out.push_back((1 << 3) | 7);
+        }
+    }
+    return out;
+}
+
+struct TestFeature {
+    epsp_mvt_geom_t type;
+    std::vector<std::vector<MvtPoint>> parts;
+    std::vector<uint32_t> tags;
+};
+
+auto layer(std::string_view name, uint32_t extent,
+           const std::vector<TestFeature> &features,
+           const std::vector<std::string_view> &keys,
+           const std::vector<int64_t> &values) -> std::vector<uint8_t> {
+    Pb pb;
+    pb.field(15, 2);
+    pb.text(1, name);
+    for (const auto &feature : features) {
+        Pb inner;
+        inner.packed(2, feature.tags);
+        inner.field(3, feature.type);
+        inner.packed(4, commands(feature.parts, feature.type == MVT_POLYGON));
+        pb.bytes(2, inner.out);
+    }
+    for (auto key : keys) {
+        pb.text(3, key);
+    }
+    for (auto value : values) {
+        Pb inner;
+        inner.field(4, static_cast<uint64_t>(value));
+        pb.bytes(4, inner.out);
+    }
+    pb.field(5, extent);
+    return pb.out;
+}
+
+auto square(int32_t x0, int32_t y0, int32_t x1, int32_t y1)
+    -> std::vector<MvtPoint> {
+    return {{x0, y0}, {x1, y0}, {x1, y1}, {x0, y1}, {x0, y0}};
+}
+
+// Water with an island, a country border, a prefecture border and a
+// maritime border that must not be drawn; extent 64.
+auto basemap_tile(int32_t shift = 0) -> std::vector<uint8_t> {
+    Pb tile;
+    tile.bytes(3, layer("water", 64,
+                        {{.type = MVT_POLYGON,
+                          .parts = {square(0, 0, 32 + shift, 64),
+                                    square(8, 8, 16, 16)},
+                          .tags = {}}},
+                        {}, {}));
+    tile.bytes(3, layer("landuse", 64,
+                        {{.type = MVT_POLYGON,
+                          .parts = {square(40, 0, 64, 64)},
+                          .tags = {}}},
+                        {}, {}));
+    // keys: admin_level, maritime; values: 2, 4, 1
+    tile.bytes(3, layer("boundary", 64,
+                        {{.type = MVT_LINESTRING,
+                          .parts = {{{48, 4}, {48, 60}}},
+                          .tags = {0, 0}},
+                         {.type = MVT_LINESTRING,
+                          .parts = {{{40, 32}, {60, 32}}},
+                          .tags = {0, 1}},
+                         {.type = MVT_LINESTRING,
+                          .parts = {{{56, 4}, {56, 60}}},
+                          .tags = {0, 0, 1, 2}}},
+                        {"admin_level", "maritime"}, {2, 4, 1}));
+    return tile.out;
+}
+
+auto gzip(std::span<const uint8_t> data) -> std::vector<uint8_t> {
+    z_stream stream{};
+    deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 16 + MAX_WBITS,
+                 8, Z_DEFAULT_STRATEGY);
+    std::vector<uint8_t> out(deflateBound(&stream,
+                                          static_cast<uLong>(data.size())) +
+                             32);
+    stream.next_in = const_cast<Bytef *>(data.data());
+    stream.avail_in = static_cast<uInt>(data.size());
+    stream.next_out = out.data();
+    stream.avail_out = static_cast<uInt>(out.size());
+    deflate(&stream, Z_FINISH);
+    out.resize(stream.total_out);
+    deflateEnd(&stream);
+    return out;
+}
+
+void write_file(const std::filesystem::path &path,
+                std::span<const uint8_t> data) {
+    std::filesystem::create_directories(path.parent_path());
+    std::ofstream(path, std::ios::binary)
+        .write(reinterpret_cast<const char *>(data.data()),
+               static_cast<std::streamsize>(data.size()));
+}
+
+// Level-0 rows of a pattern that compresses unevenly.
+auto pattern_rows(uint32_t width) -> RowSource {
+    return [width, y = 0U](std::span<uint8_t> rgb) mutable -> bool {
+        for (uint32_t x = 0; x < width; x++) {
+            rgb[x * 3] = static_cast<uint8_t>(x ^ y);
+            rgb[x * 3 + 1] = static_cast<uint8_t>(x * y);
+            rgb[x * 3 + 2] = static_cast<uint8_t>(y);
+        }
+        y++;
+        return true;
+    };
+}
+
+auto same_tiles(const TileSource &a, const TileSource &b) -> bool {
+    TileImage left;
+    TileImage right;
+    for (uint8_t level = 0; level < a.levels(); level++) {
+        for (uint16_t y = 0; y < a.rows(level); y++) {
+            for (uint16_t x = 0; x < a.columns(level); x++) {
+                TileKey key{.level = level, .x = x, .y = y};
+                if (!a.decode(key, left) || !b.decode(key, right) ||
+                    left.width != right.width ||
+                    left.height != right.height || left.rgb != right.rgb) {
+                    return false;
+                }
+            }
+        }
+    }
+    return true;
+}
+} // namespace
+
+TEST_CASE("Decode a vector tile", "[map]") {
+    auto raw = basemap_tile();
+    for (const auto &data : {raw, gzip(raw)}) {
+        MvtTile tile;
+        std::string error;
+        REQUIRE(decode_mvt(data, tile, error));
+        REQUIRE(tile.layers.size() == 3);
+
+        const auto *water = tile.layer("water");
+        REQUIRE(water != nullptr);
+        REQUIRE(water->extent == 64);
+        REQUIRE(water->features.size() == 1);
+        const auto &rings = water->features[0].parts;
+        REQUIRE(rings.size() == 2);
+        // ClosePath repeats the first point.
+        REQUIRE(rings[1].size() == 5);
+        REQUIRE(rings[1][2].x == 16);
+        REQUIRE(rings[1][2].y == 16);
+        REQUIRE(rings[1].back().x == 8);
+
+        const auto *boundary = tile.layer("boundary");
+        REQUIRE(boundary != nullptr);
+        REQUIRE(boundary->features[0].type == MVT_LINESTRING);
+        REQUIRE(boundary->int_property(boundary->features[1],
+                                       "admin_level") == 4);
+        REQUIRE(boundary->int_property(boundary->features[2], "maritime") ==
+                1);
+        REQUIRE(boundary->int_property(boundary->features[0], "maritime") ==
+                0);
+    }
+
+    // Only the layers asked for.
+    MvtTile tile;
+    std::string error;
+    std::array<std::string_view, 1> wanted = {"boundary"};
+    REQUIRE(decode_mvt(raw, tile, error, wanted));
+    REQUIRE(tile.layers.size() == 1);
+    REQUIRE(tile.layer("water") == nullptr);
+
+    raw.resize(raw.size() / 2);
+    REQUIRE_FALSE(decode_mvt(raw, tile, error));
+    REQUIRE_FALSE(error.empty());
+}
+
+TEST_CASE("Fill polygons with holes", "[map]") {
+    constexpr Rgb BG = {0, 0, 0};
+    constexpr Rgb INK = {9, 9, 9};
+    Canvas canvas(16, 16, BG);
+    std::vector<std::vector<PointF>> rings = {
+        {{2, 2}, {14, 2}, {14, 14}, {2, 14}},
+        {{6, 6}, {10, 6}, {10, 10}, {6, 10}},
+    };
+    canvas.fill_polygon(rings, INK);
+
+    REQUIRE(canvas.pixel(2, 2) == INK);
+    REQUIRE(canvas.pixel(13, 13) == INK);
+    REQUIRE(canvas.pixel(5, 8) == INK);
+    // Centres outside the outer ring or inside the hole stay clear.
+    REQUIRE(canvas.pixel(14, 14) == BG);
+    REQUIRE(canvas.pixel(1, 8) == BG);
+    REQUIRE(canvas.pixel(6, 6) == BG);
+    REQUIRE(canvas.pixel(9, 9) == BG);
+
+    // A triangle reaching off the canvas is clipped, not wrapped.
+    Canvas clipped(8, 8, BG);
+    std::vector<std::vector<PointF>> off = {{{-8, -8}, {20, -8}, {-8, 20}}};
+    clipped.fill_polygon(off, INK);
+    REQUIRE(clipped.pixel(0, 0) == INK);
+    REQUIRE(clipped.pixel(6, 4) == INK);
+    REQUIRE(clipped.pixel(7, 7) == BG);
+}
+
+TEST_CASE("Draw lines of a width", "[map]") {
+    constexpr Rgb BG = {0, 0, 0};
+    constexpr Rgb INK = {9, 9, 9};
+    Canvas canvas(16, 16, BG);
+    std::vector<PointF> line = {{1.5F, 4.5F}, {12.5F, 4.5F}, {12.5F, 12.5F}};
+    canvas.draw_line(line, INK, 1);
+    REQUIRE(canvas.pixel(1, 4) == INK);
+    REQUIRE(canvas.pixel(7, 4) == INK);
+    REQUIRE(canvas.pixel(7, 5) == BG);
+    REQUIRE(canvas.pixel(12, 12) == INK);
+
+    canvas.draw_line(std::vector<PointF>{{0.5F, 8.5F}, {15.5F, 8.5F}}, INK, 2);
+    REQUIRE(canvas.pixel(3, 8) == INK);
+    REQUIRE(canvas.pixel(3, 9) == INK);
+    REQUIRE(canvas.pixel(3, 7) == BG);
+}
+
+TEST_CASE("Render the basemap layers", "[map]") {
+    MvtTile tile;
+    std::string error;
+    REQUIRE(decode_mvt(basemap_tile(), tile, error));
+    Canvas canvas(128, 128, {15, 20, 35});
+    render_basemap(tile, canvas);
+
+    constexpr Rgb BG = {15, 20, 35};
+    REQUIRE(canvas.pixel(4, 100) == Rgb{42, 54, 76}); // water
+    REQUIRE(canvas.pixel(24, 24) == BG);              // the island
+    REQUIRE(canvas.pixel(84, 20) == BG);              // landuse is not drawn
+    REQUIRE(canvas.pixel(96, 100) == Rgb{255, 255, 255});
+    REQUIRE(canvas.pixel(84, 64) == Rgb{153, 153, 153});
+    REQUIRE(canvas.pixel(112, 100) == BG); // maritime
+}
+
+TEST_CASE("Rasterize a tile grid on several threads", "[map]") {
+    auto dir = std::filesystem::temp_directory_path() / "epsp_mvt_grid";
+    std::filesystem::remove_all(dir);
+    MvtGrid grid{.dir = dir,
+                 .zoom = 3,
+                 .x_min = 4,
+                 .x_max = 6,
+                 .y_min = 2,
+                 .y_max = 3,
+                 .tile_px = 128};
+    for (uint32_t x = grid.x_min; x <= grid.x_max; x++) {
+        for (uint32_t y = grid.y_min; y <= grid.y_max; y++) {
+            // One tile missing; it stays background.
+            if (x == 5 && y == 3) {
+                continue;
+            }
+            write_file(dir / "3" / std::to_string(x) /
+                           (std::to_string(y) + ".pbf"),
+                       gzip(basemap_tile(static_cast<int32_t>(x + y))));
+        }
+    }
+
+    std::atomic<bool> cancel{false};
+    std::string error;
+    TilePyramid serial(grid.width(), grid.height(), 64);
+    REQUIRE(build_pyramid(grid, 1, serial, cancel, error));
+    TilePyramid parallel(grid.width(), grid.height(), 64);
+    REQUIRE(build_pyramid(grid, 4, parallel, cancel, error));
+    REQUIRE(same_tiles(serial, parallel));
+
+    TileImage image;
+    REQUIRE(serial.decode({.level = 0, .x = 0, .y = 0}, image));
+    REQUIRE(image.rgb[(50 * 64 + 4) * 3] == 42); // water
+    REQUIRE(serial.decode({.level = 0, .x = 2, .y = 2}, image));
+    REQUIRE(std::ranges::all_of(image.rgb, [](uint8_t v) -> bool {
+        return v == 15 || v == 20 || v == 35;
+    }));
+
+    write_file(dir / "3/4/2.pbf", std::vector<uint8_t>{0x1F, 0x8B, 0});
+    TilePyramid broken(grid.width(), grid.height(), 64);
+    REQUIRE_FALSE(build_pyramid(grid, 4, broken, cancel, error));
+    REQUIRE(error.find("2.pbf") != std::string::npos);
+    std::filesystem::remove_all(dir);
+}
+
+TEST_CASE("Round-trip a tile pack", "[map]") {
+    TilePyramid pyramid(700, 300, 128);
+    std::atomic<bool> cancel{false};
+    REQUIRE(build_pyramid(pattern_rows(700), pyramid, cancel));
+
+    auto path = std::filesystem::temp_directory_path() / "epsp_test.pack";
+    std::string error;
+    REQUIRE(write_tile_pack(pyramid, path, error));
+    auto pack = TilePack::open(path, error);
+    REQUIRE(pack != nullptr);
+    REQUIRE(pack->levels() == pyramid.levels());
+    REQUIRE(pack->width(2) == pyramid.width(2));
+    REQUIRE(pack->compressed_bytes() == pyramid.compressed_bytes());
+    REQUIRE(pack->ready({.level = 0, .x = 5, .y = 2}));
+    REQUIRE_FALSE(pack->ready({.level = 0, .x = 6, .y = 0}));
+    REQUIRE(same_tiles(pyramid, *pack));
+
+    // Rejects what is not a whole pack.
+    auto bytes = std::filesystem::file_size(path);
+    std::filesystem::resize_file(path, bytes / 2);
+    REQUIRE(TilePack::open(path, error) == nullptr);
+    write_file(path, std::vector<uint8_t>(64, 0));
+    REQUIRE(TilePack::open(path, error) == nullptr);
+    REQUIRE(error == "not a tile pack");
+    std::filesystem::remove(path);
+    REQUIRE(TilePack::open(path, error) == nullptr);
+}
+
+TEST_CASE("Benchmark the tile pack builder", "[!benchmark][map]") {
+    // No real vector tiles ship with the repo: a 6x6 grid of synthetic
+    // ones, each with a jagged 2000-point coast, an island and borders.
+    auto dir = std::filesystem::temp_directory_path() / "epsp_mvt_bench";
+    std::filesystem::remove_all(dir);
+    MvtGrid grid{.dir = dir,
+                 .zoom = 6,
+                 .x_min = 54,
+                 .x_max = 59,
+                 .y_min = 23,
+                 .y_max = 28,
+                 .tile_px = 1024};
+    for (uint32_t x = grid.x_min; x <= grid.x_max; x++) {
+        for (uint32_t y = grid.y_min; y <= grid.y_max; y++) {
+            std::vector<MvtPoint> coast;
+            for (int32_t i = 0; i <= 2000; i++) {
+                auto wave = static_cast<int32_t>((i * 7919 + x * y) % 200);
+                coast.push_back({i * 2, 2000 + wave});
+            }
+            coast.push_back({4000, 4096});
+            coast.push_back({0, 4096});
+            coast.push_back(coast.front());
+            Pb tile;
+            tile.bytes(3, layer("water", 4096,
+                                {{.type = MVT_POLYGON,
+                                  .parts = {coast,
+                                            square(800, 2600, 1400, 3200)},
+                                  .tags = {}}},
+                                {}, {}));
+            std::vector<MvtPoint> border;
+            for (int32_t i = 0; i < 400; i++) {
+                border.push_back({i * 10, 1000 + (i * 31) % 90});
+            }
+            tile.bytes(3, layer("boundary", 4096,
+                                {{.type = MVT_LINESTRING,
+                                  .parts = {border},
+                                  .tags = {0, 0}},
+                                 {.type = MVT_LINESTRING,
+                                  .parts = {{{2000, 0}, {2100, 4096}}},
+                                  .tags = {0, 1}}},
+                                {"admin_level"}, {2, 4}));
+            write_file(dir / "6" / std::to_string(x) /
+                           (std::to_string(y) + ".pbf"),
+                       gzip(tile.out));
+        }
+    }
+
+    std::atomic<bool> cancel{false};
+    auto threads = std::max(std::thread::hardware_concurrency(), 1U);
+    BENCHMARK("6144px pack from vector tiles, 1 thread") {
+        TilePyramid pyramid(grid.width(), grid.height());
+        std::string error;
+        return build_pyramid(grid, 1, pyramid, cancel, error);
+    };
+    BENCHMARK("6144px pack from vector tiles, all threads") {
+        TilePyramid pyramid(grid.width(), grid.height());
+        std::string error;
+        return build_pyramid(grid, threads, pyramid, cancel, error);
+    };
+    std::filesystem::remove_all(dir);
+
+    // What the client's PNG pipeline does for the same image size.
+    auto png = get_executable_dir() / "assets" / "japan_z6.png";
+    if (!std::filesystem::exists(png)) {
+        WARN("no map asset next to the test binary");
+        return;
+    }
+    BENCHMARK("6144px pack from the PNG") {
+        std::string error;
+        auto rows = PngRows::open(png, error);
+        TilePyramid pyramid(rows->width(), rows->height());
+        return build_pyramid(*rows, pyramid, cancel);
+    };
+}
@@ -0,0 +1,136 @@
+#include "../src/comms/timer_wheel.h"
+#include <catch2/catch_test_macros.hpp>
+
+namespace {
+using std::chrono::milliseconds;
+const auto start = TimerWheel::clock::time_point{} + std::chrono::hours(1);
+
+auto key(uint32_t owner, epsp_timer_kind_t kind) -> TimerKey {
+    return {.owner = owner, .kind = kind};
+}
+} // namespace
+
+TEST_CASE("Expire timers on their tick", "[comms][timer]") {
+    TimerWheel wheel(milliseconds(100), start);
+    std::vector<TimerKey> expired;
+
+    wheel.schedule(key(1, epsp_timer_kind_t::TIMER_PEER_ECHO),
+                   milliseconds(250));
+    wheel.schedule(key(2, epsp_timer_kind_t::TIMER_PEER_IDLE),
+                   milliseconds(100));
+
+    wheel.advance(start + milliseconds(100), expired);
+    REQUIRE(expired.size() == 1);
+    REQUIRE(expired[0].owner == 2);
+
+    expired.clear();
+    wheel.advance(start + milliseconds(200), expired);
+    REQUIRE(expired.empty());
+
+    wheel.advance(start + milliseconds(300), expired);
+    REQUIRE(expired.size() == 1);
+    REQUIRE(expired[0] == key(1, epsp_timer_kind_t::TIMER_PEER_ECHO));
+    REQUIRE(wheel.size() == 0);
+}
+
+TEST_CASE("Reschedule and cancel timers", "[comms][timer]") {
+    TimerWheel wheel(milliseconds(100), start);
+    std::vector<TimerKey> expired;
+
+    wheel.schedule(key(1, epsp_timer_kind_t::TIMER_PEER_IDLE),
+                   milliseconds(100));
+    wheel.schedule(key(1, epsp_timer_kind_t::TIMER_PEER_IDLE),
+                   milliseconds(500));
+    wheel.schedule(key(1, epsp_timer_kind_t::TIMER_PEER_ECHO),
+                   milliseconds(100));
+    wheel.schedule(key(2, epsp_timer_kind_t::TIMER_PEER_ECHO),
+                   milliseconds(100));
+    REQUIRE(wheel.size() == 3);
+
+    wheel.cancel(key(2, epsp_timer_kind_t::TIMER_PEER_ECHO));
+    wheel.advance(start + milliseconds(400), expired);
+    REQUIRE(expired.size() == 1);
+    REQUIRE(expired[0] == key(1, epsp_timer_kind_t::TIMER_PEER_ECHO));
+
+    wheel.cancel_owner(1);
+    expired.clear();
+    wheel.advance(start + milliseconds(1000), expired);
+    REQUIRE(expired.empty());
+    REQUIRE(wheel.size() == 0);
+}
+
+TEST_CASE("Cascade long timers", "[comms][timer]") {
+    TimerWheel wheel(milliseconds(10), start);
+    std::vector<TimerKey> expired;
+
+    // 256 inner slots x 10 ms = 2.56 s; 64 outer slots = ~164 s.
+    wheel.schedule(key(1, epsp_timer_kind_t::TIMER_SERVER_ECHO),
+                   milliseconds(10'000));
+    wheel.schedule(key(2, epsp_timer_kind_t::TIMER_SERVER_ECHO),
+                   milliseconds(600'000));
+
+    wheel.advance(start + milliseconds(9'990), expired);
+    REQUIRE(expired.empty());
+    wheel.advance(start + milliseconds(10'000), expired);
+    REQUIRE(expired.size() == 1);
+    REQUIRE(expired[0].owner == 1);
+
+    expired.clear();
+    wheel.advance(start + milliseconds(599'990), expired);
+    REQUIRE(expired.empty());
+    wheel.advance(start + milliseconds(600'000), expired);
+    REQUIRE(expired.size() == 1);
+    REQUIRE(expired[0].owner == 2);
+}
+
+TEST_CASE("Drive echo and idle timers for thousands of peers",
+          "[comms][timer]") {
+    constexpr uint32_t peers = 5000;
+    TimerWheel wheel(milliseconds(100), start);
+    std::vector<TimerKey> expired;
+    std::vector<int> echoes(peers, 0);
+    std::vector<bool> evicted(peers, false);
+    std::vector<TimerWheel::clock::time_point> last_seen(peers, start);
+
+    for (uint32_t pid = 0; pid < peers; pid++) {
+        wheel.schedule(key(pid, epsp_timer_kind_t::TIMER_PEER_ECHO),
+                       milliseconds(1000 + (pid % 10) * 10));
+        wheel.schedule(key(pid, epsp_timer_kind_t::TIMER_PEER_IDLE),
+                       milliseconds(3000));
+    }
+
+    for (auto now = start; now <= start + milliseconds(10'000);
+         now += milliseconds(100)) {
+        expired.clear();
+        wheel.advance(now, expired);
+        for (auto timer : expired) {
+            auto pid = timer.owner;
+            if (timer.kind == epsp_timer_kind_t::TIMER_PEER_ECHO) {
+                echoes[pid]++;
+                // Even peers answer the echo, odd peers are dead.
+                if (pid % 2 == 0) {
+                    last_seen[pid] = now;
+                }
+                wheel.schedule(timer, milliseconds(1000));
+            } else if (now - last_seen[pid] >= milliseconds(3000)) {
+                evicted[pid] = true;
+                wheel.cancel_owner(pid);
+            } else {
+                auto idle = std::chrono::duration_cast<milliseconds>(
+                    now - last_seen[pid]);
+                wheel.schedule(timer, milliseconds(3000) - idle);
+            }
+        }
+    }
+
+    for (uint32_t pid = 0; pid < peers; pid++) {
+        if (pid % 2 == 0) {
+            REQUIRE_FALSE(evicted[pid]);
+            REQUIRE(echoes[pid] >= 9);
+        } else {
+            REQUIRE(evicted[pid]);
+            REQUIRE(echoes[pid] == 2);
+        }
+    }
+    REQUIRE(wheel.size() == peers);
+}
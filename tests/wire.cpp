@@ -0,0 +1,119 @@
+#include "../src/comms/wire.h"
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+TEST_CASE("Parse wire line with payload", "[comms][wire]") {
+    auto record = parse_wire_line("551 3 2011:6911\r");
+
+    REQUIRE(record.has_value());
+    REQUIRE(record->code == 551);
+    REQUIRE(record->hop == 3);
+    REQUIRE(record->payload == "2011:6911");
+}
+
+TEST_CASE("Parse wire line without payload", "[comms][wire]") {
+    auto record = parse_wire_line("211 1\r");
+
+    REQUIRE(record.has_value());
+    REQUIRE(record->code == 211);
+    REQUIRE(record->hop == 1);
+    REQUIRE(record->payload.empty());
+}
+
+TEST_CASE("Parse wire line with multi-digit hop", "[comms][wire]") {
+    auto record = parse_wire_line("555 12 abc def");
+
+    REQUIRE(record.has_value());
+    REQUIRE(record->hop == 12);
+    REQUIRE(record->payload == "abc def");
+}
+
+TEST_CASE("Reject malformed wire lines", "[comms][wire]") {
+    REQUIRE(parse_wire_line("").error() ==
+            epsp_wire_error_t::WIRE_ERR_TOO_SHORT);
+    REQUIRE(parse_wire_line("21 1\r").error() ==
+            epsp_wire_error_t::WIRE_ERR_TOO_SHORT);
+    REQUIRE(parse_wire_line("2x1 1").error() ==
+            epsp_wire_error_t::WIRE_ERR_BAD_CODE);
+    REQUIRE(parse_wire_line("551 x data").error() ==
+            epsp_wire_error_t::WIRE_ERR_BAD_HOP);
+    REQUIRE(parse_wire_line("551 1x data").error() ==
+            epsp_wire_error_t::WIRE_ERR_BAD_HOP);
+    REQUIRE(parse_wire_line("551 999 data").error() ==
+            epsp_wire_error_t::WIRE_ERR_BAD_HOP);
+}
+
+namespace {
+// The substr/stoul parsing used before parse_wire_line, kept for comparison.
+struct LegacyRecord {
+    uint16_t code;
+    uint8_t hop;
+    std::string payload;
+};
+
+// Takes the line by reference and trims it in place, as the old handlers
+// did with their read buffer.
+auto parse_wire_line_legacy(std::string &line) -> LegacyRecord {
+    if (line.back() == '\r') {
+        line.pop_back();
+    }
+    LegacyRecord record{};
+    record.code = std::stoul(line.substr(0, 3));
+    size_t pos = line.find(' ', 4);
+    record.hop = std::stoul(line.substr(4, pos - 4));
+    if (line.size() > 6) {
+        record.payload = line.substr(6);
+    }
+    return record;
+}
+
+auto make_flood_lines() -> std::vector<std::string> {
+    std::vector<std::string> lines;
+    lines.reserve(1024);
+    for (int i = 0; i < 1024; i++) {
+        switch (i % 3) {
+        case 0:
+            lines.emplace_back("551 " + std::to_string(i % 9 + 1) +
+                               " 5:2026/10/17 07:31:09:7:01:2,0:" +
+                               std::to_string(i) + "\r");
+            break;
+        case 1:
+            lines.emplace_back("555 " + std::to_string(i % 9 + 1) +
+                               " 0:2026/10/17 07:31:09:" + std::to_string(i) +
+                               ",355\r");
+            break;
+        default:
+            lines.emplace_back("556 " + std::to_string(i % 9 + 1) + " " +
+                               std::to_string(i) + ":0:1:8:3\r");
+            break;
+        }
+    }
+    return lines;
+}
+} // namespace
+
+// Each iteration parses 1024 lines; messages/sec = 1024 / mean.
+TEST_CASE("Benchmark wire parsing", "[comms][wire][!benchmark]") {
+    auto lines = make_flood_lines();
+    // The legacy parser strips the '\r' in place; its own copy keeps the
+    // lines the other benchmark sees intact.
+    auto legacy_lines = lines;
+
+    BENCHMARK("legacy substr/stoul x1024") {
+        size_t sum = 0;
+        for (auto &line : legacy_lines) {
+            auto record = parse_wire_line_legacy(line);
+            sum += record.code + record.hop + record.payload.size();
+        }
+        return sum;
+    };
+
+    BENCHMARK("parse_wire_line x1024") {
+        size_t sum = 0;
+        for (const auto &line : lines) {
+            auto record = parse_wire_line(line);
+            sum += record->code + record->hop + record->payload.size();
+        }
+        return sum;
+    };
+}
@@ -0,0 +1,34 @@
+#include "../src/comms/write_signal.h"
+#include "asio.hpp"
+#include <asio/co_spawn.hpp>
+#include <asio/detached.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+TEST_CASE("Wake a parked writer", "[comms][write_signal]") {
+    asio::io_context io_context;
+    WriteSignal signal(io_context.get_executor());
+    int wakes = 0;
+
+    asio::co_spawn(
+        io_context,
+        [&signal, &wakes] -> asio::awaitable<void> {
+            while (!signal.closed()) {
+                co_await signal.wait();
+                wakes++;
+            }
+        },
+        asio::detached);
+
+    io_context.poll();
+    REQUIRE(wakes == 0);
+    signal.notify();
+    io_context.poll();
+    REQUIRE(wakes == 1);
+
+    signal.close();
+    io_context.run();
+    REQUIRE(wakes == 2);
+    REQUIRE(signal.closed());
+    signal.reset();
+    REQUIRE_FALSE(signal.closed());
+}